@@ -168,6 +168,16 @@ void CropMaskTrainImagesClassifier::DoInit()
   SetParameterDescription("sample.vfn", "Name of the field used to discriminate class labels in the input vector data files.");
   SetParameterString("sample.vfn", "Class");
 
+  AddParameter(ParameterType_String, "sample.idx", "Sample index file prefix");
+  SetParameterDescription("sample.idx", "Prefix of the files keeping the pixels inside the polygons of the input vector data for each tile, "
+                                        "reused by the next trainings on the same tiles and polygons.");
+  MandatoryOff("sample.idx");
+
+  AddParameter(ParameterType_String, "sample.spill", "Sample file prefix");
+  SetParameterDescription("sample.spill", "Prefix of the memory-mapped files keeping the training and validation samples "
+                                          "instead of the memory, removed when the training ends.");
+  MandatoryOff("sample.spill");
+
   AddParameter(ParameterType_Choice, "classifier", "Classifier to use for the training");
   SetParameterDescription("classifier", "Choice of the classifier to use for the training.");
 
@@ -397,7 +407,9 @@ void CropMaskTrainImagesClassifier::DoExecute()
       "io.confmatout",
       "io.out",
       "io.rs",
-      "sample.vfn"
+      "sample.vfn",
+      "sample.idx",
+      "sample.spill"
   };
 
 
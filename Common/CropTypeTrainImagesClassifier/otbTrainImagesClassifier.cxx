@@ -75,6 +75,7 @@ void CropTypeTrainImagesClassifier::DoInit()
   MandatoryOff("io.confmatout");
   AddParameter(ParameterType_OutputFilename, "io.out", "Output model");
   SetParameterDescription("io.out", "Output file containing the model estimated (.txt format).");
+  MandatoryOff("io.out");
 
   //LBU
   // Add the possibility to use a raster to describe the training samples.
@@ -159,6 +160,31 @@ void CropTypeTrainImagesClassifier::DoInit()
   SetParameterDescription("sample.vfn", "Name of the field used to discriminate class labels in the input vector data files.");
   SetParameterString("sample.vfn", "Class");
 
+  AddParameter(ParameterType_String, "sample.idx", "Sample index file prefix");
+  SetParameterDescription("sample.idx", "Prefix of the files keeping the pixels inside the polygons of the input vector data for each tile, "
+                                        "reused by the next trainings on the same tiles and polygons.");
+  MandatoryOff("sample.idx");
+
+  AddParameter(ParameterType_String, "sample.spill", "Sample file prefix");
+  SetParameterDescription("sample.spill", "Prefix of the memory-mapped files keeping the training and validation samples "
+                                          "instead of the memory, removed when the training ends.");
+  MandatoryOff("sample.spill");
+
+  AddParameter(ParameterType_Group, "strata", "Strata");
+  SetParameterDescription("strata", "Trains a model for each stratum, reading the input tiles once for all of them.");
+  AddParameter(ParameterType_InputFilenameList, "strata.vd", "Vector data of the strata");
+  SetParameterDescription("strata.vd", "The training vector data of each stratum, used instead of io.vd.");
+  MandatoryOff("strata.vd");
+  AddParameter(ParameterType_StringList, "strata.out", "Output models");
+  SetParameterDescription("strata.out", "The output model of each stratum, used instead of io.out.");
+  MandatoryOff("strata.out");
+  AddParameter(ParameterType_StringList, "strata.confmatout", "Output confusion matrices");
+  SetParameterDescription("strata.confmatout", "The output confusion matrix of each stratum (.csv format).");
+  MandatoryOff("strata.confmatout");
+  AddParameter(ParameterType_Int, "strata.threads", "Number of models trained at a time");
+  SetParameterDescription("strata.threads", "The maximum number of models trained concurrently.");
+  MandatoryOff("strata.threads");
+
   AddParameter(ParameterType_Choice, "classifier", "Classifier to use for the training");
   SetParameterDescription("classifier", "Choice of the classifier to use for the training.");
 
@@ -361,7 +387,8 @@ void CropTypeTrainImagesClassifier::DoExecute()
       "rand",
       "sample.bm",
       "sample.mt",
-      "sample.mv"
+      "sample.mv",
+      "strata.threads"
   };
   std::string stringParams[] = {
       "classifier.ann.f",
@@ -378,7 +405,9 @@ void CropTypeTrainImagesClassifier::DoExecute()
       "io.confmatout",
       "io.out",
       "io.rs",
-      "sample.vfn"
+      "sample.vfn",
+      "sample.idx",
+      "sample.spill"
   };
 
   for (const auto &key : booleanParams) {
@@ -414,6 +443,14 @@ void CropTypeTrainImagesClassifier::DoExecute()
       app->SetParameterString("io.vd", GetParameterString("io.vd"));
   }
 
+  // the strata are trained on the same tiles, the output days are written once for all the models
+  for (const auto &key : {"strata.vd", "strata.out", "strata.confmatout"}) {
+      if (HasValue(key)) {
+          app->EnableParameter(key);
+          app->SetParameterStringList(key, GetParameterStringList(key));
+      }
+  }
+
   if (HasValue("imstat")) {
     app->EnableParameter("io.imstat");
     app->SetParameterString("io.imstat", GetParameterString("imstat"));
@@ -16,6 +16,7 @@
 #pragma once
 
 #include "otbVectorImage.h"
+#include "otbVectorFunctorImageFilter.h"
 
 typedef float                                PixelValueType;
 typedef otb::VectorImage<PixelValueType, 2>  ImageType;
@@ -27,13 +28,10 @@ class ComputeNDVIFunctor
 {
 public:
 
-    PixelType operator()(const PixelType &pixel) const
+    void operator()(const PixelType &pixel, PixelType &result) const
     {
         int numImages = pixel.Size() / 2;
 
-        // Create the output pixel
-        PixelType result(numImages);
-
         for (int imgIndex = 0; imgIndex < numImages; imgIndex++) {
             PixelValueType red = pixel[2 * imgIndex];
             PixelValueType nir = pixel[2 * imgIndex + 1];
@@ -51,8 +49,6 @@ public:
                 result[imgIndex] = (std::abs(nir+red) < eps) ? 0 : static_cast<PixelValueType>(nir-red)/(nir+red);
             }
         }
-
-        return result;
     }
 
     bool operator!=(const ComputeNDVIFunctor a) const
@@ -68,12 +64,12 @@ public:
 
 template<class TImage>
 class ITK_EXPORT ComputeNDVIFilter
-        : public itk::UnaryFunctorImageFilter<TImage, TImage, ComputeNDVIFunctor<typename TImage::PixelType>>
+        : public otb::UnaryVectorFunctorImageFilter<TImage, TImage, ComputeNDVIFunctor<typename TImage::PixelType>>
 {
 public:
     /** Standard class typedefs. */
     typedef ComputeNDVIFilter                       Self;
-    typedef itk::UnaryFunctorImageFilter<TImage, TImage, ComputeNDVIFunctor<typename TImage::PixelType>> Superclass;
+    typedef otb::UnaryVectorFunctorImageFilter<TImage, TImage, ComputeNDVIFunctor<typename TImage::PixelType>> Superclass;
     typedef itk::SmartPointer<Self>                             Pointer;
     typedef itk::SmartPointer<const Self>                       ConstPointer;
 
@@ -81,7 +77,7 @@ public:
     itkNewMacro(Self);
 
     /** Run-time type information (and related methods). */
-    itkTypeMacro(ComputeNDVIFilter, UnaryFunctorImageFilter);
+    itkTypeMacro(ComputeNDVIFilter, UnaryVectorFunctorImageFilter);
 
     /** Template related typedefs */
     typedef TImage ImageType;
@@ -15,14 +15,202 @@
  
 #pragma once
 
-#include "itkUnaryFunctorImageFilter.h"
+#include "otbVectorFunctorImageFilter.h"
 #include "otbVectorImage.h"
 
+#include <algorithm>
+#include <vector>
+
 typedef float                                PixelValueType;
 typedef otb::VectorImage<PixelValueType, 2>  ImageType;
 
 #define NODATA -10000
 
+/** Returns the median of a series, the same value as after sorting it.
+ * The values are copied to the scratch buffer, which is reordered. */
+inline PixelValueType SeriesMedian(const PixelValueType *values, int n, PixelValueType *scratch)
+{
+    std::copy(values, values + n, scratch);
+    PixelValueType *middle = scratch + n / 2;
+    std::nth_element(scratch, middle, scratch + n);
+    if (n % 2 == 1) {
+        return *middle;
+    }
+    // the lower middle value is the largest one of the lower half
+    return (*std::max_element(scratch, middle) + *middle) / 2;
+}
+
+/** Sum of a window of W values, unrolled by the compiler. The window kernels below
+ * are compiled for the usual window sizes (1 to 4) and sum each window directly,
+ * in the same order as the original loops, so they give the same values. The
+ * other sizes move the sums along the series, in O(n) instead of O(n*W). */
+template <int W>
+inline double WindowSum(const PixelValueType *values)
+{
+    double sum = 0.0;
+    for (int j = 0; j < W; j++) {
+        sum += values[j];
+    }
+    return sum;
+}
+
+/** Runtime window size */
+inline double WindowSum(const PixelValueType *values, int w)
+{
+    double sum = 0.0;
+    for (int j = 0; j < w; j++) {
+        sum += values[j];
+    }
+    return sum;
+}
+
+/** The largest and the smallest difference between the averages of two consecutive
+ * windows of W values. The series has at least 2 * W values. */
+template <int W>
+inline void WindowAverageDifferences(const PixelValueType *values, int n, PixelValueType &maxDif, PixelValueType &minDif)
+{
+    for (int i = 0; i <= n - 2 * W; i++) {
+        double first = WindowSum<W>(values + i) / W;
+        double second = WindowSum<W>(values + i + W) / W;
+
+        PixelValueType dif = static_cast<PixelValueType>(first - second);
+        maxDif = (i == 0 || maxDif < dif ? dif : maxDif);
+        minDif = (i == 0 || minDif > dif ? dif : minDif);
+    }
+}
+
+inline void WindowAverageDifferences(const PixelValueType *values, int n, int w, PixelValueType &maxDif, PixelValueType &minDif)
+{
+    switch (w) {
+    case 1:
+        return WindowAverageDifferences<1>(values, n, maxDif, minDif);
+    case 2:
+        return WindowAverageDifferences<2>(values, n, maxDif, minDif);
+    case 3:
+        return WindowAverageDifferences<3>(values, n, maxDif, minDif);
+    case 4:
+        return WindowAverageDifferences<4>(values, n, maxDif, minDif);
+    }
+
+    double firstSum = WindowSum(values, w);
+    double secondSum = WindowSum(values + w, w);
+    for (int i = 0; i <= n - 2 * w; i++) {
+        if (i > 0) {
+            firstSum = firstSum + values[i - 1 + w] - values[i - 1];
+            secondSum = secondSum + values[i - 1 + 2 * w] - values[i - 1 + w];
+        }
+        double first = firstSum / w;
+        double second = secondSum / w;
+
+        PixelValueType dif = static_cast<PixelValueType>(first - second);
+        maxDif = (i == 0 || maxDif < dif ? dif : maxDif);
+        minDif = (i == 0 || minDif > dif ? dif : minDif);
+    }
+}
+
+/** The first window of W values whose average is the largest one above maxAvg.
+ * Returns false, leaving maxAvg and start unchanged, when there is none. */
+template <int W>
+inline bool MaxWindowAverage(const PixelValueType *values, int n, PixelValueType &maxAvg, int &start)
+{
+    bool found = false;
+    for (int i = 0; i <= n - W; i++) {
+        PixelValueType avgPix = static_cast<PixelValueType>(WindowSum<W>(values + i) / W);
+        if (avgPix > maxAvg) {
+            maxAvg = avgPix;
+            start = i;
+            found = true;
+        }
+    }
+    return found;
+}
+
+inline bool MaxWindowAverage(const PixelValueType *values, int n, int w, PixelValueType &maxAvg, int &start)
+{
+    switch (w) {
+    case 1:
+        return MaxWindowAverage<1>(values, n, maxAvg, start);
+    case 2:
+        return MaxWindowAverage<2>(values, n, maxAvg, start);
+    case 3:
+        return MaxWindowAverage<3>(values, n, maxAvg, start);
+    case 4:
+        return MaxWindowAverage<4>(values, n, maxAvg, start);
+    }
+
+    bool found = false;
+    double sum = WindowSum(values, w);
+    for (int i = 0; i <= n - w; i++) {
+        if (i > 0) {
+            sum = sum + values[i - 1 + w] - values[i - 1];
+        }
+        PixelValueType avgPix = static_cast<PixelValueType>(sum / w);
+        if (avgPix > maxAvg) {
+            maxAvg = avgPix;
+            start = i;
+            found = true;
+        }
+    }
+    return found;
+}
+
+/** The largest average of the windows of 2 * W + 1 values centered on the dates,
+ * truncated at the ends of the series */
+template <int W>
+inline double MaxCenteredWindowAverage(const PixelValueType *values, int n)
+{
+    double meanMax = 0;
+    for (int i = 0; i < n; i++) {
+        int startIndex = std::max(0, i - W);
+        int endIndex = std::min(n - 1, i + W);
+        int count = endIndex - startIndex + 1;
+
+        double sum = count == 2 * W + 1 ? WindowSum<2 * W + 1>(values + startIndex)
+                                        : WindowSum(values + startIndex, count);
+        double mean = sum / count;
+        if (i == 0 || mean > meanMax) {
+            meanMax = mean;
+        }
+    }
+    return meanMax;
+}
+
+inline double MaxCenteredWindowAverage(const PixelValueType *values, int n, int w)
+{
+    switch (w) {
+    case 1:
+        return MaxCenteredWindowAverage<1>(values, n);
+    case 2:
+        return MaxCenteredWindowAverage<2>(values, n);
+    case 3:
+        return MaxCenteredWindowAverage<3>(values, n);
+    case 4:
+        return MaxCenteredWindowAverage<4>(values, n);
+    }
+
+    double meanMax = 0;
+    double sum = WindowSum(values, std::min(n, w + 1));
+    for (int i = 0; i < n; i++) {
+        int startIndex = std::max(0, i - w);
+        int endIndex = std::min(n - 1, i + w);
+        int count = endIndex - startIndex + 1;
+
+        if (i > 0) {
+            if (i + w < n) {
+                sum += values[i + w];
+            }
+            if (i - w - 1 >= 0) {
+                sum -= values[i - w - 1];
+            }
+        }
+        double mean = sum / count;
+        if (i == 0 || mean > meanMax) {
+            meanMax = mean;
+        }
+    }
+    return meanMax;
+}
+
 template <typename PixelType>
 class CropMaskFeaturesSupervisedFunctor
 {
@@ -31,20 +219,17 @@ public:
   CropMaskFeaturesSupervisedFunctor() : m_W(2), m_Delta(0.05), id(0), m_TSoil(0.2) {}
   CropMaskFeaturesSupervisedFunctor(int m_W, PixelValueType m_Delta, std::vector<int> id, PixelValueType m_TSoil) : m_W(m_W), m_Delta(m_Delta), id(std::move(id)), m_TSoil(m_TSoil) {}
 
-  PixelType operator()(const PixelType &pixel) const
+  void operator()(const PixelType &pixel, PixelType &result) const
   {
       int numImages = pixel.Size() / 4;
 
       // The output pixel contains 17 bands built from the ndvi series, 5 bands built from ndwi series and 5 bands built from brightness series
-      // Create the output pixel
-      PixelType result(27);
 
-      itk::VariableLengthVector<PixelValueType> tmp(numImages * 5);
-      PixelValueType *ndvi = &tmp[0];
-      PixelValueType *ndwi = &tmp[numImages];
-      PixelValueType *brightness = &tmp[numImages * 2];
-      PixelValueType *valuesNDWI = &tmp[numImages * 3];
-      PixelValueType *valuesBrightness = &tmp[numImages * 4];
+      m_Series.resize(numImages * 4);
+      PixelValueType *ndvi = &m_Series[0];
+      PixelValueType *ndwi = &m_Series[numImages];
+      PixelValueType *brightness = &m_Series[numImages * 2];
+      PixelValueType *scratch = &m_Series[numImages * 3];
 
       auto ok = false;
       for (int imgIndex = 0; imgIndex < numImages; imgIndex++) {
@@ -68,7 +253,7 @@ public:
 
       if (!ok) {
         result.Fill(static_cast<PixelValueType>(NODATA));
-        return result;
+        return;
       }
 
 
@@ -93,12 +278,10 @@ public:
         result[17]  = (result[17]  < ndwi[i] ? ndwi[i] : result[17] );
         result[18]  = (result[18]  > ndwi[i] ? ndwi[i] : result[18] );
         avgNDWI += ndwi[i];
-        valuesNDWI[i] = ndwi[i];
 
         result[22]  = (result[22]  < brightness[i] ? brightness[i] : result[22] );
         result[23]  = (result[23]  > brightness[i] ? brightness[i] : result[23] );
         avgBrightness += brightness[i];
-        valuesBrightness[i] = brightness[i];
     }
     avgNDVI /= numImages;
     avgNDWI /= numImages;
@@ -108,15 +291,8 @@ public:
     result[24] = static_cast<PixelValueType>(avgBrightness);
 
     // Compute the median for ndwi and brightness
-    std::sort(valuesNDWI, valuesNDWI + numImages);
-    std::sort(valuesBrightness, valuesBrightness + numImages);
-    if (numImages % 2 == 1) {
-        result[20] = valuesNDWI[numImages / 2];
-        result[25] = valuesBrightness[numImages / 2];
-    } else {
-        result[20] = (valuesNDWI[numImages / 2 - 1] + valuesNDWI[numImages / 2]) / 2;
-        result[25] = (valuesBrightness[numImages / 2 - 1] + valuesBrightness[numImages / 2]) / 2;
-    }
+    result[20] = SeriesMedian(ndwi, numImages, scratch);
+    result[25] = SeriesMedian(brightness, numImages, scratch);
 
     //Comput the square for the avegare values (used for standard deviation)
     double avgNDVI2 = avgNDVI*avgNDVI;
@@ -146,25 +322,8 @@ public:
     result[4] = static_cast<PixelValueType>(0);
     result[5] = static_cast<PixelValueType>(0);
     if (numImages >= 2 * m_W) {
-        for (int i = 0; i <= numImages - 2 * m_W; i++ ) {
-            // compute the average of the first part
-            double first = 0.0;
-            for (int j = i; j <= i + m_W - 1; j++ ) {
-                first += ndvi[j];
-            }
-            first = first / m_W;
-            // compute the average of the second part
-            double second = 0.0;
-            for (int j = i + m_W; j <= i + 2 * m_W - 1; j++ ) {
-                second += ndvi[j];
-            }
-            second = second / m_W;
-
-            PixelValueType dif = static_cast<PixelValueType>(first - second);
-            // update the max and min
-            result[3] = (i == 0 || result[3] < dif ? dif : result[3]);
-            result[4] = (i == 0 || result[4] > dif ? dif : result[4]);
-        }
+        // the max and min differences of the averages of the two parts
+        WindowAverageDifferences(ndvi, numImages, m_W, result[3], result[4]);
         // compute the difference
         result[5] = result[3] - result[4];
     }
@@ -175,21 +334,9 @@ public:
     result[8] = static_cast<PixelValueType>(0);
     if (numImages >= m_W) {
         int minIndex = 0, maxIndex = 0;
-        for (int i = 0; i <= numImages - m_W; i++) {
-            // Compute the slice average
-            double avg = 0.0;
-            for (int j = i; j <= i + m_W - 1; j++ ) {
-                avg += ndvi[j];
-            }
-            avg = avg / m_W;
-
-            PixelValueType avgPix = static_cast<PixelValueType>(avg);
-            // save the maximum average
-            if (avgPix > result[6]) {
-                result[6] = avgPix;
-                minIndex = i;
-                maxIndex = i + m_W - 1;
-            }
+        // save the maximum slice average
+        if (MaxWindowAverage(ndvi, numImages, m_W, result[6], minIndex)) {
+            maxIndex = minIndex + m_W - 1;
         }
 
         // compute the interval
@@ -314,8 +461,6 @@ public:
             result[16] = static_cast<PixelValueType>(1);
         }
     }
-
-    return result;
   }
 
   bool operator!=(const CropMaskFeaturesSupervisedFunctor a) const
@@ -338,6 +483,10 @@ public:
   // the threshhold for the soil
   PixelValueType m_TSoil;
 
+private:
+  // the ndvi, ndwi and brightness series and the median scratch buffer,
+  // reused for all the pixels of a thread
+  mutable std::vector<PixelValueType> m_Series;
 };
 
 template <typename PixelType>
@@ -348,21 +497,17 @@ public:
   CropMaskFeaturesSupervisedBMFunctor() : m_W(2), m_Delta(0.05), id(0), m_TSoil(0.2) {}
   CropMaskFeaturesSupervisedBMFunctor(int m_W, PixelValueType m_Delta, std::vector<int> id, PixelValueType m_TSoil) : m_W(m_W), m_Delta(m_Delta), id(std::move(id)), m_TSoil(m_TSoil) {}
 
-  PixelType operator()(const PixelType &pixel) const
+  void operator()(const PixelType &pixel, PixelType &result) const
   {
       int numImages = pixel.Size() / 4;
 
       // The output pixel contains 17 bands built from the ndvi series, 5 bands built from ndwi series and 5 bands built from brightness series
-      // Create the output pixel
-      PixelType result(26);
 
-      itk::VariableLengthVector<PixelValueType> tmp(numImages * 6);
-      PixelValueType *ndvi = &tmp[0];
-      PixelValueType *ndwi = &tmp[numImages];
-      PixelValueType *brightness = &tmp[numImages * 2];
-      PixelValueType *valuesNDVI = &tmp[numImages * 3];
-      PixelValueType *valuesNDWI = &tmp[numImages * 4];
-      PixelValueType *valuesBrightness = &tmp[numImages * 5];
+      m_Series.resize(numImages * 4);
+      PixelValueType *ndvi = &m_Series[0];
+      PixelValueType *ndwi = &m_Series[numImages];
+      PixelValueType *brightness = &m_Series[numImages * 2];
+      PixelValueType *scratch = &m_Series[numImages * 3];
 
       auto ok = false;
       for (int imgIndex = 0; imgIndex < numImages; imgIndex++) {
@@ -386,7 +531,7 @@ public:
 
       if (!ok) {
         result.Fill(static_cast<PixelValueType>(NODATA));
-        return result;
+        return;
       }
 
     // Compute the mean values for ndvi and the maximum, minimum and mean for ndwi and brightness
@@ -405,17 +550,14 @@ public:
 
     for (int i = 0; i < numImages; i++) {
         avgNDVI += ndvi[i];
-        valuesNDVI[i] = ndvi[i];
 
         result[16]  = (result[16]  < ndwi[i] ? ndwi[i] : result[16] );
         result[17]  = (result[17]  > ndwi[i] ? ndwi[i] : result[17] );
         avgNDWI += ndwi[i];
-        valuesNDWI[i] = ndwi[i];
 
         result[21]  = (result[21]  < brightness[i] ? brightness[i] : result[21] );
         result[22]  = (result[22]  > brightness[i] ? brightness[i] : result[22] );
         avgBrightness += brightness[i];
-        valuesBrightness[i] = brightness[i];
     }
     avgNDVI /= numImages;
     avgNDWI /= numImages;
@@ -425,18 +567,9 @@ public:
     result[23] = static_cast<PixelValueType>(avgBrightness);
 
     // Compute the median for ndvi, ndwi and brightness
-    std::sort(valuesNDVI, valuesNDVI + numImages);
-    std::sort(valuesNDWI, valuesNDWI + numImages);
-    std::sort(valuesBrightness, valuesBrightness + numImages);
-    if (numImages % 2 == 1) {
-        result[2]  = valuesNDVI[numImages / 2];
-        result[20] = valuesNDWI[numImages / 2];
-        result[25] = valuesBrightness[numImages / 2];
-    } else {
-        result[2]  = (valuesNDVI[numImages / 2 - 1] + valuesNDVI[numImages / 2]) / 2;
-        result[20] = (valuesNDWI[numImages / 2 - 1] + valuesNDWI[numImages / 2]) / 2;
-        result[25] = (valuesBrightness[numImages / 2 - 1] + valuesBrightness[numImages / 2]) / 2;
-    }
+    result[2]  = SeriesMedian(ndvi, numImages, scratch);
+    result[20] = SeriesMedian(ndwi, numImages, scratch);
+    result[25] = SeriesMedian(brightness, numImages, scratch);
 
     //Comput the square for the average values (used for standard deviation)
     double avgNDVI2 = avgNDVI*avgNDVI;
@@ -471,30 +604,14 @@ public:
     double SurfacePositiveDerivative = 0.0;
     double SlopePositiveDerivative = 0.0;
 
-    double meanMax = 0;
+    // Compute the maximum for the local average
+    double meanMax = MaxCenteredWindowAverage(ndvi, numImages, m_W);
     result[4] = static_cast<PixelValueType>(0);
     result[5] = static_cast<PixelValueType>(0);
 
     result[12] = static_cast<PixelValueType>(0);
     result[13] = static_cast<PixelValueType>(0);
     for (int i = 0; i < numImages; i++) {
-        double meanMaxCurrent = 0.0;
-
-        // compute the start and end indices based on the window
-        int startIndex = std::max(0, i-m_W);
-        int endIndex = std::min(numImages-1, i+m_W);
-        int count = endIndex - startIndex + 1;
-
-        for (int j = startIndex; j <= endIndex; j++) {
-            meanMaxCurrent += ndvi[j];
-        }
-
-        // Compute the maximum for the local average
-        meanMaxCurrent /= count;
-        if (i == 0 || meanMaxCurrent > meanMax) {
-            meanMax = meanMaxCurrent;
-        }
-
         if (i == 1 || (i > 0 && result[4] < (ndvi[i] - ndvi[i-1]))) {
             result[4] = ndvi[i] - ndvi[i-1];
         }
@@ -604,8 +721,6 @@ public:
 
     result[14] = static_cast<PixelValueType>(MeanMaxLgth);
     result[15] = static_cast<PixelValueType>(MeanMaxSurface);
-
-    return result;
   }
 
   bool operator!=(const CropMaskFeaturesSupervisedBMFunctor a) const
@@ -630,17 +745,21 @@ public:
   // the threshhold for the soil
   PixelValueType m_TSoil;
 
+private:
+  // the ndvi, ndwi and brightness series and the median scratch buffer,
+  // reused for all the pixels of a thread
+  mutable std::vector<PixelValueType> m_Series;
 };
 
-/** Unary functor image filter which produces a vector image with a
+/** Unary vector functor image filter which produces a vector image with a
 * number of bands different from the input images */
 template <typename TFunctor>
 class ITK_EXPORT UnaryFunctorImageFilterWithNBands :
-    public itk::UnaryFunctorImageFilter< ImageType, ImageType, TFunctor >
+    public otb::UnaryVectorFunctorImageFilter< ImageType, ImageType, TFunctor >
 {
 public:
   typedef UnaryFunctorImageFilterWithNBands Self;
-  typedef itk::UnaryFunctorImageFilter< ImageType, ImageType, TFunctor > Superclass;
+  typedef otb::UnaryVectorFunctorImageFilter< ImageType, ImageType, TFunctor > Superclass;
   typedef itk::SmartPointer<Self>       Pointer;
   typedef itk::SmartPointer<const Self> ConstPointer;
 
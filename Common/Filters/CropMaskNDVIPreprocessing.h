@@ -156,13 +156,13 @@ public:
         m_MaskConcat->UpdateOutputInformation();
 
         // The number of image bands can be computed as the ratio between the bands in the image and
-        // the bands in the mask
+        // the dates in the mask
         int imageBands = m_BandsConcat->GetOutput()->GetNumberOfComponentsPerPixel() /
-                         m_MaskConcat->GetOutput()->GetNumberOfComponentsPerPixel();
+                         m_MaskConcat->GetNumberOfDates();
 
 
         m_TemporalMerger->SetNumberOfOutputBands(imageBands * od.size());
-        m_TemporalMerger->SetFunctor(TemporalMergingFunctor<ImageType::PixelType, MaskType::PixelType>(imgInfos, od.size(), imageBands));
+        m_TemporalMerger->SetFunctor(TemporalMergingFunctor<ImageType::PixelType, MaskType::PixelType>(imgInfos, imageBands));
 
         m_TemporalMerger->SetInput1(m_TemporalResampler->GetOutput());
         m_TemporalMerger->SetInput2(m_MaskConcat->GetOutput());
@@ -246,14 +246,13 @@ public:
         m_MaskConcat->UpdateOutputInformation();
 
         // The number of image bands can be computed as the ratio between the bands in the image and
-        // the bands in the mask
+        // the dates in the mask
         int imageBands = m_BandsConcat->GetOutput()->GetNumberOfComponentsPerPixel() /
-                         m_MaskConcat->GetOutput()->GetNumberOfComponentsPerPixel();
+                         m_MaskConcat->GetNumberOfDates();
 
         temporalMerger->SetNumberOfOutputBands(imageBands * od.size());
         temporalMerger->SetFunctor(
-            TemporalMergingFunctor<ImageType::PixelType, MaskType::PixelType>(imgInfos, od.size(),
-                                                                              imageBands));
+            TemporalMergingFunctor<ImageType::PixelType, MaskType::PixelType>(imgInfos, imageBands));
 
         temporalMerger->SetInput1(temporalResampler->GetOutput());
         temporalMerger->SetInput2(m_MaskConcat->GetOutput());
@@ -2,6 +2,9 @@
 
 #include "otbVectorImage.h"
 #include "otbWrapperTypes.h"
+#include "otbVectorFunctorImageFilter.h"
+
+#include <vector>
 
 typedef float PixelValueType;
 typedef otb::VectorImage<PixelValueType, 2> ImageType;
@@ -32,14 +35,15 @@ public:
         return this->m_IncludeRedEdge;
     }
 
-    PixelType operator()(const PixelType &ts, const PixelType &rets) const
+    void operator()(const PixelType &ts, const PixelType &rets, PixelType &result) const
     {
         // compute the number of input image
         int numImages = m_id.size();
         auto bands = ts.Size() / numImages;
         auto outputBands = m_IncludeRedEdge ? 8 : 4;
 
-        PixelType ndvi(numImages);
+        std::vector<PixelValueType> &ndvi = m_NDVI;
+        ndvi.resize(numImages);
 
         auto ok = false;
         for (int imgIndex = 0; imgIndex < numImages; imgIndex++) {
@@ -57,12 +61,9 @@ public:
             }
         }
 
-        // Create the output pixel
-        PixelType result(INDEXSIZE * outputBands);
-
         if (!ok) {
             result.Fill(static_cast<PixelValueType>(-10000));
-            return result;
+            return;
         }
 
         // Compute the maximum and minimum NDVI slopes
@@ -121,8 +122,6 @@ public:
                 }
             }
         }
-
-        return result;
     }
 
     bool operator==(const FeaturesNoInsituFunctor &other) const
@@ -144,6 +143,10 @@ protected:
     // the days from epoch corresponding to the input series raster
     std::vector<int> m_id;
     bool m_IncludeRedEdge;
+
+private:
+    // the ndvi series of the current pixel
+    mutable std::vector<PixelValueType> m_NDVI;
 };
 
 // Output bands:
@@ -164,11 +167,11 @@ protected:
 #define MAXRED 4
 
 class ITK_EXPORT CropMaskSpectralFeaturesFilter
-    : public itk::BinaryFunctorImageFilter<ImageType, ImageType, ImageType, FeaturesNoInsituFunctor<ImageType::PixelType>>
+    : public otb::BinaryVectorFunctorImageFilter<ImageType, ImageType, ImageType, FeaturesNoInsituFunctor<ImageType::PixelType>>
 {
 public:
     typedef CropMaskSpectralFeaturesFilter Self;
-    typedef itk::BinaryFunctorImageFilter<ImageType, ImageType, ImageType, FeaturesNoInsituFunctor<ImageType::PixelType>> Superclass;
+    typedef otb::BinaryVectorFunctorImageFilter<ImageType, ImageType, ImageType, FeaturesNoInsituFunctor<ImageType::PixelType>> Superclass;
     typedef itk::SmartPointer<Self> Pointer;
     typedef itk::SmartPointer<const Self> ConstPointer;
 
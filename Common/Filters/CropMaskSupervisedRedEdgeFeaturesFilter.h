@@ -16,6 +16,7 @@
 #pragma once
 
 #include "otbVectorImage.h"
+#include "otbVectorFunctorImageFilter.h"
 
 typedef float                                PixelValueType;
 typedef otb::VectorImage<PixelValueType, 2>  ImageType;
@@ -28,13 +29,11 @@ class CropMaskSupervisedRedEdgeFeaturesFunctor
 {
 public:
 
-  PixelType operator()(const PixelType &pixel) const
+  void operator()(const PixelType &pixel, PixelType &result) const
   {
       // in: B2, B4, B5, B6, B7, B8
       // out: RE-NDVI, CHL-RE, PSRI, S2 RE-Position
       int size = pixel.Size();
-      int numImages = size / 6;
-      PixelType result(numImages * 4);
 
       int p = 0;
       for (int i = 0; i < size; i += 6, p += 4) {
@@ -63,8 +62,6 @@ public:
               result[p + 3] = NODATA;
         }
       }
-
-      return result;
     }
 
   bool operator!=(const CropMaskSupervisedRedEdgeFeaturesFunctor &) const
@@ -80,12 +77,12 @@ public:
 
 template<class TImage>
 class ITK_EXPORT CropMaskSupervisedRedEdgeFeaturesFilter
-  : public itk::UnaryFunctorImageFilter<TImage, TImage, CropMaskSupervisedRedEdgeFeaturesFunctor<typename TImage::PixelType>>
+  : public otb::UnaryVectorFunctorImageFilter<TImage, TImage, CropMaskSupervisedRedEdgeFeaturesFunctor<typename TImage::PixelType>>
 {
 public:
   /** Standard class typedefs. */
   typedef CropMaskSupervisedRedEdgeFeaturesFilter                       Self;
-  typedef itk::UnaryFunctorImageFilter<TImage, TImage, CropMaskSupervisedRedEdgeFeaturesFunctor<typename TImage::PixelType>> Superclass;
+  typedef otb::UnaryVectorFunctorImageFilter<TImage, TImage, CropMaskSupervisedRedEdgeFeaturesFunctor<typename TImage::PixelType>> Superclass;
   typedef itk::SmartPointer<Self>                             Pointer;
   typedef itk::SmartPointer<const Self>                       ConstPointer;
 
@@ -93,7 +90,7 @@ public:
   itkNewMacro(Self);
 
   /** Run-time type information (and related methods). */
-  itkTypeMacro(CropMaskSupervisedRedEdgeFeaturesFilter, UnaryFunctorImageFilter);
+  itkTypeMacro(CropMaskSupervisedRedEdgeFeaturesFilter, UnaryVectorFunctorImageFilter);
 
   /** Template related typedefs */
   typedef TImage ImageType;
@@ -2,10 +2,15 @@
 
 #include "otbVectorImage.h"
 #include "otbWrapperTypes.h"
+#include "otbTemporalMaskPackingFilter.h"
+#include "WhittakerSmoothing.h"
+
+#include <algorithm>
+#include <vector>
 
 typedef float PixelValueType;
 typedef otb::VectorImage<PixelValueType, 2> ImageType;
-typedef otb::Wrapper::UInt8VectorImageType MaskImageType;
+typedef otb::TemporalMaskImageType MaskImageType;
 
 #define GETNDVI(b) (static_cast<double>(pix[b]))
 
@@ -22,34 +27,6 @@ struct ImageInfo
     }
 };
 
-void whit1(double lambda,
-           int numValues,
-            double* values,//const double * __restrict__ values,
-            double* weights,//const double * __restrict__ weights,
-            double* c, double* d, double* z)//double * __restrict__ c, double * __restrict__ d, double * __restrict__ z)
-{
-    const double eps = 0.0001;
-
-    // Perform the Whittaker smoothing.
-    // The code is inspired from the R language package "ptw"
-    int m = numValues - 1;
-    d[0] = weights[0] + lambda;
-    c[0] = fabs(d[0]) > eps ? -lambda / d[0] : 0.0;
-    z[0] = values[0];
-
-    for (int i = 1; i < m; i++) {
-        d[i] = weights[i] + 2 * lambda - c[i - 1] * c[i - 1] * d[i - 1];
-        c[i] = fabs(d[i]) > eps ? -lambda / d[i] : 0.0;
-        z[i] = values[i] - c[i - 1] * z[i - 1];
-    }
-    d[m] = weights[m] + lambda - c[m - 1] * c[m - 1] * d[m - 1];
-    z[m] = fabs(d[m]) > eps ? (values[m] - c[m - 1] * z[m - 1]) / d[m] : 0.0;
-
-    for (int i = m - 1; 0 <= i; i--) {
-        z[i] = (fabs(d[i]) > eps ? z[i] / d[i] : 0.0) - c[i] * z[i + 1];
-    }
-}
-
 template <typename PixelType, typename MaskPixelType>
 class DataSmoothingFunctor
 {
@@ -69,62 +46,61 @@ public:
     {
     }
 
-    PixelType operator()(const PixelType &pix, const MaskPixelType &mask) const
+    void operator()(const PixelType &pix, const MaskPixelType &mask, PixelType &result) const
     {
         // compute the size of the input pixel
         int pixSize = pix.Size();
 
-        // Create the output pixel
-        PixelType result(outputDates.size() * bands);
-
         // If the input pixel is nodata return nodata
-        PixelType nodata(pixSize);
-        nodata.Fill(static_cast<PixelValueType>(-10000));
+        bool isNoData = true;
+        for (int i = 0; i < pixSize && isNoData; i++) {
+            isNoData = pix[i] == static_cast<PixelValueType>(-10000);
+        }
 
-        if (pix == nodata) {
+        if (isNoData) {
             result.Fill(static_cast<PixelValueType>(-10000));
-            return result;
+            return;
         }
 
         int firstDay = inputImages.front().day;
         int tempSize = inputImages.back().day - firstDay + 1;
-        itk::VariableLengthVector<int> indices(tempSize);
-        itk::VariableLengthVector<double> weights(tempSize * 5);
-        double *values = &weights[tempSize * 4];
+        // the buffers and the factorisations are kept between the pixels, each thread has its own functor
+        indices.resize(tempSize);
+        weights.resize(tempSize);
+        z.resize(tempSize * bands);
 
-        indices.Fill(-1);
+        std::fill(indices.begin(), indices.end(), -1);
         for (const auto &img : inputImages) {
             int pos = img.day - firstDay;
-            if (indices[pos] == -1 && !mask[img.index]) {
+            if (indices[pos] == -1 && !otb::IsDateMasked(mask, img.index)) {
                 indices[pos] = img.index;
             }
         }
 
         for (int i = 0; i < tempSize; i++) {
-            if (indices[i] != -1) {
-                weights[i] = 1.0;
-            } else {
-                weights[i] = 0.0;
-            }
+            weights[i] = indices[i] != -1 ? 1.0 : 0.0;
         }
 
-        for (int band = 0; band < bands; band++) {
-            for (int i = 0; i < tempSize; i++) {
-                if (indices[i] != -1) {
-                    values[i] = pix[indices[i] * bands + band];
-                } else {
-                    values[i] = 0;
-                }
-            }
-            double *z = &weights[tempSize * 3];
-            whit1(lambda, tempSize, values, &weights[0], &weights[tempSize], &weights[tempSize * 2], z);
-            auto pos = 0;
-            for (auto date : outputDates) {
-                result[pos++ * bands + band] = static_cast<PixelValueType>(z[date - firstDay]);
+        factorizations.Trim();
+        const WhittakerFactorization &factorization = factorizations.Get(lambda, &weights[0], tempSize);
+
+        // the bands are smoothed together, interleaved, weighted by 0 on the masked days
+        for (int i = 0; i < tempSize; i++) {
+            double *row = &z[i * bands];
+            for (int band = 0; band < bands; band++) {
+                row[band] = indices[i] != -1 ? static_cast<double>(pix[indices[i] * bands + band]) : 0.0;
             }
         }
+        whitSolve(factorization, tempSize, &z[0], bands);
 
-        return result;
+        auto pos = 0;
+        for (auto date : outputDates) {
+            const double *row = &z[(date - firstDay) * bands];
+            for (int band = 0; band < bands; band++) {
+                result[pos * bands + band] = static_cast<PixelValueType>(row[band]);
+            }
+            pos++;
+        }
     }
 
     bool operator!=(const DataSmoothingFunctor a) const
@@ -163,4 +139,10 @@ protected:
     double lambda;
     std::vector<int> outputDates;
     std::vector<ImageInfo> inputImages;
+
+private:
+    mutable std::vector<int> indices;
+    mutable std::vector<double> weights;
+    mutable std::vector<double> z;
+    mutable WhittakerFactorizationCache factorizations;
 };
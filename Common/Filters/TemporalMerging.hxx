@@ -17,6 +17,8 @@
 
 #include "itkUnaryFunctorImageFilter.h"
 #include "itkBinaryFunctorImageFilter.h"
+#include "otbTemporalMaskPackingFilter.h"
+#include "otbTemporalMergingFilter.h"
 
 struct ImageInfo
 {
@@ -35,56 +37,21 @@ template <typename PixelType, typename MaskType>
 class TemporalMergingFunctor
 {
 public:
-    TemporalMergingFunctor() :  numOutputImages(0), bands(0) {}
-    TemporalMergingFunctor(std::vector<ImageInfo>& iInfos, int n, int b) : imgInfos(iInfos), numOutputImages(n), bands(b) {}
-
-    PixelType operator()(const PixelType &pix, const MaskType &mask) const
+    TemporalMergingFunctor() : bands(0) {}
+    // the images are sorted by day and priority
+    TemporalMergingFunctor(const std::vector<ImageInfo>& iInfos, int b) : bands(b)
     {
-        PixelType result(numOutputImages * bands);
-
-        ImageInfo candidateImage(0,0,0);
-
-        int lastDay = -1;
-        int counter = 0;
-
-        for (auto& imgInfo : this->imgInfos) {
-            if (lastDay == -1) {
-                // save the current entry as candidate day for the current day
-                candidateImage = imgInfo;
-                lastDay = imgInfo.day;
-            } else if (imgInfo.day != lastDay) {
-                // the image belongs to a new day. Write the previous candidate to the output
-                for (int j = 0; j < bands; j++) {
-                    result[counter * bands + j] = pix[candidateImage.index * bands + j];
-                }
-                counter++;
-
-                // save the current entry as candidate day for the current day
-                candidateImage = imgInfo;
-                lastDay = imgInfo.day;
-            } else {
-                // This image has the same day as the candidate image
-                // Since the vector is sorted this image has a lower priority
-                // It can replace the candidate image if and only if the candidate was marked
-                // as invalid while this one is marked as valid
-                if (mask[candidateImage.index] != 0 && mask[imgInfo.index] == 0) {
-                    candidateImage = imgInfo;
-                }
-            }
-        }
+        table.Build(iInfos);
+    }
 
-        if (lastDay != -1) {
-            // Write the last candidate to the output
-            for (int j = 0; j < bands; j++) {
-                result[counter * bands + j] = pix[candidateImage.index * bands + j];
-            }
-        }
-        return result;
+    void operator()(const PixelType &pix, const MaskType &mask, PixelType &result) const
+    {
+        table.Merge(pix, mask, bands, result);
     }
 
     bool operator!=(const TemporalMergingFunctor a) const
     {
-        return (this->numOutputImages != a.numOutputImages) || (this->bands != a.bands) ;
+        return (this->table != a.table) || (this->bands != a.bands);
     }
 
     bool operator==(const TemporalMergingFunctor a) const
@@ -95,8 +62,7 @@ public:
 
 
 private:
-    std::vector<ImageInfo> imgInfos;
-    int numOutputImages;
+    otb::TemporalMergingTable table;
     int bands;
 };
 
@@ -0,0 +1,163 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// the maximum number of factorisations kept by a cache
+#define WHITTAKER_CACHE_SIZE 1024
+
+// The Whittaker smoothing solves a tridiagonal system for each series. Its
+// factorisation only depends on the weights and on lambda, so it is shared by
+// the series having the same valid dates.
+struct WhittakerFactorization
+{
+    std::vector<double> c;
+    std::vector<double> d;
+    // tells if d[i] is large enough to divide by it
+    std::vector<char> invertible;
+};
+
+inline void whitFactor(double lambda, const double *weights, int numValues, WhittakerFactorization &f)
+{
+    const double eps = 0.0001;
+
+    f.c.resize(numValues);
+    f.d.resize(numValues);
+    f.invertible.resize(numValues);
+    double *c = &f.c[0];
+    double *d = &f.d[0];
+
+    // The code is inspired from the R language package "ptw"
+    int m = numValues - 1;
+    if (m == 0) {
+        // a single value is not smoothed
+        d[0] = weights[0];
+    } else {
+        d[0] = weights[0] + lambda;
+        c[0] = fabs(d[0]) > eps ? -lambda / d[0] : 0.0;
+        for (int i = 1; i < m; i++) {
+            d[i] = weights[i] + 2 * lambda - c[i - 1] * c[i - 1] * d[i - 1];
+            c[i] = fabs(d[i]) > eps ? -lambda / d[i] : 0.0;
+        }
+        d[m] = weights[m] + lambda - c[m - 1] * c[m - 1] * d[m - 1];
+    }
+    for (int i = 0; i <= m; i++) {
+        f.invertible[i] = fabs(d[i]) > eps;
+    }
+}
+
+// Smooths the series sharing a factorisation in lockstep. The values are interleaved,
+// z[i * numSeries + k] being the value i of the series k multiplied by its weight, and
+// are replaced by the smoothed values. With 0/1 weights, the weighted values are the
+// values of the valid dates and 0 on the others.
+inline void whitSolve(const WhittakerFactorization &f, int numValues, double *z, int numSeries)
+{
+    const double *c = &f.c[0];
+    const double *d = &f.d[0];
+    const int m = numValues - 1;
+
+    for (int i = 1; i < m; i++) {
+        double *row = z + i * numSeries;
+        const double *prev = row - numSeries;
+        const double ci = c[i - 1];
+        for (int k = 0; k < numSeries; k++) {
+            row[k] -= ci * prev[k];
+        }
+    }
+
+    double *last = z + m * numSeries;
+    if (!f.invertible[m]) {
+        std::fill(last, last + numSeries, 0.0);
+    } else if (m == 0) {
+        for (int k = 0; k < numSeries; k++) {
+            last[k] /= d[0];
+        }
+    } else {
+        const double *prev = last - numSeries;
+        const double cm = c[m - 1];
+        for (int k = 0; k < numSeries; k++) {
+            last[k] = (last[k] - cm * prev[k]) / d[m];
+        }
+    }
+
+    for (int i = m - 1; 0 <= i; i--) {
+        double *row = z + i * numSeries;
+        const double *next = row + numSeries;
+        const double ci = c[i];
+        if (f.invertible[i]) {
+            const double di = d[i];
+            for (int k = 0; k < numSeries; k++) {
+                row[k] = row[k] / di - ci * next[k];
+            }
+        } else {
+            for (int k = 0; k < numSeries; k++) {
+                row[k] = 0.0 - ci * next[k];
+            }
+        }
+    }
+}
+
+// The factorisations of the series with 0/1 weights, by the dates having a weight of 1.
+// A cache is not thread safe, each thread keeps its own.
+class WhittakerFactorizationCache
+{
+public:
+    WhittakerFactorizationCache() : m_Lambda(0)
+    {
+    }
+
+    // Forgets the factorisations when there are too many of them. The references returned
+    // by Get stay valid until the next call.
+    void Trim()
+    {
+        if (m_Factorizations.size() > WHITTAKER_CACHE_SIZE) {
+            m_Factorizations.clear();
+        }
+    }
+
+    // Returns the factorisation of the system with these weights, which are 0 or 1
+    const WhittakerFactorization &Get(double lambda, const double *weights, int numValues)
+    {
+        if (lambda != m_Lambda) {
+            m_Factorizations.clear();
+            m_Lambda = lambda;
+        }
+
+        m_Key.assign((numValues + 63) / 64, 0);
+        for (int i = 0; i < numValues; i++) {
+            if (weights[i] != 0.0) {
+                m_Key[i / 64] |= uint64_t(1) << (i % 64);
+            }
+        }
+
+        auto it = m_Factorizations.find(m_Key);
+        if (it == m_Factorizations.end()) {
+            it = m_Factorizations.insert(std::make_pair(m_Key, WhittakerFactorization())).first;
+            whitFactor(lambda, weights, numValues, it->second);
+        }
+        return it->second;
+    }
+
+private:
+    double m_Lambda;
+    std::vector<uint64_t> m_Key;
+    std::map<std::vector<uint64_t>, WhittakerFactorization> m_Factorizations;
+};
@@ -0,0 +1,176 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+#ifndef otbCovarianceAccumulator_h
+#define otbCovarianceAccumulator_h
+
+#include <vector>
+#include <cstddef>
+
+namespace otb
+{
+
+/** \class CovarianceAccumulator
+ * \brief Accumulates the mean and the covariance of samples, one sample at a time.
+ *
+ * The samples are shifted by the first one, which keeps the sums of their
+ * products accurate, and buffered so that the upper triangle of the cross
+ * products is updated a block of samples at a time. Accumulators of
+ * disjoint sets of samples, for instance one per thread, are merged in
+ * pairs.
+ */
+class CovarianceAccumulator
+{
+public:
+  CovarianceAccumulator() : m_Dimension(0), m_Count(0), m_Buffered(0) {}
+
+  void Reset(unsigned int dimension)
+  {
+    m_Dimension = dimension;
+    m_Count = 0;
+    m_Buffered = 0;
+    m_Shift.assign(dimension, 0.0);
+    m_Sum.assign(dimension, 0.0);
+    m_Cross.assign(static_cast<size_t>(dimension) * dimension, 0.0);
+    m_Block.resize(static_cast<size_t>(BlockSize) * dimension);
+  }
+
+  template <typename T>
+  void Add(const T *x)
+  {
+    if (m_Count == 0 && m_Buffered == 0) {
+      for (unsigned int i = 0; i < m_Dimension; i++) {
+        m_Shift[i] = x[i];
+      }
+    }
+    double *y = &m_Block[m_Buffered * m_Dimension];
+    for (unsigned int i = 0; i < m_Dimension; i++) {
+      y[i] = x[i] - m_Shift[i];
+    }
+    if (++m_Buffered == BlockSize) {
+      Flush();
+    }
+  }
+
+  /** Adds the samples of another accumulator */
+  void Merge(CovarianceAccumulator &other)
+  {
+    other.Flush();
+    if (other.m_Count == 0) {
+      return;
+    }
+    Flush();
+    if (m_Count == 0) {
+      m_Shift = other.m_Shift;
+      m_Sum = other.m_Sum;
+      m_Cross = other.m_Cross;
+      m_Count = other.m_Count;
+      return;
+    }
+
+    // shift the sums of the other samples by the shift of this accumulator
+    const double n = static_cast<double>(other.m_Count);
+    std::vector<double> s(m_Dimension);
+    for (unsigned int i = 0; i < m_Dimension; i++) {
+      s[i] = other.m_Shift[i] - m_Shift[i];
+    }
+    for (unsigned int i = 0; i < m_Dimension; i++) {
+      for (unsigned int j = i; j < m_Dimension; j++) {
+        m_Cross[i * m_Dimension + j] += other.m_Cross[i * m_Dimension + j]
+                                        + other.m_Sum[i] * s[j] + s[i] * other.m_Sum[j]
+                                        + n * s[i] * s[j];
+      }
+    }
+    for (unsigned int i = 0; i < m_Dimension; i++) {
+      m_Sum[i] += other.m_Sum[i] + n * s[i];
+    }
+    m_Count += other.m_Count;
+  }
+
+  size_t GetCount()
+  {
+    Flush();
+    return m_Count;
+  }
+
+  unsigned int GetDimension() const { return m_Dimension; }
+
+  void GetMean(std::vector<double> &mean)
+  {
+    Flush();
+    mean.resize(m_Dimension);
+    for (unsigned int i = 0; i < m_Dimension; i++) {
+      mean[i] = m_Count > 0 ? m_Shift[i] + m_Sum[i] / m_Count : 0.0;
+    }
+  }
+
+  /** Unbiased covariance matrix, row major. Undefined with less than 2 samples. */
+  void GetCovariance(std::vector<double> &covariance)
+  {
+    Flush();
+    covariance.resize(static_cast<size_t>(m_Dimension) * m_Dimension);
+    for (unsigned int i = 0; i < m_Dimension; i++) {
+      for (unsigned int j = i; j < m_Dimension; j++) {
+        const double c = (m_Cross[i * m_Dimension + j] - m_Sum[i] * m_Sum[j] / m_Count) / (m_Count - 1.0);
+        covariance[i * m_Dimension + j] = c;
+        covariance[j * m_Dimension + i] = c;
+      }
+    }
+  }
+
+  /** Adds the buffered samples to the sums */
+  void Flush()
+  {
+    if (m_Buffered == 0) {
+      return;
+    }
+    for (size_t r = 0; r < m_Buffered; r++) {
+      const double *y = &m_Block[r * m_Dimension];
+      for (unsigned int i = 0; i < m_Dimension; i++) {
+        m_Sum[i] += y[i];
+      }
+    }
+    // one row of the cross products stays in cache for the whole block
+    for (unsigned int i = 0; i < m_Dimension; i++) {
+      double *cross = &m_Cross[i * m_Dimension];
+      for (size_t r = 0; r < m_Buffered; r++) {
+        const double *y = &m_Block[r * m_Dimension];
+        const double yi = y[i];
+        if (yi == 0.0) {
+          continue;
+        }
+        for (unsigned int j = i; j < m_Dimension; j++) {
+          cross[j] += yi * y[j];
+        }
+      }
+    }
+    m_Count += m_Buffered;
+    m_Buffered = 0;
+  }
+
+private:
+  static const size_t BlockSize = 64;
+
+  unsigned int        m_Dimension;
+  size_t              m_Count;
+  size_t              m_Buffered;
+  std::vector<double> m_Shift;
+  std::vector<double> m_Sum;
+  std::vector<double> m_Cross;
+  std::vector<double> m_Block;
+};
+
+} // end namespace otb
+
+#endif
@@ -16,7 +16,7 @@
 #ifndef __otbCropTypeFeatureExtractionFilter_h
 #define __otbCropTypeFeatureExtractionFilter_h
 
-#include "itkUnaryFunctorImageFilter.h"
+#include "otbVectorFunctorImageFilter.h"
 #include "otbVectorImage.h"
 #include "otbTemporalResamplingFilter.h"
 
@@ -37,11 +37,8 @@ class FeatureTimeSeriesFunctor
 public:
   FeatureTimeSeriesFunctor() : m_OutputBands() { }
 
-  PixelType operator()(const PixelType &rtocr) const
+  void operator()(const PixelType &rtocr, PixelType &result) const
   {
-    // Create the output pixel
-    PixelType result(m_OutputBands);
-
     int inputPos = 0;
     int outputPos = 0;
     for (const auto &sd : m_SensorData) {
@@ -64,8 +61,6 @@ public:
           inputPos += sd.bandCount;
       }
     }
-
-    return result;
   }
 
   bool operator!=(const FeatureTimeSeriesFunctor a) const
@@ -92,12 +87,12 @@ public:
  */
 template<class TImage>
 class ITK_EXPORT CropTypeFeatureExtractionFilter
-  : public itk::UnaryFunctorImageFilter<TImage, TImage, FeatureTimeSeriesFunctor<typename TImage::PixelType> >
+  : public otb::UnaryVectorFunctorImageFilter<TImage, TImage, FeatureTimeSeriesFunctor<typename TImage::PixelType> >
 {
 public:
   /** Standard class typedefs. */
   typedef CropTypeFeatureExtractionFilter                       Self;
-  typedef itk::UnaryFunctorImageFilter<TImage, TImage, FeatureTimeSeriesFunctor<typename TImage::PixelType> > Superclass;
+  typedef otb::UnaryVectorFunctorImageFilter<TImage, TImage, FeatureTimeSeriesFunctor<typename TImage::PixelType> > Superclass;
   typedef itk::SmartPointer<Self>                             Pointer;
   typedef itk::SmartPointer<const Self>                       ConstPointer;
 
@@ -105,7 +100,7 @@ public:
   itkNewMacro(Self)
 
   /** Run-time type information (and related methods). */
-  itkTypeMacro(CropTypeFeatureExtractionFilter, UnaryFunctorImageFilter)
+  itkTypeMacro(CropTypeFeatureExtractionFilter, UnaryVectorFunctorImageFilter)
 
   /** Template related typedefs */
   typedef TImage ImageType;
@@ -0,0 +1,226 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+#ifndef otbStreamingCovarianceVectorImageFilter_h
+#define otbStreamingCovarianceVectorImageFilter_h
+
+#include "otbPersistentImageFilter.h"
+#include "otbPersistentFilterStreamingDecorator.h"
+#include "itkSimpleDataObjectDecorator.h"
+#include "itkVariableSizeMatrix.h"
+#include "itkVariableLengthVector.h"
+#include "otbCovarianceAccumulator.h"
+
+#include <vector>
+
+namespace otb
+{
+
+/** \class PersistentStreamingCovarianceVectorImageFilter
+ * \brief Computes the mean and the covariance of the pixels of a large image using streaming.
+ *
+ * Each thread accumulates its pixels in a CovarianceAccumulator, and the
+ * accumulators of the threads are merged in pairs after each stream. The
+ * pixels having the user ignored value or a non finite value in any band
+ * are not counted.
+ *
+ * To reset the temporary data, one should call the Reset() function.
+ * To get the statistics once the regions have been processed via the
+ * pipeline, use the Synthetize() method.
+ *
+ * \sa PersistentImageFilter
+ */
+template<class TInputImage>
+class ITK_EXPORT PersistentStreamingCovarianceVectorImageFilter :
+  public PersistentImageFilter<TInputImage, TInputImage>
+{
+public:
+  /** Standard Self typedef */
+  typedef PersistentStreamingCovarianceVectorImageFilter  Self;
+  typedef PersistentImageFilter<TInputImage, TInputImage> Superclass;
+  typedef itk::SmartPointer<Self>                         Pointer;
+  typedef itk::SmartPointer<const Self>                   ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Runtime information support. */
+  itkTypeMacro(PersistentStreamingCovarianceVectorImageFilter, PersistentImageFilter);
+
+  /** Image related typedefs. */
+  typedef TInputImage                           ImageType;
+  typedef typename ImageType::Pointer           InputImagePointer;
+  typedef typename ImageType::RegionType        RegionType;
+  typedef typename ImageType::PixelType         PixelType;
+  typedef typename ImageType::InternalPixelType InternalPixelType;
+
+  /** Type to use for computations. */
+  typedef itk::VariableLengthVector<double>     RealPixelType;
+  typedef itk::VariableSizeMatrix<double>       MatrixType;
+
+  /** Type of DataObjects used for outputs */
+  typedef itk::SimpleDataObjectDecorator<RealPixelType>   RealPixelObjectType;
+  typedef itk::SimpleDataObjectDecorator<MatrixType>      MatrixObjectType;
+  typedef itk::SimpleDataObjectDecorator<unsigned long>   CountObjectType;
+
+  /** Smart Pointer type to a DataObject. */
+  typedef typename itk::DataObject::Pointer                   DataObjectPointer;
+  typedef itk::ProcessObject::DataObjectPointerArraySizeType  DataObjectPointerArraySizeType;
+
+  /** Return the mean of the counted pixels */
+  RealPixelType GetMean() const
+  {
+    return this->GetMeanOutput()->Get();
+  }
+  RealPixelObjectType* GetMeanOutput();
+  const RealPixelObjectType* GetMeanOutput() const;
+
+  /** Return the unbiased covariance of the counted pixels */
+  MatrixType GetCovariance() const
+  {
+    return this->GetCovarianceOutput()->Get();
+  }
+  MatrixObjectType* GetCovarianceOutput();
+  const MatrixObjectType* GetCovarianceOutput() const;
+
+  /** Return the number of counted pixels */
+  unsigned long GetCount() const
+  {
+    return this->GetCountOutput()->Get();
+  }
+  CountObjectType* GetCountOutput();
+  const CountObjectType* GetCountOutput() const;
+
+  /** Make a DataObject of the correct type to be used as the specified
+   * output.
+   */
+  virtual DataObjectPointer MakeOutput(DataObjectPointerArraySizeType idx);
+  using Superclass::MakeOutput;
+
+  virtual void Reset(void);
+
+  virtual void Synthetize(void);
+
+  itkSetMacro(IgnoreUserDefinedValue, bool);
+  itkGetMacro(IgnoreUserDefinedValue, bool);
+
+  itkSetMacro(UserIgnoredValue, double);
+  itkGetMacro(UserIgnoredValue, double);
+
+protected:
+  PersistentStreamingCovarianceVectorImageFilter();
+
+  virtual ~PersistentStreamingCovarianceVectorImageFilter() {}
+
+  /** The output image of this filter is not intended to be used. */
+  virtual void AllocateOutputs();
+
+  virtual void GenerateOutputInformation();
+
+  virtual void BeforeThreadedGenerateData();
+
+  /** Multi-thread version GenerateData. */
+  void ThreadedGenerateData(const RegionType& outputRegionForThread, itk::ThreadIdType threadId);
+
+  virtual void AfterThreadedGenerateData();
+
+private:
+  PersistentStreamingCovarianceVectorImageFilter(const Self &); //purposely not implemented
+  void operator =(const Self&); //purposely not implemented
+
+  bool    m_IgnoreUserDefinedValue;
+  double  m_UserIgnoredValue;
+
+  CovarianceAccumulator                 m_Accumulator;
+  std::vector<CovarianceAccumulator>    m_ThreadAccumulators;
+}; // end of class PersistentStreamingCovarianceVectorImageFilter
+
+/**===========================================================================*/
+
+/** \class StreamingCovarianceVectorImageFilter
+ * \brief Computes the mean and the covariance of a large image using streaming.
+ *
+ * \sa PersistentStreamingCovarianceVectorImageFilter
+ */
+template<class TInputImage>
+class ITK_EXPORT StreamingCovarianceVectorImageFilter :
+  public PersistentFilterStreamingDecorator<PersistentStreamingCovarianceVectorImageFilter<TInputImage> >
+{
+public:
+  /** Standard Self typedef */
+  typedef StreamingCovarianceVectorImageFilter Self;
+  typedef PersistentFilterStreamingDecorator
+  <PersistentStreamingCovarianceVectorImageFilter<TInputImage> > Superclass;
+  typedef itk::SmartPointer<Self>       Pointer;
+  typedef itk::SmartPointer<const Self> ConstPointer;
+
+  /** Type macro */
+  itkNewMacro(Self);
+
+  /** Creation through object factory macro */
+  itkTypeMacro(StreamingCovarianceVectorImageFilter, PersistentFilterStreamingDecorator);
+
+  typedef TInputImage                                 InputImageType;
+  typedef typename Superclass::FilterType             CovarianceFilterType;
+  typedef typename CovarianceFilterType::RealPixelType  RealPixelType;
+  typedef typename CovarianceFilterType::MatrixType     MatrixType;
+
+  using Superclass::SetInput;
+  void SetInput(InputImageType * input)
+  {
+    this->GetFilter()->SetInput(input);
+  }
+  const InputImageType * GetInput()
+  {
+    return this->GetFilter()->GetInput();
+  }
+
+  RealPixelType GetMean() const
+  {
+    return this->GetFilter()->GetMean();
+  }
+  MatrixType GetCovariance() const
+  {
+    return this->GetFilter()->GetCovariance();
+  }
+  unsigned long GetCount() const
+  {
+    return this->GetFilter()->GetCount();
+  }
+
+  otbSetObjectMemberMacro(Filter, IgnoreUserDefinedValue, bool);
+  otbGetObjectMemberMacro(Filter, IgnoreUserDefinedValue, bool);
+
+  otbSetObjectMemberMacro(Filter, UserIgnoredValue, double);
+  otbGetObjectMemberMacro(Filter, UserIgnoredValue, double);
+
+protected:
+  /** Constructor */
+  StreamingCovarianceVectorImageFilter() {}
+
+  /** Destructor */
+  virtual ~StreamingCovarianceVectorImageFilter() {}
+
+private:
+  StreamingCovarianceVectorImageFilter(const Self &); //purposely not implemented
+  void operator =(const Self&); //purposely not implemented
+};
+
+} // end namespace otb
+
+#ifndef OTB_MANUAL_INSTANTIATION
+#include "otbStreamingCovarianceVectorImageFilter.txx"
+#endif
+
+#endif
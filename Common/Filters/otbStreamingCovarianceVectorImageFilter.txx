@@ -0,0 +1,247 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+#ifndef otbStreamingCovarianceVectorImageFilter_txx
+#define otbStreamingCovarianceVectorImageFilter_txx
+
+#include "otbStreamingCovarianceVectorImageFilter.h"
+
+#include "itkImageRegionConstIterator.h"
+#include "itkProgressReporter.h"
+
+#include <cmath>
+
+namespace otb
+{
+
+template<class TInputImage>
+PersistentStreamingCovarianceVectorImageFilter<TInputImage>
+::PersistentStreamingCovarianceVectorImageFilter()
+  : m_IgnoreUserDefinedValue(false),
+    m_UserIgnoredValue(0.0)
+{
+  // first output is a copy of the image, DataObject created by
+  // superclass
+
+  // allocate the data objects for the outputs which are
+  // just decorators around vector/matrix types
+  for (unsigned int i = 1; i < 4; ++i)
+    {
+    this->itk::ProcessObject::SetNthOutput(i, this->MakeOutput(i).GetPointer());
+    }
+}
+
+template<class TInputImage>
+itk::DataObject::Pointer
+PersistentStreamingCovarianceVectorImageFilter<TInputImage>
+::MakeOutput(DataObjectPointerArraySizeType output)
+{
+  switch (output)
+    {
+    case 1:
+      return static_cast<itk::DataObject*>(RealPixelObjectType::New().GetPointer());
+      break;
+    case 2:
+      return static_cast<itk::DataObject*>(MatrixObjectType::New().GetPointer());
+      break;
+    case 3:
+      return static_cast<itk::DataObject*>(CountObjectType::New().GetPointer());
+      break;
+    default:
+      // might as well make an image
+      return static_cast<itk::DataObject*>(TInputImage::New().GetPointer());
+      break;
+    }
+}
+
+template<class TInputImage>
+typename PersistentStreamingCovarianceVectorImageFilter<TInputImage>::RealPixelObjectType*
+PersistentStreamingCovarianceVectorImageFilter<TInputImage>
+::GetMeanOutput()
+{
+  return static_cast<RealPixelObjectType*>(this->itk::ProcessObject::GetOutput(1));
+}
+
+template<class TInputImage>
+const typename PersistentStreamingCovarianceVectorImageFilter<TInputImage>::RealPixelObjectType*
+PersistentStreamingCovarianceVectorImageFilter<TInputImage>
+::GetMeanOutput() const
+{
+  return static_cast<const RealPixelObjectType*>(this->itk::ProcessObject::GetOutput(1));
+}
+
+template<class TInputImage>
+typename PersistentStreamingCovarianceVectorImageFilter<TInputImage>::MatrixObjectType*
+PersistentStreamingCovarianceVectorImageFilter<TInputImage>
+::GetCovarianceOutput()
+{
+  return static_cast<MatrixObjectType*>(this->itk::ProcessObject::GetOutput(2));
+}
+
+template<class TInputImage>
+const typename PersistentStreamingCovarianceVectorImageFilter<TInputImage>::MatrixObjectType*
+PersistentStreamingCovarianceVectorImageFilter<TInputImage>
+::GetCovarianceOutput() const
+{
+  return static_cast<const MatrixObjectType*>(this->itk::ProcessObject::GetOutput(2));
+}
+
+template<class TInputImage>
+typename PersistentStreamingCovarianceVectorImageFilter<TInputImage>::CountObjectType*
+PersistentStreamingCovarianceVectorImageFilter<TInputImage>
+::GetCountOutput()
+{
+  return static_cast<CountObjectType*>(this->itk::ProcessObject::GetOutput(3));
+}
+
+template<class TInputImage>
+const typename PersistentStreamingCovarianceVectorImageFilter<TInputImage>::CountObjectType*
+PersistentStreamingCovarianceVectorImageFilter<TInputImage>
+::GetCountOutput() const
+{
+  return static_cast<const CountObjectType*>(this->itk::ProcessObject::GetOutput(3));
+}
+
+template<class TInputImage>
+void
+PersistentStreamingCovarianceVectorImageFilter<TInputImage>
+::GenerateOutputInformation()
+{
+  Superclass::GenerateOutputInformation();
+  if (this->GetInput())
+    {
+    this->GetOutput()->CopyInformation(this->GetInput());
+    this->GetOutput()->SetLargestPossibleRegion(this->GetInput()->GetLargestPossibleRegion());
+
+    if (this->GetOutput()->GetRequestedRegion().GetNumberOfPixels() == 0)
+      {
+      this->GetOutput()->SetRequestedRegion(this->GetOutput()->GetLargestPossibleRegion());
+      }
+    }
+}
+
+template<class TInputImage>
+void
+PersistentStreamingCovarianceVectorImageFilter<TInputImage>
+::AllocateOutputs()
+{
+  // This is commented to prevent the streaming of the whole image for the first stream strip
+  // It shall not cause any problem because the output image of this filter is not intended to be used.
+  // Nothing that needs to be allocated for the remaining outputs
+}
+
+template<class TInputImage>
+void
+PersistentStreamingCovarianceVectorImageFilter<TInputImage>
+::Reset()
+{
+  TInputImage * inputPtr = const_cast<TInputImage *>(this->GetInput());
+  inputPtr->UpdateOutputInformation();
+
+  m_Accumulator.Reset(inputPtr->GetNumberOfComponentsPerPixel());
+}
+
+template<class TInputImage>
+void
+PersistentStreamingCovarianceVectorImageFilter<TInputImage>
+::Synthetize()
+{
+  const unsigned int dimension = m_Accumulator.GetDimension();
+  const size_t count = m_Accumulator.GetCount();
+
+  std::vector<double> mean;
+  std::vector<double> covariance;
+  m_Accumulator.GetMean(mean);
+  m_Accumulator.GetCovariance(covariance);
+
+  RealPixelType meanPixel(dimension);
+  MatrixType covarianceMatrix(dimension, dimension);
+  for (unsigned int i = 0; i < dimension; i++)
+    {
+    meanPixel[i] = mean[i];
+    for (unsigned int j = 0; j < dimension; j++)
+      {
+      covarianceMatrix(i, j) = count > 1 ? covariance[i * dimension + j] : 0.0;
+      }
+    }
+
+  this->GetMeanOutput()->Set(meanPixel);
+  this->GetCovarianceOutput()->Set(covarianceMatrix);
+  this->GetCountOutput()->Set(count);
+}
+
+template<class TInputImage>
+void
+PersistentStreamingCovarianceVectorImageFilter<TInputImage>
+::BeforeThreadedGenerateData()
+{
+  m_ThreadAccumulators.resize(this->GetNumberOfThreads());
+  for (auto &accumulator : m_ThreadAccumulators)
+    {
+    accumulator.Reset(m_Accumulator.GetDimension());
+    }
+}
+
+template<class TInputImage>
+void
+PersistentStreamingCovarianceVectorImageFilter<TInputImage>
+::ThreadedGenerateData(const RegionType& outputRegionForThread, itk::ThreadIdType threadId)
+{
+  // Support progress methods/callbacks
+  itk::ProgressReporter progress(this, threadId, outputRegionForThread.GetNumberOfPixels());
+
+  CovarianceAccumulator &accumulator = m_ThreadAccumulators[threadId];
+  const unsigned int dimension = accumulator.GetDimension();
+
+  itk::ImageRegionConstIterator<TInputImage> it(this->GetInput(), outputRegionForThread);
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it, progress.CompletedPixel())
+    {
+    const PixelType& vectorValue = it.Get();
+    const InternalPixelType *x = vectorValue.GetDataPointer();
+
+    bool ignored = false;
+    for (unsigned int j = 0; j < dimension && !ignored; ++j)
+      {
+      ignored = !std::isfinite(static_cast<double>(x[j]))
+                || (m_IgnoreUserDefinedValue && x[j] == m_UserIgnoredValue);
+      }
+    if (!ignored)
+      {
+      accumulator.Add(x);
+      }
+    }
+}
+
+template<class TInputImage>
+void
+PersistentStreamingCovarianceVectorImageFilter<TInputImage>
+::AfterThreadedGenerateData()
+{
+  // pairwise merge of the threads, then into the samples of the previous streams
+  const size_t nbThreads = m_ThreadAccumulators.size();
+  for (size_t step = 1; step < nbThreads; step *= 2)
+    {
+    for (size_t i = 0; i + step < nbThreads; i += 2 * step)
+      {
+      m_ThreadAccumulators[i].Merge(m_ThreadAccumulators[i + step]);
+      }
+    }
+  if (nbThreads > 0)
+    {
+    m_Accumulator.Merge(m_ThreadAccumulators[0]);
+    }
+}
+
+} // end namespace otb
+#endif
@@ -16,8 +16,12 @@
 #ifndef __otbTemporalMergingFilter_h
 #define __otbTemporalMergingFilter_h
 
-#include "itkBinaryFunctorImageFilter.h"
+#include "otbVectorFunctorImageFilter.h"
 #include "otbVectorImage.h"
+#include "otbTemporalMaskPackingFilter.h"
+
+#include <algorithm>
+#include <vector>
 
 #define NODATA          -10000
 
@@ -40,60 +44,81 @@ struct ImageInfo
 
 typedef std::vector<ImageInfo> ImageInfoCollection;
 
-template <typename PixelType>
-class TemporalMergingFunctor
+/** The inputs merged in each output date of a time series. The consecutive inputs
+ * acquired in the same day are merged: the inputs of the output date i are
+ * Inputs[Starts[i]] .. Inputs[Starts[i + 1] - 1], by decreasing priority. */
+struct TemporalMergingTable
 {
-public:
-    TemporalMergingFunctor() :  numOutputImages(0), bands(0) {}
-    TemporalMergingFunctor(ImageInfoCollection& iInfos, int n) : imgInfos(iInfos), numOutputImages(n), bands(4) {}
+    std::vector<int> Days;
+    std::vector<int> Starts;
+    std::vector<int> Inputs;
 
-    PixelType operator()(const PixelType &pix, const PixelType &mask) const
+    template <typename TImageInfoCollection>
+    void Build(const TImageInfoCollection &imgInfos)
     {
-        PixelType result(numOutputImages * bands);
-
-        ImageInfo candidateImage(0,0,0);
-
-        int lastDay = -1;
-        int counter = 0;
-
-        for (auto& imgInfo : this->imgInfos) {
-            if (lastDay == -1) {
-                // save the current entry as candidate day for the current day
-                candidateImage = imgInfo;
-                lastDay = imgInfo.day;
-            } else if (imgInfo.day != lastDay) {
-                // the image belongs to a new day. Write the previous candidate to the output
-                for (int j = 0; j < bands; j++) {
-                    result[counter * bands + j] = pix[candidateImage.index * bands + j];
-                }
-                counter++;
-
-                // save the current entry as candidate day for the current day
-                candidateImage = imgInfo;
-                lastDay = imgInfo.day;
-            } else {
-                // This image has the same day as the candidate image
-                // Since the vector is sorted this image has a lower priority
-                // It can replace the candidate image if and only if the candidate was marked
-                // as invalid while this one is marked as valid
-                if (mask[candidateImage.index] != 0 && mask[imgInfo.index] == 0) {
-                    candidateImage = imgInfo;
-                }
+        Days.clear();
+        Starts.clear();
+        Inputs.clear();
+        for (const auto &imgInfo : imgInfos) {
+            if (Days.empty() || imgInfo.day != Days.back()) {
+                Days.push_back(imgInfo.day);
+                Starts.push_back(Inputs.size());
             }
+            Inputs.push_back(imgInfo.index);
         }
+        Starts.push_back(Inputs.size());
+    }
 
-        if (lastDay != -1) {
-            // Write the last candidate to the output
-            for (int j = 0; j < bands; j++) {
-                result[counter * bands + j] = pix[candidateImage.index * bands + j];
-            }
+    /** The input used for an output date: the first one which is not masked,
+     * or the first one if they are all masked */
+    template <typename TMask>
+    int SelectInput(int date, const TMask &mask) const
+    {
+        const int first = Starts[date];
+        int selected = Inputs[first];
+        for (int i = Starts[date + 1] - 1; i >= first; i--) {
+            selected = IsDateMasked(mask, Inputs[i]) ? selected : Inputs[i];
         }
-        return result;
+        return selected;
+    }
+
+    /** Copies the bands of the input selected for each output date */
+    template <typename TPixel, typename TMask, typename TOutput>
+    void Merge(const TPixel &pix, const TMask &mask, int bands, TOutput &result) const
+    {
+        const int dates = Days.size();
+        for (int date = 0; date < dates; date++) {
+            const auto *input = &pix[SelectInput(date, mask) * bands];
+            std::copy(input, input + bands, &result[date * bands]);
+        }
+    }
+
+    bool operator==(const TemporalMergingTable &other) const
+    {
+        return Starts == other.Starts && Inputs == other.Inputs;
+    }
+
+    bool operator!=(const TemporalMergingTable &other) const
+    {
+        return !(*this == other);
+    }
+};
+
+template <typename PixelType>
+class TemporalMergingFunctor
+{
+public:
+    TemporalMergingFunctor() : bands(0) {}
+    TemporalMergingFunctor(const TemporalMergingTable &t, int b) : table(t), bands(b) {}
+
+    void operator()(const PixelType &pix, const PixelType &mask, PixelType &result) const
+    {
+        table.Merge(pix, mask, bands, result);
     }
 
     bool operator!=(const TemporalMergingFunctor a) const
     {
-        return (this->numOutputImages != a.numOutputImages) || (this->bands != a.bands) ;
+        return (this->table != a.table) || (this->bands != a.bands);
     }
 
     bool operator==(const TemporalMergingFunctor a) const
@@ -101,11 +126,8 @@ public:
         return !(*this != a);
     }
 
-
-
 private:
-    ImageInfoCollection imgInfos;
-    int numOutputImages;
+    TemporalMergingTable table;
     int bands;
 };
 
@@ -117,12 +139,12 @@ private:
  */
 template<class TImage>
 class ITK_EXPORT TemporalMergingFilter
-  : public itk::BinaryFunctorImageFilter<TImage,TImage, TImage, TemporalMergingFunctor<typename TImage::PixelType> >
+  : public otb::BinaryVectorFunctorImageFilter<TImage,TImage, TImage, TemporalMergingFunctor<typename TImage::PixelType> >
 {
 public:
   /** Standard class typedefs. */
   typedef TemporalMergingFilter                       Self;
-  typedef itk::BinaryFunctorImageFilter<TImage,TImage, TImage, TemporalMergingFunctor<typename TImage::PixelType> > Superclass;
+  typedef otb::BinaryVectorFunctorImageFilter<TImage,TImage, TImage, TemporalMergingFunctor<typename TImage::PixelType> > Superclass;
   typedef itk::SmartPointer<Self>                             Pointer;
   typedef itk::SmartPointer<const Self>                       ConstPointer;
 
@@ -130,7 +152,7 @@ public:
   itkNewMacro(Self);
 
   /** Run-time type information (and related methods). */
-  itkTypeMacro(TemporalMergingFilter, BinaryFunctorImageFilter);
+  itkTypeMacro(TemporalMergingFilter, BinaryVectorFunctorImageFilter);
 
   /** Template related typedefs */
   typedef TImage ImageType;
@@ -146,11 +168,14 @@ public:
   /** ImageDimension constant */
   itkStaticConstMacro(OutputImageDimension, unsigned int, TImage::ImageDimension);
 
-  /** Accessors for the sensors data */
-  itkSetMacro(InputData, ImageInfoCollection);
+  /** Accessors for the sensors data, the inputs are sorted and grouped by day once */
+  void SetInputData(const ImageInfoCollection &inputData);
   itkGetConstMacro(InputData, ImageInfoCollection);
 
-  itkGetConstMacro(OutDays, std::vector<int>);
+  const std::vector<int> & GetOutDays() const
+  {
+      return m_Table.Days;
+  }
 
 protected:
   /** Constructor. */
@@ -167,7 +192,7 @@ private:
   void operator =(const Self&); //purposely not implemented
 
   ImageInfoCollection  m_InputData;
-  std::vector<int>     m_OutDays;
+  TemporalMergingTable m_Table;
 
   // Sort the descriptors based on the aquisition date
   static bool SortImages(const ImageInfo& o1, const ImageInfo& o2) {
@@ -30,8 +30,6 @@ TemporalMergingFilter<TImage>
 ::TemporalMergingFilter()
 {
   this->SetNumberOfRequiredInputs(2);
-  this->m_InputData.empty();
-  this->m_OutDays.empty();
 }
 /**
  * Destructor.
@@ -41,6 +39,17 @@ TemporalMergingFilter<TImage>
 ::~TemporalMergingFilter()
 {}
 
+template <class TImage>
+void
+TemporalMergingFilter<TImage>
+::SetInputData(const ImageInfoCollection &inputData)
+{
+  m_InputData = inputData;
+  std::sort(m_InputData.begin(), m_InputData.end(), TemporalMergingFilter::SortImages);
+  m_Table.Build(m_InputData);
+  this->Modified();
+}
+
 template <class TImage>
 void
 TemporalMergingFilter<TImage>
@@ -57,22 +66,8 @@ TemporalMergingFilter<TImage>
     itkExceptionMacro(<< "No input data available for the TemporalMergingFunctor functor !");
     }
 
-  std::sort(m_InputData.begin(), m_InputData.end(), TemporalMergingFilter::SortImages);
-  this->m_OutDays.clear();
-
-  // count the number of output images and create the out days file
-  int lastDay = -1;
-  int numOutputImages = 0;
-  for (auto& imgInfo : this->m_InputData) {
-      if (lastDay != imgInfo.day) {
-          numOutputImages++;
-          this->m_OutDays.push_back(imgInfo.day);
-          lastDay = imgInfo.day;
-      }
-  }
-
   // The output contains 4 bands for each output image
-  unsigned int nbComponentsPerPixel = 4 * numOutputImages;
+  unsigned int nbComponentsPerPixel = 4 * m_Table.Days.size();
 
   // initialize the number of channels of the output image
   outputPtr->SetNumberOfComponentsPerPixel(nbComponentsPerPixel);
@@ -92,7 +87,7 @@ TemporalMergingFilter<TImage>
     }
 
   // Create the functor
-  this->SetFunctor(TemporalMergingFunctor<typename TImage::PixelType>(this->m_InputData));
+  this->SetFunctor(TemporalMergingFunctor<typename TImage::PixelType>(this->m_Table, 4));
 }
 
 
@@ -16,8 +16,9 @@
 #ifndef __otbTemporalResamplingFilter_h
 #define __otbTemporalResamplingFilter_h
 
-#include "itkBinaryFunctorImageFilter.h"
+#include "otbVectorFunctorImageFilter.h"
 #include "otbVectorImage.h"
+#include "otbTemporalMaskPackingFilter.h"
 
 #define NODATA          -10000
 
@@ -82,11 +83,8 @@ public:
         }
     }
 
-    OutputType operator()(const PixelType &pix, const MaskType &mask) const
+    void operator()(const PixelType &pix, const MaskType &mask, OutputType &result) const
     {
-        // Create the output pixel
-        OutputType result(outputSize);
-
         int sensorStart = 0;
         int outPixelId = 0;
         int offset = 0;
@@ -134,8 +132,6 @@ public:
             offset += sd.inDates.size();
             sensorStart += sd.inDates.size() * sd.bandCount;
         }
-
-        return result;
     }
 
     bool operator!=(const GapFillingFunctor a) const
@@ -208,7 +204,7 @@ private:
     }
 
     // Get the date index of the first valid pixel or -1 if none found
-    int getPixelDateIndex(int startIndex, int endIndex, const PixelType &mask, int offset)
+    int getPixelDateIndex(int startIndex, int endIndex, const MaskType &mask, int offset)
         const
     {
 
@@ -221,7 +217,7 @@ private:
 
         while (!done) {
             // if the pixel is masked then continue
-            if (mask[index + offset] != 0) {
+            if (IsDateMasked(mask, index + offset)) {
                 // if it was the last index then stop and return -1
                 if (index == endIndex) {
                     index = -1;
@@ -251,12 +247,12 @@ private:
  */
 template<class TInputImage, class TMask, class TOutputImage>
 class ITK_EXPORT TemporalResamplingFilter
-  : public itk::BinaryFunctorImageFilter<TInputImage, TMask, TInputImage, GapFillingFunctor<typename TInputImage::PixelType, typename TMask::PixelType, typename TOutputImage::PixelType> >
+  : public otb::BinaryVectorFunctorImageFilter<TInputImage, TMask, TInputImage, GapFillingFunctor<typename TInputImage::PixelType, typename TMask::PixelType, typename TOutputImage::PixelType> >
 {
 public:
   /** Standard class typedefs. */
   typedef TemporalResamplingFilter                       Self;
-  typedef itk::BinaryFunctorImageFilter<TInputImage, TMask, TInputImage, GapFillingFunctor<typename TInputImage::PixelType, typename TMask::PixelType, typename TOutputImage::PixelType> > Superclass;
+  typedef otb::BinaryVectorFunctorImageFilter<TInputImage, TMask, TInputImage, GapFillingFunctor<typename TInputImage::PixelType, typename TMask::PixelType, typename TOutputImage::PixelType> > Superclass;
   typedef itk::SmartPointer<Self>                             Pointer;
   typedef itk::SmartPointer<const Self>                       ConstPointer;
 
@@ -264,7 +260,7 @@ public:
   itkNewMacro(Self);
 
   /** Run-time type information (and related methods). */
-  itkTypeMacro(TemporalResamplingFilter, BinaryFunctorImageFilter);
+  itkTypeMacro(TemporalResamplingFilter, BinaryVectorFunctorImageFilter);
 
   /** Accessors for the sensors data */
   void SetInputData(const SensorDataCollection _arg)
@@ -299,21 +295,21 @@ private:
 
 };
 
-/** Binary functor image filter which produces a vector image with a
+/** Binary vector functor image filter which produces a vector image with a
 * number of bands different from the input images */
 template<typename Input1ImageType, typename Input2ImageType, typename OutputImageType, typename Functor>
 class ITK_EXPORT BinaryFunctorImageFilterWithNBands
-    : public itk::BinaryFunctorImageFilter<Input1ImageType,
-                                           Input2ImageType,
-                                           OutputImageType,
-                                           Functor >
+    : public otb::BinaryVectorFunctorImageFilter<Input1ImageType,
+                                                 Input2ImageType,
+                                                 OutputImageType,
+                                                 Functor >
 {
 public:
     typedef BinaryFunctorImageFilterWithNBands Self;
-    typedef itk::BinaryFunctorImageFilter<Input1ImageType,
-                                          Input2ImageType,
-                                          OutputImageType,
-                                          Functor > Superclass;
+    typedef otb::BinaryVectorFunctorImageFilter<Input1ImageType,
+                                                Input2ImageType,
+                                                OutputImageType,
+                                                Functor > Superclass;
     typedef itk::SmartPointer<Self> Pointer;
     typedef itk::SmartPointer<const Self> ConstPointer;
 
@@ -0,0 +1,120 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+
+#ifndef __otbVectorFunctorImageFilter_h
+#define __otbVectorFunctorImageFilter_h
+
+#include "itkUnaryFunctorImageFilter.h"
+#include "itkBinaryFunctorImageFilter.h"
+
+namespace otb
+{
+
+/** \class UnaryVectorFunctorImageFilter
+ * \brief Unary functor image filter for the functors which fill a vector output pixel.
+ *
+ * The functor is called as functor(input, output) and must set all the components
+ * of the output pixel, which has the number of components of the output image.
+ * Each thread uses its own copy of the functor and a single output pixel for all
+ * its pixels, so nothing is allocated per pixel. The functors can keep mutable
+ * scratch buffers, they are not shared between the threads.
+ *
+ * \ingroup OTBImageManipulation
+ */
+template <class TInputImage, class TOutputImage, class TFunctor>
+class ITK_EXPORT UnaryVectorFunctorImageFilter
+  : public itk::UnaryFunctorImageFilter<TInputImage, TOutputImage, TFunctor>
+{
+public:
+  /** Standard class typedefs. */
+  typedef UnaryVectorFunctorImageFilter                                      Self;
+  typedef itk::UnaryFunctorImageFilter<TInputImage, TOutputImage, TFunctor>  Superclass;
+  typedef itk::SmartPointer<Self>                                            Pointer;
+  typedef itk::SmartPointer<const Self>                                      ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(UnaryVectorFunctorImageFilter, UnaryFunctorImageFilter);
+
+  /** Template related typedefs */
+  typedef TFunctor                                        FunctorType;
+  typedef TInputImage                                     InputImageType;
+  typedef TOutputImage                                    OutputImageType;
+  typedef typename OutputImageType::PixelType             OutputPixelType;
+  typedef typename Superclass::InputImageRegionType       InputImageRegionType;
+  typedef typename Superclass::OutputImageRegionType      OutputImageRegionType;
+
+protected:
+  UnaryVectorFunctorImageFilter() {}
+  virtual ~UnaryVectorFunctorImageFilter() {}
+
+  virtual void ThreadedGenerateData(const OutputImageRegionType &outputRegionForThread, itk::ThreadIdType threadId);
+
+private:
+  UnaryVectorFunctorImageFilter(const Self &); //purposely not implemented
+  void operator =(const Self&); //purposely not implemented
+};
+
+/** \class BinaryVectorFunctorImageFilter
+ * \brief Binary functor image filter for the functors which fill a vector output pixel.
+ *
+ * The functor is called as functor(input1, input2, output), like in
+ * UnaryVectorFunctorImageFilter. Both inputs must be images.
+ *
+ * \ingroup OTBImageManipulation
+ */
+template <class TInputImage1, class TInputImage2, class TOutputImage, class TFunctor>
+class ITK_EXPORT BinaryVectorFunctorImageFilter
+  : public itk::BinaryFunctorImageFilter<TInputImage1, TInputImage2, TOutputImage, TFunctor>
+{
+public:
+  /** Standard class typedefs. */
+  typedef BinaryVectorFunctorImageFilter                                                   Self;
+  typedef itk::BinaryFunctorImageFilter<TInputImage1, TInputImage2, TOutputImage, TFunctor> Superclass;
+  typedef itk::SmartPointer<Self>                                                          Pointer;
+  typedef itk::SmartPointer<const Self>                                                    ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(BinaryVectorFunctorImageFilter, BinaryFunctorImageFilter);
+
+  /** Template related typedefs */
+  typedef TFunctor                                        FunctorType;
+  typedef TInputImage1                                    Input1ImageType;
+  typedef TInputImage2                                    Input2ImageType;
+  typedef TOutputImage                                    OutputImageType;
+  typedef typename OutputImageType::PixelType             OutputPixelType;
+  typedef typename Superclass::OutputImageRegionType      OutputImageRegionType;
+
+protected:
+  BinaryVectorFunctorImageFilter() {}
+  virtual ~BinaryVectorFunctorImageFilter() {}
+
+  virtual void ThreadedGenerateData(const OutputImageRegionType &outputRegionForThread, itk::ThreadIdType threadId);
+
+private:
+  BinaryVectorFunctorImageFilter(const Self &); //purposely not implemented
+  void operator =(const Self&); //purposely not implemented
+};
+
+} // end namespace otb
+#ifndef OTB_MANUAL_INSTANTIATION
+#include "otbVectorFunctorImageFilter.txx"
+#endif
+#endif
@@ -0,0 +1,88 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+
+#ifndef __otbVectorFunctorImageFilter_txx
+#define __otbVectorFunctorImageFilter_txx
+
+#include "otbVectorFunctorImageFilter.h"
+
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkProgressReporter.h"
+
+namespace otb
+{
+
+template <class TInputImage, class TOutputImage, class TFunctor>
+void
+UnaryVectorFunctorImageFilter<TInputImage, TOutputImage, TFunctor>
+::ThreadedGenerateData(const OutputImageRegionType &outputRegionForThread, itk::ThreadIdType threadId)
+{
+  const InputImageType *inputPtr = this->GetInput();
+  OutputImageType *outputPtr = this->GetOutput(0);
+
+  InputImageRegionType inputRegionForThread;
+  this->CallCopyOutputRegionToInputRegion(inputRegionForThread, outputRegionForThread);
+
+  itk::ImageRegionConstIterator<InputImageType> inputIt(inputPtr, inputRegionForThread);
+  itk::ImageRegionIterator<OutputImageType> outputIt(outputPtr, outputRegionForThread);
+
+  itk::ProgressReporter progress(this, threadId, outputRegionForThread.GetNumberOfPixels());
+
+  FunctorType functor = this->GetFunctor();
+  OutputPixelType outputPixel(outputPtr->GetNumberOfComponentsPerPixel());
+
+  for (inputIt.GoToBegin(), outputIt.GoToBegin(); !outputIt.IsAtEnd(); ++inputIt, ++outputIt)
+    {
+    functor(inputIt.Get(), outputPixel);
+    outputIt.Set(outputPixel);
+    progress.CompletedPixel();
+    }
+}
+
+template <class TInputImage1, class TInputImage2, class TOutputImage, class TFunctor>
+void
+BinaryVectorFunctorImageFilter<TInputImage1, TInputImage2, TOutputImage, TFunctor>
+::ThreadedGenerateData(const OutputImageRegionType &outputRegionForThread, itk::ThreadIdType threadId)
+{
+  const Input1ImageType *input1Ptr = dynamic_cast<const Input1ImageType *>(itk::ProcessObject::GetInput(0));
+  const Input2ImageType *input2Ptr = dynamic_cast<const Input2ImageType *>(itk::ProcessObject::GetInput(1));
+  if (!input1Ptr || !input2Ptr)
+    {
+    itkExceptionMacro(<< "Both inputs must be images");
+    }
+  OutputImageType *outputPtr = this->GetOutput(0);
+
+  itk::ImageRegionConstIterator<Input1ImageType> input1It(input1Ptr, outputRegionForThread);
+  itk::ImageRegionConstIterator<Input2ImageType> input2It(input2Ptr, outputRegionForThread);
+  itk::ImageRegionIterator<OutputImageType> outputIt(outputPtr, outputRegionForThread);
+
+  itk::ProgressReporter progress(this, threadId, outputRegionForThread.GetNumberOfPixels());
+
+  FunctorType functor = this->GetFunctor();
+  OutputPixelType outputPixel(outputPtr->GetNumberOfComponentsPerPixel());
+
+  for (input1It.GoToBegin(), input2It.GoToBegin(), outputIt.GoToBegin(); !outputIt.IsAtEnd();
+       ++input1It, ++input2It, ++outputIt)
+    {
+    functor(input1It.Get(), input2It.Get(), outputPixel);
+    outputIt.Set(outputPixel);
+    progress.CompletedPixel();
+    }
+}
+
+} // end namespace otb
+
+#endif
@@ -0,0 +1,185 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#define BOOST_TEST_MODULE CovarianceAccumulator
+#include "boost/test/unit_test.hpp"
+
+#include "otbCovarianceAccumulator.h"
+
+typedef std::vector<std::vector<float>> SampleListType;
+
+// correlated samples around an offset, the first ones far from the mean
+static SampleListType RandomSamples(size_t count, unsigned int dimension, double offset, unsigned int seed)
+{
+    std::mt19937 rng(seed);
+    std::normal_distribution<double> normal(0.0, 1.0);
+
+    SampleListType samples(count, std::vector<float>(dimension));
+    for (size_t s = 0; s < count; s++) {
+        const double common = normal(rng);
+        for (unsigned int i = 0; i < dimension; i++) {
+            samples[s][i] = static_cast<float>(offset * (i + 1) + (i + 1) * common + normal(rng)
+                                               + (s < 10 ? 50.0 : 0.0));
+        }
+    }
+    return samples;
+}
+
+// the two-pass mean and unbiased covariance
+static void TwoPass(const SampleListType &samples, std::vector<double> &mean, std::vector<double> &covariance)
+{
+    const unsigned int dimension = samples[0].size();
+    std::vector<long double> sum(dimension, 0.0L);
+    for (const auto &x : samples) {
+        for (unsigned int i = 0; i < dimension; i++) {
+            sum[i] += x[i];
+        }
+    }
+    mean.resize(dimension);
+    for (unsigned int i = 0; i < dimension; i++) {
+        mean[i] = static_cast<double>(sum[i] / samples.size());
+    }
+
+    std::vector<long double> cross(dimension * dimension, 0.0L);
+    for (const auto &x : samples) {
+        for (unsigned int i = 0; i < dimension; i++) {
+            for (unsigned int j = 0; j < dimension; j++) {
+                cross[i * dimension + j] += (static_cast<long double>(x[i]) - mean[i])
+                                            * (static_cast<long double>(x[j]) - mean[j]);
+            }
+        }
+    }
+    covariance.resize(dimension * dimension);
+    for (size_t k = 0; k < cross.size(); k++) {
+        covariance[k] = static_cast<double>(cross[k] / (samples.size() - 1.0L));
+    }
+}
+
+static void CheckAccumulator(otb::CovarianceAccumulator &accumulator, const SampleListType &samples, double tolerance)
+{
+    std::vector<double> refMean, refCovariance;
+    TwoPass(samples, refMean, refCovariance);
+
+    std::vector<double> mean, covariance;
+    accumulator.GetMean(mean);
+    accumulator.GetCovariance(covariance);
+
+    const unsigned int dimension = refMean.size();
+    BOOST_REQUIRE_EQUAL(accumulator.GetCount(), samples.size());
+    BOOST_REQUIRE_EQUAL(mean.size(), dimension);
+    BOOST_REQUIRE_EQUAL(covariance.size(), dimension * dimension);
+
+    double meanError = 0.0;
+    double covarianceError = 0.0;
+    for (unsigned int i = 0; i < dimension; i++) {
+        const double sigma = std::sqrt(refCovariance[i * dimension + i]);
+        meanError = std::max(meanError, std::abs(mean[i] - refMean[i]) / sigma);
+        for (unsigned int j = 0; j < dimension; j++) {
+            // relative to the standard deviations, as the covariances may be close to 0
+            const double scale = sigma * std::sqrt(refCovariance[j * dimension + j]);
+            covarianceError = std::max(covarianceError,
+                                       std::abs(covariance[i * dimension + j] - refCovariance[i * dimension + j]) / scale);
+        }
+    }
+    BOOST_CHECK_SMALL(meanError, tolerance);
+    BOOST_CHECK_SMALL(covarianceError, tolerance);
+}
+
+// accumulates the samples in chunks, like the threads of a filter
+static std::vector<otb::CovarianceAccumulator> AccumulateChunks(const SampleListType &samples, unsigned int dimension,
+                                                                const std::vector<size_t> &chunkSizes)
+{
+    std::vector<otb::CovarianceAccumulator> accumulators(chunkSizes.size());
+    size_t s = 0;
+    for (size_t c = 0; c < chunkSizes.size(); c++) {
+        accumulators[c].Reset(dimension);
+        for (size_t k = 0; k < chunkSizes[c]; k++, s++) {
+            accumulators[c].Add(&samples[s][0]);
+        }
+    }
+    return accumulators;
+}
+
+BOOST_AUTO_TEST_CASE(SingleAccumulator)
+{
+    const unsigned int dimension = 5;
+    const SampleListType samples = RandomSamples(1000, dimension, 3.0, 1);
+
+    otb::CovarianceAccumulator accumulator;
+    accumulator.Reset(dimension);
+    for (const auto &x : samples) {
+        accumulator.Add(&x[0]);
+    }
+    CheckAccumulator(accumulator, samples, 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE(LargeOffset)
+{
+    // the unshifted sums of the products lose all the digits of the covariance
+    const unsigned int dimension = 4;
+    const SampleListType samples = RandomSamples(20000, dimension, 1e5, 2);
+
+    otb::CovarianceAccumulator accumulator;
+    accumulator.Reset(dimension);
+    for (const auto &x : samples) {
+        accumulator.Add(&x[0]);
+    }
+    CheckAccumulator(accumulator, samples, 1e-6);
+}
+
+BOOST_AUTO_TEST_CASE(MergeOrder)
+{
+    const unsigned int dimension = 6;
+    const SampleListType samples = RandomSamples(5000, dimension, 1e4, 3);
+
+    // uneven chunks, some of them empty or smaller than a block
+    const std::vector<size_t> chunkSizes = { 1, 0, 63, 1000, 129, 2, 0, 1800, 1, 2004 };
+
+    // in order, as the filter merges its threads
+    std::vector<otb::CovarianceAccumulator> forward = AccumulateChunks(samples, dimension, chunkSizes);
+    for (size_t c = 1; c < forward.size(); c++) {
+        forward[0].Merge(forward[c]);
+    }
+    CheckAccumulator(forward[0], samples, 1e-6);
+
+    // in reverse order
+    std::vector<otb::CovarianceAccumulator> backward = AccumulateChunks(samples, dimension, chunkSizes);
+    for (size_t c = backward.size() - 1; c > 0; c--) {
+        backward[c - 1].Merge(backward[c]);
+    }
+    CheckAccumulator(backward[0], samples, 1e-6);
+
+    // by pairs, as a tree
+    std::vector<otb::CovarianceAccumulator> tree = AccumulateChunks(samples, dimension, chunkSizes);
+    for (size_t step = 1; step < tree.size(); step *= 2) {
+        for (size_t c = 0; c + step < tree.size(); c += 2 * step) {
+            tree[c].Merge(tree[c + step]);
+        }
+    }
+    CheckAccumulator(tree[0], samples, 1e-6);
+
+    // into an empty accumulator
+    otb::CovarianceAccumulator empty;
+    empty.Reset(dimension);
+    std::vector<otb::CovarianceAccumulator> chunks = AccumulateChunks(samples, dimension, chunkSizes);
+    for (auto &chunk : chunks) {
+        empty.Merge(chunk);
+    }
+    CheckAccumulator(empty, samples, 1e-6);
+}
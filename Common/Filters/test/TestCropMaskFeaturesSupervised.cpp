@@ -0,0 +1,158 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+
+#include <random>
+
+#define BOOST_TEST_MODULE CropMaskFeaturesSupervised
+#include "boost/test/unit_test.hpp"
+
+#include "CropMaskFeaturesSupervised.hxx"
+
+// The window features as they were computed before the window kernels,
+// one window at a time
+
+static void ReferenceWindowAverageDifferences(const PixelValueType *ndvi, int numImages, int w,
+                                              PixelValueType &maxDif, PixelValueType &minDif)
+{
+    for (int i = 0; i <= numImages - 2 * w; i++ ) {
+        double first = 0.0;
+        for (int j = i; j <= i + w - 1; j++ ) {
+            first += ndvi[j];
+        }
+        first = first / w;
+        double second = 0.0;
+        for (int j = i + w; j <= i + 2 * w - 1; j++ ) {
+            second += ndvi[j];
+        }
+        second = second / w;
+
+        PixelValueType dif = static_cast<PixelValueType>(first - second);
+        maxDif = (i == 0 || maxDif < dif ? dif : maxDif);
+        minDif = (i == 0 || minDif > dif ? dif : minDif);
+    }
+}
+
+static bool ReferenceMaxWindowAverage(const PixelValueType *ndvi, int numImages, int w,
+                                      PixelValueType &maxAvg, int &start)
+{
+    bool found = false;
+    for (int i = 0; i <= numImages - w; i++) {
+        double avg = 0.0;
+        for (int j = i; j <= i + w - 1; j++ ) {
+            avg += ndvi[j];
+        }
+        avg = avg / w;
+
+        PixelValueType avgPix = static_cast<PixelValueType>(avg);
+        if (avgPix > maxAvg) {
+            maxAvg = avgPix;
+            start = i;
+            found = true;
+        }
+    }
+    return found;
+}
+
+static double ReferenceMaxCenteredWindowAverage(const PixelValueType *ndvi, int numImages, int w)
+{
+    double meanMax = 0;
+    for (int i = 0; i < numImages; i++) {
+        double meanMaxCurrent = 0.0;
+        int startIndex = std::max(0, i-w);
+        int endIndex = std::min(numImages-1, i+w);
+        int count = endIndex - startIndex + 1;
+        for (int j = startIndex; j <= endIndex; j++) {
+            meanMaxCurrent += ndvi[j];
+        }
+        meanMaxCurrent /= count;
+        if (i == 0 || meanMaxCurrent > meanMax) {
+            meanMax = meanMaxCurrent;
+        }
+    }
+    return meanMax;
+}
+
+// NDVI series of 1 to 45 dates, some of them without data
+static std::vector<std::vector<PixelValueType>> RandomSeries(int count)
+{
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> length(1, 45);
+    std::uniform_int_distribution<int> band(0, 10000);
+    std::uniform_real_distribution<double> u(0.0, 1.0);
+
+    std::vector<std::vector<PixelValueType>> series(count);
+    for (auto &ndvi : series) {
+        ndvi.resize(length(rng));
+        for (auto &value : ndvi) {
+            if (u(rng) < 0.1) {
+                value = NODATA;
+            } else {
+                int b2 = band(rng);
+                int b3 = band(rng);
+                value = (std::abs(b3+b2)<0.000001) ? 0 : static_cast<PixelValueType>(b3-b2)/(b3+b2);
+            }
+        }
+    }
+    return series;
+}
+
+BOOST_AUTO_TEST_CASE(SameWindowAverageDifferences)
+{
+    unsigned int differences = 0;
+    for (const auto &ndvi : RandomSeries(20000)) {
+        const int n = ndvi.size();
+        for (int w = 1; w <= 6 && 2 * w <= n; w++) {
+            PixelValueType maxDif = 0, minDif = 0, refMaxDif = 0, refMinDif = 0;
+            WindowAverageDifferences(&ndvi[0], n, w, maxDif, minDif);
+            ReferenceWindowAverageDifferences(&ndvi[0], n, w, refMaxDif, refMinDif);
+            if (maxDif != refMaxDif || minDif != refMinDif) {
+                differences++;
+            }
+        }
+    }
+    BOOST_CHECK_EQUAL(differences, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(SameMaxWindowAverage)
+{
+    unsigned int differences = 0;
+    for (const auto &ndvi : RandomSeries(20000)) {
+        const int n = ndvi.size();
+        for (int w = 1; w <= 6 && w <= n; w++) {
+            PixelValueType maxAvg = 0, refMaxAvg = 0;
+            int start = 0, refStart = 0;
+            bool found = MaxWindowAverage(&ndvi[0], n, w, maxAvg, start);
+            bool refFound = ReferenceMaxWindowAverage(&ndvi[0], n, w, refMaxAvg, refStart);
+            if (found != refFound || maxAvg != refMaxAvg || start != refStart) {
+                differences++;
+            }
+        }
+    }
+    BOOST_CHECK_EQUAL(differences, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(SameMaxCenteredWindowAverage)
+{
+    unsigned int differences = 0;
+    for (const auto &ndvi : RandomSeries(20000)) {
+        const int n = ndvi.size();
+        for (int w = 1; w <= 6; w++) {
+            if (MaxCenteredWindowAverage(&ndvi[0], n, w) != ReferenceMaxCenteredWindowAverage(&ndvi[0], n, w)) {
+                differences++;
+            }
+        }
+    }
+    BOOST_CHECK_EQUAL(differences, 0u);
+}
@@ -0,0 +1,132 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+#ifndef itkRunLengthLabelErodeImageFilter_h
+#define itkRunLengthLabelErodeImageFilter_h
+
+#include "itkImageToImageFilter.h"
+
+#include <vector>
+
+namespace itk
+{
+/** \class RunLengthLabelErodeImageFilter
+ * \brief Erodes all the labels of a 2D label image in a single pass.
+ *
+ * A pixel keeps its label if all the pixels under the structuring element
+ * have the same label, otherwise it is set to BackgroundValue. Pixels of
+ * the background label are left unchanged, and the pixels outside the
+ * image do not erode, as with BinaryErodeImageFilter. The result is the
+ * same as chaining one BinaryErodeImageFilter per label with the same
+ * kernel and a background of 0.
+ *
+ * Each row of the kernel must be a single run of active pixels. The kernel
+ * is reduced to these runs, and each image row to the end of the run of
+ * identical labels starting at each pixel. A pixel is then tested with
+ * one comparison per kernel row, whatever the number of labels.
+ */
+template< typename TInputImage, typename TOutputImage, typename TKernel >
+class ITK_TEMPLATE_EXPORT RunLengthLabelErodeImageFilter:
+  public ImageToImageFilter< TInputImage, TOutputImage >
+{
+public:
+  /** Standard class typedefs. */
+  typedef RunLengthLabelErodeImageFilter                  Self;
+  typedef ImageToImageFilter< TInputImage, TOutputImage > Superclass;
+  typedef SmartPointer< Self >                            Pointer;
+  typedef SmartPointer< const Self >                      ConstPointer;
+
+  /** Standard New method. */
+  itkNewMacro(Self);
+
+  /** Runtime information support. */
+  itkTypeMacro(RunLengthLabelErodeImageFilter,
+               ImageToImageFilter);
+
+  /** Image related typedefs. */
+  typedef TInputImage                                InputImageType;
+  typedef TOutputImage                               OutputImageType;
+  typedef typename InputImageType::PixelType         InputPixelType;
+  typedef typename OutputImageType::PixelType        OutputPixelType;
+  typedef typename InputImageType::RegionType        InputImageRegionType;
+  typedef typename OutputImageType::RegionType       OutputImageRegionType;
+  typedef typename InputImageType::IndexValueType    IndexValueType;
+
+  /** Kernel typedef. */
+  typedef TKernel                                    KernelType;
+  typedef typename TKernel::PixelType                KernelPixelType;
+
+  /** ImageDimension constants */
+  itkStaticConstMacro(InputImageDimension, unsigned int,
+                      TInputImage::ImageDimension);
+  itkStaticConstMacro(OutputImageDimension, unsigned int,
+                      TOutputImage::ImageDimension);
+
+  /** Set the structuring element. */
+  void SetKernel(const KernelType & kernel)
+  {
+    m_Kernel = kernel;
+    this->Modified();
+  }
+  itkGetConstReferenceMacro(Kernel, KernelType);
+
+  /** The value of the eroded pixels, and the label left unchanged. */
+  itkSetMacro(BackgroundValue, OutputPixelType);
+  itkGetConstMacro(BackgroundValue, OutputPixelType);
+
+#ifdef ITK_USE_CONCEPT_CHECKING
+  // Begin concept checking
+  itkConceptMacro( InputConvertibleToOutputCheck,
+                   ( Concept::Convertible< InputPixelType, OutputPixelType > ) );
+  itkConceptMacro( SameDimensionCheck,
+                   ( Concept::SameDimension< InputImageDimension, OutputImageDimension > ) );
+  itkConceptMacro( TwoDimensionalCheck,
+                   ( Concept::SameDimension< InputImageDimension, 2 > ) );
+  // End concept checking
+#endif
+
+protected:
+  RunLengthLabelErodeImageFilter();
+  ~RunLengthLabelErodeImageFilter() {}
+
+  /** The input requested region is the output one padded by the kernel radius. */
+  virtual void GenerateInputRequestedRegion() ITK_OVERRIDE;
+
+  virtual void BeforeThreadedGenerateData() ITK_OVERRIDE;
+
+  virtual void ThreadedGenerateData(const OutputImageRegionType & outputRegionForThread,
+                                    ThreadIdType threadId) ITK_OVERRIDE;
+
+private:
+  ITK_DISALLOW_COPY_AND_ASSIGN(RunLengthLabelErodeImageFilter);
+
+  /** Active pixels [Begin, End] of the kernel row at offset Row */
+  struct KernelRun
+  {
+    IndexValueType Row;
+    IndexValueType Begin;
+    IndexValueType End;
+  };
+
+  KernelType              m_Kernel;
+  OutputPixelType         m_BackgroundValue;
+  std::vector<KernelRun>  m_KernelRuns;
+}; // end of class
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkRunLengthLabelErodeImageFilter.hxx"
+#endif
+
+#endif
@@ -0,0 +1,226 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+#ifndef itkRunLengthLabelErodeImageFilter_hxx
+#define itkRunLengthLabelErodeImageFilter_hxx
+
+#include "itkRunLengthLabelErodeImageFilter.h"
+#include "itkImageRegionIterator.h"
+#include "itkImageRegionConstIterator.h"
+
+#include <algorithm>
+
+namespace itk
+{
+template< typename TInputImage, typename TOutputImage, typename TKernel >
+RunLengthLabelErodeImageFilter< TInputImage, TOutputImage, TKernel >
+::RunLengthLabelErodeImageFilter()
+  : m_BackgroundValue(NumericTraits< OutputPixelType >::ZeroValue())
+{
+}
+
+template< typename TInputImage, typename TOutputImage, typename TKernel >
+void
+RunLengthLabelErodeImageFilter< TInputImage, TOutputImage, TKernel >
+::GenerateInputRequestedRegion()
+{
+  Superclass::GenerateInputRequestedRegion();
+
+  typename InputImageType::Pointer inputPtr = const_cast< InputImageType * >( this->GetInput() );
+  if ( !inputPtr )
+    {
+    return;
+    }
+
+  InputImageRegionType inputRequestedRegion = inputPtr->GetRequestedRegion();
+  inputRequestedRegion.PadByRadius( m_Kernel.GetRadius() );
+  if ( inputRequestedRegion.Crop( inputPtr->GetLargestPossibleRegion() ) )
+    {
+    inputPtr->SetRequestedRegion(inputRequestedRegion);
+    return;
+    }
+
+  // the requested region is outside the largest possible region
+  inputPtr->SetRequestedRegion(inputRequestedRegion);
+  InvalidRequestedRegionError e(__FILE__, __LINE__);
+  e.SetLocation(ITK_LOCATION);
+  e.SetDescription("Requested region is (at least partially) outside the largest possible region.");
+  e.SetDataObject(inputPtr);
+  throw e;
+}
+
+template< typename TInputImage, typename TOutputImage, typename TKernel >
+void
+RunLengthLabelErodeImageFilter< TInputImage, TOutputImage, TKernel >
+::BeforeThreadedGenerateData()
+{
+  typedef typename KernelType::OffsetType KernelOffsetType;
+
+  const typename KernelType::SizeType radius = m_Kernel.GetRadius();
+  const IndexValueType rx = static_cast< IndexValueType >( radius[0] );
+  const IndexValueType ry = static_cast< IndexValueType >( radius[1] );
+
+  m_KernelRuns.clear();
+  for ( IndexValueType dy = -ry; dy <= ry; dy++ )
+    {
+    KernelRun run = { dy, 0, 0 };
+    unsigned int nbRuns = 0;
+    bool previousActive = false;
+    for ( IndexValueType dx = -rx; dx <= rx; dx++ )
+      {
+      KernelOffsetType offset;
+      offset[0] = dx;
+      offset[1] = dy;
+      const bool active =
+        m_Kernel[m_Kernel.GetNeighborhoodIndex(offset)] > NumericTraits< KernelPixelType >::ZeroValue();
+      if ( active )
+        {
+        if ( !previousActive )
+          {
+          run.Begin = dx;
+          nbRuns++;
+          }
+        run.End = dx;
+        }
+      previousActive = active;
+      }
+    if ( nbRuns > 1 )
+      {
+      itkExceptionMacro(<< "Each row of the kernel must be a single run of active pixels, row " << dy
+                        << " has " << nbRuns);
+      }
+    if ( nbRuns == 1 )
+      {
+      m_KernelRuns.push_back(run);
+      }
+    }
+}
+
+template< typename TInputImage, typename TOutputImage, typename TKernel >
+void
+RunLengthLabelErodeImageFilter< TInputImage, TOutputImage, TKernel >
+::ThreadedGenerateData(const OutputImageRegionType & outputRegionForThread,
+                       ThreadIdType itkNotUsed(threadId))
+{
+  const InputImageType *input = this->GetInput();
+  OutputImageType      *output = this->GetOutput();
+
+  const InputImageRegionType & largest = input->GetLargestPossibleRegion();
+  const IndexValueType xMin = largest.GetIndex(0);
+  const IndexValueType xMax = xMin + static_cast< IndexValueType >( largest.GetSize(0) ) - 1;
+  const IndexValueType yMin = largest.GetIndex(1);
+  const IndexValueType yMax = yMin + static_cast< IndexValueType >( largest.GetSize(1) ) - 1;
+
+  const IndexValueType outX0 = outputRegionForThread.GetIndex(0);
+  const IndexValueType outX1 = outX0 + static_cast< IndexValueType >( outputRegionForThread.GetSize(0) ) - 1;
+  const IndexValueType outY0 = outputRegionForThread.GetIndex(1);
+  const IndexValueType outY1 = outY0 + static_cast< IndexValueType >( outputRegionForThread.GetSize(1) ) - 1;
+
+  // extent of the kernel, including the center row
+  IndexValueType minBegin = 0, maxEnd = 0, minRow = 0, maxRow = 0;
+  for ( const KernelRun & run : m_KernelRuns )
+    {
+    minBegin = std::min(minBegin, run.Begin);
+    maxEnd = std::max(maxEnd, run.End);
+    minRow = std::min(minRow, run.Row);
+    maxRow = std::max(maxRow, run.Row);
+    }
+
+  // the columns of the input rows which are needed
+  const IndexValueType bufX0 = std::max(xMin, outX0 + minBegin);
+  const IndexValueType bufX1 = std::min(xMax, outX1 + maxEnd);
+  const size_t width = bufX1 - bufX0 + 1;
+
+  // ring of the input rows under the kernel: their labels and, for each
+  // pixel, the last column of the run of identical labels starting there
+  const size_t nbSlots = maxRow - minRow + 1;
+  std::vector< std::vector< InputPixelType > > labels( nbSlots, std::vector< InputPixelType >(width) );
+  std::vector< std::vector< IndexValueType > > runEnds( nbSlots, std::vector< IndexValueType >(width) );
+  std::vector< IndexValueType > slotRows( nbSlots, yMin - 1 );
+
+  auto loadRow = [&](IndexValueType row) -> size_t
+    {
+    const size_t slot = static_cast< size_t >( row - yMin ) % nbSlots;
+    if ( slotRows[slot] != row )
+      {
+      InputImageRegionType rowRegion;
+      rowRegion.SetIndex(0, bufX0);
+      rowRegion.SetIndex(1, row);
+      rowRegion.SetSize(0, width);
+      rowRegion.SetSize(1, 1);
+      ImageRegionConstIterator< InputImageType > it(input, rowRegion);
+      std::vector< InputPixelType > & rowLabels = labels[slot];
+      std::vector< IndexValueType > & rowEnds = runEnds[slot];
+      for ( size_t i = 0; !it.IsAtEnd(); ++it, ++i )
+        {
+        rowLabels[i] = it.Get();
+        }
+      rowEnds[width - 1] = bufX1;
+      for ( size_t i = width - 1; i > 0; i-- )
+        {
+        rowEnds[i - 1] = (rowLabels[i - 1] == rowLabels[i]) ? rowEnds[i] : bufX0 + static_cast< IndexValueType >( i - 1 );
+        }
+      slotRows[slot] = row;
+      }
+    return slot;
+    };
+
+  const size_t noSlot = nbSlots;
+  std::vector< size_t > runSlots( m_KernelRuns.size() );
+
+  ImageRegionIterator< OutputImageType > outIt(output, outputRegionForThread);
+  outIt.GoToBegin();
+  for ( IndexValueType y = outY0; y <= outY1; y++ )
+    {
+    const size_t centerSlot = loadRow(y);
+    for ( size_t k = 0; k < m_KernelRuns.size(); k++ )
+      {
+      const IndexValueType row = y + m_KernelRuns[k].Row;
+      // the rows outside the image do not erode
+      runSlots[k] = (row < yMin || row > yMax) ? noSlot : loadRow(row);
+      }
+
+    const std::vector< InputPixelType > & centerLabels = labels[centerSlot];
+    for ( IndexValueType x = outX0; x <= outX1; x++, ++outIt )
+      {
+      const InputPixelType label = centerLabels[x - bufX0];
+      OutputPixelType value = static_cast< OutputPixelType >( label );
+      if ( value != m_BackgroundValue )
+        {
+        for ( size_t k = 0; k < m_KernelRuns.size(); k++ )
+          {
+          if ( runSlots[k] == noSlot )
+            {
+            continue;
+            }
+          const IndexValueType lo = std::max(x + m_KernelRuns[k].Begin, xMin);
+          const IndexValueType hi = std::min(x + m_KernelRuns[k].End, xMax);
+          if ( lo > hi )
+            {
+            continue;
+            }
+          // the kernel run must lie in a single run of the same label
+          if ( labels[runSlots[k]][lo - bufX0] != label || runEnds[runSlots[k]][lo - bufX0] < hi )
+            {
+            value = m_BackgroundValue;
+            break;
+            }
+          }
+        }
+      outIt.Set(value);
+      }
+    }
+}
+} // end namespace itk
+#endif
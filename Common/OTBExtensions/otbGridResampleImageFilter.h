@@ -36,7 +36,11 @@
 
 #include "itkImageToImageFilter.h"
 #include "itkLinearInterpolateImageFunction.h"
+#include "itkNearestNeighborInterpolateImageFunction.h"
 #include "itkDefaultConvertPixelTraits.h"
+#include "itkProgressReporter.h"
+
+#include <vector>
 
 #include "otbMacro.h"
 
@@ -63,6 +67,19 @@ namespace otb
  *  If CheckOutputBounds flag is set to true (default value), the
  *  interpolated value will be checked for output pixel type range
  *  prior to casting.
+ *
+ *  When the output grid is aligned with the input one, with an
+ *  integer ratio between their spacings (like the 10 m, 20 m and
+ *  60 m grids of a tile), and the interpolator is a nearest
+ *  neighbour or a linear one, the filter does not call the
+ *  interpolator. The input pixels needed by each output row and
+ *  column are computed once, and the output rows are computed
+ *  directly from the image buffers.
+ *
+ *  If UseMeanAggregation flag is set to true, an output pixel
+ *  covering several input pixels of such aligned grids (when
+ *  downsampling) is the mean of these input pixels, instead of the
+ *  interpolated value. On the other grids, the interpolator is used.
  *   
  * \ingroup OTBImageManipulation
  * \ingroup Streamed
@@ -142,6 +159,10 @@ public:
   itkGetMacro(CheckOutputBounds,bool);
   itkBooleanMacro(CheckOutputBounds);
   
+  itkSetMacro(UseMeanAggregation,bool);
+  itkGetMacro(UseMeanAggregation,bool);
+  itkBooleanMacro(UseMeanAggregation);
+
   itkSetObjectMacro(Interpolator,InterpolatorType);
   itkGetObjectMacro(Interpolator,InterpolatorType);
   
@@ -201,6 +222,46 @@ protected:
   void PrintSelf(std::ostream& os, itk::Indent indent) const;
 
 private:
+  typedef typename IndexType::IndexValueType                              IndexValueType;
+  typedef typename InputImageType::InternalPixelType                      InputInternalPixelType;
+  typedef typename OutputImageType::InternalPixelType                     OutputInternalPixelType;
+  typedef itk::NearestNeighborInterpolateImageFunction<InputImageType,
+                                                       TInterpolatorPrecision> NearestNeighborInterpolatorType;
+
+  /** The kernels computing the output pixels */
+  typedef enum
+  {
+    KERNEL_INTERPOLATOR,
+    KERNEL_NEAREST_NEIGHBOR,
+    KERNEL_LINEAR,
+    KERNEL_MEAN
+  } KernelType;
+
+  /** Position of the output grid relative to the input one, along an axis */
+  struct AxisAlignment
+  {
+    bool           Aligned;
+    bool           Upsampling;  // the input pixels are split in Ratio output pixels
+    IndexValueType Ratio;
+    IndexValueType Offset;      // the first input pixel (downsampling) or output pixel
+                                // fraction (upsampling) covered by the output pixel 0
+  };
+
+  /** The input pixels used by the output pixels of a row or a column,
+   *  as offsets along the axis from the start of the input buffer */
+  struct AxisTaps
+  {
+    std::vector<IndexValueType> First;
+    std::vector<IndexValueType> Last;
+    std::vector<double>         Weight; // weight of Last, for the linear kernel
+  };
+
+  AxisAlignment ComputeAxisAlignment(unsigned int dim) const;
+
+  void ComputeAxisTaps(unsigned int dim, IndexValueType start, unsigned int size, AxisTaps & taps) const;
+
+  void IntegerRatioGenerateData(const OutputImageRegionType& region, itk::ProgressReporter & progress);
+
   GridResampleImageFilter(const Self &); //purposely not implemented
   void operator =(const Self&); //purposely not implemented
 
@@ -214,6 +275,10 @@ private:
   bool                   m_CheckOutputBounds;    // Shall we check
                                                  // output bounds when
                                                  // casting?
+
+  bool                   m_UseMeanAggregation;   // Average the covered
+                                                 // input pixels when
+                                                 // downsampling
   
   InterpolatorPointerType m_Interpolator;        // Interpolator used
                                                  // for resampling
@@ -222,6 +287,14 @@ private:
                                                    // variable for
                                                    // speed-up. Computed
                                                    // in BeforeThreadedGenerateData
+
+  KernelType              m_Kernel;                // Kernel used by
+                                                   // ThreadedGenerateData.
+                                                   // Selected in
+                                                   // BeforeThreadedGenerateData
+
+  AxisAlignment           m_AxisAlignments[ImageDimension]; // Alignment
+                                                   // of the grids
   
 };
 
@@ -27,6 +27,9 @@
 #include "itkImageScanlineIterator.h"
 #include "itkContinuousIndex.h"
 
+#include <algorithm>
+#include <type_traits>
+
 namespace otb
 {
   
@@ -40,8 +43,10 @@ GridResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecision>
     m_OutputSpacing(),
     m_EdgePaddingValue(),
     m_CheckOutputBounds(true),
+    m_UseMeanAggregation(false),
     m_Interpolator(),
-    m_ReachableOutputRegion()
+    m_ReachableOutputRegion(),
+    m_Kernel(KERNEL_INTERPOLATOR)
 {
   // Set linear interpolator as default
   m_Interpolator = dynamic_cast<InterpolatorType *>(DefaultInterpolatorType::New().GetPointer());
@@ -179,6 +184,18 @@ GridResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecision>
       StreamingTraits<typename Superclass::InputImageType>::CalculateNeededRadiusForInterpolator(this->GetInterpolator());
   inputRequestedRegion.PadByRadius(interpolatorRadius);
 
+  // The mean of the covered input pixels reaches half an output pixel
+  // around the pixel centers
+  if(m_UseMeanAggregation)
+    {
+    SizeType aggregationRadius;
+    for(unsigned int dim = 0; dim < ImageDimension;++dim)
+      {
+      aggregationRadius[dim] = vcl_ceil(0.5 * vcl_abs(m_OutputSpacing[dim] / inputPtr->GetSpacing()[dim]));
+      }
+    inputRequestedRegion.PadByRadius(aggregationRadius);
+    }
+
   // crop the input requested region at the input's largest possible region
   if (inputRequestedRegion.Crop(inputPtr->GetLargestPossibleRegion()))
     {
@@ -282,6 +299,186 @@ GridResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecision>
 
   m_ReachableOutputRegion.SetIndex(outputIndex);
   m_ReachableOutputRegion.SetSize(outputSize);
+
+  // Select the kernel. The specialised ones work on the buffers of
+  // images of scalar components, on aligned grids.
+  m_Kernel = KERNEL_INTERPOLATOR;
+
+  bool aligned = std::is_arithmetic<InputInternalPixelType>::value
+    && std::is_arithmetic<OutputInternalPixelType>::value
+    && this->GetInput()->GetNumberOfComponentsPerPixel() == this->GetOutput()->GetNumberOfComponentsPerPixel();
+  bool upsampling = false;
+  for(unsigned int dim = 0; dim < ImageDimension && aligned;++dim)
+    {
+    m_AxisAlignments[dim] = this->ComputeAxisAlignment(dim);
+    aligned = m_AxisAlignments[dim].Aligned;
+    upsampling = upsampling || m_AxisAlignments[dim].Upsampling;
+    }
+
+  if(aligned)
+    {
+    if(m_UseMeanAggregation && !upsampling)
+      {
+      m_Kernel = KERNEL_MEAN;
+      }
+    else if(dynamic_cast<NearestNeighborInterpolatorType *>(m_Interpolator.GetPointer()))
+      {
+      m_Kernel = KERNEL_NEAREST_NEIGHBOR;
+      }
+    else if(dynamic_cast<DefaultInterpolatorType *>(m_Interpolator.GetPointer()))
+      {
+      m_Kernel = KERNEL_LINEAR;
+      }
+    }
+  otbMsgDevMacro(<< "Resampling kernel: " << m_Kernel);
+}
+
+template <typename TInputImage, typename TOutputImage,
+          typename TInterpolatorPrecision>
+typename GridResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecision>::AxisAlignment
+GridResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecision>
+::ComputeAxisAlignment(unsigned int dim) const
+{
+  // Tolerance on the ratio of the spacings and on the positions, in pixels
+  const double epsilon = 1e-6;
+
+  AxisAlignment alignment;
+  alignment.Aligned = false;
+  alignment.Upsampling = false;
+  alignment.Ratio = 1;
+  alignment.Offset = 0;
+
+  const double delta = this->GetOutput()->GetSpacing()[dim] / this->GetInput()->GetSpacing()[dim];
+  if(!(delta > 0))
+    {
+    return alignment;
+    }
+
+  // Position of the output pixel 0 in the input image
+  IndexType outIndex;
+  outIndex.Fill(0);
+  PointType outPoint;
+  ContinuousInputIndexType inCIndex;
+  this->GetOutput()->TransformIndexToPhysicalPoint(outIndex,outPoint);
+  this->GetInput()->TransformPhysicalPointToContinuousIndex(outPoint,inCIndex);
+
+  if(delta >= 1.0 - epsilon)
+    {
+    // The output pixel 0 covers the input pixels Offset to Offset + Ratio - 1
+    const double ratio = vcl_floor(delta + 0.5);
+    const double first = inCIndex[dim] - 0.5 * (ratio - 1.0);
+    const double offset = vcl_floor(first + 0.5);
+    if(vcl_abs(delta - ratio) > epsilon * ratio || vcl_abs(first - offset) > epsilon)
+      {
+      return alignment;
+      }
+    alignment.Ratio = static_cast<IndexValueType>(ratio);
+    alignment.Offset = static_cast<IndexValueType>(offset);
+    }
+  else
+    {
+    // The output pixel 0 covers the fraction Offset of Ratio of an input pixel,
+    // counted from the left edge of the input pixel 0
+    const double ratio = vcl_floor(1.0 / delta + 0.5);
+    const double fraction = (inCIndex[dim] + 0.5) * ratio - 0.5;
+    const double offset = vcl_floor(fraction + 0.5);
+    if(vcl_abs(1.0 / delta - ratio) > epsilon * ratio || vcl_abs(fraction - offset) > epsilon * ratio)
+      {
+      return alignment;
+      }
+    alignment.Upsampling = true;
+    alignment.Ratio = static_cast<IndexValueType>(ratio);
+    alignment.Offset = static_cast<IndexValueType>(offset);
+    }
+
+  alignment.Aligned = true;
+  return alignment;
+}
+
+// Integer division rounding towards negative infinity
+template <typename T>
+inline T FloorDivide(T numerator, T denominator)
+{
+  return numerator >= 0 ? numerator / denominator : -((denominator - 1 - numerator) / denominator);
+}
+
+template <typename TInputImage, typename TOutputImage,
+          typename TInterpolatorPrecision>
+void
+GridResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecision>
+::ComputeAxisTaps(unsigned int dim, IndexValueType start, unsigned int size, AxisTaps & taps) const
+{
+  const AxisAlignment & alignment = m_AxisAlignments[dim];
+  const IndexValueType ratio = alignment.Ratio;
+
+  const IndexValueType bufferStart = this->GetInput()->GetBufferedRegion().GetIndex()[dim];
+  const IndexValueType bufferEnd = bufferStart + this->GetInput()->GetBufferedRegion().GetSize()[dim] - 1;
+
+  taps.First.resize(size);
+  taps.Last.resize(size);
+  taps.Weight.assign(size, 0.);
+
+  for(unsigned int i = 0; i < size;++i)
+    {
+    const IndexValueType outIndex = start + i;
+
+    // Position of the output pixel center in the input image, as
+    // numerator / denominator
+    IndexValueType numerator, denominator;
+    if(alignment.Upsampling)
+      {
+      numerator = 2 * (alignment.Offset + outIndex) + 1 - ratio;
+      denominator = 2 * ratio;
+      }
+    else
+      {
+      numerator = 2 * (alignment.Offset + ratio * outIndex) + ratio - 1;
+      denominator = 2;
+      }
+
+    IndexValueType first, last;
+    double weight = 0.;
+    switch(m_Kernel)
+      {
+      case KERNEL_NEAREST_NEIGHBOR:
+        // Rounds the half pixels up, like the interpolator
+        first = last = FloorDivide(2 * numerator + denominator, 2 * denominator);
+        break;
+      case KERNEL_LINEAR:
+        first = FloorDivide(numerator, denominator);
+        last = first + 1;
+        weight = static_cast<double>(numerator - first * denominator) / denominator;
+        break;
+      default:
+        first = alignment.Offset + ratio * outIndex;
+        last = first + ratio - 1;
+        break;
+      }
+
+    // Clamp to the buffer, like the interpolators
+    if(m_Kernel == KERNEL_MEAN)
+      {
+      first = std::max(first, bufferStart);
+      last = std::min(last, bufferEnd);
+      }
+    else
+      {
+      if(first < bufferStart || first > bufferEnd)
+        {
+        first = std::min(std::max(first, bufferStart), bufferEnd);
+        weight = 0.;
+        }
+      if(last > bufferEnd || weight == 0.)
+        {
+        last = first;
+        weight = 0.;
+        }
+      }
+
+    taps.First[i] = first - bufferStart;
+    taps.Last[i] = last - bufferStart;
+    taps.Weight[i] = weight;
+    }
 }
 
 template <typename TInputImage, typename TOutputImage,
@@ -331,6 +528,12 @@ GridResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecision>
                                   threadId,
                                   regionToCompute.GetSize()[1]);
 
+  if(m_Kernel != KERNEL_INTERPOLATOR)
+    {
+    this->IntegerRatioGenerateData(regionToCompute, progress);
+    return;
+    }
+
   // Temporary variables for loop
   PointType outPoint;
   ContinuousInputIndexType inCIndex;
@@ -377,6 +580,141 @@ GridResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecision>
 
 }
 
+template <typename TInputImage, typename TOutputImage,
+          typename TInterpolatorPrecision>
+void
+GridResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecision>
+::IntegerRatioGenerateData(const OutputImageRegionType& region, itk::ProgressReporter & progress)
+{
+  OutputImageType *outputPtr = this->GetOutput();
+  const InputImageType *inputPtr = this->GetInput();
+
+  const unsigned int nComponents = inputPtr->GetNumberOfComponentsPerPixel();
+  const unsigned int width = region.GetSize()[0];
+  const unsigned int height = region.GetSize()[1];
+
+  // The taps of the columns and rows of the region
+  AxisTaps columns, rows;
+  this->ComputeAxisTaps(0, region.GetIndex()[0], width, columns);
+  this->ComputeAxisTaps(1, region.GetIndex()[1], height, rows);
+
+  // Bounds of the output components, like CastPixelWithBoundsChecking
+  const double minValue = static_cast<double>(itk::NumericTraits<OutputInternalPixelType>::NonpositiveMin());
+  const double maxValue = static_cast<double>(itk::NumericTraits<OutputInternalPixelType>::max());
+  const bool checkBounds = m_CheckOutputBounds;
+
+  const InputInternalPixelType *inBuffer = inputPtr->GetBufferPointer();
+  const size_t inLineStride = static_cast<size_t>(inputPtr->GetBufferedRegion().GetSize()[0]) * nComponents;
+
+  OutputInternalPixelType *outBuffer = outputPtr->GetBufferPointer();
+  const size_t outLineStride = static_cast<size_t>(outputPtr->GetBufferedRegion().GetSize()[0]) * nComponents;
+  outBuffer += static_cast<size_t>(outputPtr->ComputeOffset(region.GetIndex())) * nComponents;
+
+  // Horizontally interpolated lines, for the linear kernel
+  std::vector<double> upperLine, lowerLine;
+  if(m_Kernel == KERNEL_LINEAR)
+    {
+    upperLine.resize(static_cast<size_t>(width) * nComponents);
+    lowerLine.resize(static_cast<size_t>(width) * nComponents);
+    }
+
+  for(unsigned int y = 0; y < height;++y)
+    {
+    OutputInternalPixelType *out = outBuffer + y * outLineStride;
+    const InputInternalPixelType *upper = inBuffer + rows.First[y] * inLineStride;
+
+    switch(m_Kernel)
+      {
+      case KERNEL_NEAREST_NEIGHBOR:
+        for(unsigned int x = 0; x < width;++x)
+          {
+          const InputInternalPixelType *in = upper + columns.First[x] * nComponents;
+          for(unsigned int n = 0; n < nComponents;++n)
+            {
+            double value = static_cast<double>(in[n]);
+            if(checkBounds)
+              {
+              value = std::min(std::max(value, minValue), maxValue);
+              }
+            out[x * nComponents + n] = static_cast<OutputInternalPixelType>(value);
+            }
+          }
+        break;
+
+      case KERNEL_LINEAR:
+        {
+        // Same operations as itk::LinearInterpolateImageFunction: the two
+        // lines are interpolated along x, then the results along y
+        const InputInternalPixelType *lower = inBuffer + rows.Last[y] * inLineStride;
+        const double weightY = rows.Weight[y];
+        const unsigned int nLines = weightY > 0. ? 2 : 1;
+        for(unsigned int l = 0; l < nLines;++l)
+          {
+          const InputInternalPixelType *line = l == 0 ? upper : lower;
+          double *interpolated = l == 0 ? &upperLine[0] : &lowerLine[0];
+          for(unsigned int x = 0; x < width;++x)
+            {
+            const InputInternalPixelType *left = line + columns.First[x] * nComponents;
+            const InputInternalPixelType *right = line + columns.Last[x] * nComponents;
+            const double weightX = columns.Weight[x];
+            for(unsigned int n = 0; n < nComponents;++n)
+              {
+              const double value = static_cast<double>(left[n]);
+              interpolated[x * nComponents + n] = weightX > 0.
+                ? value + (static_cast<double>(right[n]) - value) * weightX
+                : value;
+              }
+            }
+          }
+
+        const size_t lineSize = upperLine.size();
+        for(size_t i = 0; i < lineSize;++i)
+          {
+          double value = nLines == 2 ? upperLine[i] + (lowerLine[i] - upperLine[i]) * weightY : upperLine[i];
+          if(checkBounds)
+            {
+            value = std::min(std::max(value, minValue), maxValue);
+            }
+          out[i] = static_cast<OutputInternalPixelType>(value);
+          }
+        }
+        break;
+
+      default:
+        for(unsigned int x = 0; x < width;++x)
+          {
+          // The pixels covering only the padding keep the padding value
+          if(rows.Last[y] < rows.First[y] || columns.Last[x] < columns.First[x])
+            {
+            continue;
+            }
+          const IndexValueType count = (rows.Last[y] - rows.First[y] + 1) * (columns.Last[x] - columns.First[x] + 1);
+          for(unsigned int n = 0; n < nComponents;++n)
+            {
+            double sum = 0.;
+            for(IndexValueType row = rows.First[y]; row <= rows.Last[y];++row)
+              {
+              const InputInternalPixelType *in = inBuffer + row * inLineStride + n;
+              for(IndexValueType column = columns.First[x]; column <= columns.Last[x];++column)
+                {
+                sum += static_cast<double>(in[column * nComponents]);
+                }
+              }
+            double value = sum / count;
+            if(checkBounds)
+              {
+              value = std::min(std::max(value, minValue), maxValue);
+              }
+            out[x * nComponents + n] = static_cast<OutputInternalPixelType>(value);
+            }
+          }
+        break;
+      }
+
+    progress.CompletedPixel();
+    }
+}
+
 template <typename TInputImage, typename TOutputImage,
           typename TInterpolatorPrecision>
 void
@@ -427,6 +765,8 @@ GridResampleImageFilter<TInputImage, TOutputImage, TInterpolatorPrecision>
   os << indent << "Interpolator: " << m_Interpolator.GetPointer() << std::endl;
   os << indent << "CheckOutputBounds: " << ( m_CheckOutputBounds ? "On" : "Off" )
      << std::endl;
+  os << indent << "UseMeanAggregation: " << ( m_UseMeanAggregation ? "On" : "Off" )
+     << std::endl;
 }
 
 
@@ -93,24 +93,23 @@ void TimeSeriesReader::Build(std::vector<std::string>::const_iterator begin, std
     // sort the descriptors after the aquisition date
     std::sort(m_Descriptors.begin(), m_Descriptors.end(), TimeSeriesReader::SortUnmergedMetadata);
 
+    // The bands which are not resampled are read directly from the product rasters
     for (const ImageDescriptor& id : m_Descriptors) {
         for (const auto &b : id.bands) {
-            m_FloatImageList->PushBack(b);
+            m_BandsConcat->AddBand(b);
         }
         m_UInt8ImageList->PushBack(id.mask);
     }
-    m_BandsConcat->SetInput(m_FloatImageList);
     m_MaskConcat->SetInput(m_UInt8ImageList);
 
     for (const ImageDescriptor& id : m_Descriptors) {
         if (id.mission == SENTINEL) {
             for (const auto &b : id.redEdgeBands) {
-                m_RedEdgeBandImageList->PushBack(b);
+                m_RedEdgeBandConcat->AddBand(b);
             }
             m_RedEdgeMaskImageList->PushBack(id.mask);
         }
     }
-    m_RedEdgeBandConcat->SetInput(m_RedEdgeBandImageList);
     m_RedEdgeMaskConcat->SetInput(m_RedEdgeMaskImageList);
 }
 
@@ -199,15 +198,13 @@ TimeSeriesReader::TimeSeriesReader()
 
     m_ChannelExtractors = ExtractChannelListType::New();
 
-    m_FloatImageList = FloatImageListType::New();
     m_UInt8ImageList = UInt8ImageListType::New();
-    m_RedEdgeBandImageList = FloatImageListType::New();
     m_RedEdgeMaskImageList = UInt8ImageListType::New();
 
-    m_BandsConcat = ConcatenateFloatImagesFilterType::New();
-    m_MaskConcat = ConcatenateUInt8ImagesFilterType::New();
-    m_RedEdgeBandConcat = ConcatenateFloatImagesFilterType::New();
-    m_RedEdgeMaskConcat = ConcatenateUInt8ImagesFilterType::New();
+    m_BandsConcat = BandStackImageSourceType::New();
+    m_MaskConcat = TemporalMaskPackingFilterType::New();
+    m_RedEdgeBandConcat = BandStackImageSourceType::New();
+    m_RedEdgeMaskConcat = TemporalMaskPackingFilterType::New();
 }
 
 TimeSeriesReader::~TimeSeriesReader()
@@ -37,8 +37,10 @@
 // Filters
 #include "itkVectorIndexSelectionCastImageFilter.h"
 
+#include "otbBandStackImageSource.h"
 #include "otbSentinelMaskFilter.h"
 #include "otbSpotMaskFilter.h"
+#include "otbTemporalMaskPackingFilter.h"
 
 #include <map>
 #include <string>
@@ -47,7 +49,7 @@
 #include "boost/filesystem.hpp"
 
 typedef otb::VectorImage<float, 2> ImageType;
-typedef otb::Wrapper::UInt8VectorImageType MaskType;
+typedef otb::TemporalMaskImageType MaskType;
 
 typedef otb::ImageList<otb::Wrapper::FloatImageType> FloatImageListType;
 typedef otb::ImageList<otb::Wrapper::UInt8ImageType> UInt8ImageListType;
@@ -107,6 +109,8 @@ typedef otb::ObjectList<SpotMaskFilterType> SpotMaskFilterListType;
 typedef otb::SentinelMaskFilter SentinelMaskFilterType;
 typedef otb::ObjectList<SentinelMaskFilterType> SentinelMaskFilterListType;
 
+typedef otb::TemporalMaskPackingFilter TemporalMaskPackingFilterType;
+
 typedef itk::VectorIndexSelectionCastImageFilter<otb::Wrapper::Int16VectorImageType,
                                                  otb::Wrapper::FloatImageType>
     ExtractChannelFilterType;
@@ -131,6 +135,8 @@ typedef otb::ImageListToVectorImageFilter<otb::ImageList<otb::Wrapper::Int16Imag
     ConcatenateInt16ImagesFilterType;
 typedef otb::ObjectList<ConcatenateInt16ImagesFilterType> ConcatenateInt16ImagesFilterListType;
 
+typedef otb::BandStackImageSource BandStackImageSourceType;
+
 typedef itk::CastImageFilter<otb::Wrapper::Int16ImageType, otb::Wrapper::FloatImageType>
     CastInt16FloatFilterType;
 typedef otb::ObjectList<CastInt16FloatFilterType> CastInt16FloatFilterListType;
@@ -227,14 +233,12 @@ protected:
     //    SentinelMaskFilterListType::Pointer               m_SentinelMaskFilters;
     ExtractChannelListType::Pointer m_ChannelExtractors;
 
-    FloatImageListType::Pointer m_FloatImageList;
     UInt8ImageListType::Pointer m_UInt8ImageList;
-    FloatImageListType::Pointer m_RedEdgeBandImageList;
     UInt8ImageListType::Pointer m_RedEdgeMaskImageList;
-    ConcatenateFloatImagesFilterType::Pointer m_BandsConcat;
-    ConcatenateUInt8ImagesFilterType::Pointer m_MaskConcat;
-    ConcatenateFloatImagesFilterType::Pointer m_RedEdgeBandConcat;
-    ConcatenateUInt8ImagesFilterType::Pointer m_RedEdgeMaskConcat;
+    BandStackImageSourceType::Pointer m_BandsConcat;
+    TemporalMaskPackingFilterType::Pointer m_MaskConcat;
+    BandStackImageSourceType::Pointer m_RedEdgeBandConcat;
+    TemporalMaskPackingFilterType::Pointer m_RedEdgeMaskConcat;
 
     TimeSeriesReader();
     virtual ~TimeSeriesReader();
@@ -0,0 +1,295 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+
+#include "otbBandStackImageSource.h"
+
+#include "itkImageRegionConstIterator.h"
+#include "itkVectorIndexSelectionCastImageFilter.h"
+#include "otbGDALDriverManagerWrapper.h"
+#include "otbImageFileReader.h"
+#include "otbImageListToVectorImageFilter.h"
+#include "otbMultiToMonoChannelExtractROI.h"
+
+#include "gdal_priv.h"
+
+#include <sstream>
+
+namespace otb
+{
+
+typedef itk::VectorIndexSelectionCastImageFilter<otb::Wrapper::FloatVectorImageType,
+                                                 otb::Wrapper::FloatImageType>      ChannelSelectionType;
+typedef otb::MultiToMonoChannelExtractROI<float, float>                             ChannelExtractorType;
+typedef otb::ImageFileReader<otb::Wrapper::FloatVectorImageType>                   ReaderType;
+typedef otb::ImageListToVectorImageFilter<otb::ImageList<otb::Wrapper::FloatImageType>,
+                                          otb::Wrapper::FloatVectorImageType>       ConcatenationType;
+
+// Removes the extended file name options which do not change the pixels read,
+// returns false if there are other options
+static bool GetPlainFileName(const std::string &extendedFileName, std::string &fileName)
+{
+    const std::string::size_type pos = extendedFileName.find('?');
+    fileName = extendedFileName.substr(0, pos);
+    if (pos == std::string::npos) {
+        return true;
+    }
+
+    std::istringstream options(extendedFileName.substr(pos + 1));
+    std::string option;
+    while (std::getline(options, option, '&')) {
+        const std::string name = option.substr(0, option.find('='));
+        if (!name.empty() && name != "skipgeom" && name != "skipcarto") {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename TImage1, typename TImage2>
+static bool HaveSameGrid(const TImage1 *image1, const TImage2 *image2)
+{
+    return image1->GetLargestPossibleRegion() == image2->GetLargestPossibleRegion() &&
+           image1->GetOrigin() == image2->GetOrigin() &&
+           image1->GetSpacing() == image2->GetSpacing();
+}
+
+/**
+ * Constructor.
+ */
+BandStackImageSource
+::BandStackImageSource()
+  : m_NumberOfComponents(0)
+{
+  this->SetNumberOfRequiredInputs(0);
+}
+
+/**
+ * Destructor.
+ */
+BandStackImageSource
+::~BandStackImageSource()
+{}
+
+void
+BandStackImageSource
+::AddBand(BandImageType *band)
+{
+  band->UpdateOutputInformation();
+  if (m_ReferenceBand.IsNull())
+    {
+    m_ReferenceBand = band;
+    }
+  else if (!HaveSameGrid(band, m_ReferenceBand.GetPointer()))
+    {
+    itkExceptionMacro("The band " << m_NumberOfComponents << " does not have the size, origin and spacing of the first band");
+    }
+
+  const unsigned int component = m_NumberOfComponents++;
+
+  std::string fileName;
+  int bandNumber;
+  GDALDatasetWrapper::Pointer dataset;
+  if (FindFileBand(band, fileName, bandNumber) && (dataset = OpenDataset(fileName, band)).IsNotNull()
+      && bandNumber <= dataset->GetDataSet()->GetRasterCount())
+    {
+    if (!m_FileReads.empty() && m_FileReads.back().FileName == fileName
+        && m_FileReads.back().FirstComponent + m_FileReads.back().Bands.size() == component)
+      {
+      m_FileReads.back().Bands.push_back(bandNumber);
+      }
+    else
+      {
+      FileRead read;
+      read.Dataset = dataset;
+      read.FileName = fileName;
+      read.FirstComponent = component;
+      read.Bands.push_back(bandNumber);
+      m_FileReads.push_back(read);
+      }
+    }
+  else
+    {
+    InputCopy copy;
+    copy.InputIndex = this->GetNumberOfIndexedInputs();
+    copy.Component = component;
+    m_InputCopies.push_back(copy);
+    this->SetNthInput(copy.InputIndex, band);
+    }
+
+  this->Modified();
+}
+
+unsigned int
+BandStackImageSource
+::GetNumberOfDirectBands() const
+{
+  unsigned int count = 0;
+  for (const FileRead &read : m_FileReads)
+    {
+    count += read.Bands.size();
+    }
+  return count;
+}
+
+// Follows the channel extractions and concatenations, which keep the pixels unchanged,
+// up to the reader of the band
+bool
+BandStackImageSource
+::FindFileBand(const BandImageType *band, std::string &fileName, int &bandNumber) const
+{
+  const BandImageType *image = band;
+  while (image)
+    {
+    const itk::ProcessObject *source = image->GetSource().GetPointer();
+
+    const OutputImageType *vectorImage = NULL;
+    unsigned int channel = 0;
+    if (const ChannelSelectionType *selection = dynamic_cast<const ChannelSelectionType *>(source))
+      {
+      vectorImage = selection->GetInput();
+      channel = selection->GetIndex();
+      }
+    else if (const ChannelExtractorType *extractor = dynamic_cast<const ChannelExtractorType *>(source))
+      {
+      vectorImage = extractor->GetInput();
+      channel = extractor->GetChannel() - 1;
+      }
+    if (!vectorImage || !HaveSameGrid(vectorImage, band))
+      {
+      return false;
+      }
+
+    source = vectorImage->GetSource().GetPointer();
+    if (const ReaderType *reader = dynamic_cast<const ReaderType *>(source))
+      {
+      bandNumber = channel + 1;
+      return GetPlainFileName(reader->GetFileName(), fileName);
+      }
+
+    // the image list of the concatenation is only reachable through a non-const accessor
+    ConcatenationType *concatenation = const_cast<ConcatenationType *>(dynamic_cast<const ConcatenationType *>(source));
+    if (!concatenation || !concatenation->GetInput() || channel >= concatenation->GetInput()->Size())
+      {
+      return false;
+      }
+    image = concatenation->GetInput()->GetNthElement(channel);
+    }
+  return false;
+}
+
+GDALDatasetWrapper::Pointer
+BandStackImageSource
+::OpenDataset(const std::string &fileName, const BandImageType *band)
+{
+  auto it = m_Datasets.find(fileName);
+  if (it == m_Datasets.end())
+    {
+    GDALDatasetWrapper::Pointer dataset = GDALDriverManagerWrapper::GetInstance().Open(fileName);
+    const BandImageType::SizeType &size = band->GetLargestPossibleRegion().GetSize();
+    if (dataset.IsNotNull()
+        && (static_cast<itk::SizeValueType>(dataset->GetDataSet()->GetRasterXSize()) != size[0]
+            || static_cast<itk::SizeValueType>(dataset->GetDataSet()->GetRasterYSize()) != size[1]))
+      {
+      dataset = NULL;
+      }
+    it = m_Datasets.insert(std::make_pair(fileName, dataset)).first;
+    }
+  return it->second;
+}
+
+void
+BandStackImageSource
+::GenerateOutputInformation()
+{
+  OutputImageType *output = this->GetOutput();
+
+  // like ImageListToVectorImageFilter, an empty stack gives an empty output,
+  // for instance the red edge bands of a tile without Sentinel-2 products
+  if (m_ReferenceBand.IsNull())
+    {
+    output->SetNumberOfComponentsPerPixel(0);
+    return;
+    }
+
+  output->CopyInformation(m_ReferenceBand);
+  output->SetLargestPossibleRegion(m_ReferenceBand->GetLargestPossibleRegion());
+  output->SetMetaDataDictionary(m_ReferenceBand->GetMetaDataDictionary());
+  output->SetNumberOfComponentsPerPixel(m_NumberOfComponents);
+}
+
+void
+BandStackImageSource
+::GenerateInputRequestedRegion()
+{
+  const RegionType &region = this->GetOutput()->GetRequestedRegion();
+  for (const InputCopy &copy : m_InputCopies)
+    {
+    BandImageType *input = static_cast<BandImageType *>(this->GetInput(copy.InputIndex));
+    input->SetRequestedRegion(region);
+    }
+}
+
+void
+BandStackImageSource
+::GenerateData()
+{
+  OutputImageType *output = this->GetOutput();
+  const RegionType &region = output->GetRequestedRegion();
+  output->SetBufferedRegion(region);
+  output->Allocate();
+
+  const RegionType::IndexType &start = output->GetLargestPossibleRegion().GetIndex();
+  const int x = region.GetIndex()[0] - start[0];
+  const int y = region.GetIndex()[1] - start[1];
+  const int width = region.GetSize()[0];
+  const int height = region.GetSize()[1];
+  float *buffer = output->GetBufferPointer();
+
+  const GSpacing pixelSpace = m_NumberOfComponents * sizeof(float);
+  for (FileRead &read : m_FileReads)
+    {
+    if (read.Dataset->GetDataSet()->RasterIO(GF_Read, x, y, width, height,
+                                             buffer + read.FirstComponent, width, height, GDT_Float32,
+                                             static_cast<int>(read.Bands.size()), &read.Bands[0],
+                                             pixelSpace, pixelSpace * width, sizeof(float)) != CE_None)
+      {
+      itkExceptionMacro("Unable to read the block " << region << " from " << read.FileName);
+      }
+    }
+
+  for (const InputCopy &copy : m_InputCopies)
+    {
+    const BandImageType *input = static_cast<const BandImageType *>(this->GetInput(copy.InputIndex));
+    float *out = buffer + copy.Component;
+    for (itk::ImageRegionConstIterator<BandImageType> it(input, region); !it.IsAtEnd(); ++it)
+      {
+      *out = it.Get();
+      out += m_NumberOfComponents;
+      }
+    }
+}
+
+/**
+ * PrintSelf method.
+ */
+void
+BandStackImageSource
+::PrintSelf(std::ostream& os, itk::Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "Bands: " << m_NumberOfComponents << std::endl;
+  os << indent << "Bands read from files: " << GetNumberOfDirectBands() << std::endl;
+}
+} // end namespace otb
@@ -0,0 +1,111 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+
+#ifndef __otbBandStackImageSource_h
+#define __otbBandStackImageSource_h
+
+#include "itkImageSource.h"
+#include "otbGDALDatasetWrapper.h"
+#include "otbWrapperTypes.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace otb
+{
+
+/** \class BandStackImageSource
+ * \brief Stacks single band images in a vector image, like ImageListToVectorImageFilter.
+ *
+ * The bands which are channels of a raster file, extracted without being resampled,
+ * are not read through their pipeline. The source keeps the GDAL dataset of the file
+ * open and reads the channels of each requested block with a single RasterIO call,
+ * directly in the output buffer. The other bands are inputs of the source and are
+ * copied in the output.
+ *
+ * All the bands must have the same size, origin and spacing. Without any band, the
+ * output is empty and has no component.
+ *
+ * \ingroup OTBImageManipulation
+ */
+class ITK_EXPORT BandStackImageSource
+  : public itk::ImageSource<otb::Wrapper::FloatVectorImageType>
+{
+public:
+  /** Standard class typedefs. */
+  typedef BandStackImageSource                                   Self;
+  typedef itk::ImageSource<otb::Wrapper::FloatVectorImageType>   Superclass;
+  typedef itk::SmartPointer<Self>                                Pointer;
+  typedef itk::SmartPointer<const Self>                          ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self)
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(BandStackImageSource, ImageSource)
+
+  typedef otb::Wrapper::FloatImageType         BandImageType;
+  typedef otb::Wrapper::FloatVectorImageType   OutputImageType;
+  typedef OutputImageType::RegionType          RegionType;
+
+  /** Appends a band to the output */
+  void AddBand(BandImageType *band);
+
+  /** The number of bands read from the raster files, without their pipeline */
+  unsigned int GetNumberOfDirectBands() const;
+
+protected:
+  /** Constructor. */
+  BandStackImageSource();
+  /** Destructor. */
+  virtual ~BandStackImageSource();
+  virtual void GenerateOutputInformation();
+  virtual void GenerateInputRequestedRegion();
+  virtual void GenerateData();
+  /** PrintSelf method */
+  void PrintSelf(std::ostream& os, itk::Indent indent) const;
+
+private:
+  BandStackImageSource(const Self &); //purposely not implemented
+  void operator =(const Self&); //purposely not implemented
+
+  /** Consecutive output components read from the same file */
+  struct FileRead
+  {
+    GDALDatasetWrapper::Pointer Dataset;
+    std::string                 FileName;
+    unsigned int                FirstComponent;
+    std::vector<int>            Bands;
+  };
+
+  /** An output component copied from an input */
+  struct InputCopy
+  {
+    unsigned int InputIndex;
+    unsigned int Component;
+  };
+
+  bool FindFileBand(const BandImageType *band, std::string &fileName, int &bandNumber) const;
+  GDALDatasetWrapper::Pointer OpenDataset(const std::string &fileName, const BandImageType *band);
+
+  unsigned int                                          m_NumberOfComponents;
+  BandImageType::Pointer                                m_ReferenceBand;
+  std::vector<FileRead>                                 m_FileReads;
+  std::vector<InputCopy>                                m_InputCopies;
+  std::map<std::string, GDALDatasetWrapper::Pointer>    m_Datasets;
+};
+} // end namespace otb
+#endif
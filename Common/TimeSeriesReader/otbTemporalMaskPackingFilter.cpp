@@ -0,0 +1,142 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+
+#include "otbTemporalMaskPackingFilter.h"
+
+#include "itkImageScanlineConstIterator.h"
+#include "itkProgressReporter.h"
+
+#include <algorithm>
+
+namespace otb
+{
+
+/**
+ * Constructor.
+ */
+TemporalMaskPackingFilter
+::TemporalMaskPackingFilter()
+{}
+
+/**
+ * Destructor.
+ */
+TemporalMaskPackingFilter
+::~TemporalMaskPackingFilter()
+{}
+
+unsigned int
+TemporalMaskPackingFilter
+::GetNumberOfDates()
+{
+  InputImageListType *inputPtr = this->GetInput();
+  return inputPtr ? inputPtr->Size() : 0;
+}
+
+void
+TemporalMaskPackingFilter
+::GenerateOutputInformation()
+{
+  OutputImageType *outputPtr = this->GetOutput();
+  InputImageListType *inputPtr = this->GetInput();
+  // like ImageListToVectorImageFilter, an empty list gives an empty output,
+  // for instance the red edge masks of a tile without Sentinel-2 products
+  if (!inputPtr || inputPtr->Size() == 0)
+    {
+    outputPtr->SetNumberOfComponentsPerPixel(0);
+    return;
+    }
+
+  InputImageType *firstMask = inputPtr->GetNthElement(0);
+  firstMask->UpdateOutputInformation();
+
+  outputPtr->CopyInformation(firstMask);
+  outputPtr->SetLargestPossibleRegion(firstMask->GetLargestPossibleRegion());
+
+  // initialize the number of words of the output pixels
+  outputPtr->SetNumberOfComponentsPerPixel((inputPtr->Size() + TEMPORAL_MASK_WORD_BITS - 1) / TEMPORAL_MASK_WORD_BITS);
+}
+
+void
+TemporalMaskPackingFilter
+::GenerateInputRequestedRegion()
+{
+  InputImageListType *inputPtr = this->GetInput();
+  const OutputImageRegionType &requestedRegion = this->GetOutput()->GetRequestedRegion();
+  for (unsigned int date = 0; date < GetNumberOfDates(); date++)
+    {
+    inputPtr->GetNthElement(date)->SetRequestedRegion(requestedRegion);
+    }
+}
+
+void
+TemporalMaskPackingFilter
+::ThreadedGenerateData(const OutputImageRegionType& outputRegionForThread, itk::ThreadIdType threadId)
+{
+  OutputImageType *outputPtr = this->GetOutput();
+  InputImageListType *inputPtr = this->GetInput();
+
+  const unsigned int words = outputPtr->GetNumberOfComponentsPerPixel();
+  const unsigned int width = outputRegionForThread.GetSize()[0];
+  const unsigned int height = outputRegionForThread.GetSize()[1];
+  const size_t lineStride = static_cast<size_t>(outputPtr->GetBufferedRegion().GetSize()[0]) * words;
+  TemporalMaskWordType *buffer = outputPtr->GetBufferPointer()
+      + static_cast<size_t>(outputPtr->ComputeOffset(outputRegionForThread.GetIndex())) * words;
+
+  itk::ProgressReporter progress(this, threadId, inputPtr->Size());
+
+  for (unsigned int y = 0; y < height; y++)
+    {
+    std::fill(buffer + y * lineStride, buffer + y * lineStride + width * words, 0);
+    }
+
+  // Each mask sets the bit of its date in the pixels it masks
+  for (unsigned int date = 0; date < inputPtr->Size(); date++)
+    {
+    const TemporalMaskWordType bit = static_cast<TemporalMaskWordType>(1) << (date % TEMPORAL_MASK_WORD_BITS);
+    TemporalMaskWordType *line = buffer + date / TEMPORAL_MASK_WORD_BITS;
+
+    itk::ImageScanlineConstIterator<InputImageType> it(inputPtr->GetNthElement(date), outputRegionForThread);
+    it.GoToBegin();
+    while (!it.IsAtEnd())
+      {
+      TemporalMaskWordType *out = line;
+      while (!it.IsAtEndOfLine())
+        {
+        if (it.Get() != 0)
+          {
+          *out |= bit;
+          }
+        out += words;
+        ++it;
+        }
+      it.NextLine();
+      line += lineStride;
+      }
+
+    progress.CompletedPixel();
+    }
+}
+
+/**
+ * PrintSelf method.
+ */
+void
+TemporalMaskPackingFilter
+::PrintSelf(std::ostream& os, itk::Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+}
+} // end namespace otb
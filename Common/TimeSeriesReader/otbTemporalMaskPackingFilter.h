@@ -0,0 +1,98 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+
+#ifndef __otbTemporalMaskPackingFilter_h
+#define __otbTemporalMaskPackingFilter_h
+
+#include "otbImageListToImageFilter.h"
+#include "otbVectorImage.h"
+#include "otbWrapperTypes.h"
+
+#define TEMPORAL_MASK_WORD_BITS 64
+
+namespace otb
+{
+
+/** The words of the bit-packed temporal masks, with a bit for each date */
+typedef uint64_t                                   TemporalMaskWordType;
+typedef otb::VectorImage<TemporalMaskWordType, 2>  TemporalMaskImageType;
+
+/** Tells if a date is masked, in a mask pixel having a component for each date */
+template <typename TValue>
+inline bool IsDateMasked(const itk::VariableLengthVector<TValue> &mask, int date)
+{
+    return mask[date] != 0;
+}
+
+/** Tells if a date is masked, in a bit-packed temporal mask pixel */
+inline bool IsDateMasked(const itk::VariableLengthVector<TemporalMaskWordType> &mask, int date)
+{
+    return ((mask[date / TEMPORAL_MASK_WORD_BITS] >> (date % TEMPORAL_MASK_WORD_BITS)) & 1) != 0;
+}
+
+/** \class TemporalMaskPackingFilter
+ * \brief Stacks the masks of the dates of a time series in a bit-packed temporal mask.
+ *
+ * The inputs are the single band masks of the dates, where the non-zero pixels are
+ * masked. The output has a component for each TEMPORAL_MASK_WORD_BITS dates: the
+ * date d is masked if the bit d % TEMPORAL_MASK_WORD_BITS of the component
+ * d / TEMPORAL_MASK_WORD_BITS is set. Use IsDateMasked to read it. Without any mask,
+ * the output is empty and has no component.
+ *
+ * \ingroup OTBImageManipulation
+ */
+class ITK_EXPORT TemporalMaskPackingFilter
+  : public otb::ImageListToImageFilter<otb::Wrapper::UInt8ImageType, TemporalMaskImageType>
+{
+public:
+  /** Standard class typedefs. */
+  typedef TemporalMaskPackingFilter                       Self;
+  typedef otb::ImageListToImageFilter<otb::Wrapper::UInt8ImageType, TemporalMaskImageType> Superclass;
+  typedef itk::SmartPointer<Self>                             Pointer;
+  typedef itk::SmartPointer<const Self>                       ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self)
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(TemporalMaskPackingFilter, ImageListToImageFilter)
+
+  /** Template related typedefs */
+  typedef Superclass::InputImageType            InputImageType;
+  typedef Superclass::InputImageListType        InputImageListType;
+  typedef TemporalMaskImageType                 OutputImageType;
+  typedef OutputImageType::RegionType           OutputImageRegionType;
+
+  /** The number of dates, which is the number of input masks */
+  unsigned int GetNumberOfDates();
+
+protected:
+  /** Constructor. */
+  TemporalMaskPackingFilter();
+  /** Destructor. */
+  virtual ~TemporalMaskPackingFilter();
+  virtual void GenerateOutputInformation();
+  virtual void GenerateInputRequestedRegion();
+  virtual void ThreadedGenerateData(const OutputImageRegionType& outputRegionForThread, itk::ThreadIdType threadId);
+  /** PrintSelf method */
+  void PrintSelf(std::ostream& os, itk::Indent indent) const;
+
+private:
+  TemporalMaskPackingFilter(const Self &); //purposely not implemented
+  void operator =(const Self&); //purposely not implemented
+};
+} // end namespace otb
+
+#endif
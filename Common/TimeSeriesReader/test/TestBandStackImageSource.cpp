@@ -0,0 +1,197 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+
+#define BOOST_TEST_MODULE BandStackImageSource
+#include "boost/test/unit_test.hpp"
+
+#include "otbBandStackImageSource.h"
+#include "otbImageFileReader.h"
+#include "otbImageFileWriter.h"
+#include "otbImageList.h"
+#include "otbImageListToVectorImageFilter.h"
+#include "otbMultiToMonoChannelExtractROI.h"
+#include "itkImageRegionConstIterator.h"
+
+typedef otb::Wrapper::FloatVectorImageType                                     VectorImageType;
+typedef otb::Wrapper::FloatImageType                                           BandImageType;
+typedef otb::ImageFileReader<VectorImageType>                                  ReaderType;
+typedef otb::ImageFileWriter<VectorImageType>                                  WriterType;
+typedef otb::MultiToMonoChannelExtractROI<float, float>                        ExtractorType;
+typedef otb::ImageList<BandImageType>                                          BandImageListType;
+typedef otb::ImageListToVectorImageFilter<BandImageListType, VectorImageType>  ConcatenationType;
+
+static const char *TEST_FILE = "band_stack.tif";
+
+// writes a small raster whose pixels are all different
+static VectorImageType::Pointer WriteTestFile(unsigned int bands)
+{
+    VectorImageType::SizeType size;
+    size[0] = 37;
+    size[1] = 23;
+    VectorImageType::IndexType index;
+    index.Fill(0);
+    VectorImageType::RegionType region(index, size);
+
+    auto image = VectorImageType::New();
+    image->SetRegions(region);
+    image->SetNumberOfComponentsPerPixel(bands);
+    image->Allocate();
+
+    VectorImageType::PixelType pixel(bands);
+    for (unsigned int y = 0; y < size[1]; y++) {
+        for (unsigned int x = 0; x < size[0]; x++) {
+            for (unsigned int b = 0; b < bands; b++) {
+                pixel[b] = 0.5f * x - 1.25f * y + 100.0f * b;
+            }
+            index[0] = x;
+            index[1] = y;
+            image->SetPixel(index, pixel);
+        }
+    }
+
+    auto writer = WriterType::New();
+    writer->SetInput(image);
+    writer->SetFileName(TEST_FILE);
+    writer->Update();
+
+    return image;
+}
+
+static ExtractorType::Pointer ExtractBand(VectorImageType *image, unsigned int channel)
+{
+    auto extractor = ExtractorType::New();
+    extractor->SetInput(image);
+    extractor->SetChannel(channel);
+    return extractor;
+}
+
+static void CheckSameImages(VectorImageType *image, VectorImageType *expected)
+{
+    BOOST_REQUIRE_EQUAL(image->GetNumberOfComponentsPerPixel(), expected->GetNumberOfComponentsPerPixel());
+    BOOST_REQUIRE(image->GetLargestPossibleRegion() == expected->GetLargestPossibleRegion());
+    BOOST_CHECK(image->GetOrigin() == expected->GetOrigin());
+    BOOST_CHECK(image->GetSpacing() == expected->GetSpacing());
+
+    itk::ImageRegionConstIterator<VectorImageType> it(image, image->GetLargestPossibleRegion());
+    itk::ImageRegionConstIterator<VectorImageType> itExpected(expected, expected->GetLargestPossibleRegion());
+    unsigned int differences = 0;
+    for (it.GoToBegin(), itExpected.GoToBegin(); !it.IsAtEnd(); ++it, ++itExpected) {
+        const VectorImageType::PixelType &pixel = it.Get();
+        const VectorImageType::PixelType &expectedPixel = itExpected.Get();
+        for (unsigned int b = 0; b < pixel.GetSize(); b++) {
+            if (pixel[b] != expectedPixel[b]) {
+                differences++;
+            }
+        }
+    }
+    BOOST_CHECK_EQUAL(differences, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(SameOutputAsImageListToVectorImageFilter)
+{
+    const unsigned int bands = 4;
+    auto memoryImage = WriteTestFile(bands);
+
+    auto reader = ReaderType::New();
+    reader->SetFileName(TEST_FILE);
+
+    std::vector<ExtractorType::Pointer> extractors;
+    auto bandList = BandImageListType::New();
+    auto stack = otb::BandStackImageSource::New();
+
+    // the bands of the file in a shuffled order, read directly from the raster
+    const unsigned int channels[] = { 2, 1, 4, 3, 1 };
+    for (unsigned int channel : channels) {
+        extractors.push_back(ExtractBand(reader->GetOutput(), channel));
+        bandList->PushBack(extractors.back()->GetOutput());
+        stack->AddBand(extractors.back()->GetOutput());
+    }
+
+    // a band without a file is copied from its pipeline
+    extractors.push_back(ExtractBand(memoryImage, 3));
+    bandList->PushBack(extractors.back()->GetOutput());
+    stack->AddBand(extractors.back()->GetOutput());
+
+    BOOST_CHECK_EQUAL(stack->GetNumberOfDirectBands(), 5u);
+
+    auto concat = ConcatenationType::New();
+    concat->SetInput(bandList);
+    concat->Update();
+
+    stack->Update();
+
+    CheckSameImages(stack->GetOutput(), concat->GetOutput());
+}
+
+BOOST_AUTO_TEST_CASE(SameOutputOnSubRegion)
+{
+    WriteTestFile(3);
+
+    auto reader = ReaderType::New();
+    reader->SetFileName(TEST_FILE);
+
+    std::vector<ExtractorType::Pointer> extractors;
+    auto bandList = BandImageListType::New();
+    auto stack = otb::BandStackImageSource::New();
+    for (unsigned int channel = 1; channel <= 3; channel++) {
+        extractors.push_back(ExtractBand(reader->GetOutput(), channel));
+        bandList->PushBack(extractors.back()->GetOutput());
+        stack->AddBand(extractors.back()->GetOutput());
+    }
+
+    VectorImageType::IndexType index;
+    index[0] = 5;
+    index[1] = 7;
+    VectorImageType::SizeType size;
+    size[0] = 11;
+    size[1] = 3;
+    VectorImageType::RegionType region(index, size);
+
+    auto concat = ConcatenationType::New();
+    concat->SetInput(bandList);
+    concat->UpdateOutputInformation();
+    concat->GetOutput()->SetRequestedRegion(region);
+    concat->Update();
+
+    stack->UpdateOutputInformation();
+    stack->GetOutput()->SetRequestedRegion(region);
+    stack->Update();
+
+    itk::ImageRegionConstIterator<VectorImageType> it(stack->GetOutput(), region);
+    itk::ImageRegionConstIterator<VectorImageType> itExpected(concat->GetOutput(), region);
+    unsigned int differences = 0;
+    for (it.GoToBegin(), itExpected.GoToBegin(); !it.IsAtEnd(); ++it, ++itExpected) {
+        for (unsigned int b = 0; b < 3; b++) {
+            if (it.Get()[b] != itExpected.Get()[b]) {
+                differences++;
+            }
+        }
+    }
+    BOOST_CHECK_EQUAL(differences, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(EmptyStack)
+{
+    // the red edge stack of a tile without Sentinel-2 products has no band
+    auto stack = otb::BandStackImageSource::New();
+    BOOST_CHECK_NO_THROW(stack->UpdateOutputInformation());
+    BOOST_CHECK_EQUAL(stack->GetOutput()->GetNumberOfComponentsPerPixel(), 0u);
+
+    auto concat = ConcatenationType::New();
+    concat->SetInput(BandImageListType::New());
+    concat->UpdateOutputInformation();
+    BOOST_CHECK_EQUAL(stack->GetOutput()->GetNumberOfComponentsPerPixel(),
+                      concat->GetOutput()->GetNumberOfComponentsPerPixel());
+}
@@ -0,0 +1,83 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+
+#define BOOST_TEST_MODULE TemporalMaskPackingFilter
+#include "boost/test/unit_test.hpp"
+
+#include "otbTemporalMaskPackingFilter.h"
+
+typedef otb::Wrapper::UInt8ImageType                MaskImageType;
+typedef otb::ImageList<MaskImageType>               MaskImageListType;
+
+BOOST_AUTO_TEST_CASE(PackedMasks)
+{
+    // more dates than the bits of a word, to fill several components
+    const unsigned int dates = 70;
+
+    MaskImageType::SizeType size;
+    size[0] = 9;
+    size[1] = 5;
+    MaskImageType::IndexType index;
+    index.Fill(0);
+    MaskImageType::RegionType region(index, size);
+
+    auto masks = MaskImageListType::New();
+    for (unsigned int date = 0; date < dates; date++) {
+        auto mask = MaskImageType::New();
+        mask->SetRegions(region);
+        mask->Allocate();
+        for (unsigned int y = 0; y < size[1]; y++) {
+            for (unsigned int x = 0; x < size[0]; x++) {
+                index[0] = x;
+                index[1] = y;
+                mask->SetPixel(index, (x + y * 3 + date) % 4 == 0 ? 2 : 0);
+            }
+        }
+        masks->PushBack(mask);
+    }
+
+    auto packing = otb::TemporalMaskPackingFilter::New();
+    packing->SetInput(masks);
+    packing->Update();
+
+    auto output = packing->GetOutput();
+    BOOST_REQUIRE_EQUAL(output->GetNumberOfComponentsPerPixel(), 2u);
+    BOOST_REQUIRE(output->GetLargestPossibleRegion() == region);
+
+    unsigned int differences = 0;
+    for (unsigned int y = 0; y < size[1]; y++) {
+        for (unsigned int x = 0; x < size[0]; x++) {
+            index[0] = x;
+            index[1] = y;
+            const otb::TemporalMaskImageType::PixelType pixel = output->GetPixel(index);
+            for (unsigned int date = 0; date < dates; date++) {
+                if (otb::IsDateMasked(pixel, date) != (masks->GetNthElement(date)->GetPixel(index) != 0)) {
+                    differences++;
+                }
+            }
+        }
+    }
+    BOOST_CHECK_EQUAL(differences, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(EmptyList)
+{
+    // the red edge masks of a tile without Sentinel-2 products
+    auto packing = otb::TemporalMaskPackingFilter::New();
+    packing->SetInput(MaskImageListType::New());
+    BOOST_CHECK_NO_THROW(packing->UpdateOutputInformation());
+    BOOST_CHECK_EQUAL(packing->GetNumberOfDates(), 0u);
+    BOOST_CHECK_EQUAL(packing->GetOutput()->GetNumberOfComponentsPerPixel(), 0u);
+}
@@ -23,6 +23,8 @@
 #include "itkListSample.h"
 #include "itkPreOrderTreeIterator.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "otbPolygonSampleIndex.h"
+#include "otbSampleMatrix.h"
 
 namespace otb
 {
@@ -43,6 +45,14 @@ namespace otb
  *
  *  The input VectorData is supposed to be fully contained within the image extent
  *
+ *  When a PolygonSampleIndex is set, the pixels found inside the polygons are
+ *  recorded in it, and an index matching the image grid and the polygon
+ *  vertices is used instead of testing the pixels again.
+ *
+ *  When sample matrices are set, the training and validation samples are
+ *  appended to them and the ListSample outputs stay empty. The same matrices
+ *  can be shared by the generators of several images.
+ *
  *
  * \ingroup OTBStatistics
  */
@@ -157,6 +167,28 @@ public:
   /** Compute the calss statistics*/
   void GenerateClassStatistics();
 
+  /** The index of the sample pixels, filled or used by the generator */
+  void SetSampleIndex(PolygonSampleIndex *sampleIndex)
+  {
+    m_SampleIndex = sampleIndex;
+  }
+
+  PolygonSampleIndex * GetSampleIndex() const
+  {
+    return m_SampleIndex;
+  }
+
+  /** The matrices receiving the samples instead of the ListSample outputs */
+  void SetTrainingMatrix(SampleMatrix *trainingMatrix)
+  {
+    m_TrainingMatrix = trainingMatrix;
+  }
+
+  void SetValidationMatrix(SampleMatrix *validationMatrix)
+  {
+    m_ValidationMatrix = validationMatrix;
+  }
+
 protected:
   ListSampleGeneratorEx();
   virtual ~ListSampleGeneratorEx() {}
@@ -180,11 +212,24 @@ private:
 
   void ComputeClassSelectionProbability();
 
+  /** Adds a sample pixel to the training or the validation list, or to none of them */
+  void DrawSample(const SampleType &sample, ClassLabelType label);
+
+  /** Generates the samples from the pixel runs of the sample index */
+  void GenerateDataFromSampleIndex();
+
+  /** Checks that the sample index was built for the image grid and the polygons,
+   * otherwise starts a new one */
+  void PrepareSampleIndex();
+
   // Crop the polygon wrt the image largest region,
   // and return the resulting size in pixel units
   // This does not handle interior rings
   double GetPolygonAreaInPixelsUnits(DataNodeType* polygonDataNode, ImageType* image);
 
+  // Hash of the vertex coordinates of all the rings of the polygon
+  uint64_t GetPolygonHash(DataNodeType* polygonDataNode);
+
   long int m_MaxTrainingSize; // number of training samples (-1 = no limit)
   long int m_MaxValidationSize; // number of validation samples (-1 = no limit)
   double   m_ValidationTrainingProportion; // proportion of training vs validation
@@ -207,6 +252,10 @@ private:
 
   typedef itk::Statistics::MersenneTwisterRandomVariateGenerator RandomGeneratorType;
   RandomGeneratorType::Pointer m_RandomGenerator;
+
+  PolygonSampleIndex *m_SampleIndex;
+  SampleMatrix       *m_TrainingMatrix;
+  SampleMatrix       *m_ValidationMatrix;
 };
 } // end of namespace otb
 
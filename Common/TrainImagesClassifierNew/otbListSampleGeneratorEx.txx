@@ -21,11 +21,14 @@
 #include "otbListSampleGeneratorEx.h"
 
 #include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionConstIterator.h"
 #include "otbRemoteSensingRegion.h"
 #include "otbVectorDataProjectionFilter.h"
 
 #include "otbMacro.h"
 
+#include <algorithm>
+
 namespace otb
 {
 
@@ -68,7 +71,10 @@ ListSampleGeneratorEx<TImage, TVectorData>
   m_PolygonEdgeInclusion(false),
   m_NumberOfClasses(0),
   m_ClassKey("Class"),
-  m_ClassMinSize(-1)
+  m_ClassMinSize(-1),
+  m_SampleIndex(NULL),
+  m_TrainingMatrix(NULL),
+  m_ValidationMatrix(NULL)
 {
   this->SetNumberOfRequiredInputs(2);
   this->SetNumberOfRequiredOutputs(4);
@@ -246,16 +252,41 @@ ListSampleGeneratorEx<TImage, TVectorData>
   // stores label as integers,so put the size to 1
   validationListLabel->SetMeasurementVectorSize(1);
 
+  if ((m_TrainingMatrix && m_TrainingMatrix->GetFeatureCount() != image->GetNumberOfComponentsPerPixel())
+      || (m_ValidationMatrix && m_ValidationMatrix->GetFeatureCount() != image->GetNumberOfComponentsPerPixel()))
+    {
+    itkExceptionMacro(<< "The sample matrices do not have " << image->GetNumberOfComponentsPerPixel() << " features");
+    }
+
   m_ClassesSamplesNumberTraining.clear();
   m_ClassesSamplesNumberValidation.clear();
 
+  if (m_SampleIndex)
+    {
+    this->PrepareSampleIndex();
+    if (m_SampleIndex->GetHasRuns())
+      {
+      this->GenerateDataFromSampleIndex();
+      return;
+      }
+    }
+
   typename ImageType::RegionType imageLargestRegion = image->GetLargestPossibleRegion();
 
+  size_t polygonIndex = 0;
   TreeIteratorType itVector(vectorData->GetDataTree());
   for (itVector.GoToBegin(); !itVector.IsAtEnd(); ++itVector)
     {
     if (itVector.Get()->IsPolygonFeature())
       {
+      // the pixels found inside the polygon are recorded in the sample index
+      PolygonSampleIndex::PolygonType *indexPolygon = NULL;
+      if (m_SampleIndex)
+        {
+        indexPolygon = &m_SampleIndex->GetPolygons()[polygonIndex++];
+        indexPolygon->Runs.clear();
+        }
+
       PolygonPointerType exteriorRing = itVector.Get()->GetPolygonExteriorRing();
 
       typename ImageType::RegionType polygonRegion =
@@ -272,6 +303,8 @@ ListSampleGeneratorEx<TImage, TVectorData>
       image->PropagateRequestedRegion();
       image->UpdateOutputData();
 
+      const ClassLabelType label = itVector.Get()->GetFieldAsInt(m_ClassKey);
+
       typedef itk::ImageRegionConstIteratorWithIndex<ImageType> IteratorType;
       IteratorType it(image, polygonRegion);
 
@@ -302,32 +335,186 @@ ListSampleGeneratorEx<TImage, TVectorData>
             continue; // skip this pixel and continue
             }
 
-          double randomValue = m_RandomGenerator->GetUniformVariate(0.0, 1.0);
-          if (randomValue < m_ClassesProbTraining[itVector.Get()->GetFieldAsInt(m_ClassKey)])
-            {
-            //Add the sample to the training list
-            trainingListSample->PushBack(it.Get());
-            trainingListLabel->PushBack(itVector.Get()->GetFieldAsInt(m_ClassKey));
-            m_ClassesSamplesNumberTraining[itVector.Get()->GetFieldAsInt(m_ClassKey)] += 1;
-            }
-          else if (randomValue < m_ClassesProbTraining[itVector.Get()->GetFieldAsInt(m_ClassKey)]
-                   + m_ClassesProbValidation[itVector.Get()->GetFieldAsInt(m_ClassKey)])
+          if (indexPolygon)
             {
-            //Add the sample to the validation list
-            validationListSample->PushBack(it.Get());
-            validationListLabel->PushBack(itVector.Get()->GetFieldAsInt(m_ClassKey));
-            m_ClassesSamplesNumberValidation[itVector.Get()->GetFieldAsInt(m_ClassKey)] += 1;
+            const ImageIndexType &index = it.GetIndex();
+            std::vector<PolygonSampleIndex::RunType> &runs = indexPolygon->Runs;
+            if (!runs.empty() && runs.back().Y == index[1] && runs.back().X + runs.back().Length == index[0])
+              {
+              runs.back().Length++;
+              }
+            else
+              {
+              PolygonSampleIndex::RunType run = { index[0], index[1], 1 };
+              runs.push_back(run);
+              }
             }
-          //Note: some samples may not be used at all
+
+          this->DrawSample(it.Get(), label);
           }
         }
       }
     }
 
+  if (m_SampleIndex)
+    {
+    m_SampleIndex->SetHasRuns(true);
+    }
+
   assert(trainingListSample->Size() == trainingListLabel->Size());
   assert(validationListSample->Size() == validationListLabel->Size());
 }
 
+template <class TImage, class TVectorData>
+void
+ListSampleGeneratorEx<TImage, TVectorData>
+::DrawSample(const SampleType &sample, ClassLabelType label)
+{
+  double randomValue = m_RandomGenerator->GetUniformVariate(0.0, 1.0);
+  if (randomValue < m_ClassesProbTraining[label])
+    {
+    //Add the sample to the training list
+    if (m_TrainingMatrix)
+      {
+      m_TrainingMatrix->Append(sample.GetDataPointer(), label);
+      }
+    else
+      {
+      this->GetTrainingListSample()->PushBack(sample);
+      this->GetTrainingListLabel()->PushBack(label);
+      }
+    m_ClassesSamplesNumberTraining[label] += 1;
+    }
+  else if (randomValue < m_ClassesProbTraining[label]
+           + m_ClassesProbValidation[label])
+    {
+    //Add the sample to the validation list
+    if (m_ValidationMatrix)
+      {
+      m_ValidationMatrix->Append(sample.GetDataPointer(), label);
+      }
+    else
+      {
+      this->GetValidationListSample()->PushBack(sample);
+      this->GetValidationListLabel()->PushBack(label);
+      }
+    m_ClassesSamplesNumberValidation[label] += 1;
+    }
+  //Note: some samples may not be used at all
+}
+
+template <class TImage, class TVectorData>
+void
+ListSampleGeneratorEx<TImage, TVectorData>
+::GenerateDataFromSampleIndex()
+{
+  ImagePointerType image = const_cast<ImageType*>(this->GetInput());
+
+  // the pixels are visited in the same order as when the index was built, so the same
+  // random draws select the same samples
+  typedef itk::ImageRegionConstIterator<ImageType> IteratorType;
+  const std::vector<PolygonSampleIndex::PolygonType> &polygons = m_SampleIndex->GetPolygons();
+  for (typename std::vector<PolygonSampleIndex::PolygonType>::const_iterator polygon = polygons.begin();
+       polygon != polygons.end(); ++polygon)
+    {
+    if (polygon->Runs.empty())
+      {
+      continue;
+      }
+
+    // request the region covering the runs of the polygon
+    int64_t minX = polygon->Runs.front().X, maxX = minX;
+    int64_t minY = polygon->Runs.front().Y, maxY = minY;
+    for (const PolygonSampleIndex::RunType &run : polygon->Runs)
+      {
+      minX = std::min(minX, run.X);
+      maxX = std::max(maxX, run.X + run.Length - 1);
+      minY = std::min(minY, run.Y);
+      maxY = std::max(maxY, run.Y);
+      }
+    ImageRegionType region;
+    region.SetIndex(0, minX);
+    region.SetIndex(1, minY);
+    region.SetSize(0, maxX - minX + 1);
+    region.SetSize(1, maxY - minY + 1);
+
+    image->SetRequestedRegion(region);
+    image->PropagateRequestedRegion();
+    image->UpdateOutputData();
+
+    for (const PolygonSampleIndex::RunType &run : polygon->Runs)
+      {
+      ImageRegionType runRegion;
+      runRegion.SetIndex(0, run.X);
+      runRegion.SetIndex(1, run.Y);
+      runRegion.SetSize(0, run.Length);
+      runRegion.SetSize(1, 1);
+
+      IteratorType it(image, runRegion);
+      for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+        {
+        this->DrawSample(it.Get(), polygon->Label);
+        }
+      }
+    }
+}
+
+template <class TImage, class TVectorData>
+void
+ListSampleGeneratorEx<TImage, TVectorData>
+::PrepareSampleIndex()
+{
+  ImageType* image = const_cast<ImageType*> (this->GetInput());
+  typename VectorDataType::ConstPointer vectorData = this->GetInputVectorData();
+
+  PolygonSampleIndex::GridType grid;
+  const ImageRegionType largestRegion = image->GetLargestPossibleRegion();
+  for (unsigned int i = 0; i < 2; i++)
+    {
+    grid.Origin[i] = image->GetOrigin()[i];
+    grid.Spacing[i] = image->GetSpacing()[i];
+    grid.Index[i] = largestRegion.GetIndex()[i];
+    grid.Size[i] = largestRegion.GetSize()[i];
+    }
+
+  // compare the labels and the vertices of the polygons
+  std::vector<PolygonSampleIndex::PolygonType> &polygons = m_SampleIndex->GetPolygons();
+  bool matches = m_SampleIndex->GetGrid() == grid
+                 && m_SampleIndex->GetEdgeInclusion() == m_PolygonEdgeInclusion;
+  size_t polygonIndex = 0;
+  TreeIteratorType itVector(vectorData->GetDataTree());
+  for (itVector.GoToBegin(); matches && !itVector.IsAtEnd(); ++itVector)
+    {
+    DataNodeType* datanode = itVector.Get();
+    if (datanode->IsPolygonFeature())
+      {
+      matches = polygonIndex < polygons.size()
+                && polygons[polygonIndex].Label == datanode->GetFieldAsInt(m_ClassKey)
+                && polygons[polygonIndex].Hash == GetPolygonHash(datanode);
+      polygonIndex++;
+      }
+    }
+  if (matches && polygonIndex == polygons.size())
+    {
+    return;
+    }
+
+  otbMsgDevMacro(<< "Building a new sample index");
+  m_SampleIndex->Initialize(grid, m_PolygonEdgeInclusion);
+  for (itVector.GoToBegin(); !itVector.IsAtEnd(); ++itVector)
+    {
+    DataNodeType* datanode = itVector.Get();
+    if (datanode->IsPolygonFeature())
+      {
+      PolygonSampleIndex::PolygonType polygon;
+      polygon.Label = datanode->GetFieldAsInt(m_ClassKey);
+      polygon.Hash = GetPolygonHash(datanode);
+      polygon.Area = GetPolygonAreaInPixelsUnits(datanode, image);
+      polygons.push_back(polygon);
+      }
+    }
+}
+
 template <class TImage, class TVectorData>
 void
 ListSampleGeneratorEx<TImage, TVectorData>
@@ -335,6 +522,18 @@ ListSampleGeneratorEx<TImage, TVectorData>
 {
   m_ClassesSize.clear();
 
+  if (m_SampleIndex)
+    {
+    // the areas of the polygons are kept in the sample index
+    this->PrepareSampleIndex();
+    for (const PolygonSampleIndex::PolygonType &polygon : m_SampleIndex->GetPolygons())
+      {
+      m_ClassesSize[polygon.Label] += polygon.Area;
+      }
+    m_NumberOfClasses = m_ClassesSize.size();
+    return;
+    }
+
   ImageType* image = const_cast<ImageType*> (this->GetInput());
   typename VectorDataType::ConstPointer vectorData = this->GetInputVectorData();
 
@@ -442,6 +641,40 @@ ListSampleGeneratorEx<TImage, TVectorData>
   return area;
 }
 
+template <class TImage, class TVectorData>
+uint64_t
+ListSampleGeneratorEx<TImage, TVectorData>
+::GetPolygonHash(DataNodeType* polygonDataNode)
+{
+  // the coordinates of the exterior ring, then of each interior ring
+  uint64_t hash = PolygonSampleIndex::HashSeed();
+  PolygonListPointerType interiorRings = polygonDataNode->GetPolygonInteriorRings();
+  std::vector<PolygonPointerType> rings(1, polygonDataNode->GetPolygonExteriorRing());
+  for (typename PolygonListType::Iterator interiorRing = interiorRings->Begin();
+       interiorRing != interiorRings->End();
+       ++interiorRing)
+    {
+    rings.push_back(interiorRing.Get());
+    }
+
+  for (const PolygonPointerType &ring : rings)
+    {
+    typedef typename PolygonType::VertexListType VertexListType;
+    const VertexListType *vertexList = ring->GetVertexList();
+    const uint64_t vertexCount = vertexList->Size();
+    hash = PolygonSampleIndex::HashBytes(hash, &vertexCount, sizeof(vertexCount));
+    for (typename VertexListType::ConstIterator vertex = vertexList->Begin();
+         vertex != vertexList->End();
+         ++vertex)
+      {
+      const double coordinates[2] = { vertex.Value()[0], vertex.Value()[1] };
+      hash = PolygonSampleIndex::HashBytes(hash, coordinates, sizeof(coordinates));
+      }
+    }
+
+  return hash;
+}
+
 template <class TImage, class TVectorData>
 void
 ListSampleGeneratorEx<TImage, TVectorData>
@@ -39,6 +39,7 @@
 #include "itkPreOrderTreeIterator.h"
 #include "itkMersenneTwisterRandomVariateGenerator.h"
 #include "otbStreamingManager.h"
+#include "otbSampleMatrix.h"
 
 namespace otb
 {
@@ -57,6 +58,9 @@ namespace otb
  *
  *  The input Raster is supposed to be fully contained within the image extent
  *
+ *  When sample matrices are set, the training and validation samples are
+ *  appended to them and the ListSample outputs stay empty.
+ *
  *
  * \ingroup OTBStatistics
  */
@@ -178,6 +182,17 @@ public:
   /** Compute the calss statistics*/
   void GenerateClassStatistics();
 
+  /** The matrices receiving the samples instead of the ListSample outputs */
+  void SetTrainingMatrix(SampleMatrix *trainingMatrix)
+  {
+    m_TrainingMatrix = trainingMatrix;
+  }
+
+  void SetValidationMatrix(SampleMatrix *validationMatrix)
+  {
+    m_ValidationMatrix = validationMatrix;
+  }
+
 protected:
   ListSampleGeneratorRaster();
   virtual ~ListSampleGeneratorRaster() {}
@@ -217,6 +232,9 @@ private:
   RandomGeneratorType::Pointer m_RandomGenerator;
 
   StreamingManagerPointerType m_StreamingManager;
+
+  SampleMatrix *m_TrainingMatrix;
+  SampleMatrix *m_ValidationMatrix;
 };
 } // end of namespace otb
 
@@ -38,7 +38,9 @@ ListSampleGeneratorRaster<TImage, TRaster>
   m_BoundByMin(true),
   m_NoDataLabel(static_cast<RasterPixelType>(0)),
   m_NumberOfClasses(0),
-  m_ClassMinSize(-1)
+  m_ClassMinSize(-1),
+  m_TrainingMatrix(NULL),
+  m_ValidationMatrix(NULL)
 {
   this->SetNumberOfRequiredInputs(2);
   this->SetNumberOfRequiredOutputs(4);
@@ -220,6 +222,12 @@ ListSampleGeneratorRaster<TImage, TRaster>
   // stores label as integers,so put the size to 1
   validationListLabel->SetMeasurementVectorSize(1);
 
+  if ((m_TrainingMatrix && m_TrainingMatrix->GetFeatureCount() != image->GetNumberOfComponentsPerPixel())
+      || (m_ValidationMatrix && m_ValidationMatrix->GetFeatureCount() != image->GetNumberOfComponentsPerPixel()))
+    {
+    itkExceptionMacro(<< "The sample matrices do not have " << image->GetNumberOfComponentsPerPixel() << " features");
+    }
+
   m_ClassesSamplesNumberTraining.clear();
   m_ClassesSamplesNumberValidation.clear();
 
@@ -259,16 +267,30 @@ ListSampleGeneratorRaster<TImage, TRaster>
       if (randomValue < m_ClassesProbTraining[rasterClass])
         {
         //Add the sample to the training list
-        trainingListSample->PushBack(it.Get());
-        trainingListLabel->PushBack(rasterClass);
+        if (m_TrainingMatrix)
+          {
+          m_TrainingMatrix->Append(it.Get().GetDataPointer(), rasterClass);
+          }
+        else
+          {
+          trainingListSample->PushBack(it.Get());
+          trainingListLabel->PushBack(rasterClass);
+          }
         m_ClassesSamplesNumberTraining[rasterClass] += 1;
         }
       else if (randomValue < m_ClassesProbTraining[rasterClass]
                + m_ClassesProbValidation[rasterClass])
         {
         //Add the sample to the validation list
-        validationListSample->PushBack(it.Get());
-        validationListLabel->PushBack(rasterClass);
+        if (m_ValidationMatrix)
+          {
+          m_ValidationMatrix->Append(it.Get().GetDataPointer(), rasterClass);
+          }
+        else
+          {
+          validationListSample->PushBack(it.Get());
+          validationListLabel->PushBack(rasterClass);
+          }
         m_ClassesSamplesNumberValidation[rasterClass] += 1;
         }
       //Note: some samples may not be used at all
@@ -0,0 +1,213 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+
+#ifndef __otbPolygonSampleIndex_h
+#define __otbPolygonSampleIndex_h
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+
+namespace otb
+{
+
+/** \class PolygonSampleIndex
+ *  \brief The pixels lying inside the polygons of a vector data, for an image grid.
+ *
+ *  For each polygon of the vector data, in the order of the data tree, the
+ *  index holds its class label, its area in pixels and the runs of pixels of
+ *  each image line which are inside it. It is filled by ListSampleGeneratorEx
+ *  the first time the samples of an image are generated and saved to a file,
+ *  so that the next trainings on the same grid read the sample pixels at
+ *  their offsets instead of testing every pixel of the polygon bounding boxes.
+ *
+ *  The grid, the edge inclusion mode and the label and a hash of the vertex
+ *  coordinates of each polygon are kept to detect an index built for other
+ *  data, so an index is rebuilt as soon as a polygon moves or changes shape.
+ */
+class PolygonSampleIndex
+{
+public:
+  struct GridType
+  {
+    double  Origin[2];
+    double  Spacing[2];
+    int64_t Index[2];
+    int64_t Size[2];
+
+    bool operator==(const GridType &other) const
+    {
+      return std::memcmp(this, &other, sizeof(GridType)) == 0;
+    }
+  };
+
+  struct RunType
+  {
+    int64_t X;
+    int64_t Y;
+    int64_t Length;
+  };
+
+  struct PolygonType
+  {
+    int32_t              Label;
+    uint64_t             Hash;
+    double               Area;
+    std::vector<RunType> Runs;
+  };
+
+  PolygonSampleIndex() : m_EdgeInclusion(false), m_HasRuns(false), m_Modified(false)
+  {
+    std::memset(&m_Grid, 0, sizeof(m_Grid));
+  }
+
+  /** Forgets the polygons and starts an index for another grid */
+  void Initialize(const GridType &grid, bool edgeInclusion)
+  {
+    m_Grid = grid;
+    m_EdgeInclusion = edgeInclusion;
+    m_HasRuns = false;
+    m_Modified = true;
+    m_Polygons.clear();
+  }
+
+  const GridType & GetGrid() const { return m_Grid; }
+  bool GetEdgeInclusion() const { return m_EdgeInclusion; }
+
+  std::vector<PolygonType> & GetPolygons() { return m_Polygons; }
+  const std::vector<PolygonType> & GetPolygons() const { return m_Polygons; }
+
+  /** The runs are known once the samples have been generated a first time */
+  bool GetHasRuns() const { return m_HasRuns; }
+  void SetHasRuns(bool hasRuns) { m_HasRuns = hasRuns; }
+
+  /** True when the index was rebuilt since it was loaded or saved */
+  bool GetModified() const { return m_Modified; }
+
+  /** FNV-1a hash, started from HashSeed() and extended by HashBytes() */
+  static uint64_t HashSeed() { return 14695981039346656037ULL; }
+
+  static uint64_t HashBytes(uint64_t hash, const void *data, size_t size)
+  {
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t i = 0; i < size; i++)
+      {
+      hash = (hash ^ bytes[i]) * 1099511628211ULL;
+      }
+    return hash;
+  }
+
+  /** Reads an index, returns false if the file is missing or invalid */
+  bool Load(const std::string &fileName)
+  {
+    std::ifstream in(fileName.c_str(), std::ios::binary);
+    if (!in)
+      {
+      return false;
+      }
+
+    char magic[MagicSize];
+    uint64_t polygonCount = 0;
+    uint8_t edgeInclusion = 0;
+    GridType grid;
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, GetMagic(), MagicSize) != 0
+        || !Read(in, grid) || !Read(in, edgeInclusion) || !Read(in, polygonCount))
+      {
+      return false;
+      }
+
+    std::vector<PolygonType> polygons(polygonCount);
+    for (PolygonType &polygon : polygons)
+      {
+      uint64_t runCount = 0;
+      if (!Read(in, polygon.Label) || !Read(in, polygon.Hash) || !Read(in, polygon.Area)
+          || !Read(in, runCount))
+        {
+        return false;
+        }
+      polygon.Runs.resize(runCount);
+      if (runCount && !in.read(reinterpret_cast<char *>(&polygon.Runs[0]), runCount * sizeof(RunType)))
+        {
+        return false;
+        }
+      }
+
+    m_Grid = grid;
+    m_EdgeInclusion = edgeInclusion != 0;
+    m_Polygons.swap(polygons);
+    m_HasRuns = true;
+    m_Modified = false;
+    return true;
+  }
+
+  /** Writes the index, returns false on error */
+  bool Save(const std::string &fileName)
+  {
+    std::ofstream out(fileName.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out)
+      {
+      return false;
+      }
+
+    const uint8_t edgeInclusion = m_EdgeInclusion ? 1 : 0;
+    const uint64_t polygonCount = m_Polygons.size();
+    out.write(GetMagic(), MagicSize);
+    Write(out, m_Grid);
+    Write(out, edgeInclusion);
+    Write(out, polygonCount);
+    for (const PolygonType &polygon : m_Polygons)
+      {
+      const uint64_t runCount = polygon.Runs.size();
+      Write(out, polygon.Label);
+      Write(out, polygon.Hash);
+      Write(out, polygon.Area);
+      Write(out, runCount);
+      if (runCount)
+        {
+        out.write(reinterpret_cast<const char *>(&polygon.Runs[0]), runCount * sizeof(RunType));
+        }
+      }
+    m_Modified = !out;
+    return !m_Modified;
+  }
+
+private:
+  static const char * GetMagic() { return "S2APSID2"; }
+  static const size_t MagicSize = 8;
+
+  template <typename T>
+  static bool Read(std::istream &in, T &value)
+  {
+    return static_cast<bool>(in.read(reinterpret_cast<char *>(&value), sizeof(T)));
+  }
+
+  template <typename T>
+  static void Write(std::ostream &out, const T &value)
+  {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+  }
+
+  GridType                  m_Grid;
+  bool                      m_EdgeInclusion;
+  bool                      m_HasRuns;
+  bool                      m_Modified;
+  std::vector<PolygonType>  m_Polygons;
+};
+
+} // end of namespace otb
+
+#endif
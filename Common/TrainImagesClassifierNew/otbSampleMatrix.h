@@ -0,0 +1,245 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+
+#ifndef __otbSampleMatrix_h
+#define __otbSampleMatrix_h
+
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <cerrno>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+namespace otb
+{
+
+/** \class SampleMatrix
+ *  \brief The features and the labels of a set of samples, in a contiguous matrix.
+ *
+ *  Each row holds the features of a sample as floats, followed by a column
+ *  with the int32 label of the sample, stored bitwise. The rows are appended
+ *  one after the other, without any allocation per sample.
+ *
+ *  When a spill file name is given, the matrix is kept in a memory-mapped
+ *  file instead of the heap, so that the kernel can write the samples back
+ *  to the disk instead of running out of memory. The file is removed when
+ *  the matrix is cleared or destroyed.
+ */
+class SampleMatrix
+{
+public:
+  SampleMatrix()
+    : m_FeatureCount(0), m_RowCount(0), m_Capacity(0), m_Data(NULL), m_File(-1)
+  {
+  }
+
+  ~SampleMatrix()
+  {
+    Clear();
+  }
+
+  /** Forgets the samples and starts a matrix of featureCount columns, plus the label */
+  void Initialize(unsigned int featureCount, const std::string &spillFileName = std::string())
+  {
+    Clear();
+    m_FeatureCount = featureCount;
+    m_SpillFileName = spillFileName;
+  }
+
+  /** Releases the samples and removes the spill file */
+  void Clear()
+  {
+    if (m_File != -1)
+      {
+      if (m_Data)
+        {
+        munmap(m_Data, m_Capacity * GetRowSize());
+        }
+      close(m_File);
+      unlink(m_SpillFileName.c_str());
+      m_File = -1;
+      }
+    else
+      {
+      std::free(m_Data);
+      }
+    m_Data = NULL;
+    m_RowCount = 0;
+    m_Capacity = 0;
+  }
+
+  /** Drops the rows appended after the first rowCount ones */
+  void Truncate(size_t rowCount)
+  {
+    if (rowCount < m_RowCount)
+      {
+      m_RowCount = rowCount;
+      }
+  }
+
+  unsigned int GetFeatureCount() const { return m_FeatureCount; }
+  size_t GetRowCount() const { return m_RowCount; }
+
+  /** The number of floats between two rows */
+  size_t GetStride() const { return m_FeatureCount + 1; }
+
+  /** The rows of the matrix, in row-major order */
+  float * GetData() { return m_Data; }
+  const float * GetData() const { return m_Data; }
+
+  float * GetRow(size_t row) { return m_Data + row * GetStride(); }
+  const float * GetRow(size_t row) const { return m_Data + row * GetStride(); }
+
+  int32_t GetLabel(size_t row) const
+  {
+    int32_t label;
+    std::memcpy(&label, GetRow(row) + m_FeatureCount, sizeof(label));
+    return label;
+  }
+
+  /** Appends a sample, converting its features to float */
+  template <typename TValue>
+  void Append(const TValue *features, int32_t label)
+  {
+    if (m_RowCount == m_Capacity)
+      {
+      Reserve(m_Capacity ? m_Capacity * 2 : 4096);
+      }
+
+    float *row = GetRow(m_RowCount++);
+    for (unsigned int i = 0; i < m_FeatureCount; i++)
+      {
+      row[i] = static_cast<float>(features[i]);
+      }
+    std::memcpy(row + m_FeatureCount, &label, sizeof(label));
+  }
+
+  /** Replaces each feature x by (x - shift) / scale, as ShiftScaleSampleListFilter does.
+   *  The features having a null scale become 0. */
+  template <typename TVector>
+  void ShiftScale(const TVector &shifts, const TVector &scales)
+  {
+    double *invertedScales = new double[m_FeatureCount];
+    for (unsigned int i = 0; i < m_FeatureCount; i++)
+      {
+      invertedScales[i] = scales[i] - 1e-10 < 0. ? 0. : 1. / scales[i];
+      }
+
+    for (size_t row = 0; row < m_RowCount; row++)
+      {
+      float *features = GetRow(row);
+      for (unsigned int i = 0; i < m_FeatureCount; i++)
+        {
+        features[i] = static_cast<float>((static_cast<double>(features[i]) - static_cast<double>(shifts[i]))
+                                         * invertedScales[i]);
+        }
+      }
+    delete[] invertedScales;
+  }
+
+  /** Copies the samples to a ListSample and a label ListSample, which are resized once */
+  template <typename TListSample, typename TListLabel>
+  void Export(TListSample *listSample, TListLabel *listLabel) const
+  {
+    typename TListSample::MeasurementVectorType sample(m_FeatureCount);
+    typename TListLabel::MeasurementVectorType label;
+
+    listSample->Clear();
+    listSample->SetMeasurementVectorSize(m_FeatureCount);
+    listSample->Resize(m_RowCount);
+    listLabel->Clear();
+    listLabel->SetMeasurementVectorSize(1);
+    listLabel->Resize(m_RowCount);
+    for (size_t row = 0; row < m_RowCount; row++)
+      {
+      const float *features = GetRow(row);
+      for (unsigned int i = 0; i < m_FeatureCount; i++)
+        {
+        sample[i] = features[i];
+        }
+      label[0] = GetLabel(row);
+      listSample->SetMeasurementVector(row, sample);
+      listLabel->SetMeasurementVector(row, label);
+      }
+  }
+
+private:
+  SampleMatrix(const SampleMatrix &); //purposely not implemented
+  void operator =(const SampleMatrix &); //purposely not implemented
+
+  size_t GetRowSize() const { return GetStride() * sizeof(float); }
+
+  void Reserve(size_t capacity)
+  {
+    const size_t size = capacity * GetRowSize();
+    if (m_SpillFileName.empty())
+      {
+      float *data = static_cast<float *>(std::realloc(m_Data, size));
+      if (!data)
+        {
+        throw std::runtime_error("Unable to allocate the sample matrix");
+        }
+      m_Data = data;
+      }
+    else
+      {
+      if (m_File == -1)
+        {
+        m_File = open(m_SpillFileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+        if (m_File == -1)
+          {
+          throw std::runtime_error("Unable to create the sample file " + m_SpillFileName + ": "
+                                   + std::strerror(errno));
+          }
+        }
+      if (m_Data)
+        {
+        munmap(m_Data, m_Capacity * GetRowSize());
+        m_Data = NULL;
+        }
+      void *data = MAP_FAILED;
+      if (ftruncate(m_File, size) == 0)
+        {
+        data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_File, 0);
+        }
+      if (data == MAP_FAILED)
+        {
+        // the samples written so far stay in the file, but can no longer be reached
+        m_RowCount = 0;
+        m_Capacity = 0;
+        throw std::runtime_error("Unable to extend the sample file " + m_SpillFileName + ": "
+                                 + std::strerror(errno));
+        }
+      m_Data = static_cast<float *>(data);
+      }
+    m_Capacity = capacity;
+  }
+
+  unsigned int  m_FeatureCount;
+  size_t        m_RowCount;
+  size_t        m_Capacity;
+  float        *m_Data;
+  int           m_File;
+  std::string   m_SpillFileName;
+};
+
+} // end of namespace otb
+
+#endif
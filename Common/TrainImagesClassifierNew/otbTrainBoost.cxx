@@ -71,7 +71,7 @@ namespace Wrapper
   }
 
 
-  void TrainImagesClassifierNew::TrainBoost(ListSampleType::Pointer trainingListSample, LabelListSampleType::Pointer trainingLabeledListSample)
+  TrainImagesClassifierNew::ModelPointerType TrainImagesClassifierNew::TrainBoost(ListSampleType::Pointer trainingListSample, LabelListSampleType::Pointer trainingLabeledListSample)
   {
     BoostType::Pointer boostClassifier = BoostType::New();
     boostClassifier->SetInputListSample(trainingListSample);
@@ -82,7 +82,7 @@ namespace Wrapper
     boostClassifier->SetMaxDepth(GetParameterInt("classifier.boost.m"));
 
     boostClassifier->Train();
-    boostClassifier->Save(GetParameterString("io.out"));
+    return boostClassifier.GetPointer();
   }
 #endif
 
@@ -96,7 +96,7 @@ void TrainImagesClassifierNew::InitDecisionTreeParams()
 
 }
 
-void TrainImagesClassifierNew::TrainDecisionTree(ListSampleType::Pointer trainingListSample,
+TrainImagesClassifierNew::ModelPointerType TrainImagesClassifierNew::TrainDecisionTree(ListSampleType::Pointer trainingListSample,
                                                              LabelListSampleType::Pointer trainingLabeledListSample)
 {
   DecisionTreeType::Pointer classifier = DecisionTreeType::New();
@@ -116,7 +116,7 @@ void TrainImagesClassifierNew::TrainDecisionTree(ListSampleType::Pointer trainin
     classifier->SetTruncatePrunedTree(false);
     }
   classifier->Train();
-  classifier->Save(GetParameterString("io.out"));
+  return classifier.GetPointer();
 }
 #endif
 } //end namespace wrapper
@@ -32,6 +32,15 @@
 
 #include "otbTrainImagesClassifier.h"
 
+#include "itkMultiThreader.h"
+
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
 namespace otb
 {
 namespace Wrapper
@@ -79,6 +88,7 @@ void TrainImagesClassifierNew::DoInit()
     MandatoryOff("io.confmatout");
     AddParameter(ParameterType_OutputFilename, "io.out", "Output model");
     SetParameterDescription("io.out", "Output file containing the model estimated (.txt format).");
+    MandatoryOff("io.out");
 
     //LBU
     // Add the possibility to use a raster to describe the training samples.
@@ -128,6 +138,41 @@ void TrainImagesClassifierNew::DoInit()
     SetParameterDescription("sample.vfn", "Name of the field used to discriminate class labels in the input vector data files.");
     SetParameterString("sample.vfn", "Class");
 
+    AddParameter(ParameterType_String, "sample.idx", "Sample index file prefix");
+    SetParameterDescription("sample.idx",
+                            "Prefix of the files keeping the pixels inside the polygons of the input vector data for each input image "
+                            "(<prefix>_<image grid hash>.idx), the grid being the origin, spacing, size and projection of the image. "
+                            "An index built for the same image grid and polygon vertices is reused, "
+                            "otherwise it is built and written while generating the samples.");
+    MandatoryOff("sample.idx");
+
+    AddParameter(ParameterType_String, "sample.spill", "Sample file prefix");
+    SetParameterDescription("sample.spill",
+                            "Prefix of the memory-mapped files keeping the training and validation samples "
+                            "(<prefix>_training.bin and <prefix>_validation.bin) instead of the memory. "
+                            "The files are removed when the training ends.");
+    MandatoryOff("sample.spill");
+
+    //Group Strata
+    AddParameter(ParameterType_Group, "strata", "Strata");
+    SetParameterDescription("strata",
+                            "This group of parameters allows to train a model for each stratum in a single run. "
+                            "The input images are read once for all the strata and the models are trained concurrently.");
+    AddParameter(ParameterType_InputVectorDataList, "strata.vd", "Vector data of the strata");
+    SetParameterDescription("strata.vd", "The training vector data of each stratum, used instead of io.vd.");
+    MandatoryOff("strata.vd");
+    AddParameter(ParameterType_StringList, "strata.out", "Output models");
+    SetParameterDescription("strata.out", "The output model of each stratum, used instead of io.out.");
+    MandatoryOff("strata.out");
+    AddParameter(ParameterType_StringList, "strata.confmatout", "Output confusion matrices");
+    SetParameterDescription("strata.confmatout", "The output confusion matrix of each stratum (.csv format).");
+    MandatoryOff("strata.confmatout");
+    AddParameter(ParameterType_Int, "strata.threads", "Number of models trained at a time");
+    SetParameterDescription("strata.threads",
+                            "The maximum number of models trained concurrently (default = the number of ITK threads).");
+    MandatoryOff("strata.threads");
+    SetMinimumParameterIntValue("strata.threads", 1);
+
     AddParameter(ParameterType_Choice, "classifier", "Classifier to use for the training");
     SetParameterDescription("classifier", "Choice of the classifier to use for the training.");
 
@@ -242,18 +287,18 @@ void TrainImagesClassifierNew::LogConfusionMatrix(ConfusionMatrixCalculatorType*
     otbAppLogINFO("Confusion matrix (rows = reference labels, columns = produced labels):\n" << os.str());
 }
 
-void TrainImagesClassifierNew::Classify(ListSampleType::Pointer validationListSample, LabelListSampleType::Pointer &predictedList)
+void TrainImagesClassifierNew::Classify(const std::string &modelFile, ListSampleType::Pointer validationListSample, LabelListSampleType::Pointer &predictedList)
 {
     //Classification
-    ModelPointerType model = MachineLearningModelFactoryType::CreateMachineLearningModel(GetParameterString("io.out"),
+    ModelPointerType model = MachineLearningModelFactoryType::CreateMachineLearningModel(modelFile,
                                                                                          MachineLearningModelFactoryType::ReadMode);
 
     if (model.IsNull())
     {
-        otbAppLogFATAL(<< "Error when loading model " << GetParameterString("io.out"));
+        otbAppLogFATAL(<< "Error when loading model " << modelFile);
     }
 
-    model->Load(GetParameterString("io.out"));
+    model->Load(modelFile);
     model->SetInputListSample(validationListSample);
     //model->SetTargetListSample(predictedList);
     //model->PredictAll();
@@ -261,84 +306,173 @@ void TrainImagesClassifierNew::Classify(ListSampleType::Pointer validationListSa
     model->SetTargetListSample(predictedList);
 }
 
-void TrainImagesClassifierNew::DoExecute()
+TrainImagesClassifierNew::ModelPointerType TrainImagesClassifierNew::TrainModel(ListSampleType::Pointer trainingListSample,
+                                                                                LabelListSampleType::Pointer trainingLabeledListSample)
 {
-    GetLogger()->Debug("Entering DoExecute\n");
-    //Create training and validation for list samples and label list samples
-    ConcatenateLabelListSampleFilterType::Pointer concatenateTrainingLabels =
-            ConcatenateLabelListSampleFilterType::New();
-    ConcatenateListSampleFilterType::Pointer concatenateTrainingSamples = ConcatenateListSampleFilterType::New();
-    ConcatenateLabelListSampleFilterType::Pointer concatenateValidationLabels =
-            ConcatenateLabelListSampleFilterType::New();
-    ConcatenateListSampleFilterType::Pointer concatenateValidationSamples = ConcatenateListSampleFilterType::New();
-
-    MeasurementType meanMeasurementVector;
-    MeasurementType stddevMeasurementVector;
-
-    //--------------------------
-    // Load measurements from images
-    unsigned int nbBands = 0;
-    //Iterate over all input images
+    const std::string classifierType = GetParameterString("classifier");
 
-    FloatVectorImageListType* imageList = GetParameterImageList("io.il");
-    auto sampleMt = GetParameterInt("sample.mt");
-    auto sampleMv = GetParameterInt("sample.mv");
-    if (sampleMt != -1)
+    if (classifierType == "libsvm")
     {
-        sampleMt *= imageList->Size();
+#ifdef OTB_USE_LIBSVM
+        return TrainLibSVM(trainingListSample, trainingLabeledListSample);
+#else
+        otbAppLogFATAL("Module LIBSVM is not installed. You should consider turning OTB_USE_LIBSVM on during cmake configuration.");
+#endif
     }
-    if (sampleMv != -1)
+    else if (classifierType == "svm")
     {
-        sampleMv *= imageList->Size();
+#ifdef OTB_USE_OPENCV
+        return TrainSVM(trainingListSample, trainingLabeledListSample);
+#else
+        otbAppLogFATAL("Module OPENCV is not installed. You should consider turning OTB_USE_OPENCV on during cmake configuration.");
+#endif
     }
+    else if (classifierType == "boost")
+    {
+#ifdef OTB_USE_OPENCV
+        return TrainBoost(trainingListSample, trainingLabeledListSample);
+#else
+        otbAppLogFATAL("Module OPENCV is not installed. You should consider turning OTB_USE_OPENCV on during cmake configuration.");
+#endif
+    }
+    else if (classifierType == "dt")
+    {
+#ifdef OTB_USE_OPENCV
+        return TrainDecisionTree(trainingListSample, trainingLabeledListSample);
+#else
+        otbAppLogFATAL("Module OPENCV is not installed. You should consider turning OTB_USE_OPENCV on during cmake configuration.");
+#endif
+    }
+    else if (classifierType == "ann")
+    {
+#ifdef OTB_USE_OPENCV
+        return TrainNeuralNetwork(trainingListSample, trainingLabeledListSample);
+#else
+        otbAppLogFATAL("Module OPENCV is not installed. You should consider turning OTB_USE_OPENCV on during cmake configuration.");
+#endif
+    }
+    else if (classifierType == "bayes")
+    {
+#ifdef OTB_USE_OPENCV
+        return TrainNormalBayes(trainingListSample, trainingLabeledListSample);
+#else
+        otbAppLogFATAL("Module OPENCV is not installed. You should consider turning OTB_USE_OPENCV on during cmake configuration.");
+#endif
+    }
+    else if (classifierType == "rf")
+    {
+#ifdef OTB_USE_OPENCV
+        return TrainRandomForests(trainingListSample, trainingLabeledListSample);
+#else
+        otbAppLogFATAL("Module OPENCV is not installed. You should consider turning OTB_USE_OPENCV on during cmake configuration.");
+#endif
+    }
+    else if (classifierType == "knn")
+    {
+#ifdef OTB_USE_OPENCV
+        return TrainKNN(trainingListSample, trainingLabeledListSample);
+#else
+        otbAppLogFATAL("Module OPENCV is not installed. You should consider turning OTB_USE_OPENCV on during cmake configuration.");
+#endif
+    }
+
+    otbAppLogFATAL("The " << classifierType << " classifier is not supported.");
+    return ModelPointerType();
+}
+
+void TrainImagesClassifierNew::GenerateVectorDataSamples(StratumListType &strata)
+{
+    FloatVectorImageListType* imageList = GetParameterImageList("io.il");
+    const bool multiStratum = HasValue("strata.vd");
+
+    //Iterate over all input images
+    otbAppLogINFO("Number of inputs " << imageList->Size() << std::endl);
+    std::cerr << "Number of inputs " << imageList->Size() << std::endl;
+    // Setup the DEM Handler
+    otb::Wrapper::ElevationParametersHandler::SetupDEMHandlerFromElevationParameters(this, "elev");
+
+    std::cerr << "Computing class counts" << std::endl;
 
-    std::map<int, int> classPixels;
+    // The vector data of each stratum, reprojected on each image
+    typedef otb::ObjectList<VectorDataReprojectionType> VectorDataReprojectionListType;
+    typedef otb::ObjectList<typename VectorDataReprojectionType::OutputVectorDataType> VectorDataListType;
+    VectorDataReprojectionListType::Pointer vectorDataReprojectionList = VectorDataReprojectionListType::New();
+    VectorDataListType::Pointer vectorDataList = VectorDataListType::New();
 
-    if (this->HasValue("io.vd")) {
-        VectorDataType::Pointer vectorData = GetParameterVectorData("io.vd");
+    for (size_t stratumIndex = 0; stratumIndex < strata.size(); ++stratumIndex)
+    {
+        Stratum &stratum = *strata[stratumIndex];
         // read the Vectordata
-        vectorData->Update();
-
-        auto ok = false;
-        std::string errors;
-        //Iterate over all input images
-        otbAppLogINFO("Number of inputs " << imageList->Size() << std::endl);
-        std::cerr << "Number of inputs " << imageList->Size() << std::endl;
-        ListSampleGeneratorType::ClassesSizeType classesSize;
-        // Setup the DEM Handler
-        otb::Wrapper::ElevationParametersHandler::SetupDEMHandlerFromElevationParameters(this, "elev");
-
-        std::cerr << "Computing class counts" << std::endl;
-
-        typedef otb::ObjectList<VectorDataReprojectionType> VectorDataReprojectionListType;
-        typedef otb::ObjectList<typename VectorDataReprojectionType::OutputVectorDataType> VectorDataListType;
-        VectorDataReprojectionListType::Pointer vectorDataReprojectionList = VectorDataReprojectionListType::New();
-        VectorDataListType::Pointer vectorDataList = VectorDataListType::New();
-        typedef otb::ObjectList<ListSampleGeneratorType> ListSampleGeneratorListType;
-        ListSampleGeneratorListType::Pointer listSampleGenerators = ListSampleGeneratorListType::New();
-        for (unsigned int imgIndex = 0; imgIndex < imageList->Size(); ++imgIndex)
+        stratum.VectorData->Update();
+        stratum.ImageHasSamples.resize(imageList->Size());
+
+        // the sample index of each image, read from a previous training
+        if (HasValue("sample.idx"))
         {
-            FloatVectorImageType::Pointer image = imageList->GetNthElement(imgIndex);
-            image->UpdateOutputInformation();
+            stratum.SampleIndexes.resize(imageList->Size());
+            for (unsigned int imgIndex = 0; imgIndex < imageList->Size(); ++imgIndex)
+            {
+                // the files are named by the image grids, as the in-memory images have no path
+                FloatVectorImageType *image = imageList->GetNthElement(imgIndex);
+                image->UpdateOutputInformation();
+                uint64_t gridHash = otb::PolygonSampleIndex::HashSeed();
+                const FloatVectorImageType::RegionType largestRegion = image->GetLargestPossibleRegion();
+                for (unsigned int i = 0; i < 2; i++)
+                {
+                    const double origin = image->GetOrigin()[i];
+                    const double spacing = image->GetSpacing()[i];
+                    const int64_t index = largestRegion.GetIndex()[i];
+                    const int64_t size = largestRegion.GetSize()[i];
+                    gridHash = otb::PolygonSampleIndex::HashBytes(gridHash, &origin, sizeof(origin));
+                    gridHash = otb::PolygonSampleIndex::HashBytes(gridHash, &spacing, sizeof(spacing));
+                    gridHash = otb::PolygonSampleIndex::HashBytes(gridHash, &index, sizeof(index));
+                    gridHash = otb::PolygonSampleIndex::HashBytes(gridHash, &size, sizeof(size));
+                }
+                const std::string projection = image->GetProjectionRef();
+                gridHash = otb::PolygonSampleIndex::HashBytes(gridHash, projection.data(), projection.size());
 
-            std::cerr << "Image " << imgIndex << " vector length " << image->GetNumberOfComponentsPerPixel() << std::endl;
+                std::ostringstream fileName;
+                fileName << GetParameterString("sample.idx") << '_';
+                if (multiStratum)
+                {
+                    fileName << stratumIndex << '_';
+                }
+                fileName << std::hex << std::setfill('0') << std::setw(16)
+                         << gridHash << ".idx";
+                stratum.SampleIndexFiles.push_back(fileName.str());
+                if (stratum.SampleIndexes[imgIndex].Load(stratum.SampleIndexFiles[imgIndex]))
+                {
+                    otbAppLogINFO("Read the sample index " << stratum.SampleIndexFiles[imgIndex]);
+                }
+            }
+        }
+    }
+
+    for (unsigned int imgIndex = 0; imgIndex < imageList->Size(); ++imgIndex)
+    {
+        FloatVectorImageType::Pointer image = imageList->GetNthElement(imgIndex);
+        image->UpdateOutputInformation();
 
+        std::cerr << "Image " << imgIndex << " vector length " << image->GetNumberOfComponentsPerPixel() << std::endl;
+
+        for (auto &stratum : strata)
+        {
             VectorDataReprojectionType::Pointer vdreproj = VectorDataReprojectionType::New();
             vectorDataReprojectionList->PushBack(vdreproj);
 
             vdreproj->SetInputImage(image);
-            vdreproj->SetInput(vectorData);
+            vdreproj->SetInput(stratum->VectorData);
             vdreproj->SetUseOutputSpacingAndOriginFromImage(false);
             vdreproj->Update();
 
             vectorDataList->PushBack(vdreproj->GetOutput());
             ListSampleGeneratorType::Pointer sampleGenerator = ListSampleGeneratorType::New();
             sampleGenerator->SetInput(image);
-            sampleGenerator->SetInputVectorData(vectorDataList->GetNthElement(imgIndex));
+            sampleGenerator->SetInputVectorData(vdreproj->GetOutput());
 
             sampleGenerator->SetClassKey(GetParameterString("sample.vfn"));
-            sampleGenerator->SetMaxTrainingSize(sampleMt);
-            sampleGenerator->SetMaxValidationSize(sampleMv);
+            sampleGenerator->SetMaxTrainingSize(GetParameterInt("sample.mt"));
+            sampleGenerator->SetMaxValidationSize(GetParameterInt("sample.mv"));
             sampleGenerator->SetValidationTrainingProportion(GetParameterFloat("sample.vtr"));
             sampleGenerator->SetBoundByMin(GetParameterInt("sample.bm")!=0);
 
@@ -348,28 +482,76 @@ void TrainImagesClassifierNew::DoExecute()
                 sampleGenerator->SetPolygonEdgeInclusion(true);
             }
 
+            if (!stratum->SampleIndexes.empty())
+            {
+                sampleGenerator->SetSampleIndex(&stratum->SampleIndexes[imgIndex]);
+            }
+
             sampleGenerator->GenerateClassStatistics();
 
             for (const auto &entry : sampleGenerator->GetClassesSize()) {
-                classesSize[entry.first] += entry.second;
+                stratum->ClassesSize[entry.first] += entry.second;
+                if (entry.second > 0) {
+                    stratum->ImageHasSamples[imgIndex] = true;
+                }
+            }
+            if (stratum->ImageHasSamples[imgIndex]) {
+                stratum->ImageCount++;
             }
         }
+    }
 
-        for (const auto &entry : classesSize) {
+    for (const auto &stratum : strata)
+    {
+        if (multiStratum) {
+            std::cerr << stratum->Name << '\n';
+        }
+        for (const auto &entry : stratum->ClassesSize) {
             std::cerr << entry.first << ' ' << entry.second << '\n';
         }
         std::cerr << std::endl;
+    }
+
+    auto ok = false;
+    std::string errors;
 
-        for (unsigned int imgIndex = 0; imgIndex < imageList->Size(); ++imgIndex)
+    // The images are read once, the samples of all the strata are extracted before moving to the next one
+    for (unsigned int imgIndex = 0; imgIndex < imageList->Size(); ++imgIndex)
+    {
+        FloatVectorImageType::Pointer image = imageList->GetNthElement(imgIndex);
+
+        for (size_t stratumIndex = 0; stratumIndex < strata.size(); ++stratumIndex)
         {
+            Stratum &stratum = *strata[stratumIndex];
+
+            // the images of the other strata are skipped, but a single model still uses them all
+            if (multiStratum && !stratum.ImageHasSamples[imgIndex])
+            {
+                continue;
+            }
+
+            // the sample sizes are given per image
+            const unsigned int imageCount = multiStratum ? stratum.ImageCount : imageList->Size();
+            auto sampleMt = GetParameterInt("sample.mt");
+            auto sampleMv = GetParameterInt("sample.mv");
+            if (sampleMt != -1)
+            {
+                sampleMt *= imageCount;
+            }
+            if (sampleMv != -1)
+            {
+                sampleMv *= imageCount;
+            }
+
+            // the samples of an image which cannot be processed are dropped
+            const size_t trainingRows = stratum.TrainingMatrix.GetRowCount();
+            const size_t validationRows = stratum.ValidationMatrix.GetRowCount();
             try {
                 otbAppLogINFO("Processing input " << imgIndex << std::endl);
                 std::cerr << "Processing input " << imgIndex << std::endl;
-                FloatVectorImageType::Pointer image = imageList->GetNthElement(imgIndex);
-
-                if (imgIndex == 0)
+                if (multiStratum)
                 {
-                    nbBands = image->GetNumberOfComponentsPerPixel();
+                    std::cerr << "Stratum " << stratum.Name << std::endl;
                 }
 
                 std::cerr << "Image " << imgIndex << " vector length " << image->GetNumberOfComponentsPerPixel() << std::endl;
@@ -377,10 +559,9 @@ void TrainImagesClassifierNew::DoExecute()
 
                 //Sample list generator
                 ListSampleGeneratorType::Pointer sampleGenerator = ListSampleGeneratorType::New();
-                listSampleGenerators->PushBack(sampleGenerator);
 
                 sampleGenerator->SetInput(image);
-                sampleGenerator->SetInputVectorData(vectorDataList->GetNthElement(imgIndex));
+                sampleGenerator->SetInputVectorData(vectorDataList->GetNthElement(imgIndex * strata.size() + stratumIndex));
 
                 sampleGenerator->SetClassKey(GetParameterString("sample.vfn"));
 
@@ -388,7 +569,9 @@ void TrainImagesClassifierNew::DoExecute()
                 sampleGenerator->SetMaxValidationSize(sampleMv);
                 sampleGenerator->SetValidationTrainingProportion(GetParameterFloat("sample.vtr"));
                 sampleGenerator->SetBoundByMin(GetParameterInt("sample.bm")!=0);
-                sampleGenerator->SetClassesSize(classesSize);
+                sampleGenerator->SetClassesSize(stratum.ClassesSize);
+                sampleGenerator->SetTrainingMatrix(&stratum.TrainingMatrix);
+                sampleGenerator->SetValidationMatrix(&stratum.ValidationMatrix);
 
                 // take pixel located on polygon edge into consideration
                 if (IsParameterEnabled("sample.edg"))
@@ -396,21 +579,32 @@ void TrainImagesClassifierNew::DoExecute()
                     sampleGenerator->SetPolygonEdgeInclusion(true);
                 }
 
+                if (!stratum.SampleIndexes.empty())
+                {
+                    sampleGenerator->SetSampleIndex(&stratum.SampleIndexes[imgIndex]);
+                }
+
                 sampleGenerator->Update();
 
+                if (!stratum.SampleIndexes.empty() && stratum.SampleIndexes[imgIndex].GetModified())
+                {
+                    if (stratum.SampleIndexes[imgIndex].Save(stratum.SampleIndexFiles[imgIndex]))
+                    {
+                        otbAppLogINFO("Wrote the sample index " << stratum.SampleIndexFiles[imgIndex]);
+                    }
+                    else
+                    {
+                        otbAppLogWARNING("Unable to write the sample index " << stratum.SampleIndexFiles[imgIndex]);
+                    }
+                }
+
                 for (const auto &entry : sampleGenerator->GetClassesSamplesNumberTraining()) {
                     std::cerr << "Tile pixels of class " << entry.first << ": " << entry.second << '\n';
-                    classPixels[entry.first] += entry.second;
+                    stratum.ClassPixels[entry.first] += entry.second;
                 }
 
-                std::cerr << "Training samples: " << sampleGenerator->GetTrainingListSample()->Size() << '\n';
-                std::cerr << "Validation samples: " << sampleGenerator->GetValidationListSample()->Size() << '\n';
-
-                //Concatenate training and validation samples from the image
-                concatenateTrainingLabels->AddInput(sampleGenerator->GetTrainingListLabel());
-                concatenateTrainingSamples->AddInput(sampleGenerator->GetTrainingListSample());
-                concatenateValidationLabels->AddInput(sampleGenerator->GetValidationListLabel());
-                concatenateValidationSamples->AddInput(sampleGenerator->GetValidationListSample());
+                std::cerr << "Training samples: " << stratum.TrainingMatrix.GetRowCount() << '\n';
+                std::cerr << "Validation samples: " << stratum.ValidationMatrix.GetRowCount() << '\n';
 
                 ok = true;
             } catch (const std::exception &e) {
@@ -418,301 +612,215 @@ void TrainImagesClassifierNew::DoExecute()
                 otbAppLogWARNING(<< e.what());
                 errors += e.what();
                 errors += '\n';
+                stratum.TrainingMatrix.Truncate(trainingRows);
+                stratum.ValidationMatrix.Truncate(validationRows);
             } catch (...) {
                 otbAppLogWARNING("Unknown error");
                 errors += "Unknown error";
+                stratum.TrainingMatrix.Truncate(trainingRows);
+                stratum.ValidationMatrix.Truncate(validationRows);
             }
         }
+    }
 
-        if (!ok) {
-            itkExceptionMacro("Unable to train classifier: " << errors);
-        }
-    } else if (this->HasValue("io.rs")) {
-        std::vector<std::string> referenceRasters = GetParameterStringList("io.rs");
-
-        typedef ImageFileReader<Int32ImageType> ImageReaderType;
-        ImageReaderType::Pointer firstReader = ImageReaderType::New();
-        firstReader->SetFileName(referenceRasters[0]);
-        firstReader->UpdateOutputInformation();
-
-        std::cerr << "Computing class counts" << std::endl;
-
-        ListSampleGeneratorRasterType::ClassesSizeType classesSize;
-        typedef otb::ObjectList<ListSampleGeneratorRasterType> ListSampleGeneratorRasterListType;
-        ListSampleGeneratorRasterListType::Pointer listSampleGeneratorsRaster = ListSampleGeneratorRasterListType::New();
-
-        for (unsigned int imgIndex = 0; imgIndex < imageList->Size(); ++imgIndex)
-        {
-            FloatVectorImageType::Pointer image = imageList->GetNthElement(imgIndex);
-            image->UpdateOutputInformation();
-
-            ImageReaderType::Pointer reader;
-            Int32ImageType::Pointer raster;
-            if (imgIndex == 0 || referenceRasters.size() == 1) {
-                raster = firstReader->GetOutput();
-            } else {
-                reader = ImageReaderType::New();
-                reader->SetFileName(referenceRasters[imgIndex]);
-                reader->UpdateOutputInformation();
-                raster = reader->GetOutput();
-            }
-
-            raster->SetRequestedRegionToLargestPossibleRegion();
-            raster->PropagateRequestedRegion();
-            raster->UpdateOutputData();
+    if (!ok) {
+        itkExceptionMacro("Unable to train classifier: " << errors);
+    }
+}
 
-            //Sample list generator
-            ListSampleGeneratorRasterType::Pointer sampleGenerator = ListSampleGeneratorRasterType::New();
-            listSampleGeneratorsRaster->PushBack(sampleGenerator);
+void TrainImagesClassifierNew::GenerateRasterSamples(Stratum &stratum)
+{
+    FloatVectorImageListType* imageList = GetParameterImageList("io.il");
+    auto sampleMt = GetParameterInt("sample.mt");
+    auto sampleMv = GetParameterInt("sample.mv");
+    if (sampleMt != -1)
+    {
+        sampleMt *= imageList->Size();
+    }
+    if (sampleMv != -1)
+    {
+        sampleMv *= imageList->Size();
+    }
 
-            sampleGenerator->SetInput(image);
-            sampleGenerator->SetInputRaster(raster);
+    std::vector<std::string> referenceRasters = GetParameterStringList("io.rs");
 
-            sampleGenerator->SetNoDataLabel(GetParameterInt("nodatalabel"));
-            sampleGenerator->SetMaxTrainingSize(sampleMt);
-            sampleGenerator->SetMaxValidationSize(sampleMv);
-            sampleGenerator->SetValidationTrainingProportion(GetParameterFloat("sample.vtr"));
-            sampleGenerator->SetBoundByMin(GetParameterInt("sample.bm")!=0);
+    typedef ImageFileReader<Int32ImageType> ImageReaderType;
+    ImageReaderType::Pointer firstReader = ImageReaderType::New();
+    firstReader->SetFileName(referenceRasters[0]);
+    firstReader->UpdateOutputInformation();
 
-            sampleGenerator->GenerateClassStatistics();
+    std::cerr << "Computing class counts" << std::endl;
 
-            for (const auto &entry : sampleGenerator->GetClassesSize()) {
-                classesSize[entry.first] += entry.second;
-            }
-        }
+    ListSampleGeneratorRasterType::ClassesSizeType classesSize;
+    typedef otb::ObjectList<ListSampleGeneratorRasterType> ListSampleGeneratorRasterListType;
+    ListSampleGeneratorRasterListType::Pointer listSampleGeneratorsRaster = ListSampleGeneratorRasterListType::New();
 
-        for (const auto &entry : classesSize) {
-            std::cerr << entry.first << ' ' << entry.second << '\n';
+    for (unsigned int imgIndex = 0; imgIndex < imageList->Size(); ++imgIndex)
+    {
+        FloatVectorImageType::Pointer image = imageList->GetNthElement(imgIndex);
+        image->UpdateOutputInformation();
+
+        ImageReaderType::Pointer reader;
+        Int32ImageType::Pointer raster;
+        if (imgIndex == 0 || referenceRasters.size() == 1) {
+            raster = firstReader->GetOutput();
+        } else {
+            reader = ImageReaderType::New();
+            reader->SetFileName(referenceRasters[imgIndex]);
+            reader->UpdateOutputInformation();
+            raster = reader->GetOutput();
         }
-        std::cerr << std::endl;
 
-        //Iterate over all input images
-        for (unsigned int imgIndex = 0; imgIndex < imageList->Size(); ++imgIndex)
-        {
-            otbAppLogINFO("Processing input " << imgIndex << std::endl);
-
-            FloatVectorImageType::Pointer image = imageList->GetNthElement(imgIndex);
-            image->UpdateOutputInformation();
-
-            if (imgIndex == 0)
-            {
-                nbBands = image->GetNumberOfComponentsPerPixel();
-            }
+        raster->SetRequestedRegionToLargestPossibleRegion();
+        raster->PropagateRequestedRegion();
+        raster->UpdateOutputData();
 
-            ImageReaderType::Pointer reader;
-            Int32ImageType::Pointer raster;
-            if (imgIndex == 0 || referenceRasters.size() == 1) {
-                raster = firstReader->GetOutput();
-            } else {
-                reader = ImageReaderType::New();
-                reader->SetFileName(referenceRasters[imgIndex]);
-                raster = reader->GetOutput();
-            }
+        //Sample list generator
+        ListSampleGeneratorRasterType::Pointer sampleGenerator = ListSampleGeneratorRasterType::New();
+        listSampleGeneratorsRaster->PushBack(sampleGenerator);
 
-            //Sample list generator
-            ListSampleGeneratorRasterType::Pointer sampleGenerator = ListSampleGeneratorRasterType::New();
-
-            sampleGenerator->SetInput(image);
-            sampleGenerator->SetInputRaster(raster);
-
-            sampleGenerator->SetNoDataLabel(GetParameterInt("nodatalabel"));
-            sampleGenerator->SetMaxTrainingSize(sampleMt);
-            sampleGenerator->SetMaxValidationSize(sampleMv);
-            sampleGenerator->SetValidationTrainingProportion(GetParameterFloat("sample.vtr"));
-            sampleGenerator->SetBoundByMin(GetParameterInt("sample.bm")!=0);
-            sampleGenerator->SetClassesSize(classesSize);
-            sampleGenerator->Update();
+        sampleGenerator->SetInput(image);
+        sampleGenerator->SetInputRaster(raster);
 
-            for (const auto &entry : sampleGenerator->GetClassesSamplesNumberTraining()) {
-                std::cerr << "Tile pixels of class " << entry.first << ": " << entry.second << '\n';
-                classPixels[entry.first] += entry.second;
-            }
+        sampleGenerator->SetNoDataLabel(GetParameterInt("nodatalabel"));
+        sampleGenerator->SetMaxTrainingSize(sampleMt);
+        sampleGenerator->SetMaxValidationSize(sampleMv);
+        sampleGenerator->SetValidationTrainingProportion(GetParameterFloat("sample.vtr"));
+        sampleGenerator->SetBoundByMin(GetParameterInt("sample.bm")!=0);
 
-            std::cerr << "Training samples: " << sampleGenerator->GetTrainingListSample()->Size() << '\n';
-            std::cerr << "Validation samples: " << sampleGenerator->GetValidationListSample()->Size() << '\n';
+        sampleGenerator->GenerateClassStatistics();
 
-            //Concatenate training and validation samples from the image
-            concatenateTrainingLabels->AddInput(sampleGenerator->GetTrainingListLabel());
-            concatenateTrainingSamples->AddInput(sampleGenerator->GetTrainingListSample());
-            concatenateValidationLabels->AddInput(sampleGenerator->GetValidationListLabel());
-            concatenateValidationSamples->AddInput(sampleGenerator->GetValidationListSample());
+        for (const auto &entry : sampleGenerator->GetClassesSize()) {
+            classesSize[entry.first] += entry.second;
         }
-    } else {
-        otbAppLogFATAL("No samples provided! ");
     }
 
-    // Update
-    concatenateTrainingSamples->Update();
-    concatenateTrainingLabels->Update();
-    concatenateValidationSamples->Update();
-    concatenateValidationLabels->Update();
-
-    for (const auto &entry : classPixels) {
-        std::cerr << "Total pixels of class " << entry.first << ": " << entry.second << '\n';
+    for (const auto &entry : classesSize) {
+        std::cerr << entry.first << ' ' << entry.second << '\n';
     }
+    std::cerr << std::endl;
 
-    std::cerr << "Total training samples: " << concatenateTrainingSamples->GetOutput()->Size() << '\n';
-    std::cerr << "Total validation samples: " << concatenateValidationSamples->GetOutput()->Size() << '\n';
-
-    if (concatenateTrainingSamples->GetOutput()->Size() == 0)
+    //Iterate over all input images
+    for (unsigned int imgIndex = 0; imgIndex < imageList->Size(); ++imgIndex)
     {
-        otbAppLogFATAL("No training samples, cannot perform SVM training.");
-    }
+        otbAppLogINFO("Processing input " << imgIndex << std::endl);
+
+        FloatVectorImageType::Pointer image = imageList->GetNthElement(imgIndex);
+        image->UpdateOutputInformation();
+
+        ImageReaderType::Pointer reader;
+        Int32ImageType::Pointer raster;
+        if (imgIndex == 0 || referenceRasters.size() == 1) {
+            raster = firstReader->GetOutput();
+        } else {
+            reader = ImageReaderType::New();
+            reader->SetFileName(referenceRasters[imgIndex]);
+            raster = reader->GetOutput();
+        }
 
-    if (concatenateValidationSamples->GetOutput()->Size() == 0)
-    {
-        otbAppLogWARNING("No validation samples.");
-    }
+        //Sample list generator
+        ListSampleGeneratorRasterType::Pointer sampleGenerator = ListSampleGeneratorRasterType::New();
+
+        sampleGenerator->SetInput(image);
+        sampleGenerator->SetInputRaster(raster);
+
+        sampleGenerator->SetNoDataLabel(GetParameterInt("nodatalabel"));
+        sampleGenerator->SetMaxTrainingSize(sampleMt);
+        sampleGenerator->SetMaxValidationSize(sampleMv);
+        sampleGenerator->SetValidationTrainingProportion(GetParameterFloat("sample.vtr"));
+        sampleGenerator->SetBoundByMin(GetParameterInt("sample.bm")!=0);
+        sampleGenerator->SetClassesSize(classesSize);
+        sampleGenerator->SetTrainingMatrix(&stratum.TrainingMatrix);
+        sampleGenerator->SetValidationMatrix(&stratum.ValidationMatrix);
+        sampleGenerator->Update();
+
+        for (const auto &entry : sampleGenerator->GetClassesSamplesNumberTraining()) {
+            std::cerr << "Tile pixels of class " << entry.first << ": " << entry.second << '\n';
+            stratum.ClassPixels[entry.first] += entry.second;
+        }
 
-    if (IsParameterEnabled("io.imstat"))
-    {
-        StatisticsReader::Pointer statisticsReader = StatisticsReader::New();
-        statisticsReader->SetFileName(GetParameterString("io.imstat"));
-        meanMeasurementVector = statisticsReader->GetStatisticVectorByName("mean");
-        stddevMeasurementVector = statisticsReader->GetStatisticVectorByName("stddev");
+        std::cerr << "Training samples: " << stratum.TrainingMatrix.GetRowCount() << '\n';
+        std::cerr << "Validation samples: " << stratum.ValidationMatrix.GetRowCount() << '\n';
     }
-    else
-    {
-        meanMeasurementVector.SetSize(nbBands);
-        meanMeasurementVector.Fill(0.);
-        stddevMeasurementVector.SetSize(nbBands);
-        stddevMeasurementVector.Fill(1.);
-    }
-
-    // Shift scale the samples
-    ShiftScaleFilterType::Pointer trainingShiftScaleFilter = ShiftScaleFilterType::New();
-    trainingShiftScaleFilter->SetInput(concatenateTrainingSamples->GetOutput());
-    trainingShiftScaleFilter->SetShifts(meanMeasurementVector);
-    trainingShiftScaleFilter->SetScales(stddevMeasurementVector);
-    trainingShiftScaleFilter->Update();
+}
 
-    ListSampleType::Pointer validationListSample=ListSampleType::New();
+void TrainImagesClassifierNew::TrainStratum(Stratum &stratum)
+{
+    // The models only take list samples, the training samples are copied once and
+    // released, the validation ones stay in their matrix until the model is evaluated
+    stratum.TrainingListSample = ListSampleType::New();
+    stratum.TrainingLabeledListSample = LabelListSampleType::New();
+    stratum.TrainingMatrix.Export(stratum.TrainingListSample.GetPointer(), stratum.TrainingLabeledListSample.GetPointer());
+    stratum.TrainingMatrix.Clear();
+
+    stratum.Model = TrainModel(stratum.TrainingListSample, stratum.TrainingLabeledListSample);
+}
 
-    //Test if the validation test is empty
-    if ( concatenateValidationSamples->GetOutput()->Size() != 0 )
+void TrainImagesClassifierNew::TrainModels(StratumListType &strata)
+{
+    if (strata.size() == 1)
     {
-        ShiftScaleFilterType::Pointer validationShiftScaleFilter = ShiftScaleFilterType::New();
-        validationShiftScaleFilter->SetInput(concatenateValidationSamples->GetOutput());
-        validationShiftScaleFilter->SetShifts(meanMeasurementVector);
-        validationShiftScaleFilter->SetScales(stddevMeasurementVector);
-        validationShiftScaleFilter->Update();
-        validationListSample = validationShiftScaleFilter->GetOutput();
+        TrainStratum(*strata[0]);
+        return;
     }
 
-    ListSampleType::Pointer listSample;
-    LabelListSampleType::Pointer labelListSample;
-    //--------------------------
-    // Balancing training sample (if needed)
-    // if (IsParameterEnabled("sample.b"))
-    //   {
-    //   // Balance the list sample.
-    //   otbAppLogINFO("Number of training samples before balancing: " << concatenateTrainingSamples->GetOutput()->Size())
-    //   BalancingListSampleFilterType::Pointer balancingFilter = BalancingListSampleFilterType::New();
-    //   balancingFilter->SetInput(trainingShiftScaleFilter->GetOutput());
-    //   balancingFilter->SetInputLabel(concatenateTrainingLabels->GetOutput());
-    //   balancingFilter->SetBalancingFactor(GetParameterInt("sample.b"));
-    //   balancingFilter->Update();
-    //   listSample = balancingFilter->GetOutput();
-    //   labelListSample = balancingFilter->GetOutputLabelSampleList();
-    //   otbAppLogINFO("Number of samples after balancing: " << balancingFilter->GetOutput()->Size());
-
-    //   }
-    // else
-    //   {
-    listSample = trainingShiftScaleFilter->GetOutput();
-    labelListSample = concatenateTrainingLabels->GetOutput();
-    otbAppLogINFO("Number of training samples: " << concatenateTrainingSamples->GetOutput()->Size());
-    //  }
-    //--------------------------
-    // Split the data set into training/validation set
-    ListSampleType::Pointer trainingListSample = listSample;
-    LabelListSampleType::Pointer trainingLabeledListSample = labelListSample;
-
-    LabelListSampleType::Pointer validationLabeledListSample = concatenateValidationLabels->GetOutput();
-    otbAppLogINFO("Size of training set: " << trainingListSample->Size());
-    otbAppLogINFO("Size of validation set: " << validationListSample->Size());
-    otbAppLogINFO("Size of labeled training set: " << trainingLabeledListSample->Size());
-    otbAppLogINFO("Size of labeled validation set: " << validationLabeledListSample->Size());
-
-    //--------------------------
-    // Estimate model
-    //--------------------------
-    LabelListSampleType::Pointer predictedList = LabelListSampleType::New();
-    const std::string classifierType = GetParameterString("classifier");
-
-    if (classifierType == "libsvm")
+    unsigned int budget = itk::MultiThreader::GetGlobalDefaultNumberOfThreads();
+    if (HasValue("strata.threads") && GetParameterInt("strata.threads") > 0)
     {
-#ifdef OTB_USE_LIBSVM
-        TrainLibSVM(trainingListSample, trainingLabeledListSample);
-#else
-        otbAppLogFATAL("Module LIBSVM is not installed. You should consider turning OTB_USE_LIBSVM on during cmake configuration.");
-#endif
+        budget = GetParameterInt("strata.threads");
     }
-    else if (classifierType == "svm")
+    otbAppLogINFO("Training " << strata.size() << " models, " << budget << " at a time");
+
+    // Each model is trained by a new thread. OpenCV keeps a random generator for each thread,
+    // so every model is trained as if it was the only one, whatever the order of the threads.
+    std::mutex mutex;
+    std::condition_variable finished;
+    unsigned int running = 0;
+    std::vector<std::exception_ptr> errors(strata.size());
+    std::vector<std::thread> threads;
+    threads.reserve(strata.size());
+    for (size_t i = 0; i < strata.size(); ++i)
     {
-#ifdef OTB_USE_OPENCV
-        TrainSVM(trainingListSample, trainingLabeledListSample);
-#else
-        otbAppLogFATAL("Module OPENCV is not installed. You should consider turning OTB_USE_OPENCV on during cmake configuration.");
-#endif
-    }
-    else if (classifierType == "boost")
-    {
-#ifdef OTB_USE_OPENCV
-        TrainBoost(trainingListSample, trainingLabeledListSample);
-#else
-        otbAppLogFATAL("Module OPENCV is not installed. You should consider turning OTB_USE_OPENCV on during cmake configuration.");
-#endif
-    }
-    else if (classifierType == "dt")
-    {
-#ifdef OTB_USE_OPENCV
-        TrainDecisionTree(trainingListSample, trainingLabeledListSample);
-#else
-        otbAppLogFATAL("Module OPENCV is not installed. You should consider turning OTB_USE_OPENCV on during cmake configuration.");
-#endif
-    }
-    else if (classifierType == "gbt")
-    {
-#ifdef OTB_USE_OPENCV
-//        TrainGradientBoostedTree(trainingListSample, trainingLabeledListSample);
-#else
-        otbAppLogFATAL("Module OPENCV is not installed. You should consider turning OTB_USE_OPENCV on during cmake configuration.");
-#endif
-    }
-    else if (classifierType == "ann")
-    {
-#ifdef OTB_USE_OPENCV
-        TrainNeuralNetwork(trainingListSample, trainingLabeledListSample);
-#else
-        otbAppLogFATAL("Module OPENCV is not installed. You should consider turning OTB_USE_OPENCV on during cmake configuration.");
-#endif
-    }
-    else if (classifierType == "bayes")
-    {
-#ifdef OTB_USE_OPENCV
-        TrainNormalBayes(trainingListSample, trainingLabeledListSample);
-#else
-        otbAppLogFATAL("Module OPENCV is not installed. You should consider turning OTB_USE_OPENCV on during cmake configuration.");
-#endif
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [&] { return running < budget; });
+            ++running;
+        }
+        threads.emplace_back([this, &strata, &errors, &mutex, &finished, &running, i] {
+            try {
+                TrainStratum(*strata[i]);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            --running;
+            finished.notify_one();
+        });
     }
-    else if (classifierType == "rf")
+    for (auto &thread : threads)
     {
-#ifdef OTB_USE_OPENCV
-        TrainRandomForests(trainingListSample, trainingLabeledListSample);
-#else
-        otbAppLogFATAL("Module OPENCV is not installed. You should consider turning OTB_USE_OPENCV on during cmake configuration.");
-#endif
+        thread.join();
     }
-    else if (classifierType == "knn")
+
+    for (size_t i = 0; i < strata.size(); ++i)
     {
-#ifdef OTB_USE_OPENCV
-        TrainKNN(trainingListSample, trainingLabeledListSample);
-#else
-        otbAppLogFATAL("Module OPENCV is not installed. You should consider turning OTB_USE_OPENCV on during cmake configuration.");
-#endif
+        if (errors[i])
+        {
+            otbAppLogWARNING("Unable to train the model of " << strata[i]->Name);
+            std::rethrow_exception(errors[i]);
+        }
     }
+}
 
+void TrainImagesClassifierNew::EvaluateModel(Stratum &stratum)
+{
+    ListSampleType::Pointer validationListSample = ListSampleType::New();
+    LabelListSampleType::Pointer validationLabeledListSample = LabelListSampleType::New();
+    stratum.ValidationMatrix.Export(validationListSample.GetPointer(), validationLabeledListSample.GetPointer());
+    stratum.ValidationMatrix.Clear();
+
+    LabelListSampleType::Pointer predictedList = LabelListSampleType::New();
 
     //--------------------------
     // Performances estimation
@@ -729,11 +837,11 @@ void TrainImagesClassifierNew::DoExecute()
     else
     {
         otbAppLogWARNING("The validation set is empty. The performance estimation is done using the input training set in this case.");
-        performanceListSample = trainingListSample;
-        performanceLabeledListSample = trainingLabeledListSample;
+        performanceListSample = stratum.TrainingListSample;
+        performanceLabeledListSample = stratum.TrainingLabeledListSample;
     }
 
-    Classify(performanceListSample, predictedList);
+    Classify(stratum.ModelFile, performanceListSample, predictedList);
 
     ConfusionMatrixCalculatorType::Pointer confMatCalc = ConfusionMatrixCalculatorType::New();
 
@@ -744,7 +852,7 @@ void TrainImagesClassifierNew::DoExecute()
 
     confMatCalc->Compute();
 
-    otbAppLogINFO("training performances");
+    otbAppLogINFO("training performances" << (stratum.Name.empty() ? "" : " of ") << stratum.Name);
     LogConfusionMatrix(confMatCalc);
 
     for (unsigned int itClasses = 0; itClasses < confMatCalc->GetNumberOfClasses(); itClasses++)
@@ -759,7 +867,7 @@ void TrainImagesClassifierNew::DoExecute()
     otbAppLogINFO("Global performance, Kappa index: " << confMatCalc->GetKappaIndex());
 
 
-    if (this->HasValue("io.confmatout"))
+    if (!stratum.ConfusionMatrixFile.empty())
     {
         // Writing the confusion matrix in the output .CSV file
 
@@ -809,7 +917,7 @@ void TrainImagesClassifierNew::DoExecute()
         }
 
         std::ofstream outFile;
-        outFile.open(this->GetParameterString("io.confmatout").c_str());
+        outFile.open(stratum.ConfusionMatrixFile.c_str());
         outFile << std::fixed;
         outFile.precision(10);
 
@@ -844,7 +952,172 @@ void TrainImagesClassifierNew::DoExecute()
         }
 
         outFile.close();
-    } // END if (this->HasValue("io.confmatout"))
+    } // END if (!stratum.ConfusionMatrixFile.empty())
+
+    // The training samples were kept for the evaluation
+    stratum.TrainingListSample = ListSampleType::Pointer();
+    stratum.TrainingLabeledListSample = LabelListSampleType::Pointer();
+}
+
+void TrainImagesClassifierNew::DoExecute()
+{
+    GetLogger()->Debug("Entering DoExecute\n");
+    MeasurementType meanMeasurementVector;
+    MeasurementType stddevMeasurementVector;
+
+    //--------------------------
+    // Load measurements from images
+    FloatVectorImageListType* imageList = GetParameterImageList("io.il");
+    imageList->GetNthElement(0)->UpdateOutputInformation();
+    const unsigned int nbBands = imageList->GetNthElement(0)->GetNumberOfComponentsPerPixel();
+
+    // Either a single model, or a model for each stratum
+    StratumListType strata;
+    const bool multiStratum = HasValue("strata.vd");
+    if (multiStratum)
+    {
+        VectorDataListType* vectorDataList = GetParameterVectorDataList("strata.vd");
+        if (!HasValue("strata.out") || GetParameterStringList("strata.out").size() != vectorDataList->Size())
+        {
+            otbAppLogFATAL("The number of output models must match the number of strata.");
+        }
+        std::vector<std::string> modelFiles = GetParameterStringList("strata.out");
+        std::vector<std::string> confusionMatrixFiles;
+        if (HasValue("strata.confmatout"))
+        {
+            confusionMatrixFiles = GetParameterStringList("strata.confmatout");
+            if (confusionMatrixFiles.size() != vectorDataList->Size())
+            {
+                otbAppLogFATAL("The number of output confusion matrices must match the number of strata.");
+            }
+        }
+        for (unsigned int i = 0; i < vectorDataList->Size(); ++i)
+        {
+            std::unique_ptr<Stratum> stratum(new Stratum);
+            stratum->Name = modelFiles[i];
+            stratum->VectorData = vectorDataList->GetNthElement(i);
+            stratum->ModelFile = modelFiles[i];
+            if (!confusionMatrixFiles.empty())
+            {
+                stratum->ConfusionMatrixFile = confusionMatrixFiles[i];
+            }
+            strata.push_back(std::move(stratum));
+        }
+    }
+    else
+    {
+        if (!HasValue("io.out"))
+        {
+            otbAppLogFATAL("No output model provided!");
+        }
+        std::unique_ptr<Stratum> stratum(new Stratum);
+        if (HasValue("io.vd"))
+        {
+            stratum->VectorData = GetParameterVectorData("io.vd");
+        }
+        stratum->ModelFile = GetParameterString("io.out");
+        if (HasValue("io.confmatout"))
+        {
+            stratum->ConfusionMatrixFile = GetParameterString("io.confmatout");
+        }
+        strata.push_back(std::move(stratum));
+    }
+
+    // The samples of all the images are appended to the same matrices
+    for (size_t i = 0; i < strata.size(); ++i)
+    {
+        std::string trainingSpillFile;
+        std::string validationSpillFile;
+        if (HasValue("sample.spill"))
+        {
+            std::ostringstream prefix;
+            prefix << GetParameterString("sample.spill");
+            if (multiStratum)
+            {
+                prefix << '_' << i;
+            }
+            trainingSpillFile = prefix.str() + "_training.bin";
+            validationSpillFile = prefix.str() + "_validation.bin";
+        }
+        strata[i]->TrainingMatrix.Initialize(nbBands, trainingSpillFile);
+        strata[i]->ValidationMatrix.Initialize(nbBands, validationSpillFile);
+    }
+
+    if (multiStratum || this->HasValue("io.vd")) {
+        GenerateVectorDataSamples(strata);
+    } else if (this->HasValue("io.rs")) {
+        GenerateRasterSamples(*strata[0]);
+    } else {
+        otbAppLogFATAL("No samples provided! ");
+    }
+
+    if (IsParameterEnabled("io.imstat"))
+    {
+        StatisticsReader::Pointer statisticsReader = StatisticsReader::New();
+        statisticsReader->SetFileName(GetParameterString("io.imstat"));
+        meanMeasurementVector = statisticsReader->GetStatisticVectorByName("mean");
+        stddevMeasurementVector = statisticsReader->GetStatisticVectorByName("stddev");
+    }
+    else
+    {
+        meanMeasurementVector.SetSize(nbBands);
+        meanMeasurementVector.Fill(0.);
+        stddevMeasurementVector.SetSize(nbBands);
+        stddevMeasurementVector.Fill(1.);
+    }
+
+    if (meanMeasurementVector.Size() != nbBands || stddevMeasurementVector.Size() != nbBands)
+    {
+        otbAppLogFATAL("The image statistics do not have " << nbBands << " components.");
+    }
+
+    for (auto &stratum : strata)
+    {
+        if (multiStratum) {
+            std::cerr << "Stratum " << stratum->Name << '\n';
+        }
+        for (const auto &entry : stratum->ClassPixels) {
+            std::cerr << "Total pixels of class " << entry.first << ": " << entry.second << '\n';
+        }
+
+        std::cerr << "Total training samples: " << stratum->TrainingMatrix.GetRowCount() << '\n';
+        std::cerr << "Total validation samples: " << stratum->ValidationMatrix.GetRowCount() << '\n';
+
+        if (stratum->TrainingMatrix.GetRowCount() == 0)
+        {
+            otbAppLogFATAL("No training samples" << (multiStratum ? " for " + stratum->Name : std::string())
+                           << ", cannot perform SVM training.");
+        }
+
+        if (stratum->ValidationMatrix.GetRowCount() == 0)
+        {
+            otbAppLogWARNING("No validation samples" << (multiStratum ? " for " + stratum->Name : std::string()) << ".");
+        }
+
+        // Shift scale the samples in place
+        stratum->TrainingMatrix.ShiftScale(meanMeasurementVector, stddevMeasurementVector);
+        stratum->ValidationMatrix.ShiftScale(meanMeasurementVector, stddevMeasurementVector);
+
+        otbAppLogINFO("Size of training set: " << stratum->TrainingMatrix.GetRowCount());
+        otbAppLogINFO("Size of validation set: " << stratum->ValidationMatrix.GetRowCount());
+    }
+
+    //--------------------------
+    // Estimate the models
+    //--------------------------
+    TrainModels(strata);
+
+    // The models are written once they are all trained
+    for (auto &stratum : strata)
+    {
+        stratum->Model->Save(stratum->ModelFile);
+        stratum->Model = ModelPointerType();
+    }
+
+    for (auto &stratum : strata)
+    {
+        EvaluateModel(*stratum);
+    }
 
     // TODO: implement hyperplane distance classifier and performance validation (cf. object detection) ?
 
@@ -34,6 +34,9 @@
 #include "otbWrapperApplicationFactory.h"
 
 #include <iostream>
+#include <memory>
+#include <vector>
+#include <map>
 
 //Image
 #include "otbVectorImage.h"
@@ -161,6 +164,32 @@ public:
   // Extract ROI
   typedef otb::VectorDataIntoImageProjectionFilter<VectorDataType, FloatVectorImageType> VectorDataReprojectionType;
 
+  /** The samples of a model and its output files. A single model is trained from io.vd or io.rs,
+   * or one for each vector data of strata.vd, sharing the input images */
+  struct Stratum
+  {
+    Stratum() : ImageCount(0) {}
+
+    std::string                               Name;
+    VectorDataType::Pointer                   VectorData;
+    std::string                               ModelFile;
+    std::string                               ConfusionMatrixFile;
+
+    ListSampleGeneratorType::ClassesSizeType  ClassesSize;
+    std::vector<bool>                         ImageHasSamples;
+    unsigned int                              ImageCount;
+    std::vector<otb::PolygonSampleIndex>      SampleIndexes;
+    std::vector<std::string>                  SampleIndexFiles;
+    std::map<int, int>                        ClassPixels;
+
+    otb::SampleMatrix                         TrainingMatrix;
+    otb::SampleMatrix                         ValidationMatrix;
+    ListSampleType::Pointer                   TrainingListSample;
+    LabelListSampleType::Pointer              TrainingLabeledListSample;
+    ModelPointerType                          Model;
+  };
+  typedef std::vector<std::unique_ptr<Stratum> > StratumListType;
+
 protected:
   using Superclass::AddParameter;
   friend void InitSVMParams(TrainImagesClassifierNew & app);
@@ -188,21 +217,33 @@ private:
 #endif
 
 #ifdef OTB_USE_LIBSVM 
-  void TrainLibSVM(ListSampleType::Pointer trainingListSample, LabelListSampleType::Pointer trainingLabeledListSample);
+  ModelPointerType TrainLibSVM(ListSampleType::Pointer trainingListSample, LabelListSampleType::Pointer trainingLabeledListSample);
 #endif 
   
 #ifdef OTB_USE_OPENCV
-  void TrainBoost(ListSampleType::Pointer trainingListSample, LabelListSampleType::Pointer trainingLabeledListSample);
-  void TrainSVM(ListSampleType::Pointer trainingListSample, LabelListSampleType::Pointer trainingLabeledListSample);
-  void TrainDecisionTree(ListSampleType::Pointer trainingListSample, LabelListSampleType::Pointer trainingLabeledListSample);
+  ModelPointerType TrainBoost(ListSampleType::Pointer trainingListSample, LabelListSampleType::Pointer trainingLabeledListSample);
+  ModelPointerType TrainSVM(ListSampleType::Pointer trainingListSample, LabelListSampleType::Pointer trainingLabeledListSample);
+  ModelPointerType TrainDecisionTree(ListSampleType::Pointer trainingListSample, LabelListSampleType::Pointer trainingLabeledListSample);
 //  void TrainGradientBoostedTree(ListSampleType::Pointer trainingListSample, LabelListSampleType::Pointer trainingLabeledListSample);
-  void TrainNeuralNetwork(ListSampleType::Pointer trainingListSample, LabelListSampleType::Pointer trainingLabeledListSample);
-  void TrainNormalBayes(ListSampleType::Pointer trainingListSample, LabelListSampleType::Pointer trainingLabeledListSample);
-  void TrainRandomForests(ListSampleType::Pointer trainingListSample, LabelListSampleType::Pointer trainingLabeledListSample);
-  void TrainKNN(ListSampleType::Pointer trainingListSample, LabelListSampleType::Pointer trainingLabeledListSample);
+  ModelPointerType TrainNeuralNetwork(ListSampleType::Pointer trainingListSample, LabelListSampleType::Pointer trainingLabeledListSample);
+  ModelPointerType TrainNormalBayes(ListSampleType::Pointer trainingListSample, LabelListSampleType::Pointer trainingLabeledListSample);
+  ModelPointerType TrainRandomForests(ListSampleType::Pointer trainingListSample, LabelListSampleType::Pointer trainingLabeledListSample);
+  ModelPointerType TrainKNN(ListSampleType::Pointer trainingListSample, LabelListSampleType::Pointer trainingLabeledListSample);
 #endif
 
-  void Classify(ListSampleType::Pointer validationListSample, LabelListSampleType::Pointer &predictedList);
+  /** Trains a model of the chosen classifier, without writing it */
+  ModelPointerType TrainModel(ListSampleType::Pointer trainingListSample, LabelListSampleType::Pointer trainingLabeledListSample);
+
+  void GenerateVectorDataSamples(StratumListType &strata);
+  void GenerateRasterSamples(Stratum &stratum);
+
+  /** Trains the models of the strata concurrently, with at most strata.threads threads */
+  void TrainModels(StratumListType &strata);
+  void TrainStratum(Stratum &stratum);
+
+  void EvaluateModel(Stratum &stratum);
+
+  void Classify(const std::string &modelFile, ListSampleType::Pointer validationListSample, LabelListSampleType::Pointer &predictedList);
 
   void DoExecute();
 };
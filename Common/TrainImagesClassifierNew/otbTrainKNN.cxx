@@ -52,7 +52,7 @@ namespace Wrapper
   }
 
 
-  void TrainImagesClassifierNew::TrainKNN(ListSampleType::Pointer trainingListSample, LabelListSampleType::Pointer trainingLabeledListSample)
+  TrainImagesClassifierNew::ModelPointerType TrainImagesClassifierNew::TrainKNN(ListSampleType::Pointer trainingListSample, LabelListSampleType::Pointer trainingLabeledListSample)
   {
     KNNType::Pointer knnClassifier = KNNType::New();
     knnClassifier->SetInputListSample(trainingListSample);
@@ -60,7 +60,7 @@ namespace Wrapper
     knnClassifier->SetK(GetParameterInt("classifier.knn.k"));
 
     knnClassifier->Train();
-    knnClassifier->Save(GetParameterString("io.out"));
+    return knnClassifier.GetPointer();
   }
 #endif
 } //end namespace wrapper
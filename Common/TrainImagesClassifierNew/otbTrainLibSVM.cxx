@@ -60,7 +60,7 @@ namespace Wrapper
   }
 
 
-  void TrainImagesClassifierNew::TrainLibSVM(ListSampleType::Pointer trainingListSample, LabelListSampleType::Pointer trainingLabeledListSample)
+  TrainImagesClassifierNew::ModelPointerType TrainImagesClassifierNew::TrainLibSVM(ListSampleType::Pointer trainingListSample, LabelListSampleType::Pointer trainingLabeledListSample)
   {
     LibSVMType::Pointer libSVMClassifier = LibSVMType::New();
     libSVMClassifier->SetInputListSample(trainingListSample);
@@ -92,7 +92,7 @@ namespace Wrapper
         break;
       }
     libSVMClassifier->Train();
-    libSVMClassifier->Save(GetParameterString("io.out"));
+    return libSVMClassifier.GetPointer();
   }
 #endif
 } //end namespace wrapper
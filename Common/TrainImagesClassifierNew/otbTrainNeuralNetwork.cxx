@@ -134,7 +134,7 @@ void TrainImagesClassifierNew::InitNeuralNetworkParams()
 
 }
 
-void TrainImagesClassifierNew::TrainNeuralNetwork(ListSampleType::Pointer trainingListSample,
+TrainImagesClassifierNew::ModelPointerType TrainImagesClassifierNew::TrainNeuralNetwork(ListSampleType::Pointer trainingListSample,
                                                               LabelListSampleType::Pointer trainingLabeledListSample)
 {
   NeuralNetworkType::Pointer classifier = NeuralNetworkType::New();
@@ -223,7 +223,7 @@ void TrainImagesClassifierNew::TrainNeuralNetwork(ListSampleType::Pointer traini
   classifier->SetEpsilon(GetParameterFloat("classifier.ann.eps"));
   classifier->SetMaxIter(GetParameterInt("classifier.ann.iter"));
   classifier->Train();
-  classifier->Save(GetParameterString("io.out"));
+  return classifier.GetPointer();
 }
 #endif
 } //end namespace wrapper
@@ -47,13 +47,13 @@ namespace Wrapper
   }
 
 
-  void TrainImagesClassifierNew::TrainNormalBayes(ListSampleType::Pointer trainingListSample, LabelListSampleType::Pointer trainingLabeledListSample)
+  TrainImagesClassifierNew::ModelPointerType TrainImagesClassifierNew::TrainNormalBayes(ListSampleType::Pointer trainingListSample, LabelListSampleType::Pointer trainingLabeledListSample)
   {
     NormalBayesType::Pointer classifier = NormalBayesType::New();
     classifier->SetInputListSample(trainingListSample);
     classifier->SetTargetListSample(trainingLabeledListSample);
     classifier->Train();
-    classifier->Save(GetParameterString("io.out"));
+    return classifier.GetPointer();
   }
 #endif
 } //end namespace wrapper
@@ -110,7 +110,7 @@ void TrainImagesClassifierNew::InitRandomForestsParams()
   //TerminationCriteria not exposed
 }
 
-void TrainImagesClassifierNew::TrainRandomForests(ListSampleType::Pointer trainingListSample,
+TrainImagesClassifierNew::ModelPointerType TrainImagesClassifierNew::TrainRandomForests(ListSampleType::Pointer trainingListSample,
                                                               LabelListSampleType::Pointer trainingLabeledListSample)
 {
   RandomForestType::Pointer classifier = RandomForestType::New();
@@ -125,7 +125,7 @@ void TrainImagesClassifierNew::TrainRandomForests(ListSampleType::Pointer traini
   classifier->SetForestAccuracy(GetParameterFloat("classifier.rf.acc"));
 
   classifier->Train();
-  classifier->Save(GetParameterString("io.out"));
+  return classifier.GetPointer();
 }
 #endif
 } //end namespace wrapper
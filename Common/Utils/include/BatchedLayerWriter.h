@@ -0,0 +1,87 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+
+#ifndef BATCHEDLAYERWRITER_H
+#define BATCHEDLAYERWRITER_H
+
+#include "otbOGRLayerWrapper.h"
+#include "otbOGRFeatureWrapper.h"
+
+#include <cstddef>
+
+/** Copies features to an OGR layer having the same fields, committing a
+ * transaction every batchSize features.
+ *
+ * A single output feature is reused for all the copies. The drivers which
+ * do not support transactions, like the shapefile one, write directly.
+ */
+class BatchedLayerWriter
+{
+public:
+    BatchedLayerWriter(otb::ogr::Layer layer, size_t batchSize = 10000)
+        : m_Layer(layer),
+          m_Feature(layer.GetLayerDefn()),
+          m_BatchSize(batchSize),
+          m_Pending(0),
+          m_Count(0)
+    {
+        m_Layer.ogr().StartTransaction();
+    }
+
+    ~BatchedLayerWriter()
+    {
+        Commit();
+    }
+
+    void Write(const otb::ogr::Feature &feature)
+    {
+        m_Feature.SetFrom(feature);
+        m_Feature.ogr().SetFID(OGRNullFID);
+        m_Layer.CreateFeature(m_Feature);
+
+        m_Count++;
+        if (++m_Pending == m_BatchSize) {
+            m_Layer.ogr().CommitTransaction();
+            m_Layer.ogr().StartTransaction();
+            m_Pending = 0;
+        }
+    }
+
+    /** Commits the pending features. No feature can be written afterwards. */
+    void Commit()
+    {
+        if (m_BatchSize) {
+            m_Layer.ogr().CommitTransaction();
+            m_BatchSize = 0;
+        }
+    }
+
+    size_t GetCount() const
+    {
+        return m_Count;
+    }
+
+private:
+    BatchedLayerWriter(const BatchedLayerWriter &);
+    void operator=(const BatchedLayerWriter &);
+
+    otb::ogr::Layer     m_Layer;
+    otb::ogr::Feature   m_Feature;
+    size_t              m_BatchSize;
+    size_t              m_Pending;
+    size_t              m_Count;
+};
+
+#endif // BATCHEDLAYERWRITER_H
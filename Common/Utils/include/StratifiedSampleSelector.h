@@ -0,0 +1,100 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+
+#ifndef STRATIFIEDSAMPLESELECTOR_H
+#define STRATIFIEDSAMPLESELECTOR_H
+
+#include <random>
+#include <unordered_map>
+#include <cstddef>
+
+/** Draws a fixed number of items from each class of a stream, without replacement.
+ *
+ * The number of items of each class is counted beforehand and given with
+ * SetQuota. The items are then offered in any order with Select, which
+ * keeps the next item of a class with a probability equal to the number of
+ * items still to select divided by the number of items still to come in the
+ * class. Exactly the quota of each class is selected and every subset of
+ * that size is equally likely, as with a reservoir, but nothing has to be
+ * kept in memory.
+ */
+template <typename TKey>
+class StratifiedSampleSelector
+{
+public:
+    explicit StratifiedSampleSelector(std::mt19937::result_type seed) : m_Generator(seed)
+    {
+    }
+
+    /** Sets the number of items of a class and how many of them to select */
+    void SetQuota(const TKey &key, size_t population, size_t quota)
+    {
+        Stratum &stratum = m_Strata[key];
+        stratum.Remaining = population;
+        stratum.Quota = quota < population ? quota : population;
+        stratum.Selected = 0;
+    }
+
+    /** Decides if the next item of a class is selected. The items of the
+     * classes without a quota are never selected. */
+    bool Select(const TKey &key)
+    {
+        typename StrataMap::iterator it = m_Strata.find(key);
+        if (it == m_Strata.end()) {
+            return false;
+        }
+        Stratum &stratum = it->second;
+        if (stratum.Remaining == 0) {
+            return false;
+        }
+
+        const size_t left = stratum.Quota - stratum.Selected;
+        bool selected;
+        if (left == 0) {
+            selected = false;
+        } else if (left == stratum.Remaining) {
+            selected = true;
+        } else {
+            std::uniform_int_distribution<size_t> draw(0, stratum.Remaining - 1);
+            selected = draw(m_Generator) < left;
+        }
+
+        stratum.Remaining--;
+        if (selected) {
+            stratum.Selected++;
+        }
+        return selected;
+    }
+
+    size_t GetQuota(const TKey &key) const
+    {
+        typename StrataMap::const_iterator it = m_Strata.find(key);
+        return it == m_Strata.end() ? 0 : it->second.Quota;
+    }
+
+private:
+    struct Stratum
+    {
+        size_t Remaining;
+        size_t Quota;
+        size_t Selected;
+    };
+    typedef std::unordered_map<TKey, Stratum> StrataMap;
+
+    StrataMap       m_Strata;
+    std::mt19937    m_Generator;
+};
+
+#endif // STRATIFIEDSAMPLESELECTOR_H
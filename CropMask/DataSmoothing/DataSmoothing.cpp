@@ -49,14 +49,11 @@
 #include "otbWrapperApplication.h"
 #include "otbWrapperApplicationFactory.h"
 #include "otbConcatenateVectorImageFilter.h"
-#include "itkBinaryFunctorImageFilter.h"
 
 #include "DataSmoothing.hxx"
 
 typedef otb::ImageFileReader<ImageType> ReaderType;
-typedef DataSmoothingFunctor<ImageType::PixelType, MaskImageType::PixelType> DataSmoothingFunctorType;
-typedef itk::BinaryFunctorImageFilter<ImageType, MaskImageType, ImageType, DataSmoothingFunctorType>
-DataSmoothingFilterType;
+typedef DataSmoothingFilter DataSmoothingFilterType;
 typedef otb::ConcatenateVectorImageFilter<ImageType, ImageType, ImageType>
 ConcatenateVectorImageFilterType;
 //  Software Guide : EndCodeSnippet
@@ -292,12 +289,13 @@ private:
 
         int bands = m_tsReader->GetOutput()->GetNumberOfComponentsPerPixel() / images.size();
 
-        // connect the functor based filter
-        m_smoothFilter->SetFunctor(DataSmoothingFunctorType(bands, lambda, outputDates, images));
+        // connect the smoothing filter
+        m_smoothFilter->SetBands(bands);
+        m_smoothFilter->SetLambda(lambda);
+        m_smoothFilter->SetOutputDates(outputDates);
+        m_smoothFilter->SetInputImages(images);
         m_smoothFilter->SetInput1(m_tsReader->GetOutput());
         m_smoothFilter->SetInput2(GetParameterInt16VectorImage("mask"));
-        m_smoothFilter->UpdateOutputInformation();
-        m_smoothFilter->GetOutput()->SetNumberOfComponentsPerPixel(outputDates.size() * bands);
         SetParameterOutputImage("sts", m_smoothFilter->GetOutput());
     }
     //  Software Guide :EndCodeSnippet
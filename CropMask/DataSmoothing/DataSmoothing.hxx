@@ -17,6 +17,15 @@
 #define TEMPORALRESAMPLING_HXX
 
 #include "otbVectorImage.h"
+#include "itkImageToImageFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkProgressReporter.h"
+#include "WhittakerSmoothing.h"
+
+#include <algorithm>
+#include <functional>
+#include <vector>
 
 typedef float PixelValueType;
 typedef otb::VectorImage<PixelValueType, 2> ImageType;
@@ -37,133 +46,216 @@ struct ImageInfo
     }
 };
 
-void whit1(double lambda,
-           const itk::VariableLengthVector<PixelValueType> &values,
-           const itk::VariableLengthVector<double> &weights,
-           itk::VariableLengthVector<PixelValueType> &result)
+// the number of pixels smoothed together
+#define DATA_SMOOTHING_BATCH_SIZE 256
+
+/** Smooths the time series with the Whittaker smoother. The series are resampled
+* daily, from the first to the last input date, the masked dates having no weight.
+* The pixels of a batch having the same valid days share the factorisation of their
+* system, and their bands are solved together. */
+class ITK_EXPORT DataSmoothingFilter : public itk::ImageToImageFilter<ImageType, ImageType>
 {
-    int numImages = values.Size();
-    // Create two temporary vectors c and d and the temporary result z.
-    std::vector<double> c(numImages);
-    std::vector<double> d(numImages);
-    std::vector<double> z(numImages);
-
-    const double eps = 0.0001;
-
-    // Perform the Whitaker smoothing.
-    // The code is inspired from the R language package "ptw"
-    int m = numImages - 1;
-    d[0] = weights[0] + lambda;
-    c[0] = fabs(d[0]) > eps ? -lambda / d[0] : 0.0;
-    z[0] = weights[0] * static_cast<double>(values[0]);
-
-    for (int i = 1; i < m; i++) {
-        d[i] = weights[i] + 2 * lambda - c[i - 1] * c[i - 1] * d[i - 1];
-        c[i] = fabs(d[i]) > eps ? -lambda / d[i] : 0.0;
-        z[i] = weights[i] * static_cast<double>(values[i]) - c[i - 1] * z[i - 1];
+public:
+    typedef DataSmoothingFilter Self;
+    typedef itk::ImageToImageFilter<ImageType, ImageType> Superclass;
+    typedef itk::SmartPointer<Self> Pointer;
+    typedef itk::SmartPointer<const Self> ConstPointer;
+
+    typedef ImageType::RegionType OutputImageRegionType;
+
+    /** Method for creation through the object factory. */
+    itkNewMacro(Self)
+
+    /** Macro defining the type*/
+    itkTypeMacro(DataSmoothingFilter, ImageToImageFilter)
+
+    /** Accessors for the number of bands of each image and for the smoothing parameter */
+    itkSetMacro(Bands, int)
+    itkGetConstMacro(Bands, int)
+    itkSetMacro(Lambda, double)
+    itkGetConstMacro(Lambda, double)
+
+    void SetOutputDates(std::vector<int> outputDates)
+    {
+        m_OutputDates = std::move(outputDates);
+        this->Modified();
     }
-    d[m] = weights[m] + lambda - c[m - 1] * c[m - 1] * d[m - 1];
-    z[m] = fabs(d[m]) > eps ? (weights[m] * static_cast<double>(values[m]) - c[m - 1] * z[m - 1]) / d[m] : 0.0;
 
-    result[m] = static_cast<PixelValueType>(z[m]);
-    for (int i = m - 1; 0 <= i; i--) {
-        z[i] = (fabs(d[i]) > eps ? z[i] / d[i] : 0.0) - c[i] * z[i + 1];
-        result[i] = static_cast<PixelValueType>(z[i]);
+    /** The input images, sorted by day and priority */
+    void SetInputImages(std::vector<ImageInfo> inputImages)
+    {
+        m_InputImages = std::move(inputImages);
+        this->Modified();
     }
-}
 
-template <typename PixelType, typename MaskPixelType>
-class DataSmoothingFunctor
-{
-public:
-    DataSmoothingFunctor() : bands(1), lambda(1), outputDates()
+    void SetInput1(const ImageType *image)
     {
+        this->SetNthInput(0, const_cast<ImageType *>(image));
     }
-    DataSmoothingFunctor(int bands,
-                         double lambda,
-                         std::vector<int> outputDates,
-                         std::vector<ImageInfo> inputImages)
-        : bands(bands),
-          lambda(lambda),
-          outputDates(std::move(outputDates)),
-          inputImages(std::move(inputImages))
+
+    void SetInput2(const MaskImageType *mask)
     {
+        this->SetNthInput(1, const_cast<MaskImageType *>(mask));
     }
 
-    PixelType operator()(const PixelType &pix, const MaskPixelType &mask) const
+protected:
+    DataSmoothingFilter() : m_Bands(1), m_Lambda(1)
     {
-        // compute the size of the input pixel
-        int pixSize = pix.Size();
+        this->SetNumberOfRequiredInputs(2);
+    }
 
-        // Create the output pixel
-        PixelType result(outputDates.size() * bands);
+    virtual ~DataSmoothingFilter()
+    {
+    }
 
-        // If the input pixel is nodata return nodata
-        PixelType nodata(pixSize);
-        nodata.Fill(static_cast<PixelValueType>(-10000));
+    void GenerateOutputInformation()
+    {
+        Superclass::GenerateOutputInformation();
+        this->GetOutput()->SetNumberOfComponentsPerPixel(m_OutputDates.size() * m_Bands);
+    }
 
-        if (pix == nodata) {
-            result.Fill(static_cast<PixelValueType>(-10000));
-            return result;
+    void BeforeThreadedGenerateData()
+    {
+        if (m_InputImages.empty()) {
+            itkExceptionMacro("No input image to smooth");
         }
+    }
+
+    void ThreadedGenerateData(const OutputImageRegionType &outputRegionForThread, itk::ThreadIdType threadId)
+    {
+        const ImageType *input = this->GetInput();
+        const MaskImageType *mask = static_cast<const MaskImageType *>(itk::ProcessObject::GetInput(1));
+        ImageType *output = this->GetOutput();
+
+        itk::ImageRegionConstIterator<ImageType> inputIt(input, outputRegionForThread);
+        itk::ImageRegionConstIterator<MaskImageType> maskIt(mask, outputRegionForThread);
+        itk::ImageRegionIterator<ImageType> outputIt(output, outputRegionForThread);
+        itk::ProgressReporter progress(this, threadId, outputRegionForThread.GetNumberOfPixels());
+
+        const int pixSize = input->GetNumberOfComponentsPerPixel();
+        const int outSize = output->GetNumberOfComponentsPerPixel();
+        const int firstDay = m_InputImages.front().day;
+        const int tempSize = m_InputImages.back().day - firstDay + 1;
+
+        // the work buffers of the thread, reused for all the batches
+        WhittakerFactorizationCache factorizations;
+        std::vector<PixelValueType> values(DATA_SMOOTHING_BATCH_SIZE * pixSize);
+        std::vector<int> indices(DATA_SMOOTHING_BATCH_SIZE * tempSize);
+        std::vector<const WhittakerFactorization *> pixelFactorizations(DATA_SMOOTHING_BATCH_SIZE);
+        std::vector<int> order(DATA_SMOOTHING_BATCH_SIZE);
+        std::vector<PixelValueType> results(DATA_SMOOTHING_BATCH_SIZE * outSize);
+        std::vector<double> weights(tempSize);
+        std::vector<double> z;
 
-        int firstDay = inputImages.front().day;
-        int tempSize = inputImages.back().day - firstDay + 1;
-        itk::VariableLengthVector<int> indices(tempSize);
-        itk::VariableLengthVector<double> weights(tempSize);
-        itk::VariableLengthVector<PixelValueType> values(tempSize);
-
-        indices.Fill(-1);
-        for (const auto &img : inputImages) {
-            int pos = img.day - firstDay;
-            if (indices[pos] == -1 && !mask[img.index]) {
-                indices[pos] = img.index;
+        inputIt.GoToBegin();
+        maskIt.GoToBegin();
+        outputIt.GoToBegin();
+        while (!inputIt.IsAtEnd()) {
+            // the pointers to the factorisations must stay valid during the batch
+            factorizations.Trim();
+
+            int count = 0;
+            for (; count < DATA_SMOOTHING_BATCH_SIZE && !inputIt.IsAtEnd(); ++count, ++inputIt, ++maskIt) {
+                const ImageType::PixelType &pix = inputIt.Get();
+                const MaskImageType::PixelType &maskPix = maskIt.Get();
+
+                // If the input pixel is nodata return nodata
+                PixelValueType *pixValues = &values[count * pixSize];
+                bool isNoData = true;
+                for (int i = 0; i < pixSize; i++) {
+                    pixValues[i] = pix[i];
+                    isNoData = isNoData && pixValues[i] == static_cast<PixelValueType>(-10000);
+                }
+                if (isNoData) {
+                    pixelFactorizations[count] = nullptr;
+                    continue;
+                }
+
+                int *pixIndices = &indices[count * tempSize];
+                std::fill(pixIndices, pixIndices + tempSize, -1);
+                for (const auto &img : m_InputImages) {
+                    int pos = img.day - firstDay;
+                    if (pixIndices[pos] == -1 && !maskPix[img.index]) {
+                        pixIndices[pos] = img.index;
+                    }
+                }
+
+                for (int i = 0; i < tempSize; i++) {
+                    weights[i] = pixIndices[i] != -1 ? 1.0 : 0.0;
+                }
+                pixelFactorizations[count] = &factorizations.Get(m_Lambda, &weights[0], tempSize);
             }
-        }
 
-        for (int i = 0; i < tempSize; i++) {
-            if (indices[i] != -1) {
-                weights[i] = 1.0;
-            } else {
-                weights[i] = 0.0;
+            // group the pixels sharing a factorisation
+            for (int p = 0; p < count; p++) {
+                order[p] = p;
             }
-        }
+            std::sort(order.begin(), order.begin() + count, [&](int p1, int p2) {
+                return std::less<const WhittakerFactorization *>()(pixelFactorizations[p1], pixelFactorizations[p2]);
+            });
 
-        itk::VariableLengthVector<PixelValueType> res(tempSize);
-        for (int band = 0; band < bands; band++) {
-            for (int i = 0; i < tempSize; i++) {
-                if (indices[i] != -1) {
-                    values[i] = pix[indices[i] * bands + band];
-                } else {
-                    values[i] = 0;
+            for (int groupStart = 0; groupStart < count;) {
+                const WhittakerFactorization *factorization = pixelFactorizations[order[groupStart]];
+                int groupEnd = groupStart + 1;
+                while (groupEnd < count && pixelFactorizations[order[groupEnd]] == factorization) {
+                    groupEnd++;
                 }
+
+                if (!factorization) {
+                    for (int g = groupStart; g < groupEnd; g++) {
+                        PixelValueType *result = &results[order[g] * outSize];
+                        std::fill(result, result + outSize, static_cast<PixelValueType>(-10000));
+                    }
+                    groupStart = groupEnd;
+                    continue;
+                }
+
+                // the series of all the bands of the group, interleaved, weighted by 0 on the masked days
+                const int numSeries = (groupEnd - groupStart) * m_Bands;
+                z.resize(tempSize * numSeries);
+                for (int i = 0; i < tempSize; i++) {
+                    double *row = &z[i * numSeries];
+                    for (int g = groupStart; g < groupEnd; g++) {
+                        const int p = order[g];
+                        const int index = indices[p * tempSize + i];
+                        for (int band = 0; band < m_Bands; band++) {
+                            *row++ = index != -1 ? static_cast<double>(values[p * pixSize + index * m_Bands + band]) : 0.0;
+                        }
+                    }
+                }
+
+                whitSolve(*factorization, tempSize, &z[0], numSeries);
+
+                for (int g = groupStart; g < groupEnd; g++) {
+                    PixelValueType *result = &results[order[g] * outSize];
+                    const int series = (g - groupStart) * m_Bands;
+                    auto pos = 0;
+                    for (auto date : m_OutputDates) {
+                        const double *row = &z[(date - firstDay) * numSeries + series];
+                        for (int band = 0; band < m_Bands; band++) {
+                            result[pos * m_Bands + band] = static_cast<PixelValueType>(row[band]);
+                        }
+                        pos++;
+                    }
+                }
+                groupStart = groupEnd;
             }
-            whit1(lambda, values, weights, res);
-            auto pos = 0;
-            for (auto date : outputDates) {
-                result[pos++ * bands + band] = res[date - firstDay];
+
+            for (int p = 0; p < count; p++, ++outputIt) {
+                outputIt.Set(ImageType::PixelType(&results[p * outSize], outSize));
+                progress.CompletedPixel();
             }
         }
-
-        return result;
     }
 
-    bool operator!=(const DataSmoothingFunctor a) const
-    {
-        return (this->outputDates != a.outputDates || this->bands != a.bands ||
-                this->lambda != a.lambda);
-    }
-
-    bool operator==(const DataSmoothingFunctor a) const
-    {
-        return !(*this != a);
-    }
+private:
+    DataSmoothingFilter(const Self &); // purposely not implemented
+    void operator=(const Self &);      // purposely not implemented
 
-protected:
-    int bands;
-    double lambda;
-    std::vector<int> outputDates;
-    std::vector<ImageInfo> inputImages;
+    int m_Bands;
+    double m_Lambda;
+    std::vector<int> m_OutputDates;
+    std::vector<ImageInfo> m_InputImages;
 };
 
 #endif // TEMPORALRESAMPLING_HXX
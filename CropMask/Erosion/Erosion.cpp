@@ -50,10 +50,7 @@
 
 #include "itkBinaryBallStructuringElement.h"
 
-#include "itkBinaryErodeImageFilter.h"
-#include "otbBandMathImageFilter.h"
-
-#include <unordered_set>
+#include "itkRunLengthLabelErodeImageFilter.h"
 
 typedef short                                PixelValueType;
 typedef otb::Image<PixelValueType, 2>        InternalImageType;
@@ -62,11 +59,7 @@ typedef otb::ImageFileReader<InternalImageType>
 typedef itk::BinaryBallStructuringElement<PixelValueType, 2>                        BallStructuringType;
 typedef BallStructuringType::RadiusType                                             RadiusType;
 
-typedef InternalImageType::SizeType          ReferenceSizeType;
-typedef InternalImageType::SizeValueType     ReferenceSizeValueType;
-
-typedef itk::BinaryErodeImageFilter<InternalImageType, InternalImageType, BallStructuringType>   BinaryErodeImageFilterType;
-typedef otb::ObjectList<BinaryErodeImageFilterType>                    BinaryErodeImageFilterListType;
+typedef itk::RunLengthLabelErodeImageFilter<InternalImageType, InternalImageType, BallStructuringType>   LabelErodeImageFilterType;
 
 
 //  Software Guide : EndCodeSnippet
@@ -206,7 +199,7 @@ private:
   {
 
       m_inReader = ReaderType::New();
-      m_erodeFilterList = BinaryErodeImageFilterListType::New();
+      m_erodeFilter = LabelErodeImageFilterType::New();
 
   }
   //  Software Guide : EndCodeSnippet
@@ -224,10 +217,6 @@ private:
 
       //Read the input file
       m_inReader->SetFileName(GetParameterString("in"));
-      m_inReader->Update();
-
-      InternalImageType::Pointer refImg = m_inReader->GetOutput();
-      ReferenceSizeType imgSize = refImg->GetLargestPossibleRegion().GetSize();
 
       // build ball structure
       RadiusType rad;
@@ -237,55 +226,19 @@ private:
       se.SetRadius(rad);
       se.CreateStructuringElement();
 
-      // define the class set
-      std::unordered_set<PixelValueType> classes;
-
-      for (ReferenceSizeValueType i = 0; i < imgSize[0]; i++) {
-          for (ReferenceSizeValueType j = 0; j < imgSize[1]; j++) {
-              InternalImageType::IndexType index;
-              index[0] = i;
-              index[1] = j;
-
-              InternalImageType::PixelType pix = refImg->GetPixel(index);
-              classes.insert(pix);
-          }
-      }
-
-      BinaryErodeImageFilterType::Pointer prevErodeFilter;
-
-      // erode each class
-      for (PixelValueType pix : classes) {
-          BinaryErodeImageFilterType::Pointer currentErodeFilter = BinaryErodeImageFilterType::New();
-
-          if (prevErodeFilter.IsNull()) {
-              currentErodeFilter->SetInput(m_inReader->GetOutput());
-          } else {
-              currentErodeFilter->SetInput(prevErodeFilter->GetOutput());
-          }
-
-          // set the kernel and foreground and background values
-          currentErodeFilter->SetKernel(se);
-          currentErodeFilter->SetErodeValue(pix);
-          currentErodeFilter->SetBackgroundValue(0);
-
-          // add to list
-          m_erodeFilterList->PushBack(currentErodeFilter);
+      // erode all the classes at once, the pixels which are not eroded keep their class
+      m_erodeFilter->SetInput(m_inReader->GetOutput());
+      m_erodeFilter->SetKernel(se);
+      m_erodeFilter->SetBackgroundValue(0);
 
-          // update the previous erode filter
-          prevErodeFilter = currentErodeFilter;
-      }
       // set the output
-      if (prevErodeFilter.IsNotNull()) {
-          SetParameterOutputImage("out", prevErodeFilter->GetOutput());
-      } else {
-          SetParameterOutputImage("out", m_inReader->GetOutput());
-      }
+      SetParameterOutputImage("out", m_erodeFilter->GetOutput());
 
   }
   //  Software Guide :EndCodeSnippet
 
   ReaderType::Pointer                               m_inReader;
-  BinaryErodeImageFilterListType::Pointer           m_erodeFilterList;
+  LabelErodeImageFilterType::Pointer                m_erodeFilter;
 };
 }
 }
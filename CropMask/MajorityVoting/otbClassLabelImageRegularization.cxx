@@ -39,6 +39,8 @@
 #include <itkLabelImageToLabelMapFilter.h>
 #include <itkLabelMapToAttributeImageFilter.h>
 #include "otbLabelMapWithMajorityClassLabelFilter.h"
+#include "otbStreamingMajorityVotingFilter.h"
+#include "itkUnaryFunctorImageFilter.h"
 
 namespace otb
 {
@@ -69,6 +71,10 @@ public:
   typedef itk::LabelImageToLabelMapFilter<Int32ImageType /*ImageType*/ , LabelMapType > 		ConverterType;
   typedef itk::LabelMapToAttributeImageFilter< LabelMapType, Int32ImageType /*ImageType*/ > 		AttributeToImageType;
 
+  typedef otb::StreamingMajorityVotingFilter<Int32ImageType, Int32ImageType>                  MajorityVotingFilterType;
+  typedef otb::Functor::SegmentClassLabel<Int32ImageType::PixelType, Int32ImageType::PixelType> SegmentClassLabelFunctorType;
+  typedef itk::UnaryFunctorImageFilter<Int32ImageType, Int32ImageType, SegmentClassLabelFunctorType> SegmentClassLabelFilterType;
+
 private:
   void DoInit()
   {
@@ -79,7 +85,7 @@ private:
     //SetDocName("Class label image regularization ");
     SetDocLongDescription("This application performs classification (input 1) regularization using a prior segmentation (input 2)"
 			  "For each segment, the most frequent class label is obtained and set to the new classification label image (output)");
-    SetDocLimitations("Streaming is not available");
+    SetDocLimitations("Streaming is not available with the labelmap option");
     SetDocAuthors("OTB-Team");
     SetDocSeeAlso(" ");
 
@@ -115,6 +121,10 @@ private:
     SetMinimumParameterIntValue("minarea", 0);
     MandatoryOff("minarea");
 
+    AddParameter(ParameterType_Bool, "labelmap", "Build the label map of the whole segmentation");
+    SetParameterDescription("labelmap", "Vote with a label map of the whole segmentation, kept in memory, instead of streaming the segmentation and the classification by tiles.");
+    MandatoryOff("labelmap");
+
     // Doc example parameter settings
     SetDocExampleParameterValue("inclass", "classImage.tif");
     SetDocExampleParameterValue("inseg", "classSeg.tif");
@@ -134,33 +144,54 @@ private:
     Int32ImageType* inputC = GetParameterInt32Image("inclass");
     Int32ImageType* inputS = GetParameterInt32Image("inseg");
 
-    //Instanciations
-    m_Image2LabelMap = ConverterType::New();
-    m_Attribute2Image = AttributeToImageType::New();
-    m_ClassRegularization = ClassRegularizationFilterType::New();
-
-    //Settings
-    m_ClassRegularization->SetNoDataSegValue(GetParameterInt("nodatasegvalue"));
-    m_ClassRegularization->SetNoDataClassifValue(GetParameterInt("nodataclassifvalue"));
-    m_ClassRegularization->SetMinArea(GetParameterInt("minarea"));
-
-    //Pipeline
-    m_Image2LabelMap->SetInput(inputS);
-    m_Image2LabelMap->SetBackgroundValue(0);
-    m_ClassRegularization->SetInput(m_Image2LabelMap->GetOutput());
-    m_ClassRegularization->SetClassifImage(inputC);
-    m_Attribute2Image->SetInput(m_ClassRegularization->GetOutput());
-    m_Attribute2Image->SetBackgroundValue(0);
-    m_Attribute2Image->UpdateOutputInformation();
-    m_Attribute2Image->GetOutput()->CopyInformation(inputC);
-    SetParameterOutputImage("rout", m_Attribute2Image->GetOutput());
-    
+    if (GetParameterInt("labelmap")) {
+        //Instanciations
+        m_Image2LabelMap = ConverterType::New();
+        m_Attribute2Image = AttributeToImageType::New();
+        m_ClassRegularization = ClassRegularizationFilterType::New();
+
+        //Settings
+        m_ClassRegularization->SetNoDataSegValue(GetParameterInt("nodatasegvalue"));
+        m_ClassRegularization->SetNoDataClassifValue(GetParameterInt("nodataclassifvalue"));
+        m_ClassRegularization->SetMinArea(GetParameterInt("minarea"));
+
+        //Pipeline
+        m_Image2LabelMap->SetInput(inputS);
+        m_Image2LabelMap->SetBackgroundValue(0);
+        m_ClassRegularization->SetInput(m_Image2LabelMap->GetOutput());
+        m_ClassRegularization->SetClassifImage(inputC);
+        m_Attribute2Image->SetInput(m_ClassRegularization->GetOutput());
+        m_Attribute2Image->SetBackgroundValue(0);
+        m_Attribute2Image->UpdateOutputInformation();
+        m_Attribute2Image->GetOutput()->CopyInformation(inputC);
+        SetParameterOutputImage("rout", m_Attribute2Image->GetOutput());
+        return;
+    }
+
+    // Vote while the segmentation and the classification are streamed
+    m_MajorityVoting = MajorityVotingFilterType::New();
+    m_MajorityVoting->SetNoDataSegValue(GetParameterInt("nodatasegvalue"));
+    m_MajorityVoting->SetNoDataClassifValue(GetParameterInt("nodataclassifvalue"));
+    m_MajorityVoting->SetMinArea(GetParameterInt("minarea"));
+    m_MajorityVoting->SetInput(inputS);
+    m_MajorityVoting->SetClassifImage(inputC);
+    m_MajorityVoting->Update();
+
+    // Then replace each segment with its class
+    m_SegmentClassLabel = SegmentClassLabelFilterType::New();
+    m_SegmentClassLabel->GetFunctor().SetClassMap(&m_MajorityVoting->GetClassMap());
+    m_SegmentClassLabel->SetInput(inputS);
+    m_SegmentClassLabel->UpdateOutputInformation();
+    m_SegmentClassLabel->GetOutput()->CopyInformation(inputC);
+    SetParameterOutputImage("rout", m_SegmentClassLabel->GetOutput());
    }
 
    //Keep object references as a members of the class, else the pipeline will be broken after exiting DoExecute().
    ConverterType::Pointer m_Image2LabelMap;
    AttributeToImageType::Pointer  m_Attribute2Image;
    ClassRegularizationFilterType::Pointer m_ClassRegularization;
+   MajorityVotingFilterType::Pointer m_MajorityVoting;
+   SegmentClassLabelFilterType::Pointer m_SegmentClassLabel;
 
 
 };
@@ -34,8 +34,7 @@
 #define __otbLabelMapWithMajorityClassLabelFilter_h
  
 #include "itkInPlaceLabelMapFilter.h"
-
-#include <map>
+#include "otbMajorityClassHistogram.h"
 
 namespace otb
 {
@@ -60,7 +59,7 @@ public:
  typedef itk::SmartPointer< const Self > ConstPointer;
 
  typedef TInputImage InputImageType;
- typedef TInputImage InputImageType2;
+ typedef TInputImage2 InputImageType2;
  //typedef TOutputImage OutputImageType;
 
  typedef typename InputImageType::Pointer InputImagePointer;
@@ -116,6 +115,11 @@ void SetClassifImage(const TInputImage2 *input)
   itkSetMacro(MinArea, int);
   /** Get MinArea */
   itkGetConstReferenceMacro(MinArea, int);
+
+  /** Set the number of classes counted in an array, the classes in [0, NumberOfClasses) */
+  itkSetMacro(NumberOfClasses, unsigned int);
+  /** Get NumberOfClasses */
+  itkGetConstReferenceMacro(NumberOfClasses, unsigned int);
  
  protected:
  LabelMapWithMajorityClassLabelFilter();
@@ -129,12 +133,13 @@ void SetClassifImage(const TInputImage2 *input)
  void operator=(const Self &); //purposely not implemented
 
  
- typedef std::map<LabelType,unsigned int>	HistoType;
+ typedef MajorityClassHistogram<InputImagePixelType2>	HistoType;
   
  const TInputImage2 * m_ClassifImage;
  LabelType m_NoDataSegValue;
  InputImagePixelType2 m_NoDataClassifValue;  
  int m_MinArea;
+ unsigned int m_NumberOfClasses;
 
 
 }; // end of class
@@ -37,6 +37,7 @@ LabelMapWithMajorityClassLabelFilter < TInputImage, TInputImage2 >::LabelMapWith
 	m_NoDataSegValue=static_cast<LabelType>(0);
   	m_NoDataClassifValue=static_cast<InputImagePixelType2>(0);
     m_MinArea = 20;
+    m_NumberOfClasses = 16;
 
 	/*m_ClassifImage = GetClassifImage();
 
@@ -52,9 +53,9 @@ void LabelMapWithMajorityClassLabelFilter < TInputImage, TInputImage2 >::Threade
 	if (label != m_NoDataSegValue)
 	{
 
-		HistoType histo;
-        typename LabelObjectType::LineType::LengthType labelSize = 0;
-		for(int j=0; j<labelObject->GetNumberOfLines(); j++)
+		HistoType histo(m_NumberOfClasses);
+		const InputImagePixelType2 * buffer = m_ClassifImage->GetBufferPointer();
+		for(typename LabelObjectType::SizeValueType j=0; j<labelObject->GetNumberOfLines(); j++)
 		{
 
 			const typename LabelObjectType::LineType & line = labelObject->GetLine(j);
@@ -62,41 +63,19 @@ void LabelMapWithMajorityClassLabelFilter < TInputImage, TInputImage2 >::Threade
 			const typename LabelObjectType::LineType::IndexType & firstIdx = line.GetIndex(); //lit->GetIndex();
 			const typename LabelObjectType::LineType::LengthType & length = line.GetLength(); //lit->GetLength();
 
-
-		
-			for( typename InputImageType::IndexType idx = firstIdx; idx[0]<firstIdx[0] + length; idx[0]++)
-                if (m_ClassifImage->GetPixel( idx ) != m_NoDataClassifValue ) {
-					histo[m_ClassifImage->GetPixel( idx )]++;
-                    labelSize++;
+			// the pixels of a line follow each other in the buffer
+			const InputImagePixelType2 * pixel = buffer + m_ClassifImage->ComputeOffset( firstIdx );
+			const InputImagePixelType2 * lineEnd = pixel + length;
+			for( ; pixel != lineEnd; ++pixel )
+                if (*pixel != m_NoDataClassifValue ) {
+					histo.Add(*pixel);
                 }
 		
 		}
 
 		//Search for the most frequent classif label
-		bool uniqueLabel = true;
-	    	typename HistoType::key_type greatestLabel = static_cast<typename HistoType::key_type>(0.0);  //LabelType
-	    	typename HistoType::mapped_type greatestLabelFreq = static_cast<typename HistoType::mapped_type>(0.0);  //unsigned int
-		typename HistoType::iterator histoIt = histo.begin();
-		while ( histoIt != histo.end() )
-	  	{
-	    		typename HistoType::key_type classifLabel = histoIt->first;
-	    		typename HistoType::mapped_type Freq = histoIt->second;
-
-            if ( Freq > 0 && Freq >= greatestLabelFreq )
-	      		{
-	       			if ( Freq == greatestLabelFreq )
-                    {
-                        uniqueLabel = false;
-                    }
-                    else
-                    {
-                        greatestLabelFreq = Freq;
-                        greatestLabel = classifLabel;
-                        uniqueLabel = true;
-                    }
-	      		}
-			++histoIt;
-		}
+		typename HistoType::ClassLabelType greatestLabel;
+		const bool uniqueLabel = histo.GetMajorityLabel(greatestLabel);
 	    	if (uniqueLabel)
 	    	{
 	     		 //std::cout << "greatest label is " << greatestLabel << std::endl;
@@ -106,7 +85,7 @@ void LabelMapWithMajorityClassLabelFilter < TInputImage, TInputImage2 >::Threade
 	    	{
 	      		//std::cout << "greatest label is undifined (" << extUndifinedValue << ")" << std::endl;
                 // choose one between 0 and 1
-            labelObject->SetAttribute( labelSize >= m_MinArea ? 1 : 0 );
+            labelObject->SetAttribute( histo.GetTotal() >= static_cast<size_t>(m_MinArea) ? 1 : 0 );
 	   	}
 
 	}
@@ -0,0 +1,113 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+#ifndef __otbMajorityClassHistogram_h
+#define __otbMajorityClassHistogram_h
+
+#include <vector>
+#include <map>
+#include <cstddef>
+
+namespace otb
+{
+
+/** \class MajorityClassHistogram
+ * \brief Histogram of the class labels of a segment.
+ *
+ * The labels in [0, NumberOfClasses) are counted in an array, the other
+ * ones in a map, so the histogram stays exact whatever the labels are.
+ */
+template <class TClassLabel>
+class MajorityClassHistogram
+{
+public:
+  typedef TClassLabel       ClassLabelType;
+  typedef unsigned int      CountType;
+
+  MajorityClassHistogram() : m_Total(0) {}
+
+  explicit MajorityClassHistogram(size_t nbClasses) : m_Dense(nbClasses, 0), m_Total(0) {}
+
+  void Add(ClassLabelType label, CountType count = 1)
+  {
+    Bin(label) += count;
+    m_Total += count;
+  }
+
+  void Merge(const MajorityClassHistogram &other)
+  {
+    for (size_t i = 0; i < other.m_Dense.size(); i++) {
+      if (other.m_Dense[i] > 0) {
+        Bin(static_cast<ClassLabelType>(i)) += other.m_Dense[i];
+      }
+    }
+    for (const auto &bin : other.m_Sparse) {
+      Bin(bin.first) += bin.second;
+    }
+    m_Total += other.m_Total;
+  }
+
+  /** Number of labels counted */
+  size_t GetTotal() const
+  {
+    return m_Total;
+  }
+
+  /** Gets the most frequent label. Returns false if several labels are the
+   * most frequent ones. An empty histogram has the label 0. */
+  bool GetMajorityLabel(ClassLabelType &label) const
+  {
+    label = ClassLabelType();
+    CountType greatestFreq = 0;
+    bool unique = true;
+    for (size_t i = 0; i < m_Dense.size(); i++) {
+      Vote(static_cast<ClassLabelType>(i), m_Dense[i], label, greatestFreq, unique);
+    }
+    for (const auto &bin : m_Sparse) {
+      Vote(bin.first, bin.second, label, greatestFreq, unique);
+    }
+    return unique;
+  }
+
+private:
+  CountType & Bin(ClassLabelType label)
+  {
+    if (label >= ClassLabelType() && static_cast<size_t>(label) < m_Dense.size()) {
+      return m_Dense[static_cast<size_t>(label)];
+    }
+    return m_Sparse[label];
+  }
+
+  static void Vote(ClassLabelType label, CountType freq,
+                   ClassLabelType &greatestLabel, CountType &greatestFreq, bool &unique)
+  {
+    if (freq > 0 && freq >= greatestFreq) {
+      if (freq == greatestFreq) {
+        unique = false;
+      } else {
+        greatestFreq = freq;
+        greatestLabel = label;
+        unique = true;
+      }
+    }
+  }
+
+  std::vector<CountType>                m_Dense;
+  std::map<ClassLabelType, CountType>   m_Sparse;
+  size_t                                m_Total;
+};
+
+} // end namespace otb
+
+#endif
@@ -0,0 +1,262 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+#ifndef __otbStreamingMajorityVotingFilter_h
+#define __otbStreamingMajorityVotingFilter_h
+
+#include "otbPersistentImageFilter.h"
+#include "otbPersistentFilterStreamingDecorator.h"
+#include "itkSimpleDataObjectDecorator.h"
+#include "otbMajorityClassHistogram.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace otb
+{
+
+/** \class PersistentMajorityVotingFilter
+ * \brief Computes the most frequent class of each segment of a
+ * segmentation while the segmentation and the classification are streamed.
+ *
+ * The class histograms of the segments are built for each stream and each
+ * thread, one row run of a segment at a time, and merged by segment label,
+ * so that a segment split by the tiles gets the histogram of all its
+ * pixels. The voting is the one of LabelMapWithMajorityClassLabelFilter:
+ * the segments with no unique most frequent class get the class 1 if they
+ * have at least MinArea classified pixels, 0 otherwise.
+ *
+ * Only the segments voting for a class other than 0 are kept in the
+ * ClassMap output.
+ */
+template< class TSegmentationImage, class TClassImage >
+class ITK_EXPORT PersistentMajorityVotingFilter :
+  public PersistentImageFilter< TSegmentationImage, TSegmentationImage >
+{
+public:
+  /** Standard class typedefs */
+  typedef PersistentMajorityVotingFilter                                   Self;
+  typedef PersistentImageFilter< TSegmentationImage, TSegmentationImage >  Superclass;
+  typedef itk::SmartPointer< Self >                                        Pointer;
+  typedef itk::SmartPointer< const Self >                                  ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Runtime information support. */
+  itkTypeMacro(PersistentMajorityVotingFilter, PersistentImageFilter);
+
+  /** Image related typedefs. */
+  typedef TSegmentationImage                          SegmentationImageType;
+  typedef typename SegmentationImageType::RegionType  RegionType;
+  typedef typename SegmentationImageType::PixelType   SegmentLabelType;
+  typedef TClassImage                                 ClassImageType;
+  typedef typename ClassImageType::PixelType          ClassLabelType;
+
+  typedef MajorityClassHistogram< ClassLabelType >                          HistogramType;
+  typedef std::unordered_map< SegmentLabelType, HistogramType >             HistogramMapType;
+  typedef std::unordered_map< SegmentLabelType, ClassLabelType >            ClassMapType;
+  typedef itk::SimpleDataObjectDecorator< ClassMapType >                    ClassMapObjectType;
+
+  /** Smart Pointer type to a DataObject. */
+  typedef typename itk::DataObject::Pointer                    DataObjectPointer;
+  typedef itk::ProcessObject::DataObjectPointerArraySizeType   DataObjectPointerArraySizeType;
+
+  /** The classification raster */
+  void SetClassifImage(const ClassImageType *classif);
+  const ClassImageType * GetClassifImage() const;
+
+  /** The class of the segments which do not vote for 0 */
+  const ClassMapType & GetClassMap() const
+  {
+    return this->GetClassMapOutput()->Get();
+  }
+  ClassMapObjectType* GetClassMapOutput();
+  const ClassMapObjectType* GetClassMapOutput() const;
+
+  /** The segmentation label which is not voted */
+  itkSetMacro(NoDataSegValue, SegmentLabelType);
+  itkGetConstReferenceMacro(NoDataSegValue, SegmentLabelType);
+
+  /** The classification label which is not counted */
+  itkSetMacro(NoDataClassifValue, ClassLabelType);
+  itkGetConstReferenceMacro(NoDataClassifValue, ClassLabelType);
+
+  /** The number of classified pixels of a segment with no unique majority
+   * class to get the class 1 */
+  itkSetMacro(MinArea, int);
+  itkGetConstReferenceMacro(MinArea, int);
+
+  /** The classes in [0, NumberOfClasses) are counted in an array */
+  itkSetMacro(NumberOfClasses, unsigned int);
+  itkGetConstReferenceMacro(NumberOfClasses, unsigned int);
+
+  /** Make a DataObject of the correct type to be used as the specified
+   * output.
+   */
+  virtual DataObjectPointer MakeOutput(DataObjectPointerArraySizeType idx);
+  using Superclass::MakeOutput;
+
+  virtual void Reset(void);
+
+  virtual void Synthetize(void);
+
+protected:
+  PersistentMajorityVotingFilter();
+  virtual ~PersistentMajorityVotingFilter() {}
+
+  /** The output is not used, nothing is allocated. */
+  virtual void AllocateOutputs();
+
+  virtual void GenerateOutputInformation();
+
+  virtual void BeforeThreadedGenerateData();
+
+  void ThreadedGenerateData(const RegionType& outputRegionForThread, itk::ThreadIdType threadId);
+
+  virtual void AfterThreadedGenerateData();
+
+private:
+  PersistentMajorityVotingFilter(const Self &); //purposely not implemented
+  void operator =(const Self&); //purposely not implemented
+
+  SegmentLabelType    m_NoDataSegValue;
+  ClassLabelType      m_NoDataClassifValue;
+  int                 m_MinArea;
+  unsigned int        m_NumberOfClasses;
+
+  HistogramMapType                 m_Histograms;
+  std::vector<HistogramMapType>    m_ThreadHistograms;
+}; // end of class PersistentMajorityVotingFilter
+
+/**===========================================================================*/
+
+/** \class StreamingMajorityVotingFilter
+ * \brief Streaming version of PersistentMajorityVotingFilter.
+ */
+template< class TSegmentationImage, class TClassImage >
+class ITK_EXPORT StreamingMajorityVotingFilter :
+  public PersistentFilterStreamingDecorator< PersistentMajorityVotingFilter< TSegmentationImage, TClassImage > >
+{
+public:
+  /** Standard class typedefs */
+  typedef StreamingMajorityVotingFilter Self;
+  typedef PersistentFilterStreamingDecorator
+  < PersistentMajorityVotingFilter< TSegmentationImage, TClassImage > > Superclass;
+  typedef itk::SmartPointer< Self >       Pointer;
+  typedef itk::SmartPointer< const Self > ConstPointer;
+
+  /** Type macro */
+  itkNewMacro(Self);
+
+  /** Creation through object factory macro */
+  itkTypeMacro(StreamingMajorityVotingFilter, PersistentFilterStreamingDecorator);
+
+  typedef TSegmentationImage                              SegmentationImageType;
+  typedef TClassImage                                     ClassImageType;
+  typedef typename Superclass::FilterType                 VotingFilterType;
+  typedef typename VotingFilterType::SegmentLabelType     SegmentLabelType;
+  typedef typename VotingFilterType::ClassLabelType       ClassLabelType;
+  typedef typename VotingFilterType::ClassMapType         ClassMapType;
+
+  using Superclass::SetInput;
+  void SetInput(SegmentationImageType * input)
+  {
+    this->GetFilter()->SetInput(input);
+  }
+  const SegmentationImageType * GetInput()
+  {
+    return this->GetFilter()->GetInput();
+  }
+
+  void SetClassifImage(const ClassImageType * classif)
+  {
+    this->GetFilter()->SetClassifImage(classif);
+  }
+  const ClassImageType * GetClassifImage()
+  {
+    return this->GetFilter()->GetClassifImage();
+  }
+
+  const ClassMapType & GetClassMap() const
+  {
+    return this->GetFilter()->GetClassMap();
+  }
+
+  otbSetObjectMemberMacro(Filter, NoDataSegValue, SegmentLabelType);
+  otbGetObjectMemberMacro(Filter, NoDataSegValue, SegmentLabelType);
+
+  otbSetObjectMemberMacro(Filter, NoDataClassifValue, ClassLabelType);
+  otbGetObjectMemberMacro(Filter, NoDataClassifValue, ClassLabelType);
+
+  otbSetObjectMemberMacro(Filter, MinArea, int);
+  otbGetObjectMemberMacro(Filter, MinArea, int);
+
+  otbSetObjectMemberMacro(Filter, NumberOfClasses, unsigned int);
+  otbGetObjectMemberMacro(Filter, NumberOfClasses, unsigned int);
+
+protected:
+  StreamingMajorityVotingFilter() {}
+  virtual ~StreamingMajorityVotingFilter() {}
+
+private:
+  StreamingMajorityVotingFilter(const Self &); //purposely not implemented
+  void operator =(const Self&); //purposely not implemented
+};
+
+namespace Functor
+{
+/** \class SegmentClassLabel
+ * \brief Replaces the label of a segment with its voted class.
+ */
+template< class TSegmentLabel, class TClassLabel >
+class SegmentClassLabel
+{
+public:
+  typedef std::unordered_map< TSegmentLabel, TClassLabel > ClassMapType;
+
+  SegmentClassLabel() : m_ClassMap(NULL) {}
+
+  void SetClassMap(const ClassMapType *classMap)
+  {
+    m_ClassMap = classMap;
+  }
+
+  bool operator!=(const SegmentClassLabel &other) const
+  {
+    return m_ClassMap != other.m_ClassMap;
+  }
+  bool operator==(const SegmentClassLabel &other) const
+  {
+    return !(*this != other);
+  }
+
+  inline TClassLabel operator()(const TSegmentLabel &segment) const
+  {
+    typename ClassMapType::const_iterator it = m_ClassMap->find(segment);
+    return it != m_ClassMap->end() ? it->second : TClassLabel();
+  }
+
+private:
+  const ClassMapType *m_ClassMap;
+};
+} // end namespace Functor
+
+} // end namespace otb
+
+#ifndef OTB_MANUAL_INSTANTIATION
+#include "otbStreamingMajorityVotingFilter.txx"
+#endif
+
+#endif
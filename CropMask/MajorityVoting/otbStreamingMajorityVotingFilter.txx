@@ -0,0 +1,245 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+#ifndef __otbStreamingMajorityVotingFilter_txx
+#define __otbStreamingMajorityVotingFilter_txx
+
+#include "otbStreamingMajorityVotingFilter.h"
+
+#include "itkImageScanlineConstIterator.h"
+
+#include <algorithm>
+
+namespace otb
+{
+
+template< class TSegmentationImage, class TClassImage >
+PersistentMajorityVotingFilter< TSegmentationImage, TClassImage >
+::PersistentMajorityVotingFilter()
+  : m_NoDataSegValue(static_cast<SegmentLabelType>(0)),
+    m_NoDataClassifValue(static_cast<ClassLabelType>(0)),
+    m_MinArea(20),
+    m_NumberOfClasses(16)
+{
+  // allocate the data object for the class map output
+  this->itk::ProcessObject::SetNthOutput(1, this->MakeOutput(1).GetPointer());
+
+  // the segmentation and the classification
+  this->SetNumberOfRequiredInputs(2);
+}
+
+template< class TSegmentationImage, class TClassImage >
+itk::DataObject::Pointer
+PersistentMajorityVotingFilter< TSegmentationImage, TClassImage >
+::MakeOutput(DataObjectPointerArraySizeType output)
+{
+  switch (output)
+    {
+    case 1:
+      return static_cast<itk::DataObject*>(ClassMapObjectType::New().GetPointer());
+      break;
+    default:
+      return static_cast<itk::DataObject*>(TSegmentationImage::New().GetPointer());
+      break;
+    }
+}
+
+template< class TSegmentationImage, class TClassImage >
+void
+PersistentMajorityVotingFilter< TSegmentationImage, TClassImage >
+::SetClassifImage(const ClassImageType *classif)
+{
+  this->itk::ProcessObject::SetNthInput(1, const_cast<ClassImageType *>(classif));
+}
+
+template< class TSegmentationImage, class TClassImage >
+const typename PersistentMajorityVotingFilter< TSegmentationImage, TClassImage >::ClassImageType *
+PersistentMajorityVotingFilter< TSegmentationImage, TClassImage >
+::GetClassifImage() const
+{
+  if (this->GetNumberOfInputs() < 2)
+    {
+    return 0;
+    }
+  return static_cast<const ClassImageType *>(this->itk::ProcessObject::GetInput(1));
+}
+
+template< class TSegmentationImage, class TClassImage >
+typename PersistentMajorityVotingFilter< TSegmentationImage, TClassImage >::ClassMapObjectType *
+PersistentMajorityVotingFilter< TSegmentationImage, TClassImage >
+::GetClassMapOutput()
+{
+  return static_cast<ClassMapObjectType *>(this->itk::ProcessObject::GetOutput(1));
+}
+
+template< class TSegmentationImage, class TClassImage >
+const typename PersistentMajorityVotingFilter< TSegmentationImage, TClassImage >::ClassMapObjectType *
+PersistentMajorityVotingFilter< TSegmentationImage, TClassImage >
+::GetClassMapOutput() const
+{
+  return static_cast<const ClassMapObjectType *>(this->itk::ProcessObject::GetOutput(1));
+}
+
+template< class TSegmentationImage, class TClassImage >
+void
+PersistentMajorityVotingFilter< TSegmentationImage, TClassImage >
+::GenerateOutputInformation()
+{
+  Superclass::GenerateOutputInformation();
+  if (this->GetInput())
+    {
+    this->GetOutput()->CopyInformation(this->GetInput());
+    this->GetOutput()->SetLargestPossibleRegion(this->GetInput()->GetLargestPossibleRegion());
+
+    if (this->GetOutput()->GetRequestedRegion().GetNumberOfPixels() == 0)
+      {
+      this->GetOutput()->SetRequestedRegion(this->GetOutput()->GetLargestPossibleRegion());
+      }
+    }
+}
+
+template< class TSegmentationImage, class TClassImage >
+void
+PersistentMajorityVotingFilter< TSegmentationImage, TClassImage >
+::AllocateOutputs()
+{
+  // The output image of this filter is not intended to be used.
+}
+
+template< class TSegmentationImage, class TClassImage >
+void
+PersistentMajorityVotingFilter< TSegmentationImage, TClassImage >
+::Reset()
+{
+  SegmentationImageType * segmentationPtr = const_cast<SegmentationImageType *>(this->GetInput());
+  segmentationPtr->UpdateOutputInformation();
+
+  ClassImageType * classifPtr = const_cast<ClassImageType *>(this->GetClassifImage());
+  if (!classifPtr)
+    {
+    itkExceptionMacro(<< "No classification image was set");
+    }
+  classifPtr->UpdateOutputInformation();
+  if (classifPtr->GetLargestPossibleRegion() != segmentationPtr->GetLargestPossibleRegion())
+    {
+    itkExceptionMacro(<< "The segmentation and the classification must have the same size");
+    }
+
+  m_Histograms.clear();
+  this->GetClassMapOutput()->Set(ClassMapType());
+}
+
+template< class TSegmentationImage, class TClassImage >
+void
+PersistentMajorityVotingFilter< TSegmentationImage, TClassImage >
+::Synthetize()
+{
+  ClassMapType classMap;
+  for (const auto &segment : m_Histograms)
+    {
+    const HistogramType &histogram = segment.second;
+    ClassLabelType cls;
+    if (!histogram.GetMajorityLabel(cls))
+      {
+      // choose one between 0 and 1
+      cls = static_cast<ClassLabelType>(histogram.GetTotal() >= static_cast<size_t>(std::max(m_MinArea, 0)) ? 1 : 0);
+      }
+    if (cls != ClassLabelType())
+      {
+      classMap[segment.first] = cls;
+      }
+    }
+  m_Histograms.clear();
+
+  itkDebugMacro(<< classMap.size() << " segments voted for a class");
+  this->GetClassMapOutput()->Set(classMap);
+}
+
+template< class TSegmentationImage, class TClassImage >
+void
+PersistentMajorityVotingFilter< TSegmentationImage, TClassImage >
+::BeforeThreadedGenerateData()
+{
+  m_ThreadHistograms.assign(this->GetNumberOfThreads(), HistogramMapType());
+}
+
+template< class TSegmentationImage, class TClassImage >
+void
+PersistentMajorityVotingFilter< TSegmentationImage, TClassImage >
+::ThreadedGenerateData(const RegionType& outputRegionForThread, itk::ThreadIdType threadId)
+{
+  HistogramMapType &histograms = m_ThreadHistograms[threadId];
+
+  itk::ImageScanlineConstIterator<SegmentationImageType> segIt(this->GetInput(), outputRegionForThread);
+  itk::ImageScanlineConstIterator<ClassImageType> classIt(this->GetClassifImage(), outputRegionForThread);
+
+  for (segIt.GoToBegin(), classIt.GoToBegin(); !segIt.IsAtEnd(); segIt.NextLine(), classIt.NextLine())
+    {
+    // the histogram is looked up once for each run of a segment along the line
+    SegmentLabelType currentSegment = m_NoDataSegValue;
+    HistogramType *histogram = NULL;
+    for (; !segIt.IsAtEndOfLine(); ++segIt, ++classIt)
+      {
+      const SegmentLabelType segment = segIt.Get();
+      // 0 is the background of the segmentation
+      if (segment == m_NoDataSegValue || segment == SegmentLabelType())
+        {
+        continue;
+        }
+      if (histogram == NULL || segment != currentSegment)
+        {
+        typename HistogramMapType::iterator it = histograms.find(segment);
+        if (it == histograms.end())
+          {
+          it = histograms.insert(std::make_pair(segment, HistogramType(m_NumberOfClasses))).first;
+          }
+        histogram = &it->second;
+        currentSegment = segment;
+        }
+      const ClassLabelType cls = classIt.Get();
+      if (cls != m_NoDataClassifValue)
+        {
+        histogram->Add(cls);
+        }
+      }
+    }
+}
+
+template< class TSegmentationImage, class TClassImage >
+void
+PersistentMajorityVotingFilter< TSegmentationImage, TClassImage >
+::AfterThreadedGenerateData()
+{
+  // the parts of the segments split by the threads and the streams are stitched by label
+  for (auto &threadHistograms : m_ThreadHistograms)
+    {
+    for (auto &segment : threadHistograms)
+      {
+      typename HistogramMapType::iterator it = m_Histograms.find(segment.first);
+      if (it == m_Histograms.end())
+        {
+        m_Histograms.insert(std::make_pair(segment.first, std::move(segment.second)));
+        }
+      else
+        {
+        it->second.Merge(segment.second);
+        }
+      }
+    threadHistograms.clear();
+    }
+}
+
+} // end namespace otb
+
+#endif
@@ -49,14 +49,207 @@
 #include "otbWrapperApplicationFactory.h"
 
 #include "otbMeanShiftSegmentationFilter.h"
+#include "otbMeanShiftSmoothingImageFilter.h"
+#include "otbLabelImageRegionMergingFilter.h"
+#include "otbLabelImageRegionPruningFilter.h"
 #include "otbVectorImage.h"
+#include "otbMultiChannelExtractROI.h"
+#include "itkMultiThreader.h"
+#include "itkImageSource.h"
+#include "itkImageRegionIterator.h"
+
+#include "SegmentationTileStitcher.h"
+
+#include <unordered_map>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
 
 typedef short                                PixelValueType;
 typedef otb::VectorImage<PixelValueType, 2>  ImageType;
 typedef otb::Image<PixelValueType, 2>  LabelImageType;
+typedef otb::Image<SegmentationTileStitcher::LabelType, 2>  TiledLabelImageType;
 
 typedef otb::ImageFileReader<ImageType>                                          ReaderType;
 typedef otb::MeanShiftSegmentationFilter<ImageType, LabelImageType, ImageType>   MeanShiftFilterType;
+typedef otb::MultiChannelExtractROI<PixelValueType, PixelValueType>              ExtractROIFilterType;
+
+// the stages of MeanShiftSegmentationFilter, run separately on the tiles to set their number of threads
+typedef otb::MeanShiftSmoothingImageFilter<ImageType, ImageType, TiledLabelImageType>                       TileSmoothingFilterType;
+typedef otb::LabelImageRegionMergingFilter<TiledLabelImageType, ImageType, TiledLabelImageType, ImageType>   TileMergingFilterType;
+typedef otb::LabelImageRegionPruningFilter<TiledLabelImageType, ImageType, TiledLabelImageType, ImageType>   TilePruningFilterType;
+
+/** The labels of the tiles, written to a temporary file while the tiles are segmented so that only
+ * their borders are kept in memory. The labels of a tile are stored line by line from its offset. */
+class TileLabelFile
+{
+public:
+  typedef SegmentationTileStitcher::LabelType LabelType;
+
+  TileLabelFile() : m_File(std::tmpfile())
+  {
+    if (!m_File) {
+      throw std::runtime_error("Unable to create the temporary file of the tile labels");
+    }
+  }
+
+  ~TileLabelFile()
+  {
+    std::fclose(m_File);
+  }
+
+  void Write(size_t offset, const LabelType *labels, size_t count)
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (fseeko(m_File, static_cast<off_t>(offset * sizeof(LabelType)), SEEK_SET) != 0 ||
+        std::fwrite(labels, sizeof(LabelType), count, m_File) != count) {
+      throw std::runtime_error("Unable to write the tile labels to the temporary file");
+    }
+  }
+
+  void Read(size_t offset, LabelType *labels, size_t count)
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    if (fseeko(m_File, static_cast<off_t>(offset * sizeof(LabelType)), SEEK_SET) != 0 ||
+        std::fread(labels, sizeof(LabelType), count, m_File) != count) {
+      throw std::runtime_error("Unable to read the tile labels from the temporary file");
+    }
+  }
+
+private:
+  TileLabelFile(const TileLabelFile &); //purposely not implemented
+  void operator =(const TileLabelFile&); //purposely not implemented
+
+  FILE        *m_File;
+  std::mutex  m_Mutex;
+};
+
+/** Builds the label or the clustered image of a tiled segmentation for the regions requested by
+ * the writer, from the labels of the tiles and the final segments of the stitcher. */
+template <class TOutputImage>
+class StitchedSegmentationImageSource : public itk::ImageSource<TOutputImage>
+{
+public:
+  typedef StitchedSegmentationImageSource     Self;
+  typedef itk::ImageSource<TOutputImage>      Superclass;
+  typedef itk::SmartPointer<Self>             Pointer;
+  typedef itk::SmartPointer<const Self>       ConstPointer;
+
+  itkNewMacro(Self)
+  itkTypeMacro(StitchedSegmentationImageSource, itk::ImageSource)
+
+  typedef typename TOutputImage::RegionType   RegionType;
+  typedef SegmentationTileStitcher::LabelType LabelType;
+
+  void SetSegmentation(const ImageType *reference, const SegmentationTileStitcher *stitcher,
+                       TileLabelFile *labelFile, const std::vector<size_t> &tileOffsets)
+  {
+    m_Reference = reference;
+    m_Stitcher = stitcher;
+    m_LabelFile = labelFile;
+    m_TileOffsets = tileOffsets;
+    this->Modified();
+  }
+
+protected:
+  StitchedSegmentationImageSource() : m_Stitcher(NULL), m_LabelFile(NULL), m_ModeLabel(0)
+  {
+  }
+
+  virtual void GenerateOutputInformation()
+  {
+    TOutputImage *output = this->GetOutput();
+    output->CopyInformation(m_Reference);
+    output->SetLargestPossibleRegion(m_Reference->GetLargestPossibleRegion());
+    output->SetNumberOfComponentsPerPixel(NumberOfComponents(output));
+  }
+
+  virtual void GenerateData()
+  {
+    TOutputImage *output = this->GetOutput();
+    const RegionType region = output->GetRequestedRegion();
+    output->SetBufferedRegion(region);
+    output->Allocate();
+
+    const RegionType largest = output->GetLargestPossibleRegion();
+    std::vector<LabelType> labels;
+    for (size_t i = 0; i < m_Stitcher->GetNumberOfTiles(); i++) {
+      const SegmentationTileStitcher::Tile &tile = m_Stitcher->GetTile(i);
+      RegionType part;
+      part.SetIndex(0, largest.GetIndex(0) + tile.X);
+      part.SetIndex(1, largest.GetIndex(1) + tile.Y);
+      part.SetSize(0, tile.Width);
+      part.SetSize(1, tile.Height);
+      if (!part.Crop(region)) {
+        continue;
+      }
+
+      // read the part of each line of the tile inside the region
+      const size_t x = part.GetIndex(0) - largest.GetIndex(0) - tile.X;
+      const size_t width = part.GetSize(0);
+      labels.resize(width);
+      RegionType line = part;
+      line.SetSize(1, 1);
+      for (size_t y = 0; y < part.GetSize(1); y++) {
+        line.SetIndex(1, part.GetIndex(1) + y);
+        const size_t tileY = line.GetIndex(1) - largest.GetIndex(1) - tile.Y;
+        m_LabelFile->Read(m_TileOffsets[i] + tileY * tile.Width + x, &labels[0], width);
+
+        itk::ImageRegionIterator<TOutputImage> it(output, line);
+        for (size_t p = 0; p < width; p++, ++it) {
+          SetPixel(it, tile.Segments[labels[p]]);
+        }
+      }
+    }
+  }
+
+private:
+  StitchedSegmentationImageSource(const Self &); //purposely not implemented
+  void operator =(const Self&); //purposely not implemented
+
+  unsigned int NumberOfComponents(const TiledLabelImageType *) const
+  {
+    return 1;
+  }
+
+  unsigned int NumberOfComponents(const ImageType *) const
+  {
+    return m_Reference->GetNumberOfComponentsPerPixel();
+  }
+
+  void SetPixel(itk::ImageRegionIterator<TiledLabelImageType> &it, LabelType label)
+  {
+    it.Set(label);
+  }
+
+  void SetPixel(itk::ImageRegionIterator<ImageType> &it, LabelType label)
+  {
+    const unsigned int bands = m_Reference->GetNumberOfComponentsPerPixel();
+    if (m_Mode.GetSize() != bands) {
+      m_Mode.SetSize(bands);
+      m_ModeLabel = 0;
+    }
+    if (label != m_ModeLabel) {
+      const double *m = m_Stitcher->GetMode(label);
+      for (unsigned int b = 0; b < bands; b++) {
+        m_Mode[b] = static_cast<PixelValueType>(std::round(m[b]));
+      }
+      m_ModeLabel = label;
+    }
+    it.Set(m_Mode);
+  }
+
+  ImageType::ConstPointer           m_Reference;
+  const SegmentationTileStitcher    *m_Stitcher;
+  TileLabelFile                     *m_LabelFile;
+  std::vector<size_t>               m_TileOffsets;
+  ImageType::PixelType              m_Mode;
+  LabelType                         m_ModeLabel;
+};
 
 
 //  Software Guide : EndCodeSnippet
@@ -142,7 +335,10 @@ private:
       SetDocLongDescription("The feature extraction step produces the relevant features for the classication. The features are computed"
                             "for each date of the resampled and gaplled time series and concatenated together into a single multi-channel"
                             "image file. The selected features are the surface reflectances, the NDVI, the NDWI and the brightness.");
-      SetDocLimitations("None");
+      SetDocLimitations("Without tilesize, the whole image is segmented in memory. With tilesize, the tiles are "
+                        "segmented in memory, several at the same time, their labels are kept in a temporary file and "
+                        "the outputs are written by blocks. The small regions are pruned inside each tile, so the "
+                        "segments near the tile borders may differ from the segmentation of the whole image.");
       SetDocAuthors("LBU");
       SetDocSeeAlso(" ");
     //  Software Guide : EndCodeSnippet
@@ -175,9 +371,20 @@ private:
     AddParameter(ParameterType_OutputImage, "out", "Segmentation result image");
     AddParameter(ParameterType_OutputImage, "outbound", "Segmentation boundaries file");
 
+    AddParameter(ParameterType_Int, "tilesize", "Size of the tiles segmented independently, 0 to segment the whole image at once. "
+                                                "The regions smaller than minsize are pruned inside each tile, its margin included, "
+                                                "so the segments near the tile borders may differ from the segmentation of the whole image.");
+    MandatoryOff("tilesize");
+    AddParameter(ParameterType_Int, "tilemargin", "Margin read around each tile (default 3 times the spatial radius).");
+    MandatoryOff("tilemargin");
+    AddParameter(ParameterType_Int, "tilethreads", "Number of tiles segmented at the same time, 0 for the number of threads.");
+    MandatoryOff("tilethreads");
+
     SetDefaultParameterInt("spatialradius", 10);
     SetDefaultParameterFloat("rangeradius", 0.65);
     SetDefaultParameterInt("minsize", 10);
+    SetDefaultParameterInt("tilesize", 0);
+    SetDefaultParameterInt("tilethreads", 0);
 
      //  Software Guide : EndCodeSnippet
 
@@ -226,6 +433,10 @@ private:
       m_pcaReader->SetFileName(GetParameterString("pca"));
       m_pcaReader->UpdateOutputInformation();
 
+      if (GetParameterInt("tilesize") > 0) {
+          SegmentByTiles(spatialRadius, rangeRadius, minSize);
+          return;
+      }
 
       m_meanShiftFilter->SetInput( m_pcaReader->GetOutput());
 
@@ -239,8 +450,209 @@ private:
   }
   //  Software Guide :EndCodeSnippet
 
+  /** State shared by the threads segmenting the tiles */
+  struct TileThreadStruct
+  {
+    const MeanShiftSegmentation   *App;
+    SegmentationTileStitcher      *Stitcher;
+    TileLabelFile                 *LabelFile;
+    const std::vector<size_t>     *TileOffsets;
+    const ImageType               *Input;
+    int                           SpatialRadius;
+    float                         RangeRadius;
+    int                           MinSize;
+    int                           Margin;
+    itk::ThreadIdType             FilterThreads;
+    std::atomic<size_t>           NextTile;
+    std::atomic<bool>             Failed;
+    std::mutex                    Mutex;
+    std::string                   Error;
+  };
+
+  // The image is split into tiles which are segmented independently, several at the same time,
+  // each one with a margin around it so that the mean-shift of the pixels near its border
+  // sees the same neighbourhood as in the whole image. The segments touching across the borders
+  // of the tiles are then merged when their modes are closer than the range radius.
+  // Only the borders of the tiles are kept in memory, their labels are written to a temporary
+  // file from which the outputs are built block by block.
+  void SegmentByTiles(int spatialRadius, float rangeRadius, int minSize)
+  {
+      const ImageType *input = m_pcaReader->GetOutput();
+      const ImageType::RegionType largest = input->GetLargestPossibleRegion();
+      const unsigned int bands = input->GetNumberOfComponentsPerPixel();
+      const size_t tileSize = GetParameterInt("tilesize");
+
+      m_stitcher.reset(new SegmentationTileStitcher(largest.GetSize(0), largest.GetSize(1), tileSize, tileSize, bands));
+      SegmentationTileStitcher &stitcher = *m_stitcher;
+
+      m_labelFile.reset(new TileLabelFile());
+      m_tileOffsets.resize(stitcher.GetNumberOfTiles());
+      size_t offset = 0;
+      for (size_t i = 0; i < stitcher.GetNumberOfTiles(); i++) {
+          m_tileOffsets[i] = offset;
+          offset += stitcher.GetTile(i).Width * stitcher.GetTile(i).Height;
+      }
+
+      TileThreadStruct str;
+      str.App = this;
+      str.Stitcher = &stitcher;
+      str.LabelFile = m_labelFile.get();
+      str.TileOffsets = &m_tileOffsets;
+      str.Input = input;
+      str.SpatialRadius = spatialRadius;
+      str.RangeRadius = rangeRadius;
+      str.MinSize = minSize;
+      str.Margin = std::max(0, HasValue("tilemargin") ? GetParameterInt("tilemargin") : 3 * spatialRadius);
+      str.NextTile = 0;
+      str.Failed = false;
+
+      // the threads of the machine are shared between the tiles segmented at the same time
+      const itk::ThreadIdType nbThreads = itk::MultiThreader::GetGlobalDefaultNumberOfThreads();
+      itk::ThreadIdType nbTileThreads = GetParameterInt("tilethreads") > 0 ? GetParameterInt("tilethreads") : nbThreads;
+      nbTileThreads = std::max<itk::ThreadIdType>(1, std::min<size_t>(nbTileThreads, stitcher.GetNumberOfTiles()));
+
+      str.FilterThreads = std::max<itk::ThreadIdType>(1, nbThreads / nbTileThreads);
+
+      otbAppLogINFO("Segmenting " << stitcher.GetNumberOfTiles() << " tiles of " << tileSize << " pixels, "
+                    << nbTileThreads << " at a time with " << str.FilterThreads << " threads each");
+
+      itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+      threader->SetNumberOfThreads(nbTileThreads);
+      threader->SetSingleMethod(SegmentTilesCallback, &str);
+      threader->SingleMethodExecute();
+
+      if (str.Failed) {
+          itkExceptionMacro(<< "Segmentation of a tile failed: " << str.Error);
+      }
+
+      stitcher.Stitch(rangeRadius);
+      otbAppLogINFO("Found " << stitcher.GetNumberOfSegments() << " segments");
+
+      // the outputs are built from the tile labels for the blocks requested by the writers
+      m_tiledLabels = StitchedSegmentationImageSource<TiledLabelImageType>::New();
+      m_tiledLabels->SetSegmentation(input, m_stitcher.get(), m_labelFile.get(), m_tileOffsets);
+      m_tiledClustered = StitchedSegmentationImageSource<ImageType>::New();
+      m_tiledClustered->SetSegmentation(input, m_stitcher.get(), m_labelFile.get(), m_tileOffsets);
+
+      SetParameterOutputImage("out", m_tiledClustered->GetOutput());
+      SetParameterOutputImage("outbound", m_tiledLabels->GetOutput());
+  }
+
+  static ITK_THREAD_RETURN_TYPE SegmentTilesCallback(void *arg)
+  {
+      TileThreadStruct *str = (TileThreadStruct*)(((itk::MultiThreader::ThreadInfoStruct *)(arg))->UserData);
+
+      size_t i;
+      while (!str->Failed && (i = str->NextTile++) < str->Stitcher->GetNumberOfTiles()) {
+          try {
+              str->App->SegmentTile(*str, i);
+          } catch (const std::exception &e) {
+              std::lock_guard<std::mutex> lock(str->Mutex);
+              if (!str->Failed) {
+                  str->Error = e.what();
+                  str->Failed = true;
+              }
+          }
+      }
+
+      return ITK_THREAD_RETURN_VALUE;
+  }
+
+  void SegmentTile(TileThreadStruct &str, size_t tileIndex) const
+  {
+      SegmentationTileStitcher::Tile &tile = str.Stitcher->GetTile(tileIndex);
+      const ImageType::RegionType largest = str.Input->GetLargestPossibleRegion();
+      ImageType::RegionType core;
+      core.SetIndex(0, largest.GetIndex(0) + tile.X);
+      core.SetIndex(1, largest.GetIndex(1) + tile.Y);
+      core.SetSize(0, tile.Width);
+      core.SetSize(1, tile.Height);
+      ImageType::RegionType extended = core;
+      extended.PadByRadius(str.Margin);
+      extended.Crop(largest);
+
+      // the reader is shared by the threads, the tiles are read one at a time
+      ImageType::Pointer image;
+      {
+          std::lock_guard<std::mutex> lock(str.Mutex);
+          ExtractROIFilterType::Pointer extract = ExtractROIFilterType::New();
+          extract->SetInput(str.Input);
+          extract->SetExtractionRegion(extended);
+          extract->SetNumberOfThreads(str.FilterThreads);
+          extract->Update();
+          image = extract->GetOutput();
+          image->DisconnectPipeline();
+      }
+
+      // the stages of MeanShiftSegmentationFilter, each one with the threads given to the tile
+      TileSmoothingFilterType::Pointer smoothing = TileSmoothingFilterType::New();
+      smoothing->SetInput(image);
+      smoothing->SetSpatialBandwidth(str.SpatialRadius);
+      smoothing->SetRangeBandwidth(str.RangeRadius);
+      smoothing->SetModeSearch(false);
+      smoothing->SetNumberOfThreads(str.FilterThreads);
+
+      TileMergingFilterType::Pointer merging = TileMergingFilterType::New();
+      merging->SetInputLabelImage(smoothing->GetLabelOutput());
+      merging->SetInputSpectralImage(smoothing->GetRangeOutput());
+      merging->SetRangeBandwidth(str.RangeRadius);
+      merging->SetNumberOfThreads(str.FilterThreads);
+
+      const TiledLabelImageType *labels;
+      const ImageType *clustered;
+      TilePruningFilterType::Pointer pruning;
+      if (str.MinSize > 0) {
+          pruning = TilePruningFilterType::New();
+          pruning->SetInputLabelImage(merging->GetLabelOutput());
+          pruning->SetInputSpectralImage(merging->GetClusteredOutput());
+          pruning->SetMinRegionSize(str.MinSize);
+          pruning->SetNumberOfThreads(str.FilterThreads);
+          pruning->Update();
+          labels = pruning->GetLabelOutput();
+          clustered = pruning->GetClusteredOutput();
+      } else {
+          merging->Update();
+          labels = merging->GetLabelOutput();
+          clustered = merging->GetClusteredOutput();
+      }
+      const unsigned int bands = clustered->GetNumberOfComponentsPerPixel();
+
+      // keep the core of the tile, with its segments numbered from 0
+      ImageType::RegionType coreInTile = core;
+      coreInTile.SetIndex(0, labels->GetLargestPossibleRegion().GetIndex(0) + core.GetIndex(0) - extended.GetIndex(0));
+      coreInTile.SetIndex(1, labels->GetLargestPossibleRegion().GetIndex(1) + core.GetIndex(1) - extended.GetIndex(1));
+
+      std::unordered_map<TiledLabelImageType::PixelType, SegmentationTileStitcher::LabelType> segments;
+      std::vector<SegmentationTileStitcher::LabelType> tileLabels(tile.Width * tile.Height);
+      itk::ImageRegionConstIterator<TiledLabelImageType> labelIt(labels, coreInTile);
+      itk::ImageRegionConstIterator<ImageType> clusteredIt(clustered, coreInTile);
+      size_t p = 0;
+      for (labelIt.GoToBegin(), clusteredIt.GoToBegin(); !labelIt.IsAtEnd(); ++labelIt, ++clusteredIt, ++p) {
+          auto it = segments.find(labelIt.Get());
+          if (it == segments.end()) {
+              it = segments.insert(std::make_pair(labelIt.Get(),
+                                                  static_cast<SegmentationTileStitcher::LabelType>(segments.size()))).first;
+              const ImageType::PixelType &mode = clusteredIt.Get();
+              for (unsigned int b = 0; b < bands; b++) {
+                  tile.Modes.push_back(mode[b]);
+              }
+              tile.Counts.push_back(0);
+          }
+          tileLabels[p] = it->second;
+          tile.Counts[it->second]++;
+      }
+
+      SegmentationTileStitcher::SetBorders(tile, &tileLabels[0]);
+      str.LabelFile->Write((*str.TileOffsets)[tileIndex], &tileLabels[0], tileLabels.size());
+  }
+
   ReaderType::Pointer                     m_pcaReader;
   MeanShiftFilterType::Pointer            m_meanShiftFilter;
+  std::unique_ptr<SegmentationTileStitcher>   m_stitcher;
+  std::unique_ptr<TileLabelFile>              m_labelFile;
+  std::vector<size_t>                         m_tileOffsets;
+  StitchedSegmentationImageSource<TiledLabelImageType>::Pointer m_tiledLabels;
+  StitchedSegmentationImageSource<ImageType>::Pointer           m_tiledClustered;
 };
 }
 }
@@ -0,0 +1,208 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+
+#ifndef SEGMENTATION_TILE_STITCHER_H
+#define SEGMENTATION_TILE_STITCHER_H
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+/** Joins the segmentations of the tiles of an image.
+ *
+ * The image is split into a grid of tiles, segmented independently. Each
+ * tile holds the labels of the pixels of its borders, numbered from 0 in the
+ * tile, and the mode (spectral mean) and the number of pixels of each
+ * segment. Stitch merges the segments of two neighbouring tiles which touch
+ * across the border and whose modes are closer than the range radius, as the
+ * region merging of the mean-shift segmentation does inside a tile. Each
+ * tile then holds the final label, numbered from 1, of each of its segments.
+ * The labels of the inner pixels are not needed and are kept by the caller.
+ */
+class SegmentationTileStitcher
+{
+public:
+  typedef uint32_t LabelType;
+
+  struct Tile
+  {
+    size_t                  X;
+    size_t                  Y;
+    size_t                  Width;
+    size_t                  Height;
+    std::vector<LabelType>  Top;
+    std::vector<LabelType>  Bottom;
+    std::vector<LabelType>  Left;
+    std::vector<LabelType>  Right;
+    std::vector<double>     Modes;
+    std::vector<size_t>     Counts;
+    std::vector<LabelType>  Segments;
+  };
+
+  SegmentationTileStitcher(size_t width, size_t height, size_t tileWidth, size_t tileHeight, unsigned int bands)
+    : m_TilesX((width + tileWidth - 1) / tileWidth),
+      m_TilesY((height + tileHeight - 1) / tileHeight),
+      m_Bands(bands),
+      m_Tiles(m_TilesX * m_TilesY)
+  {
+    for (size_t ty = 0; ty < m_TilesY; ty++) {
+      for (size_t tx = 0; tx < m_TilesX; tx++) {
+        Tile &tile = m_Tiles[ty * m_TilesX + tx];
+        tile.X = tx * tileWidth;
+        tile.Y = ty * tileHeight;
+        tile.Width = std::min(tileWidth, width - tile.X);
+        tile.Height = std::min(tileHeight, height - tile.Y);
+      }
+    }
+  }
+
+  size_t GetNumberOfTiles() const { return m_Tiles.size(); }
+  Tile & GetTile(size_t i) { return m_Tiles[i]; }
+  const Tile & GetTile(size_t i) const { return m_Tiles[i]; }
+
+  size_t GetNumberOfSegments() const { return m_NumberOfSegments; }
+
+  /** Keeps the borders of the labels of a tile, given line by line */
+  static void SetBorders(Tile &tile, const LabelType *labels)
+  {
+    tile.Top.assign(labels, labels + tile.Width);
+    tile.Bottom.assign(labels + (tile.Height - 1) * tile.Width, labels + tile.Height * tile.Width);
+    tile.Left.resize(tile.Height);
+    tile.Right.resize(tile.Height);
+    for (size_t y = 0; y < tile.Height; y++) {
+      tile.Left[y] = labels[y * tile.Width];
+      tile.Right[y] = labels[y * tile.Width + tile.Width - 1];
+    }
+  }
+
+  /** Mode of a final segment, the mean of the modes of its parts weighted by their size */
+  const double * GetMode(LabelType label) const { return &m_Modes[(label - 1) * m_Bands]; }
+
+  void Stitch(double rangeRadius)
+  {
+    // global numbering of the segments of the tiles
+    std::vector<size_t> offsets(m_Tiles.size() + 1, 0);
+    for (size_t i = 0; i < m_Tiles.size(); i++) {
+      offsets[i + 1] = offsets[i] + m_Tiles[i].Counts.size();
+    }
+    m_Parents.resize(offsets.back());
+    for (size_t i = 0; i < m_Parents.size(); i++) {
+      m_Parents[i] = i;
+    }
+
+    const double range2 = rangeRadius * rangeRadius;
+    for (size_t ty = 0; ty < m_TilesY; ty++) {
+      for (size_t tx = 0; tx < m_TilesX; tx++) {
+        const size_t i = ty * m_TilesX + tx;
+        const Tile &tile = m_Tiles[i];
+        if (tx + 1 < m_TilesX) {
+          const Tile &right = m_Tiles[i + 1];
+          for (size_t y = 0; y < tile.Height; y++) {
+            Join(tile, offsets[i], tile.Right[y], right, offsets[i + 1], right.Left[y], range2);
+          }
+        }
+        if (ty + 1 < m_TilesY) {
+          const Tile &below = m_Tiles[i + m_TilesX];
+          for (size_t x = 0; x < tile.Width; x++) {
+            Join(tile, offsets[i], tile.Bottom[x], below, offsets[i + m_TilesX], below.Top[x], range2);
+          }
+        }
+      }
+    }
+
+    // number the merged segments in the order of the tiles and compute their modes
+    std::vector<LabelType> finalLabels(m_Parents.size(), 0);
+    std::vector<double> sums;
+    std::vector<size_t> counts;
+    m_NumberOfSegments = 0;
+    for (size_t i = 0; i < m_Tiles.size(); i++) {
+      const Tile &tile = m_Tiles[i];
+      for (size_t s = 0; s < tile.Counts.size(); s++) {
+        const size_t root = Find(offsets[i] + s);
+        if (finalLabels[root] == 0) {
+          finalLabels[root] = static_cast<LabelType>(++m_NumberOfSegments);
+          sums.resize(m_NumberOfSegments * m_Bands, 0.0);
+          counts.resize(m_NumberOfSegments, 0);
+        }
+        const LabelType label = finalLabels[root];
+        double *sum = &sums[(label - 1) * m_Bands];
+        for (unsigned int b = 0; b < m_Bands; b++) {
+          sum[b] += tile.Modes[s * m_Bands + b] * tile.Counts[s];
+        }
+        counts[label - 1] += tile.Counts[s];
+      }
+    }
+    m_Modes.swap(sums);
+    for (size_t s = 0; s < m_NumberOfSegments; s++) {
+      for (unsigned int b = 0; b < m_Bands; b++) {
+        m_Modes[s * m_Bands + b] /= std::max<size_t>(counts[s], 1);
+      }
+    }
+
+    for (size_t i = 0; i < m_Tiles.size(); i++) {
+      Tile &tile = m_Tiles[i];
+      tile.Segments.resize(tile.Counts.size());
+      for (size_t s = 0; s < tile.Counts.size(); s++) {
+        tile.Segments[s] = finalLabels[Find(offsets[i] + s)];
+      }
+      std::vector<LabelType>().swap(tile.Top);
+      std::vector<LabelType>().swap(tile.Bottom);
+      std::vector<LabelType>().swap(tile.Left);
+      std::vector<LabelType>().swap(tile.Right);
+      std::vector<double>().swap(tile.Modes);
+      std::vector<size_t>().swap(tile.Counts);
+    }
+    std::vector<size_t>().swap(m_Parents);
+  }
+
+private:
+  void Join(const Tile &a, size_t offsetA, LabelType la,
+            const Tile &b, size_t offsetB, LabelType lb, double range2)
+  {
+    const size_t ra = Find(offsetA + la);
+    const size_t rb = Find(offsetB + lb);
+    if (ra == rb) {
+      return;
+    }
+    double d2 = 0;
+    for (unsigned int i = 0; i < m_Bands; i++) {
+      const double d = a.Modes[la * m_Bands + i] - b.Modes[lb * m_Bands + i];
+      d2 += d * d;
+    }
+    if (d2 < range2) {
+      m_Parents[std::max(ra, rb)] = std::min(ra, rb);
+    }
+  }
+
+  size_t Find(size_t s)
+  {
+    while (m_Parents[s] != s) {
+      m_Parents[s] = m_Parents[m_Parents[s]];
+      s = m_Parents[s];
+    }
+    return s;
+  }
+
+  size_t                m_TilesX;
+  size_t                m_TilesY;
+  unsigned int          m_Bands;
+  std::vector<Tile>     m_Tiles;
+  std::vector<size_t>   m_Parents;
+  std::vector<double>   m_Modes;
+  size_t                m_NumberOfSegments = 0;
+};
+
+#endif // SEGMENTATION_TILE_STITCHER_H
@@ -37,6 +37,11 @@
 #include "otbPCAImageFilter.h"
 #include "otbVectorImage.h"
 #include "otbStreamingStatisticsVectorImageFilterEx.h"
+#include "otbStreamingCovarianceVectorImageFilter.h"
+#include "otbStatisticsXMLFileWriter.h"
+#include "otbStatisticsXMLFileReader.h"
+
+#include <sstream>
 
 template<class TInputImage, class TOutputImage = TInputImage>
 class ITK_EXPORT FillNoDataImageFilter
@@ -134,8 +139,14 @@ typedef otb::VectorImage<PixelValueType, 2>  ImageType;
 typedef otb::PCAImageFilter<ImageType, ImageType, otb::Transform::FORWARD>  PCAFilterType;
 //typedef otb::StreamingStatisticsVectorImageFilterEx<ImageType>              StreamingStatisticsVectorImageFilterType;
 typedef otb::StreamingStatisticsVectorImageFilter<ImageType>              StreamingStatisticsVectorImageFilterType;
+typedef otb::StreamingCovarianceVectorImageFilter<ImageType>                StreamingCovarianceVectorImageFilterType;
 typedef FillNoDataImageFilter<ImageType>                                    FillNoDataImageFilterType;
 
+typedef PCAFilterType::VectorType                                           StatisticVectorType;
+typedef PCAFilterType::MatrixType                                           StatisticMatrixType;
+typedef otb::StatisticsXMLFileWriter<StatisticVectorType>                   StatisticsWriterType;
+typedef otb::StatisticsXMLFileReader<StatisticVectorType>                   StatisticsReaderType;
+
 namespace otb
 {
 
@@ -172,6 +183,12 @@ public:
         MandatoryOff("bv");
         AddParameter(ParameterType_Int, "nbcomp", "Number of Components");
         AddParameter(ParameterType_OutputImage, "out", "Output Image");
+        AddParameter(ParameterType_InputFilename, "instat", "Input statistics file");
+        SetParameterDescription("instat", "XML file with the statistics written by a previous run on the same image, used instead of computing them again");
+        MandatoryOff("instat");
+        AddParameter(ParameterType_OutputFilename, "outstat", "Output statistics file");
+        SetParameterDescription("outstat", "XML file receiving the mean, the covariance, the eigenvalues and the transformation matrix");
+        MandatoryOff("outstat");
 
         AddRAMParameter();
 
@@ -196,26 +213,31 @@ public:
 
         m_pcaFilter->SetNumberOfPrincipalComponentsRequired(nbcomp);
 
-        if (HasValue("bv")) {
-            StreamingStatisticsVectorImageFilterType::Pointer streamingStatisticsVectorImageFilter = StreamingStatisticsVectorImageFilterType::New();
-            streamingStatisticsVectorImageFilter->SetInput(inputImage);
-            streamingStatisticsVectorImageFilter->SetIgnoreUserDefinedValue(true);
-            streamingStatisticsVectorImageFilter->SetUserIgnoredValue(noDataValue);
-            streamingStatisticsVectorImageFilter->SetEnableSecondOrderStats(false);
-            streamingStatisticsVectorImageFilter->SetEnableMinMax(false);
-            streamingStatisticsVectorImageFilter->Update();
-
-            StreamingStatisticsVectorImageFilterType::RealPixelType means = streamingStatisticsVectorImageFilter->GetMean();
-            for (unsigned int i = 0; i < means.Size(); i++)
-            {
-                if (std::isnan(means[i]))
-                {
-                    otbAppLogCRITICAL("Found NaN band mean value for band" << i);
-                    means[i] = 0;
-                }
+        // The statistics are computed in a single pass, ignoring the background pixels,
+        // or read from the file written by a previous run
+        StatisticVectorType means;
+        StatisticMatrixType covariance;
+        if (HasValue("instat")) {
+            ReadStatistics(GetParameterString("instat"), inputImage->GetNumberOfComponentsPerPixel(), means, covariance);
+            otbAppLogINFO("Statistics read from " << GetParameterString("instat"));
+        } else {
+            StreamingCovarianceVectorImageFilterType::Pointer covarianceFilter = StreamingCovarianceVectorImageFilterType::New();
+            covarianceFilter->SetInput(inputImage);
+            if (HasValue("bv")) {
+                covarianceFilter->SetIgnoreUserDefinedValue(true);
+                covarianceFilter->SetUserIgnoredValue(noDataValue);
             }
-            otbAppLogINFO("Band means: " << means);
+            covarianceFilter->Update();
 
+            if (covarianceFilter->GetCount() < 2) {
+                itkExceptionMacro("Not enough valid pixels to compute the covariance: " << covarianceFilter->GetCount());
+            }
+            means = covarianceFilter->GetMean();
+            covariance = covarianceFilter->GetCovariance();
+        }
+        otbAppLogINFO("Band means: " << means);
+
+        if (HasValue("bv")) {
             m_fillNoDataImageFilter = FillNoDataImageFilterType::New();
             m_fillNoDataImageFilter->SetInput(inputImage);
             m_fillNoDataImageFilter->SetNoDataValue(noDataValue);
@@ -226,9 +248,73 @@ public:
             m_pcaFilter->SetInput(inputImage);
         }
 
+        // the PCA filter only computes the eigen decomposition of the given covariance
+        m_pcaFilter->SetMeanValues(means);
+        m_pcaFilter->SetCovarianceMatrix(covariance);
+
+        if (HasValue("outstat")) {
+            m_pcaFilter->UpdateOutputInformation();
+            WriteStatistics(GetParameterString("outstat"), means, covariance,
+                            m_pcaFilter->GetEigenValues(), m_pcaFilter->GetTransformationMatrix());
+            otbAppLogINFO("Statistics written to " << GetParameterString("outstat"));
+        }
+
         SetParameterOutputImage("out", m_pcaFilter->GetOutput());
     }
 
+    static std::string RowName(const char *name, unsigned int row)
+    {
+        std::ostringstream os;
+        os << name << "_" << row;
+        return os.str();
+    }
+
+    static StatisticVectorType MatrixRow(const StatisticMatrixType &matrix, unsigned int row)
+    {
+        StatisticVectorType v(matrix.Cols());
+        for (unsigned int j = 0; j < matrix.Cols(); j++) {
+            v[j] = matrix(row, j);
+        }
+        return v;
+    }
+
+    void WriteStatistics(const std::string &fileName, const StatisticVectorType &means, const StatisticMatrixType &covariance,
+                         const StatisticVectorType &eigenValues, const StatisticMatrixType &transformation)
+    {
+        StatisticsWriterType::Pointer writer = StatisticsWriterType::New();
+        writer->SetFileName(fileName);
+        writer->AddInput("mean", means);
+        for (unsigned int i = 0; i < covariance.Rows(); i++) {
+            writer->AddInput(RowName("covariance", i).c_str(), MatrixRow(covariance, i));
+        }
+        writer->AddInput("eigenvalues", eigenValues);
+        for (unsigned int i = 0; i < transformation.Rows(); i++) {
+            writer->AddInput(RowName("transformation", i).c_str(), MatrixRow(transformation, i));
+        }
+        writer->Update();
+    }
+
+    void ReadStatistics(const std::string &fileName, unsigned int nbBands, StatisticVectorType &means, StatisticMatrixType &covariance)
+    {
+        StatisticsReaderType::Pointer reader = StatisticsReaderType::New();
+        reader->SetFileName(fileName);
+        means = reader->GetStatisticVectorByName("mean");
+        if (means.Size() != nbBands) {
+            itkExceptionMacro("The statistics of " << fileName << " are for " << means.Size()
+                              << " bands, the input image has " << nbBands);
+        }
+        covariance.SetSize(nbBands, nbBands);
+        for (unsigned int i = 0; i < nbBands; i++) {
+            const StatisticVectorType row = reader->GetStatisticVectorByName(RowName("covariance", i).c_str());
+            if (row.Size() != nbBands) {
+                itkExceptionMacro("Invalid covariance row " << i << " in " << fileName);
+            }
+            for (unsigned int j = 0; j < nbBands; j++) {
+                covariance(i, j) = row[j];
+            }
+        }
+    }
+
     PCAFilterType::Pointer                  m_pcaFilter;
     FillNoDataImageFilterType::Pointer      m_fillNoDataImageFilter;
 };
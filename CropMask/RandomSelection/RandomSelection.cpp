@@ -48,6 +48,11 @@
 #include "otbWrapperApplication.h"
 #include "otbWrapperApplicationFactory.h"
 #include "otbOGRDataSourceToLabelImageFilter.h"
+
+#include "StratifiedSampleSelector.h"
+#include "BatchedLayerWriter.h"
+
+#include <map>
 //  Software Guide : EndCodeSnippet
 
 namespace otb
@@ -195,7 +200,8 @@ private:
   // Software Guide : BeginLatex
   // The algorithm consists in a random sampling without replacement of the polygons of each class with
   // probability p = sample_ratio value for the training set and
-  // 1 - p for the validation set.
+  // 1 - p for the validation set. The classes are counted in a first pass over the attributes, then
+  // the polygons are streamed to the output files, drawing exactly the training count of each class.
   // Software Guide : EndLatex
   //  Software Guide :BeginCodeSnippet
   void DoExecute()
@@ -205,8 +211,6 @@ private:
       otb::ogr::DataSource::Pointer ogrTrp;
       otb::ogr::DataSource::Pointer ogrTsp;
 
-      std::multimap<int, ogr::Feature> featuresMap;
-
       // Create the reader over the reference file
       ogrRef = otb::ogr::DataSource::New(GetParameterString("ref"), otb::ogr::DataSource::Modes::Read);
       if (ogrRef->GetLayersCount() < 1) {
@@ -232,22 +236,41 @@ private:
       int cropNumber = 0;
       int noCropNumber = 0;
 
-      // read all features from the source file and add them to the multimap
+      // count the features of each class, without reading the geometries. The crop type of
+      // a class is the one of its first feature
+      std::map<int, std::pair<int, bool> > classes;
+      const char *ignoredFields[] = { "OGR_GEOMETRY", NULL };
+      sourceLayer.ogr().SetIgnoredFields(ignoredFields);
       for (ogr::Feature& feature : sourceLayer) {
-          featuresMap.insert(std::pair<int, ogr::Feature>(feature.ogr().GetFieldAsInteger("CODE"), feature.Clone()));
-          if (feature.ogr().GetFieldAsInteger("CROP") == 1) {
+          const bool crop = feature.ogr().GetFieldAsInteger("CROP") == 1;
+          auto it = classes.insert(std::make_pair(feature.ogr().GetFieldAsInteger("CODE"), std::make_pair(0, crop))).first;
+          it->second.first++;
+          if (crop) {
               cropNumber++;
           } else {
               noCropNumber++;
           }
       }
+      sourceLayer.ogr().SetIgnoredFields(NULL);
 
       // update the number of features so that it will not be bigger than the crop or nocrop number
       nbtrsample = std::min(nbtrsample, std::min(cropNumber, noCropNumber));
 
       // compute the ratio for the features.
-      float cropRatio = (float) nbtrsample / cropNumber;
-      float noCropRatio = (float) nbtrsample / noCropNumber;
+      float cropRatio = cropNumber ? (float) nbtrsample / cropNumber : 0.0f;
+      float noCropRatio = noCropNumber ? (float) nbtrsample / noCropNumber : 0.0f;
+
+      // compute the number of training polygons of each class based on the polygon type
+      StratifiedSampleSelector<int> selector(seed);
+      for (const auto &cls : classes) {
+          int count = cls.second.first;
+          float ratio = cls.second.second ? cropRatio : noCropRatio;
+          int trCount = std::round(ratio * count);
+          if (trCount == 0) {
+              trCount = 1;
+          }
+          selector.SetQuota(cls.first, count, trCount);
+      }
 
       // create the layers for the target files
       otb::ogr::Layer trpLayer = ogrTrp->CreateLayer(sourceLayer.GetName(), sourceLayer.GetSpatialRef()->Clone(), sourceLayer.GetGeomType());
@@ -262,83 +285,26 @@ private:
           tspLayer.ogr().CreateField(fieldDefn);
       }
 
-      OGRFeatureDefn* trpLayerDefn = trpLayer.ogr().GetLayerDefn();
-      OGRFeatureDefn* tspLayerDefn = tspLayer.ogr().GetLayerDefn();
-
-      // initialise the random number generator
-      std::srand(seed);
-      // Loop through the key set
-      std::multimap<int,ogr::Feature>::iterator it;
-      for (it=featuresMap.begin(); it!=featuresMap.end(); it = featuresMap.upper_bound(it->first)) {
-          // get the number of polygons from the feature
-          int count = featuresMap.count(it->first);
-
-          // compute the number of training polygons based on the polygon type
-          float ratio;
-          if (it->second.ogr().GetFieldAsInteger("CROP") == 1) {
-              ratio = cropRatio;
+      // split the features of each class while reading them
+      BatchedLayerWriter trpWriter(trpLayer);
+      BatchedLayerWriter tspWriter(tspLayer);
+      sourceLayer.ogr().ResetReading();
+      for (ogr::Feature& feature : sourceLayer) {
+          if (selector.Select(feature.ogr().GetFieldAsInteger("CODE"))) {
+              trpWriter.Write(feature);
           } else {
-
-              ratio = noCropRatio;
-          }
-          int trCount = std::round(ratio * count);
-          if (trCount == 0) {
-              trCount = 1;
-          }
-
-          // loop through the features belonging to the current key
-          std::multimap<int,ogr::Feature>::iterator featuresIt;
-          for (featuresIt = featuresMap.lower_bound(it->first); featuresIt != featuresMap.upper_bound(it->first); ++featuresIt) {
-              // get the feature
-              ogr::Feature &f = featuresIt->second;
-
-              // generate a random number and convert it to the [0..1] interval
-              float random = (float) std::rand() / (float)RAND_MAX;
-
-              if ((trCount != 0) && (trCount == count || random <= ratio)) {
-                  // add feature to training set
-                  ogr::Feature feat(*trpLayerDefn);
-                  // Add field values from input Layer
-                  for (int i = 0; i < trpLayerDefn->GetFieldCount(); i++) {
-                      OGRFieldDefn* fieldDefn = trpLayerDefn->GetFieldDefn(i);
-                      feat.ogr().SetField(fieldDefn->GetNameRef(), f.ogr().GetRawFieldRef(i));
-                  }
-
-                  // Set the geometry
-                  feat.ogr().SetGeometry(f.ogr().GetGeometryRef()->clone());
-
-                  trpLayer.CreateFeature(feat);
-
-                  // decrement the number of training features
-                  trCount--;
-              } else {
-                  // add feature to testing set
-                  ogr::Feature feat(*tspLayerDefn);
-                  // Add field values from input Layer
-                  for (int i = 0; i < tspLayerDefn->GetFieldCount(); i++) {
-                      OGRFieldDefn* fieldDefn = tspLayerDefn->GetFieldDefn(i);
-                      feat.ogr().SetField(fieldDefn->GetNameRef(), f.ogr().GetRawFieldRef(i));
-                  }
-
-                  // Set the geometry
-                  feat.ogr().SetGeometry(f.ogr().GetGeometryRef()->clone());
-
-                  tspLayer.CreateFeature(feat);
-              }
-
-              // decrement the count
-              count--;
+              tspWriter.Write(feature);
           }
       }
 
       // save the output files
-      trpLayer.ogr().CommitTransaction();
-      tspLayer.ogr().CommitTransaction();
+      trpWriter.Commit();
+      tspWriter.Commit();
 
       ogrTrp->SyncToDisk();
       ogrTsp->SyncToDisk();
 
-      std::cout << "total features: " << featureCount << ", Training features: " << trpLayer.GetFeatureCount(true) << ", Testing features: " << tspLayer.GetFeatureCount(true) << std::endl;
+      std::cout << "total features: " << featureCount << ", Training features: " << trpWriter.GetCount() << ", Testing features: " << tspWriter.GetCount() << std::endl;
   }
   //  Software Guide :EndCodeSnippet
 
@@ -48,7 +48,6 @@
 
 #include "otbWrapperApplication.h"
 #include "otbWrapperApplicationFactory.h"
-#include "itkBinaryFunctorImageFilter.h"
 
 #include "otbTemporalResamplingFilter.h"
 #include "TimeSeriesReader.h"
@@ -57,7 +56,7 @@
 
 typedef otb::ImageFileReader<ImageType> ReaderType;
 typedef DataSmoothingFunctor<ImageType::PixelType, MaskImageType::PixelType> DataSmoothingFunctorType;
-typedef itk::BinaryFunctorImageFilter<ImageType, MaskImageType, ImageType, DataSmoothingFunctorType> DataSmoothingFilterType;
+typedef otb::BinaryFunctorImageFilterWithNBands<ImageType, MaskImageType, ImageType, DataSmoothingFunctorType> DataSmoothingFilterType;
 
 typedef CropMaskSpectralFeaturesFilter                                  CropMaskSpectralFeaturesFilterType;
 
@@ -81,7 +80,7 @@ public:
         m_FloatImageList = FloatImageListType::New();
         m_UInt8ImageList = UInt8ImageListType::New();
         m_BandsConcat = ConcatenateFloatImagesFilterType::New();
-        m_MaskConcat = ConcatenateUInt8ImagesFilterType::New();
+        m_MaskConcat = TemporalMaskPackingFilterType::New();
         m_DataSmoothingFilter = DataSmoothingFilterType::New();
         m_SpectralFeaturesFilter = CropMaskSpectralFeaturesFilterType::New();
     }
@@ -253,9 +252,7 @@ public:
 
             m_RedEdgeDataSmoothingFilter->SetInput1(m_RedEdgeBandConcat->GetOutput());
             m_RedEdgeDataSmoothingFilter->SetInput2(m_RedEdgeMaskConcat->GetOutput());
-
-            m_RedEdgeDataSmoothingFilter->UpdateOutputInformation();
-            m_RedEdgeDataSmoothingFilter->GetOutput()->SetNumberOfComponentsPerPixel(od.size() * reBands);
+            m_RedEdgeDataSmoothingFilter->SetNumberOfOutputBands(od.size() * reBands);
 
             hasRedEdge = !reImgInfos.empty();
         }
@@ -268,9 +265,7 @@ public:
 
         m_DataSmoothingFilter->SetInput1(m_BandsConcat->GetOutput());
         m_DataSmoothingFilter->SetInput2(m_MaskConcat->GetOutput());
-
-        m_DataSmoothingFilter->UpdateOutputInformation();
-        m_DataSmoothingFilter->GetOutput()->SetNumberOfComponentsPerPixel(od.size() * bands);
+        m_DataSmoothingFilter->SetNumberOfOutputBands(od.size() * bands);
 
         m_SpectralFeaturesFilter->GetFunctor().SetInputDates(od);
         m_SpectralFeaturesFilter->SetInput1(m_DataSmoothingFilter->GetOutput());
@@ -298,7 +293,7 @@ private:
     FloatImageListType::Pointer                       m_FloatImageList;
     UInt8ImageListType::Pointer                       m_UInt8ImageList;
     ConcatenateFloatImagesFilterType::Pointer         m_BandsConcat;
-    ConcatenateUInt8ImagesFilterType::Pointer         m_MaskConcat;
+    TemporalMaskPackingFilterType::Pointer            m_MaskConcat;
     DataSmoothingFilterType::Pointer                  m_DataSmoothingFilter;
     DataSmoothingFilterType::Pointer                  m_RedEdgeDataSmoothingFilter;
     CropMaskSpectralFeaturesFilterType::Pointer       m_SpectralFeaturesFilter;
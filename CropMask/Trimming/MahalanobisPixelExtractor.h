@@ -42,10 +42,26 @@
 #include "itkImageRegionSplitter.h"
 #include "itkVariableSizeMatrix.h"
 #include "itkVariableLengthVector.h"
+#include "itkMultiThreader.h"
+#include "MahalanobisStatistics.h"
 
 #include <unordered_map>
-
-template<class TInputImage>
+#include <atomic>
+
+/** \class PersistentMahalanobisPixelExtractorFilter
+ * \brief Selects the pixels of each class of a reference raster which are
+ * not Mahalanobis outliers of their class in the features raster.
+ *
+ * The pixels having a positive value in the reference raster are gathered
+ * by class while the features and the reference are streamed, together
+ * with the running mean and covariance of each class. In Synthetize, the
+ * points further than the chi-squared threshold are removed, the statistics
+ * being downdated instead of recomputed, until no point is removed. The
+ * classes are trimmed in parallel, each one with its own random generator
+ * seeded from Seed and the class, so the result does not depend on the
+ * number of threads.
+ */
+template<class TInputImage, class TReferenceImage>
 class ITK_EXPORT PersistentMahalanobisPixelExtractorFilter :
   public otb::PersistentImageFilter<TInputImage, TInputImage>
 {
@@ -71,6 +87,8 @@ public:
   typedef typename ImageType::PixelType         PixelType;
   typedef typename ImageType::InternalPixelType InternalPixelType;
 
+  typedef TReferenceImage                       ReferenceImageType;
+
 
   /** Image related typedefs. */
   itkStaticConstMacro(ImageDimension, unsigned int, TInputImage::ImageDimension);
@@ -83,9 +101,14 @@ public:
   typedef std::vector<IndexType>                                  IndexVectorType;
   typedef std::unordered_map<short, IndexVectorType>              IndexMapType;
 
-  typedef std::vector<PixelType>                                  PixelVectorType;
-  typedef std::unordered_map<short, PixelVectorType>              PixelMapType;
-
+  /** Points of one class, their features (one after the other) and their statistics */
+  struct ClassSamples
+  {
+    IndexVectorType                 Indices;
+    std::vector<InternalPixelType>  Values;
+    OnlineCovarianceEstimator       Statistics;
+  };
+  typedef std::unordered_map<short, ClassSamples>                 ClassSamplesMapType;
 
 
   /** Type of DataObjects used for outputs */
@@ -100,11 +123,9 @@ public:
   const IndexMapObjectType* GetIndecesOutput() const;
 
 
-  /** Add evaluated point. */
-  void AddPoint(const IndexType & point, const short cls);
-
-  /** Remove all points */
-  void ClearPoints();
+  /** The reference raster, having the class of each pixel or 0 */
+  void SetReferenceImage(const ReferenceImageType *reference);
+  const ReferenceImageType * GetReferenceImage() const;
 
   /** Make a DataObject of the correct type to be used as the specified
    * output.
@@ -139,9 +160,13 @@ protected:
 
   virtual void PrintSelf(std::ostream& os, itk::Indent indent) const;
 
+  virtual void BeforeThreadedGenerateData();
+
   /** Multi-thread version GenerateData. */
   void  ThreadedGenerateData(const RegionType& outputRegionForThread, itk::ThreadIdType threadId);
 
+  virtual void AfterThreadedGenerateData();
+
 private:
   PersistentMahalanobisPixelExtractorFilter(const Self &); //purposely not implemented
   void operator =(const Self&); //purposely not implemented
@@ -150,24 +175,38 @@ private:
   int                 m_NbSamples;
   int                 m_Seed;
 
-  IndexMapType        m_Points;
-  PixelMapType        m_Pixels;
+  ClassSamplesMapType                 m_Samples;
+  std::vector<ClassSamplesMapType>    m_ThreadSamples;
 
+  /** Removes the outliers of one class and selects NbSamples of the remaining points */
+  void TrimClass(short cls, ClassSamples &samples, double chi, IndexVectorType &selected) const;
+
+  /** Trimming of the classes in parallel */
+  struct TrimThreadStruct
+  {
+    Self                                  *Filter;
+    std::vector<short>                    Classes;
+    std::vector<ClassSamples*>            Samples;
+    std::vector<IndexVectorType>          Selected;
+    double                                Chi;
+    std::atomic<size_t>                   NextClass;
+  };
+  static ITK_THREAD_RETURN_TYPE TrimThreaderCallback(void *arg);
 
 }; // end of class PersistentStreamingStatisticsVectorImageFilter
 
 /**===========================================================================*/
 
 
-template<class TInputImage>
+template<class TInputImage, class TReferenceImage>
 class ITK_EXPORT MahalanobisPixelExtractorFilter :
-  public otb::PersistentFilterStreamingDecorator<PersistentMahalanobisPixelExtractorFilter<TInputImage> >
+  public otb::PersistentFilterStreamingDecorator<PersistentMahalanobisPixelExtractorFilter<TInputImage, TReferenceImage> >
 {
 public:
   /** Standard Self typedef */
   typedef MahalanobisPixelExtractorFilter Self;
   typedef otb::PersistentFilterStreamingDecorator
-  <PersistentMahalanobisPixelExtractorFilter<TInputImage> > Superclass;
+  <PersistentMahalanobisPixelExtractorFilter<TInputImage, TReferenceImage> > Superclass;
   typedef itk::SmartPointer<Self>       Pointer;
   typedef itk::SmartPointer<const Self> ConstPointer;
 
@@ -178,6 +217,7 @@ public:
   itkTypeMacro(MahalanobisPixelExtractorFilter, otb::PersistentFilterStreamingDecorator);
 
   typedef TInputImage                                 InputImageType;
+  typedef TReferenceImage                             ReferenceImageType;
   typedef typename Superclass::FilterType             MahalanobisFilterType;
 
   /** Type of DataObjects used for outputs */
@@ -210,16 +250,13 @@ public:
     return this->GetFilter()->GetIndecesOutput();
   }
 
-  /** Add evaluated point. */
-  void AddPoint(const IndexType & point, const short cls)
+  void SetReferenceImage(const ReferenceImageType * reference)
   {
-      this->GetFilter()->AddPoint(point, cls);
+    this->GetFilter()->SetReferenceImage(reference);
   }
-
-  /** Remove all points */
-  void ClearPoints()
+  const ReferenceImageType * GetReferenceImage()
   {
-      this->GetFilter()->ClearPoints();
+    return this->GetFilter()->GetReferenceImage();
   }
 
 
@@ -35,6 +35,7 @@
 #include "MahalanobisPixelExtractor.h"
 
 #include "itkImageRegionIterator.h"
+#include "itkImageRegionConstIterator.h"
 #include "itkImageRegionConstIteratorWithIndex.h"
 #include "itkProgressReporter.h"
 #include "otbMacro.h"
@@ -48,13 +49,12 @@
 #include "itkNumericTraitsRGBPixel.h"
 #include "itkProgressReporter.h"
 
-#include "itkListSample.h"
-#include "itkCovarianceSampleFilter.h"
-#include "itkMahalanobisDistanceMembershipFunction.h"
+#include <random>
+#include <algorithm>
 
 
-template<class TInputImage>
-PersistentMahalanobisPixelExtractorFilter<TInputImage>
+template<class TInputImage, class TReferenceImage>
+PersistentMahalanobisPixelExtractorFilter<TInputImage, TReferenceImage>
 ::PersistentMahalanobisPixelExtractorFilter()
    : m_Alpha(0.01),
      m_NbSamples(0),
@@ -66,11 +66,14 @@ PersistentMahalanobisPixelExtractorFilter<TInputImage>
   // allocate the data objects for the outputs which are
   // just decorators around vector/matrix types
   this->itk::ProcessObject::SetNthOutput(1, this->MakeOutput(1).GetPointer());
+
+  // the features and the reference raster
+  this->SetNumberOfRequiredInputs(2);
 }
 
-template<class TInputImage>
+template<class TInputImage, class TReferenceImage>
 itk::DataObject::Pointer
-PersistentMahalanobisPixelExtractorFilter<TInputImage>
+PersistentMahalanobisPixelExtractorFilter<TInputImage, TReferenceImage>
 ::MakeOutput(DataObjectPointerArraySizeType output)
 {
   switch (output)
@@ -88,48 +91,46 @@ PersistentMahalanobisPixelExtractorFilter<TInputImage>
     }
 }
 
-template<class TInputImage>
+template<class TInputImage, class TReferenceImage>
 void
-PersistentMahalanobisPixelExtractorFilter<TInputImage>
-::AddPoint(const IndexType & point, const short cls)
+PersistentMahalanobisPixelExtractorFilter<TInputImage, TReferenceImage>
+::SetReferenceImage(const ReferenceImageType *reference)
 {
-    // get the vector that corresponds to the class
-    m_Points[cls].emplace_back(point);
-    m_Pixels[cls].emplace_back(0);
+  this->itk::ProcessObject::SetNthInput(1, const_cast<ReferenceImageType *>(reference));
 }
 
-template<class TInputImage>
-void
-PersistentMahalanobisPixelExtractorFilter<TInputImage>
-::ClearPoints()
+template<class TInputImage, class TReferenceImage>
+const typename PersistentMahalanobisPixelExtractorFilter<TInputImage, TReferenceImage>::ReferenceImageType*
+PersistentMahalanobisPixelExtractorFilter<TInputImage, TReferenceImage>
+::GetReferenceImage() const
 {
-  if ( this->m_Points.size() > 0 )
-  {
-    this->m_Points.clear();
-    this->m_Pixels.clear();
-  }
+  if (this->GetNumberOfInputs() < 2)
+    {
+    return 0;
+    }
+  return static_cast<const ReferenceImageType *>(this->itk::ProcessObject::GetInput(1));
 }
 
-template<class TInputImage>
-typename PersistentMahalanobisPixelExtractorFilter<TInputImage>::IndexMapObjectType*
-PersistentMahalanobisPixelExtractorFilter<TInputImage>
+template<class TInputImage, class TReferenceImage>
+typename PersistentMahalanobisPixelExtractorFilter<TInputImage, TReferenceImage>::IndexMapObjectType*
+PersistentMahalanobisPixelExtractorFilter<TInputImage, TReferenceImage>
 ::GetIndecesOutput()
 {
   return static_cast<IndexMapObjectType*>(this->itk::ProcessObject::GetOutput(1));
 }
 
-template<class TInputImage>
-const typename PersistentMahalanobisPixelExtractorFilter<TInputImage>::IndexMapObjectType*
-PersistentMahalanobisPixelExtractorFilter<TInputImage>
+template<class TInputImage, class TReferenceImage>
+const typename PersistentMahalanobisPixelExtractorFilter<TInputImage, TReferenceImage>::IndexMapObjectType*
+PersistentMahalanobisPixelExtractorFilter<TInputImage, TReferenceImage>
 ::GetIndecesOutput() const
 {
   return static_cast<const IndexMapObjectType*>(this->itk::ProcessObject::GetOutput(1));
 }
 
 
-template<class TInputImage>
+template<class TInputImage, class TReferenceImage>
 void
-PersistentMahalanobisPixelExtractorFilter<TInputImage>
+PersistentMahalanobisPixelExtractorFilter<TInputImage, TReferenceImage>
 ::GenerateOutputInformation()
 {
   Superclass::GenerateOutputInformation();
@@ -145,9 +146,9 @@ PersistentMahalanobisPixelExtractorFilter<TInputImage>
     }
 }
 
-template<class TInputImage>
+template<class TInputImage, class TReferenceImage>
 void
-PersistentMahalanobisPixelExtractorFilter<TInputImage>
+PersistentMahalanobisPixelExtractorFilter<TInputImage, TReferenceImage>
 ::AllocateOutputs()
 {
   // This is commented to prevent the streaming of the whole image for the first stream strip
@@ -157,21 +158,31 @@ PersistentMahalanobisPixelExtractorFilter<TInputImage>
   // Nothing that needs to be allocated for the remaining outputs
 }
 
-template<class TInputImage>
+template<class TInputImage, class TReferenceImage>
 void
-PersistentMahalanobisPixelExtractorFilter<TInputImage>
+PersistentMahalanobisPixelExtractorFilter<TInputImage, TReferenceImage>
 ::Reset()
 {
   TInputImage * inputPtr = const_cast<TInputImage *>(this->GetInput());
   inputPtr->UpdateOutputInformation();
 
-  //m_Pixels.clear();
-  //m_Points.clear();
+  ReferenceImageType * referencePtr = const_cast<ReferenceImageType *>(this->GetReferenceImage());
+  if (!referencePtr)
+    {
+    itkExceptionMacro(<< "No reference image was set");
+    }
+  referencePtr->UpdateOutputInformation();
+  if (referencePtr->GetLargestPossibleRegion() != inputPtr->GetLargestPossibleRegion())
+    {
+    itkExceptionMacro(<< "The reference and the features rasters must have the same size");
+    }
+
+  m_Samples.clear();
 }
 
-template<class TInputImage>
+template<class TInputImage, class TReferenceImage>
 void
-PersistentMahalanobisPixelExtractorFilter<TInputImage>
+PersistentMahalanobisPixelExtractorFilter<TInputImage, TReferenceImage>
 ::Synthetize()
 {
     itkDebugMacro(<< "Starting processing");
@@ -182,125 +193,182 @@ PersistentMahalanobisPixelExtractorFilter<TInputImage>
     typedef itk::Statistics::ChiSquareDistribution      ChiSquareDistributionType;
     const double chi = ChiSquareDistributionType::InverseCDF(1.0 - m_Alpha, dimension);
 
-    // Compute the statistics of the points
-    typedef itk::Statistics::ListSample< PixelType > SampleType;
-
-    typedef itk::Statistics::MahalanobisDistanceMembershipFunction< PixelType >  MahalanobisDistanceFunctionType;
+    // process the classes in a fixed order, whatever the thread which trims them
+    TrimThreadStruct str;
+    str.Filter = this;
+    str.Chi = chi;
+    str.NextClass = 0;
+    for (const auto& samples : m_Samples) {
+        str.Classes.push_back(samples.first);
+    }
+    std::sort(str.Classes.begin(), str.Classes.end());
+    for (short cls : str.Classes) {
+        str.Samples.push_back(&m_Samples[cls]);
+    }
+    str.Selected.resize(str.Classes.size());
 
-    typename MahalanobisDistanceFunctionType::Pointer distance = MahalanobisDistanceFunctionType::New();
+    if (!str.Classes.empty()) {
+        const itk::ThreadIdType nbThreads = std::min<size_t>(this->GetNumberOfThreads(), str.Classes.size());
+        this->GetMultiThreader()->SetNumberOfThreads(nbThreads);
+        this->GetMultiThreader()->SetSingleMethod(this->TrimThreaderCallback, &str);
+        this->GetMultiThreader()->SingleMethodExecute();
+    }
 
-    typename SampleType::Pointer sample = SampleType::New();
-    sample->SetMeasurementVectorSize( dimension );
+    IndexMapType points;
+    for (size_t i = 0; i < str.Classes.size(); i++) {
+        itkDebugMacro(<< "Class " << str.Classes[i] << ": " << str.Selected[i].size() << " points selected");
+        points[str.Classes[i]].swap(str.Selected[i]);
+    }
+    m_Samples.clear();
 
-    // initialise the random number generator
-    std::srand(m_Seed);
-    for (auto& points : m_Points) {
-        itk::SizeValueType removed_cnt = 1;
-        itkDebugMacro(<< "Number of points at the begining: " << points.second.size());
+    this->GetIndecesOutput()->Set(points);
+}
 
-        while (points.second.size() > 0 && removed_cnt > 0) {
-            // first add the points to the sample
-            sample->Clear();
+template<class TInputImage, class TReferenceImage>
+ITK_THREAD_RETURN_TYPE
+PersistentMahalanobisPixelExtractorFilter<TInputImage, TReferenceImage>
+::TrimThreaderCallback(void *arg)
+{
+    TrimThreadStruct *str = (TrimThreadStruct*)(((itk::MultiThreader::ThreadInfoStruct *)(arg))->UserData);
 
-            PixelVectorType &pixels = m_Pixels[points.first];
+    size_t i;
+    while ((i = str->NextClass++) < str->Classes.size()) {
+        str->Filter->TrimClass(str->Classes[i], *str->Samples[i], str->Chi, str->Selected[i]);
+    }
 
-            typename PixelVectorType::iterator siPix = pixels.begin();
-            typename PixelVectorType::iterator liPix = pixels.end();
+    return ITK_THREAD_RETURN_VALUE;
+}
 
-            removed_cnt = 0;
-            while ( siPix != liPix )
-            {
-                sample->PushBack(*siPix);
-                 ++siPix;
+template<class TInputImage, class TReferenceImage>
+void
+PersistentMahalanobisPixelExtractorFilter<TInputImage, TReferenceImage>
+::TrimClass(short cls, ClassSamples &samples, double chi, IndexVectorType &selected) const
+{
+    IndexVectorType &indices = samples.Indices;
+    std::vector<InternalPixelType> &values = samples.Values;
+    OnlineCovarianceEstimator &statistics = samples.Statistics;
+    const unsigned int dimension = statistics.GetDimension();
+
+    SquaredMahalanobisDistance distance;
+    std::vector<double> covariance;
+    std::vector<char> outlier;
+
+    size_t count = indices.size();
+    size_t removed_cnt = 1;
+    while (count > 0 && removed_cnt > 0) {
+        statistics.GetCovariance(covariance);
+        distance.SetStatistics(statistics.GetMean(), covariance, count);
+
+        removed_cnt = 0;
+        outlier.assign(count, 0);
+        for (size_t i = 0; i < count; i++) {
+            if (distance.Evaluate(&values[i * dimension]) > chi) {
+                outlier[i] = 1;
+                removed_cnt++;
             }
+        }
+        if (removed_cnt == 0) {
+            break;
+        }
 
-            // compute the mean and convergence of the sample
-            typedef itk::Statistics::CovarianceSampleFilter< SampleType >  CovarianceAlgorithmType;
-            typename CovarianceAlgorithmType::Pointer covarianceAlgorithm = CovarianceAlgorithmType::New();
-            covarianceAlgorithm->SetInput( sample );
-            covarianceAlgorithm->Update();
-
-            distance->SetMean(covarianceAlgorithm->GetMean());
-            distance->SetCovariance(covarianceAlgorithm->GetCovarianceMatrix());
-
-            typename IndexVectorType::iterator si = points.second.begin();
-            typename IndexVectorType::iterator li = points.second.end();
-            siPix = pixels.begin();
-            while (siPix != liPix) {
-                if (distance->Evaluate(*siPix) > chi) {
-                    removed_cnt++;
-                    // move to end
-                    std::swap(*si, *(--li));
-                    std::swap(*siPix, *(--liPix));
-                    //si = m_Points.erase(si);
-                } else {
-                    ++si;
-                    ++siPix;
+        // downdate the statistics with the removed points, or compute them
+        // again from the kept ones if these are fewer
+        const bool recompute = 2 * removed_cnt > count;
+        if (recompute) {
+            statistics.Reset(dimension);
+        }
+        size_t kept = 0;
+        for (size_t i = 0; i < count; i++) {
+            const InternalPixelType *x = &values[i * dimension];
+            if (outlier[i]) {
+                if (!recompute) {
+                    statistics.Remove(x);
                 }
+                continue;
             }
-            // remove the last elements
-            pixels.erase(liPix, pixels.end());
-            points.second.erase(li, points.second.end());
-        }
-        itkDebugMacro(<< "Number of points at the end: " << m_Points.size());
-
-        // Reduce the number of pixels in oder to reduce the time of clasification
-        if (m_NbSamples > 0 && points.second.size() > m_NbSamples) {
-
-            typename IndexVectorType::iterator st = points.second.begin();
-            int pixSel = 0;
-            int size = points.second.size();
-            while (pixSel < m_NbSamples) {
-                typename IndexVectorType::iterator r = st;
-                float rnd = (float)std::rand() / (float)RAND_MAX;
-                std::advance(r, (int)(rnd * (float)size));
-                std::swap(*st, *r);
-                ++st;
-                --size;
-                ++pixSel;
+            if (recompute) {
+                statistics.Add(x);
             }
-
-            // Remove unselected pixels
-            points.second.erase(st, points.second.end());
+            if (kept != i) {
+                indices[kept] = indices[i];
+                std::copy(x, x + dimension, &values[kept * dimension]);
+            }
+            ++kept;
         }
+        count = kept;
     }
+    indices.resize(count);
+    std::vector<InternalPixelType>().swap(values);
+
+    // Reduce the number of pixels in oder to reduce the time of clasification
+    if (m_NbSamples > 0 && count > static_cast<size_t>(m_NbSamples)) {
+        std::seed_seq seq{static_cast<unsigned int>(m_Seed), static_cast<unsigned int>(cls)};
+        std::mt19937 rng(seq);
+        for (size_t i = 0; i < static_cast<size_t>(m_NbSamples); i++) {
+            std::uniform_int_distribution<size_t> pick(i, count - 1);
+            std::swap(indices[i], indices[pick(rng)]);
+        }
+        indices.resize(m_NbSamples);
+    }
+    selected.swap(indices);
+}
 
-
-
-    this->GetIndecesOutput()->Set(m_Points);
+template<class TInputImage, class TReferenceImage>
+void
+PersistentMahalanobisPixelExtractorFilter<TInputImage, TReferenceImage>
+::BeforeThreadedGenerateData()
+{
+    m_ThreadSamples.assign(this->GetNumberOfThreads(), ClassSamplesMapType());
 }
 
-template<class TInputImage>
+template<class TInputImage, class TReferenceImage>
 void
-PersistentMahalanobisPixelExtractorFilter<TInputImage>
+PersistentMahalanobisPixelExtractorFilter<TInputImage, TReferenceImage>
 ::ThreadedGenerateData(const RegionType& outputRegionForThread, itk::ThreadIdType threadId)
  {
-    typedef itk::ImageRegionConstIterator<TInputImage> ImageRegionConstIteratorType;
-
-    ImageRegionConstIteratorType inputImage = ImageRegionConstIteratorType(this->GetInput(), outputRegionForThread);
-
-    for (auto& points : m_Points) {
-        auto& pixels = m_Pixels[points.first];
+    const unsigned int dimension = this->GetInput()->GetNumberOfComponentsPerPixel();
+    ClassSamplesMapType &threadSamples = m_ThreadSamples[threadId];
 
-        typename IndexVectorType::iterator si = points.second.begin();
-        typename IndexVectorType::iterator li = points.second.end();
+    itk::ImageRegionConstIterator<TInputImage> featIt(this->GetInput(), outputRegionForThread);
+    itk::ImageRegionConstIteratorWithIndex<ReferenceImageType> refIt(this->GetReferenceImage(), outputRegionForThread);
 
-        int counter = 0;
-        while (si != li) {
-            if (outputRegionForThread.IsInside(*si)) {
-                inputImage.SetIndex(*si);
-                pixels[counter] = inputImage.Get();
+    for (featIt.GoToBegin(), refIt.GoToBegin(); !featIt.IsAtEnd(); ++featIt, ++refIt) {
+        const typename ReferenceImageType::PixelType cls = refIt.Get();
+        if (cls > 0) {
+            ClassSamples &samples = threadSamples[static_cast<short>(cls)];
+            if (samples.Statistics.GetDimension() != dimension) {
+                samples.Statistics.Reset(dimension);
             }
-            counter++;
-            ++si;
+            const InternalPixelType *x = featIt.Get().GetDataPointer();
+            samples.Indices.push_back(refIt.GetIndex());
+            samples.Values.insert(samples.Values.end(), x, x + dimension);
+            samples.Statistics.Add(x);
         }
-
     }
  }
 
-template <class TImage>
+template<class TInputImage, class TReferenceImage>
+void
+PersistentMahalanobisPixelExtractorFilter<TInputImage, TReferenceImage>
+::AfterThreadedGenerateData()
+{
+    // the thread regions follow each other, so the points stay in raster order
+    for (auto& threadSamples : m_ThreadSamples) {
+        for (auto& samples : threadSamples) {
+            ClassSamples &classSamples = m_Samples[samples.first];
+            classSamples.Indices.insert(classSamples.Indices.end(),
+                                        samples.second.Indices.begin(), samples.second.Indices.end());
+            classSamples.Values.insert(classSamples.Values.end(),
+                                       samples.second.Values.begin(), samples.second.Values.end());
+            classSamples.Statistics.Merge(samples.second.Statistics);
+        }
+        threadSamples.clear();
+    }
+}
+
+template<class TInputImage, class TReferenceImage>
 void
-PersistentMahalanobisPixelExtractorFilter<TImage>
+PersistentMahalanobisPixelExtractorFilter<TInputImage, TReferenceImage>
 ::PrintSelf(std::ostream& os, itk::Indent indent) const
 {
   Superclass::PrintSelf(os, indent);
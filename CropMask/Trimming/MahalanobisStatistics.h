@@ -0,0 +1,202 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+
+#ifndef MAHALANOBIS_STATISTICS_H
+#define MAHALANOBIS_STATISTICS_H
+
+#include <vector>
+#include <cmath>
+#include <cstddef>
+
+/** Mean and covariance of a set of samples, updated one sample at a time.
+ *
+ * Samples are added with the Welford update and removed with its exact
+ * inverse, so that outliers can be dropped without a pass over the
+ * remaining samples. Estimators of disjoint sets are merged with the
+ * pairwise formula of Chan et al.
+ */
+class OnlineCovarianceEstimator
+{
+public:
+  OnlineCovarianceEstimator() : m_Dimension(0), m_Count(0) {}
+
+  void Reset(unsigned int dimension)
+  {
+    m_Dimension = dimension;
+    m_Count = 0;
+    m_Mean.assign(dimension, 0.0);
+    m_M2.assign(dimension * dimension, 0.0);
+    m_Delta.resize(dimension);
+  }
+
+  template <typename T>
+  void Add(const T *x)
+  {
+    ++m_Count;
+    for (unsigned int i = 0; i < m_Dimension; i++) {
+      m_Delta[i] = x[i] - m_Mean[i];
+      m_Mean[i] += m_Delta[i] / m_Count;
+    }
+    // M2 += (x - old mean) (x - new mean)^T
+    for (unsigned int i = 0; i < m_Dimension; i++) {
+      for (unsigned int j = 0; j < m_Dimension; j++) {
+        m_M2[i * m_Dimension + j] += m_Delta[i] * (x[j] - m_Mean[j]);
+      }
+    }
+  }
+
+  template <typename T>
+  void Remove(const T *x)
+  {
+    if (m_Count <= 1) {
+      Reset(m_Dimension);
+      return;
+    }
+    --m_Count;
+    // M2 -= (x - new mean) (x - old mean)^T
+    for (unsigned int i = 0; i < m_Dimension; i++) {
+      m_Delta[i] = x[i] - m_Mean[i];
+      m_Mean[i] -= m_Delta[i] / m_Count;
+    }
+    for (unsigned int i = 0; i < m_Dimension; i++) {
+      for (unsigned int j = 0; j < m_Dimension; j++) {
+        m_M2[i * m_Dimension + j] -= (x[i] - m_Mean[i]) * m_Delta[j];
+      }
+    }
+  }
+
+  void Merge(const OnlineCovarianceEstimator &other)
+  {
+    if (other.m_Count == 0) {
+      return;
+    }
+    if (m_Count == 0) {
+      *this = other;
+      return;
+    }
+    const double n = static_cast<double>(m_Count) + other.m_Count;
+    const double f = static_cast<double>(m_Count) * other.m_Count / n;
+    for (unsigned int i = 0; i < m_Dimension; i++) {
+      m_Delta[i] = other.m_Mean[i] - m_Mean[i];
+    }
+    for (unsigned int i = 0; i < m_Dimension; i++) {
+      for (unsigned int j = 0; j < m_Dimension; j++) {
+        m_M2[i * m_Dimension + j] += other.m_M2[i * m_Dimension + j] + m_Delta[i] * m_Delta[j] * f;
+      }
+      m_Mean[i] += m_Delta[i] * other.m_Count / n;
+    }
+    m_Count += other.m_Count;
+  }
+
+  size_t GetCount() const { return m_Count; }
+  unsigned int GetDimension() const { return m_Dimension; }
+  const std::vector<double> & GetMean() const { return m_Mean; }
+
+  /** Unbiased covariance matrix, row major. Undefined with less than 2 samples. */
+  void GetCovariance(std::vector<double> &covariance) const
+  {
+    covariance.resize(m_M2.size());
+    for (size_t i = 0; i < m_M2.size(); i++) {
+      covariance[i] = m_M2[i] / (m_Count - 1.0);
+    }
+  }
+
+private:
+  unsigned int        m_Dimension;
+  size_t              m_Count;
+  std::vector<double> m_Mean;
+  std::vector<double> m_M2;
+  std::vector<double> m_Delta;
+};
+
+/** Squared Mahalanobis distance to a mean for a covariance matrix.
+ *
+ * As itk::Statistics::MahalanobisDistanceMembershipFunction, the inverse
+ * covariance is replaced by the identity when the determinant of the
+ * covariance is not above 1e-6. The distance is evaluated with the
+ * Cholesky factor of the covariance instead of its inverse.
+ */
+class SquaredMahalanobisDistance
+{
+public:
+  SquaredMahalanobisDistance() : m_Dimension(0), m_Identity(true) {}
+
+  void SetStatistics(const std::vector<double> &mean, const std::vector<double> &covariance, size_t count)
+  {
+    m_Dimension = mean.size();
+    m_Mean = mean;
+    m_Y.resize(m_Dimension);
+    m_Identity = count < 2 || !Factorize(covariance);
+  }
+
+  template <typename T>
+  double Evaluate(const T *x) const
+  {
+    double d2 = 0;
+    if (m_Identity) {
+      for (size_t i = 0; i < m_Dimension; i++) {
+        const double d = x[i] - m_Mean[i];
+        d2 += d * d;
+      }
+      return d2;
+    }
+    // solve L y = x - mean, the distance is |y|^2
+    for (size_t i = 0; i < m_Dimension; i++) {
+      double s = x[i] - m_Mean[i];
+      for (size_t k = 0; k < i; k++) {
+        s -= m_L[i * m_Dimension + k] * m_Y[k];
+      }
+      m_Y[i] = s / m_L[i * m_Dimension + i];
+      d2 += m_Y[i] * m_Y[i];
+    }
+    return d2;
+  }
+
+private:
+  bool Factorize(const std::vector<double> &covariance)
+  {
+    const double singularThreshold = 1.0e-6;
+    m_L.assign(m_Dimension * m_Dimension, 0.0);
+    double det = 1.0;
+    for (size_t j = 0; j < m_Dimension; j++) {
+      double s = covariance[j * m_Dimension + j];
+      for (size_t k = 0; k < j; k++) {
+        s -= m_L[j * m_Dimension + k] * m_L[j * m_Dimension + k];
+      }
+      if (!(s > 0)) {
+        return false;
+      }
+      det *= s;
+      const double ljj = std::sqrt(s);
+      m_L[j * m_Dimension + j] = ljj;
+      for (size_t i = j + 1; i < m_Dimension; i++) {
+        double v = covariance[i * m_Dimension + j];
+        for (size_t k = 0; k < j; k++) {
+          v -= m_L[i * m_Dimension + k] * m_L[j * m_Dimension + k];
+        }
+        m_L[i * m_Dimension + j] = v / ljj;
+      }
+    }
+    return det > singularThreshold;
+  }
+
+  size_t              m_Dimension;
+  bool                m_Identity;
+  std::vector<double> m_Mean;
+  std::vector<double> m_L;
+  mutable std::vector<double> m_Y;
+};
+
+#endif // MAHALANOBIS_STATISTICS_H
@@ -69,7 +69,7 @@ typedef otb::ImageFileReader<InternalImageType> ImageReaderType;
 typedef InternalImageType::SizeType          ReferenceSizeType;
 typedef InternalImageType::SizeValueType     ReferenceSizeValueType;
 
-typedef MahalanobisPixelExtractorFilter<ImageType> MahalanobisPixelExtractorFilterType;
+typedef MahalanobisPixelExtractorFilter<ImageType, InternalImageType> MahalanobisPixelExtractorFilterType;
 typedef MahalanobisTrimmingFilter<InternalImageType, InternalImageType> MahalanobisTrimmingFilterType;
 
 //typedef std::map<InternalImageType::PixelType, MahalanobisTrimmingFilterType::Pointer> MahalanobisTrimmingFilterMap;
@@ -285,34 +285,15 @@ private:
 
       //Read the Reference input file
       m_ReferenceReader->SetFileName(GetParameterString("ref"));
-      m_ReferenceReader->Update();
+      m_ReferenceReader->UpdateOutputInformation();
 
-      // Get the output
-      InternalImageType::Pointer refImg = m_ReferenceReader->GetOutput();
-
-      ReferenceSizeType imgSize = refImg->GetLargestPossibleRegion().GetSize();
-      //int bandCount = 0;
-
-      // loop through the image
+      // The pixels are split into classes while the reference and the features are streamed
       GetLogger()->Debug("Splitting pixels into classes!\n");
-      // signal that class 11 is found.
-      //bool have11 = false;
       m_PixelExtractor->SetAlpha(alpha);
       m_PixelExtractor->SetNbSamples(nbSamples);
       m_PixelExtractor->SetSeed(seed);
       m_PixelExtractor->SetInput(needExtract ? m_BandsExtractor->GetOutput() : m_FeaturesReader->GetOutput());
-      for (ReferenceSizeValueType i = 0; i < imgSize[0]; i++) {
-          for (ReferenceSizeValueType j = 0; j < imgSize[1]; j++) {
-              InternalImageType::IndexType index;
-              index[0] = i;
-              index[1] = j;
-
-              InternalImageType::PixelType pix = refImg->GetPixel(index);
-              if (pix > 0) {
-                  m_PixelExtractor->AddPoint(index, pix);
-              }
-          }
-      }
+      m_PixelExtractor->SetReferenceImage(m_ReferenceReader->GetOutput());
 
       // Update the pixels extractor
       m_PixelExtractor->Update();
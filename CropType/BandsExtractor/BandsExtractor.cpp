@@ -48,8 +48,8 @@
 #include "otbWrapperApplication.h"
 #include "otbWrapperApplicationFactory.h"
 
-#include "../../MACCSMetadata/include/MACCSMetadataReader.hpp"
-#include "../../MACCSMetadata/include/SPOT4MetadataReader.hpp"
+#include "../../ProductReaders/MACCSMetadata/include/MACCSMetadataReader.hpp"
+#include "../../ProductReaders/MACCSMetadata/include/SPOT4MetadataReader.hpp"
 
 #include "otbVectorImage.h"
 #include "otbImageList.h"
@@ -57,7 +57,8 @@
 #include "otbMultiToMonoChannelExtractROI.h"
 #include "otbBandMathImageFilter.h"
 
-#include "otbStreamingResampleImageFilter.h"
+#include "otbGridResampleImageFilter.h"
+#include "otbBCOInterpolateImageFunction.h"
 #include "otbStreamingStatisticsImageFilter.h"
 #include "otbLabelImageToVectorDataFilter.h"
 
@@ -68,6 +69,10 @@
 
 #include "otbOGRIOHelper.h"
 
+#include <cmath>
+#include <map>
+#include <tuple>
+
 
 #define LANDSAT    "LANDSAT"
 #define SENTINEL   "SENTINEL"
@@ -131,8 +136,10 @@ typedef otb::ObjectList<ImageReaderType>                           ImageReaderLi
 typedef itk::MACCSMetadataReader                                   MACCSMetadataReaderType;
 typedef itk::SPOT4MetadataReader                                   SPOT4MetadataReaderType;
 
-typedef otb::StreamingResampleImageFilter<InternalImageType, InternalImageType, double>    ResampleFilterType;
+typedef otb::GridResampleImageFilter<InternalImageType, InternalImageType, double>    ResampleFilterType;
 typedef otb::ObjectList<ResampleFilterType>                           ResampleFilterListType;
+typedef otb::GridResampleImageFilter<ImageType, ImageType, double>                    VectorResampleFilterType;
+typedef otb::ObjectList<VectorResampleFilterType>                     VectorResampleFilterListType;
 typedef otb::BCOInterpolateImageFunction<InternalImageType,
                                             double>          BicubicInterpolationType;
 typedef itk::LinearInterpolateImageFunction<InternalImageType,
@@ -309,6 +316,7 @@ private:
     m_MasksList = InternalImageListType::New();
     m_AllMasksList = InternalImageListType::New();
     m_ResamplersList = ResampleFilterListType::New();
+    m_VectorResamplersList = VectorResampleFilterListType::New();
     m_ExtractorList = ExtractROIFilterListType::New();
     m_ImageReaderList = ImageReaderListType::New();
     m_BandMathList = BandMathImageFilterListType::New();
@@ -355,6 +363,9 @@ private:
     AddParameter(ParameterType_Empty, "ndh", "Information about mission name and number of xmls will not be added inside the dates files (default off)");
     MandatoryOff("ndh");
 
+    AddParameter(ParameterType_Empty, "fastresample", "Resample the bands on integer ratio grids (for instance 20 m to 10 m) bilinearly when upsampling and with the mean of the covered pixels when downsampling, instead of the BCO interpolation (default off)");
+    MandatoryOff("fastresample");
+
      //  Software Guide : EndCodeSnippet
 
     // Software Guide : BeginLatex
@@ -388,6 +399,9 @@ private:
       m_AllMasksList = InternalImageListType::New();
       m_ExtractorList = ExtractROIFilterListType::New();
       m_ResamplersList = ResampleFilterListType::New();
+      m_VectorResamplersList = VectorResampleFilterListType::New();
+      m_ResamplingGrids.clear();
+      m_ResampledImages.clear();
       m_ImageReaderList = ImageReaderListType::New();
       m_BandMathList = BandMathImageFilterListType::New();
       //m_VldMaskList = InternalImageListType::New();
@@ -425,6 +439,12 @@ private:
       if (IsParameterEnabled("ndh")) {
           m_ndh = true;
       }
+
+      // verify if the cheaper kernels of the integer ratio grids are used
+      m_fastResample = false;
+      if (IsParameterEnabled("fastresample")) {
+          m_fastResample = true;
+      }
       // Get the list of input files
       std::vector<std::string> descriptors = this->GetParameterStringList("il");
 
@@ -563,23 +583,12 @@ private:
       float curRes = reader->GetOutput()->GetSpacing()[0];
       ExtractROIFilterType::Pointer extractor;
 
-      // Extract the green band
-      extractor = getExtractor(reader->GetOutput(), 1);
-      // resample if needed
-      descriptor.imgG = getResampledBand(extractor->GetOutput(), curRes, false);
-
-      // Extract the red band
-      extractor = getExtractor(reader->GetOutput(), 2);
-      descriptor.imgR = getResampledBand(extractor->GetOutput(), curRes, false);
-
-      // Extract the NIR band
-      extractor = getExtractor(reader->GetOutput(), 3);
-      // resample if needed
-      descriptor.imgNIR = getResampledBand(extractor->GetOutput(), curRes, false);
-
-      // Extract the SWIR band
-      extractor = getExtractor(reader->GetOutput(), 4);
-      descriptor.imgSWIR = getResampledBand(extractor->GetOutput(), curRes, false);
+      // Extract the green, red, NIR and SWIR bands, resampled together if needed
+      std::vector<InternalImageType::Pointer> bands = getResampledBands(reader->GetOutput(), {1, 2, 3, 4}, curRes, false);
+      descriptor.imgG = bands[0];
+      descriptor.imgR = bands[1];
+      descriptor.imgNIR = bands[2];
+      descriptor.imgSWIR = bands[3];
 
       // Get the validity mask
       std::string maskFileDiv = rootFolder + meta.Files.MaskDiv;
@@ -662,27 +671,13 @@ private:
       reader->UpdateOutputInformation();
       float curRes = reader->GetOutput()->GetSpacing()[0];
       ExtractROIFilterType::Pointer extractor;
-      ResampleFilterType::Pointer resampler;
-
-      // Extract the green band
-      extractor = getExtractor(reader->GetOutput(), 3);
-      // resample if needed
-      descriptor.imgG = getResampledBand(extractor->GetOutput(), curRes, false);
 
-      // Extract the red band
-      extractor = getExtractor(reader->GetOutput(), 4);
-      // resample if needed
-      descriptor.imgR = getResampledBand(extractor->GetOutput(), curRes, false);
-
-      // Extract the NIR band
-      extractor = getExtractor(reader->GetOutput(), 5);
-      // resample if needed
-      descriptor.imgNIR = getResampledBand(extractor->GetOutput(), curRes, false);
-
-      // Extract the SWIR band
-      extractor = getExtractor(reader->GetOutput(), 6);
-      // resample if needed
-      descriptor.imgSWIR = getResampledBand(extractor->GetOutput(), curRes, false);
+      // Extract the green, red, NIR and SWIR bands, resampled together if needed
+      std::vector<InternalImageType::Pointer> bands = getResampledBands(reader->GetOutput(), {3, 4, 5, 6}, curRes, false);
+      descriptor.imgG = bands[0];
+      descriptor.imgR = bands[1];
+      descriptor.imgNIR = bands[2];
+      descriptor.imgSWIR = bands[3];
 
       // Get the validity mask
       std::string maskFileQuality = getMACCSMaskFileName(rootFolder, meta.ProductOrganization.AnnexFiles, "_QLT");
@@ -763,7 +758,6 @@ private:
       std::string rootFolder = extractFolder(filename);
 
       ExtractROIFilterType::Pointer extractor;
-      ResampleFilterType::Pointer resampler;
 
       //Extract the first 3 bands form the first file. No resampling needed
       std::string imageFile1 = getMACCSRasterFileName(rootFolder, meta.ProductOrganization.ImageFiles, "_FRE_R1");
@@ -771,23 +765,18 @@ private:
       reader1->UpdateOutputInformation();
       float curRes = reader1->GetOutput()->GetSpacing()[0];
 
-      // Extract Green band
+      // Extract the green, red and NIR bands, resampled together if needed
       int gIndex = getBandIndex(meta.ImageInformation.Resolutions[0].Bands, "B3");
-      extractor = getExtractor(reader1->GetOutput(), gIndex);
-      // resample if needed
-      descriptor.imgG = getResampledBand(extractor->GetOutput(), curRes, false);
-
-      // Extract Red band
       int rIndex = getBandIndex(meta.ImageInformation.Resolutions[0].Bands, "B4");
-      extractor = getExtractor(reader1->GetOutput(), rIndex);
-      // resample if needed
-      descriptor.imgR = getResampledBand(extractor->GetOutput(), curRes, false);
-
-      // Extract NIR band
       int nirIndex = getBandIndex(meta.ImageInformation.Resolutions[0].Bands, "B8");
-      extractor = getExtractor(reader1->GetOutput(), nirIndex);
-      // resample if needed
-      descriptor.imgNIR = getResampledBand(extractor->GetOutput(), curRes, false);
+      std::vector<InternalImageType::Pointer> bands = getResampledBands(reader1->GetOutput(),
+                                                                        {static_cast<unsigned int>(gIndex),
+                                                                         static_cast<unsigned int>(rIndex),
+                                                                         static_cast<unsigned int>(nirIndex)},
+                                                                        curRes, false);
+      descriptor.imgG = bands[0];
+      descriptor.imgR = bands[1];
+      descriptor.imgNIR = bands[2];
 
       //Extract the last band form the second file. Resampling needed.
       std::string imageFile2 = getMACCSRasterFileName(rootFolder, meta.ProductOrganization.ImageFiles, "_FRE_R2");
@@ -1208,77 +1197,135 @@ private:
       return extractor;
   }
 
-  InternalImageType::Pointer getResampledBand(const InternalImageType::Pointer& image, const float curRes, const bool isMask) {
-       const float invRatio = static_cast<float>(m_pixSize) / curRes;
-
-       // Scale Transform
-       OutputVectorType scale;
-       scale[0] = invRatio;
-       scale[1] = invRatio;
-
-       auto imageSize = image->GetLargestPossibleRegion().GetSize();
-
-       // Evaluate size
-       ResampleFilterType::SizeType recomputedSize;
-       if (m_imageWidth != 0 && m_imageHeight != 0) {
-           recomputedSize[0] = m_imageWidth;
-           recomputedSize[1] = m_imageHeight;
-       } else {
-           recomputedSize[0] = imageSize[0] / scale[0];
-           recomputedSize[1] = imageSize[1] / scale[1];
-       }
-
-       if (imageSize == recomputedSize)
-           return image;
-
-       ResampleFilterType::Pointer resampler = ResampleFilterType::New();
-       resampler->SetInput(image);
-
-       // Set the interpolator
-       if (isMask) {
-           NearestNeighborInterpolationType::Pointer interpolator = NearestNeighborInterpolationType::New();
-           resampler->SetInterpolator(interpolator);
-       } else {
-           BicubicInterpolationType::Pointer interpolator = BicubicInterpolationType::New();
-           resampler->SetInterpolator(interpolator);
-       }
+  // The output grid for the rasters having a given size and spacing
+  struct ResamplingGrid {
+      bool needsResampling;
+      bool integerRatio;
+      InternalImageType::SizeType size;
+      InternalImageType::SpacingType spacing;
+  };
+
+  typedef std::tuple<itk::SizeValueType, itk::SizeValueType, double, double, float> ResamplingGridKey;
+
+  // The grids are computed once for all the rasters, of all the products, sharing the source grid
+  const ResamplingGrid& getResamplingGrid(const itk::ImageBase<2>* image, const float curRes) {
+      const auto &imageSize = image->GetLargestPossibleRegion().GetSize();
+      const auto &imageSpacing = image->GetSpacing();
+
+      const ResamplingGridKey key(imageSize[0], imageSize[1], imageSpacing[0], imageSpacing[1], curRes);
+      auto it = m_ResamplingGrids.find(key);
+      if (it != m_ResamplingGrids.end()) {
+          return it->second;
+      }
 
-       IdentityTransformType::Pointer transform = IdentityTransformType::New();
+      const float invRatio = static_cast<float>(m_pixSize) / curRes;
 
-       resampler->SetOutputParametersFromImage( image );
+      // Evaluate size
+      ResamplingGrid grid;
+      if (m_imageWidth != 0 && m_imageHeight != 0) {
+          grid.size[0] = m_imageWidth;
+          grid.size[1] = m_imageHeight;
+      } else {
+          grid.size[0] = imageSize[0] / invRatio;
+          grid.size[1] = imageSize[1] / invRatio;
+      }
+      grid.needsResampling = !(imageSize == grid.size);
 
-       // Evaluate spacing
-       InternalImageType::SpacingType spacing = image->GetSpacing();
-       InternalImageType::SpacingType OutputSpacing;
-       OutputSpacing[0] = spacing[0] * scale[0];
-       OutputSpacing[1] = spacing[1] * scale[1];
+      // 20 m to 10 m and the like, where GridResampleImageFilter uses its integer ratio kernels
+      const float ratio = invRatio < 1.0f ? 1.0f / invRatio : invRatio;
+      grid.integerRatio = std::abs(ratio - std::round(ratio)) < EPSILON;
 
-       resampler->SetOutputSpacing(OutputSpacing);
+      // Evaluate spacing
+      grid.spacing[0] = imageSpacing[0] * invRatio;
+      grid.spacing[1] = imageSpacing[1] * invRatio;
 
-//       FloatVectorImageType::PointType origin = image->GetOrigin();
-//       FloatVectorImageType::PointType outputOrigin;
-//       outputOrigin[0] = origin[0] + 0.5 * spacing[0] * (scale[0] - 1.0);
-//       outputOrigin[1] = origin[1] + 0.5 * spacing[1] * (scale[1] - 1.0);
+      return m_ResamplingGrids.insert(std::make_pair(key, grid)).first->second;
+  }
 
-       resampler->SetOutputOrigin(m_imageOrigin);
+  template <typename TImage>
+  typename otb::GridResampleImageFilter<TImage, TImage, double>::Pointer
+  createResampler(const typename TImage::Pointer& image, const ResamplingGrid& grid, const bool isMask) {
+      typedef otb::GridResampleImageFilter<TImage, TImage, double> FilterType;
+      typedef typename TImage::PixelType PixelType;
+      typedef typename itk::NumericTraits<PixelType>::ValueType ValueType;
+
+      typename FilterType::Pointer resampler = FilterType::New();
+      resampler->SetInput(image);
+
+      // Set the interpolator. On the integer ratio grids, the nearest neighbour and linear
+      // interpolations and the mean of the covered pixels are computed by the kernels of the
+      // filter, from precomputed input offsets and weights, without calling the interpolator.
+      // The bands keep the BCO interpolation unless these kernels are requested.
+      if (isMask) {
+          resampler->SetInterpolator(itk::NearestNeighborInterpolateImageFunction<TImage, double>::New());
+      } else if (grid.integerRatio && m_fastResample) {
+          resampler->SetInterpolator(itk::LinearInterpolateImageFunction<TImage, double>::New());
+          resampler->SetUseMeanAggregation(true);
+      } else {
+          resampler->SetInterpolator(otb::BCOInterpolateImageFunction<TImage, double>::New());
+      }
 
-       resampler->SetTransform(transform);
+      resampler->SetOutputParametersFromImage(image);
+      resampler->SetOutputSpacing(grid.spacing);
+      resampler->SetOutputOrigin(m_imageOrigin);
+      resampler->SetOutputSize(grid.size);
 
-       resampler->SetOutputSize(recomputedSize);
+      // Padd with nodata
+      PixelType defaultValue;
+      itk::NumericTraits<PixelType>::SetLength(defaultValue, image->GetNumberOfComponentsPerPixel());
+      defaultValue = static_cast<ValueType>(isMask ? 0 : -10000) * itk::NumericTraits<PixelType>::OneValue(defaultValue);
+      resampler->SetEdgePaddingValue(defaultValue);
 
-       // Padd with nodata
-       InternalImageType::PixelType defaultValue;
-       itk::NumericTraits<InternalImageType::PixelType>::SetLength(defaultValue, image->GetNumberOfComponentsPerPixel());
-       if(!isMask) {
-           defaultValue = -10000;
-       }
-       resampler->SetEdgePaddingValue(defaultValue);
+      return resampler;
+  }
 
+  InternalImageType::Pointer getResampledBand(const InternalImageType::Pointer& image, const float curRes, const bool isMask) {
+       const ResamplingGrid &grid = getResamplingGrid(image, curRes);
+       if (!grid.needsResampling)
+           return image;
 
+       ResampleFilterType::Pointer resampler = createResampler<InternalImageType>(image, grid, isMask);
        m_ResamplersList->PushBack(resampler);
        return resampler->GetOutput();
   }
 
+  // Extract some channels of an image, resampled if needed. When most of the channels
+  // are needed, the image is resampled once, in a single multi-band pass, and the
+  // channels are extracted from the result instead of being resampled one by one.
+  std::vector<InternalImageType::Pointer> getResampledBands(const ImageType::Pointer& image, const std::vector<unsigned int>& channels,
+                                                            const float curRes, const bool isMask) {
+      std::vector<InternalImageType::Pointer> bands;
+
+      const ResamplingGrid &grid = getResamplingGrid(image, curRes);
+      if (!grid.needsResampling) {
+          for (unsigned int channel : channels) {
+              bands.push_back(getExtractor(image, channel)->GetOutput());
+          }
+          return bands;
+      }
+
+      if (channels.size() < 2 || channels.size() * 2 < image->GetNumberOfComponentsPerPixel()) {
+          for (unsigned int channel : channels) {
+              bands.push_back(getResampledBand(getExtractor(image, channel)->GetOutput(), curRes, isMask));
+          }
+          return bands;
+      }
+
+      const auto key = std::make_pair(image.GetPointer(), isMask);
+      auto it = m_ResampledImages.find(key);
+      if (it == m_ResampledImages.end()) {
+          VectorResampleFilterType::Pointer resampler = createResampler<ImageType>(image, grid, isMask);
+          resampler->UpdateOutputInformation();
+          m_VectorResamplersList->PushBack(resampler);
+          it = m_ResampledImages.insert(std::make_pair(key, ImageType::Pointer(resampler->GetOutput()))).first;
+      }
+
+      for (unsigned int channel : channels) {
+          bands.push_back(getExtractor(it->second, channel)->GetOutput());
+      }
+      return bands;
+  }
+
 
   // build the date for spot products as YYYYMMDD
   inline std::string formatSPOT4Date(const std::string& date) {
@@ -1290,6 +1337,9 @@ private:
   ListConcatenerFilterType::Pointer     m_AllMasks;
   ExtractROIFilterListType::Pointer     m_ExtractorList;
   ResampleFilterListType::Pointer       m_ResamplersList;
+  VectorResampleFilterListType::Pointer m_VectorResamplersList;
+  std::map<ResamplingGridKey, ResamplingGrid> m_ResamplingGrids;
+  std::map<std::pair<const ImageType*, bool>, ImageType::Pointer> m_ResampledImages;
   InternalImageListType::Pointer        m_ImageList;
   InternalImageListType::Pointer        m_MasksList;
   InternalImageListType::Pointer        m_AllMasksList;
@@ -1305,6 +1355,7 @@ private:
   FloatVectorImageType::PointType       m_imageOrigin;
   bool                                  m_merge;
   bool                                  m_ndh;
+  bool                                  m_fastResample;
 
 //  InternalImageListType::Pointer        m_VldMaskList;
 //  std::vector<float>                    m_MeanPixels;
@@ -20,13 +20,17 @@
 // set and the validation set.
 // These sets are composed of polygons, not individual pixels.
 
+#include <map>
 #include <random>
-#include <unordered_map>
+#include <unordered_set>
 
 #include "otbWrapperApplication.h"
 #include "otbWrapperApplicationFactory.h"
 #include "otbOGRDataSourceToLabelImageFilter.h"
 
+#include "StratifiedSampleSelector.h"
+#include "BatchedLayerWriter.h"
+
 namespace otb
 {
 
@@ -96,7 +100,8 @@ private:
     // The algorithm consists in a random sampling without replacement of the polygons of each class
     // with
     // probability p = sample_ratio value for the training set and
-    // 1 - p for the validation set.
+    // 1 - p for the validation set. The classes are counted in a first pass, then the polygons
+    // are streamed to the output files, drawing exactly the training count of each class.
     void DoExecute()
     {
         // Internal variables for accessing the files
@@ -104,8 +109,6 @@ private:
         otb::ogr::DataSource::Pointer ogrTp;
         otb::ogr::DataSource::Pointer ogrVp;
 
-        std::unordered_multimap<int, ogr::Feature> featuresMap;
-
         // Create the reader over the reference file
         ogrRef =
             otb::ogr::DataSource::New(GetParameterString("ref"), otb::ogr::DataSource::Modes::Read);
@@ -118,7 +121,7 @@ private:
         // get the random seed
         const int seed = GetParameterInt("seed");
 
-        std::mt19937 urng(seed);
+        StratifiedSampleSelector<int> selector(seed);
 
         // Create the writers over the outut files
         ogrTp = otb::ogr::DataSource::New(GetParameterString("tp"),
@@ -142,11 +145,18 @@ private:
             }
         }
 
-        // read all features from the source field and add them to the multimap
+        // count the features of each class, the features are not kept in memory
+        std::map<int, size_t> classCounts;
         for (ogr::Feature &feature : sourceLayer) {
             if (!filter || feature.ogr().GetFieldAsInteger("CROP")) {
-                featuresMap.insert(std::pair<int, ogr::Feature>(
-                    feature.ogr().GetFieldAsInteger("CODE"), feature));
+                const int code = feature.ogr().GetFieldAsInteger("CODE");
+                size_t &count = classCounts[code];
+                if (feature.GetGeometry()) {
+                    count++;
+                } else {
+                    otbAppLogWARNING("Feature " << feature.ogr().GetFieldAsInteger("ID")
+                                                << " has no associated geometry");
+                }
             }
         }
         std::cerr << '\n';
@@ -166,65 +176,58 @@ private:
             vpLayer.CreateField(fieldDefn);
         }
 
-        size_t featTrainingTarget = 0;
-        size_t featValidationTarget = 0;
-        size_t featTrainingCount = 0;
-        size_t featValidationCount = 0;
-
-        // Loop through the entries
-        decltype (featuresMap.equal_range(0)) range;
-        auto itEnd = featuresMap.end();
-        std::vector<ogr::Feature> classFeatures;
-        for (auto it = featuresMap.begin(); it != itEnd; it = range.second) {
-            range = featuresMap.equal_range(it->first);
-
-            classFeatures.clear();
-            classFeatures.reserve(std::distance(range.first, range.second));
-
-            for (auto itGroup = range.first; itGroup != range.second; ++itGroup) {
-                ogr::Feature &f = itGroup->second;
-                if (f.GetGeometry()) {
-                    classFeatures.emplace_back(f);
-                } else {
-                    otbAppLogWARNING("Feature " << f.ogr().GetFieldAsInteger("ID")
-                                                << " has no associated geometry");
-                }
-            }
-            std::shuffle(classFeatures.begin(), classFeatures.end(), urng);
+        // the classes whose features are used for both training and validation
+        std::unordered_set<int> sharedClasses;
 
-            auto featCount = classFeatures.size();
+        // Loop through the classes
+        for (const auto &cls : classCounts) {
+            auto featCount = cls.second;
             if (!featCount) {
-                otbAppLogWARNING("No valid features found for CODE = " << it->first);
+                otbAppLogWARNING("No valid features found for CODE = " << cls.first);
                 continue;
             }
 
             // compute the target training features
-            featTrainingTarget = static_cast<size_t>(featCount * ratio + 0.5f);
-            featValidationTarget = featCount - featTrainingTarget;
+            size_t featTrainingTarget = static_cast<size_t>(featCount * ratio + 0.5f);
+            size_t featValidationTarget = featCount - featTrainingTarget;
 
             if (!featTrainingTarget || !featValidationTarget) {
-                otbAppLogWARNING("Too few features for code CODE = " << it->first << ", using all of them for validation and training. Validation accuracy might suffer.");
+                otbAppLogWARNING("Too few features for code CODE = " << cls.first << ", using all of them for validation and training. Validation accuracy might suffer.");
                 featTrainingTarget = featValidationTarget = featCount;
+                sharedClasses.insert(cls.first);
             }
 
             // Add info message to log
-            otbAppLogINFO("Found " << featCount << " features with CODE = " << it->first << ". "
+            otbAppLogINFO("Found " << featCount << " features with CODE = " << cls.first << ". "
                                    << "Using " << featTrainingTarget << " for training and "
                                    << featValidationTarget << " for validation. ");
 
-            for (size_t i = 0; i < featTrainingTarget; i++) {
-                const auto &f = classFeatures[i];
+            selector.SetQuota(cls.first, featCount, featTrainingTarget);
+        }
 
-                tpLayer.CreateFeature(f);
-                featTrainingCount++;
+        // split the features while reading them a second time
+        BatchedLayerWriter tpWriter(tpLayer);
+        BatchedLayerWriter vpWriter(vpLayer);
+        sourceLayer.ogr().ResetReading();
+        for (ogr::Feature &feature : sourceLayer) {
+            if ((filter && !feature.ogr().GetFieldAsInteger("CROP")) || !feature.GetGeometry()) {
+                continue;
             }
-            for (size_t i = featCount - featValidationTarget; i < featCount; i++) {
-                const auto &f = classFeatures[i];
-
-                vpLayer.CreateFeature(f);
-                featValidationCount++;
+            const int code = feature.ogr().GetFieldAsInteger("CODE");
+            if (sharedClasses.count(code)) {
+                tpWriter.Write(feature);
+                vpWriter.Write(feature);
+            } else if (selector.Select(code)) {
+                tpWriter.Write(feature);
+            } else {
+                vpWriter.Write(feature);
             }
         }
+        tpWriter.Commit();
+        vpWriter.Commit();
+
+        size_t featTrainingCount = tpWriter.GetCount();
+        size_t featValidationCount = vpWriter.GetCount();
 
         ogrTp->SyncToDisk();
         ogrVp->SyncToDisk();
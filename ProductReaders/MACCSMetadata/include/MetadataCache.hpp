@@ -0,0 +1,84 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <sys/stat.h>
+
+// Returns the name of the root element of an XML file, reading only its prolog,
+// or an empty string if the file cannot be read or the root is too far away
+std::string GetXmlRootElementName(const std::string &path);
+
+// Keeps the metadata parsed by a reader, for each file path, as long as the file
+// keeps the same modification time and size. The files which could not be parsed
+// are remembered too. The callers get their own copy of the metadata, which they
+// are free to modify.
+template <typename TMetadata>
+class MetadataCache
+{
+public:
+    template <typename TParser>
+    std::unique_ptr<TMetadata> Get(const std::string &path, TParser parser)
+    {
+        struct stat fileStat;
+        if (stat(path.c_str(), &fileStat) != 0) {
+            return parser(path);
+        }
+
+        std::shared_ptr<const TMetadata> metadata;
+        bool found = false;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            auto it = m_Entries.find(path);
+            if (it != m_Entries.end() && it->second.ModificationTime == fileStat.st_mtime &&
+                it->second.Size == fileStat.st_size) {
+                metadata = it->second.Metadata;
+                found = true;
+            }
+        }
+
+        if (!found) {
+            // the file is parsed without holding the lock, two threads might parse it at once
+            metadata = std::shared_ptr<const TMetadata>(parser(path).release());
+
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            Entry &entry = m_Entries[path];
+            entry.ModificationTime = fileStat.st_mtime;
+            entry.Size = fileStat.st_size;
+            entry.Metadata = metadata;
+        }
+
+        if (!metadata) {
+            return nullptr;
+        }
+        return std::unique_ptr<TMetadata>(new TMetadata(*metadata));
+    }
+
+private:
+    struct Entry
+    {
+        time_t ModificationTime;
+        off_t Size;
+        std::shared_ptr<const TMetadata> Metadata;
+    };
+
+    std::mutex m_Mutex;
+    std::map<std::string, Entry> m_Entries;
+};
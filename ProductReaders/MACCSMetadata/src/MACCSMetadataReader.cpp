@@ -21,24 +21,29 @@
 #include "otbMacro.h"
 
 #include "MACCSMetadataReader.hpp"
+#include "MetadataCache.hpp"
 #include "MetadataUtil.hpp"
 #include "tinyxml_utils.hpp"
 #include "string_utils.hpp"
 
 namespace itk
 {
+static MetadataCache<MACCSFileMetadata> metadataCache;
+
 std::unique_ptr<MACCSFileMetadata> MACCSMetadataReader::ReadMetadata(const std::string &path)
 {
-    TiXmlDocument doc(path);
-    if (!doc.LoadFile()) {
-        return nullptr;
-    }
+    return metadataCache.Get(path, [this](const std::string &file) -> std::unique_ptr<MACCSFileMetadata> {
+        TiXmlDocument doc(file);
+        if (!doc.LoadFile()) {
+            return nullptr;
+        }
 
-    auto metadata = ReadMetadataXml(doc);
-    if (metadata) {
-        metadata->ProductPath = path;
-    }
-    return metadata;
+        auto metadata = ReadMetadataXml(doc);
+        if (metadata) {
+            metadata->ProductPath = file;
+        }
+        return metadata;
+    });
 }
 
 MACCSFixedHeader ReadFixedHeader(const TiXmlElement *el)
@@ -22,6 +22,7 @@
 
 
 #include "MAJAMetadataReader.hpp"
+#include "MetadataCache.hpp"
 #include "MetadataUtil.hpp"
 #include "tinyxml_utils.hpp"
 #include "string_utils.hpp"
@@ -29,18 +30,22 @@
 namespace itk
 {
 
+static MetadataCache<MACCSFileMetadata> metadataCache;
+
 std::unique_ptr<MACCSFileMetadata> MAJAMetadataReader::ReadMetadata(const std::string &path)
 {
-    TiXmlDocument doc(path);
-    if (!doc.LoadFile()) {
-        return nullptr;
-    }
+    return metadataCache.Get(path, [this](const std::string &file) -> std::unique_ptr<MACCSFileMetadata> {
+        TiXmlDocument doc(file);
+        if (!doc.LoadFile()) {
+            return nullptr;
+        }
 
-    auto metadata = ReadMetadataXml(doc);
-    if (metadata) {
-        metadata->ProductPath = path;
-    }
-    return metadata;
+        auto metadata = ReadMetadataXml(doc);
+        if (metadata) {
+            metadata->ProductPath = file;
+        }
+        return metadata;
+    });
 }
 
 MAJAMetadataIdentification ReadMAJAMetadataIdentification(const TiXmlElement *el)
@@ -0,0 +1,68 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+
+#include <cstring>
+#include <fstream>
+
+#include "MetadataCache.hpp"
+
+// The prolog of the metadata files is short, but some of them start with
+// stylesheet declarations or comments
+#define XML_PROLOG_MAX_SIZE 65536
+
+std::string GetXmlRootElementName(const std::string &path)
+{
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if (!in) {
+        return std::string();
+    }
+
+    std::string prolog(XML_PROLOG_MAX_SIZE, '\0');
+    in.read(&prolog[0], prolog.size());
+    prolog.resize(in.gcount());
+
+    std::string::size_type pos = 0;
+    if (prolog.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+        pos = 3;
+    }
+
+    while ((pos = prolog.find('<', pos)) != std::string::npos) {
+        const char *end = nullptr;
+        if (prolog.compare(pos, 2, "<?") == 0) {
+            end = "?>";
+        } else if (prolog.compare(pos, 4, "<!--") == 0) {
+            end = "-->";
+        } else if (prolog.compare(pos, 2, "<!") == 0) {
+            end = ">";
+        }
+
+        if (!end) {
+            const auto nameStart = pos + 1;
+            const auto nameEnd = prolog.find_first_of(" \t\r\n/>", nameStart);
+            if (nameEnd == std::string::npos || nameEnd == nameStart) {
+                return std::string();
+            }
+            return prolog.substr(nameStart, nameEnd - nameStart);
+        }
+
+        pos = prolog.find(end, pos + 2);
+        if (pos == std::string::npos) {
+            return std::string();
+        }
+        pos += std::strlen(end);
+    }
+
+    return std::string();
+}
@@ -21,25 +21,30 @@
 #include "otbMacro.h"
 
 #include "SEN2CORMetadataReader.hpp"
+#include "MetadataCache.hpp"
 #include "MetadataUtil.hpp"
 #include "tinyxml_utils.hpp"
 #include "string_utils.hpp"
 
 namespace itk
 {
+    static MetadataCache<MACCSFileMetadata> metadataCache;
+
     std::unique_ptr<MACCSFileMetadata> SEN2COR_METADATA_READER_EXPORT SEN2CORMetadataReader::ReadMetadata(const std::string& path)
     {
-        TiXmlDocument doc(path);
-        if (!doc.LoadFile()) {
-            return nullptr;
-        }
+        return metadataCache.Get(path, [this](const std::string& file) -> std::unique_ptr<MACCSFileMetadata> {
+            TiXmlDocument doc(file);
+            if (!doc.LoadFile()) {
+                return nullptr;
+            }
 
-        auto metadata = ReadMetadataXml(doc);
-        if (metadata) {
-            metadata->ProductPath = path;
-        }
+            auto metadata = ReadMetadataXml(doc);
+            if (metadata) {
+                metadata->ProductPath = file;
+            }
 
-        return metadata;
+            return metadata;
+        });
     }
 
     MACCSFixedHeader ReadSEN2CORGeneralInfo(const TiXmlElement* el)
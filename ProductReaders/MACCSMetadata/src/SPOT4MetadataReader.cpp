@@ -21,6 +21,7 @@
 #include "otbMacro.h"
 
 #include "SPOT4MetadataReader.hpp"
+#include "MetadataCache.hpp"
 #include "tinyxml_utils.hpp"
 #include "string_utils.hpp"
 
@@ -32,18 +33,22 @@ static SPOT4Radiometry ReadRadiometry(const TiXmlElement *el);
 
 namespace itk
 {
+static MetadataCache<SPOT4Metadata> metadataCache;
+
 std::unique_ptr<SPOT4Metadata> SPOT4MetadataReader::ReadMetadata(const std::string &path)
 {
-    TiXmlDocument doc(path);
-    if (!doc.LoadFile()) {
-        return nullptr;
-    }
+    return metadataCache.Get(path, [this](const std::string &file) -> std::unique_ptr<SPOT4Metadata> {
+        TiXmlDocument doc(file);
+        if (!doc.LoadFile()) {
+            return nullptr;
+        }
 
-    auto metadata = ReadMetadataXml(doc);
-    if (metadata) {
-        metadata->ProductPath = path;
-    }
-    return metadata;
+        auto metadata = ReadMetadataXml(doc);
+        if (metadata) {
+            metadata->ProductPath = file;
+        }
+        return metadata;
+    });
 }
 
 std::unique_ptr<SPOT4Metadata> SPOT4MetadataReader::ReadMetadataXml(const TiXmlDocument &doc)
@@ -19,34 +19,60 @@
 #include "MACCSS2MetadataHelper.h"
 #include "MACCSL8MetadataHelper.h"
 #include "SEN2CORMetadataHelper.h"
+#include "MetadataCache.hpp"
 
 
 
+// Loads the metadata with a helper of type THelper, keeping it on success
+template <typename THelper, typename PixelType, typename MasksPixelType>
+static bool TryLoadMetadata(const std::string& metadataFileName,
+                            std::unique_ptr<MetadataHelper<PixelType, MasksPixelType>>& metadataHelper)
+{
+    std::unique_ptr<MetadataHelper<PixelType, MasksPixelType>> helper(new THelper);
+    if (!helper->LoadMetadataFile(metadataFileName))
+        return false;
+
+    metadataHelper = std::move(helper);
+    return true;
+}
+
 template <typename PixelType, typename MasksPixelType>
 //std::unique_ptr<MetadataHelper<PixelType, MasksPixelType>> METADATA_HELPER_FACTORY_EXPORT MetadataHelperFactory::GetMetadataHelper(const std::string& metadataFileName)
 std::unique_ptr<MetadataHelper<PixelType, MasksPixelType>> MetadataHelperFactory::GetMetadataHelper(const std::string& metadataFileName)
 {
     // std::cout << "Getting metadata helper" << std::endl;
 
-    std::unique_ptr<MetadataHelper<PixelType, MasksPixelType>> majaMetadataHelper(new MAJAMetadataHelper<PixelType, MasksPixelType>);
-    if (majaMetadataHelper->LoadMetadataFile(metadataFileName))
-        return majaMetadataHelper;
-
-    std::unique_ptr<MetadataHelper<PixelType, MasksPixelType>> maccsS2MetadataHelper(new MACCSS2MetadataHelper<PixelType, MasksPixelType>);
-    if (maccsS2MetadataHelper->LoadMetadataFile(metadataFileName))
-        return maccsS2MetadataHelper;
-
-    std::unique_ptr<MetadataHelper<PixelType, MasksPixelType>> maccsL8MetadataHelper(new MACCSL8MetadataHelper<PixelType, MasksPixelType>);
-    if (maccsL8MetadataHelper->LoadMetadataFile(metadataFileName))
-        return maccsL8MetadataHelper;
-
-    std::unique_ptr<MetadataHelper<PixelType, MasksPixelType>> sen2corMetadataHelper(new SEN2CORMetadataHelper<PixelType, MasksPixelType>);
-    if (sen2corMetadataHelper->LoadMetadataFile(metadataFileName))
-        return sen2corMetadataHelper;
-
-    std::unique_ptr<MetadataHelper<PixelType, MasksPixelType>> spot4MetadataHelper(new Spot4MetadataHelper<PixelType, MasksPixelType>);
-    if (spot4MetadataHelper->LoadMetadataFile(metadataFileName))
-        return spot4MetadataHelper;
+    typedef MAJAMetadataHelper<PixelType, MasksPixelType> MAJAHelperType;
+    typedef MACCSS2MetadataHelper<PixelType, MasksPixelType> MACCSS2HelperType;
+    typedef MACCSL8MetadataHelper<PixelType, MasksPixelType> MACCSL8HelperType;
+    typedef SEN2CORMetadataHelper<PixelType, MasksPixelType> SEN2CORHelperType;
+    typedef Spot4MetadataHelper<PixelType, MasksPixelType> Spot4HelperType;
+
+    std::unique_ptr<MetadataHelper<PixelType, MasksPixelType>> metadataHelper;
+
+    // The root element tells the format of the file, so only the helpers reading it are tried.
+    // The other readers would reject the file anyway, as they look for another root element.
+    const std::string rootElement = GetXmlRootElementName(metadataFileName);
+    if (rootElement == "Muscate_Metadata_Document") {
+        if (TryLoadMetadata<MAJAHelperType>(metadataFileName, metadataHelper))
+            return metadataHelper;
+    } else if (rootElement == "Earth_Explorer_Header") {
+        if (TryLoadMetadata<MACCSS2HelperType>(metadataFileName, metadataHelper) ||
+            TryLoadMetadata<MACCSL8HelperType>(metadataFileName, metadataHelper))
+            return metadataHelper;
+    } else if (rootElement == "n1:Level-2A_User_Product" || rootElement == "n1:Level-2A_Tile_ID") {
+        if (TryLoadMetadata<SEN2CORHelperType>(metadataFileName, metadataHelper))
+            return metadataHelper;
+    } else if (rootElement == "METADATA") {
+        if (TryLoadMetadata<Spot4HelperType>(metadataFileName, metadataHelper))
+            return metadataHelper;
+    } else if (TryLoadMetadata<MAJAHelperType>(metadataFileName, metadataHelper) ||
+               TryLoadMetadata<MACCSS2HelperType>(metadataFileName, metadataHelper) ||
+               TryLoadMetadata<MACCSL8HelperType>(metadataFileName, metadataHelper) ||
+               TryLoadMetadata<SEN2CORHelperType>(metadataFileName, metadataHelper) ||
+               TryLoadMetadata<Spot4HelperType>(metadataFileName, metadataHelper)) {
+        return metadataHelper;
+    }
 
     itkExceptionMacro("Unable to read metadata from " << metadataFileName);
 
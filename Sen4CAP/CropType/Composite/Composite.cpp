@@ -43,7 +43,11 @@
 #include "otbImageListToImageFilter.h"
 
 #include "otbImageToGenericRSOutputParameters.h"
-#include "otbGenericRSResampleImageFilter.h"
+#include "otbGenericRSTransform.h"
+#include "otbStreamingWarpImageFilter.h"
+#include "itkTransformToDisplacementFieldFilter.h"
+#include "otbMetaDataKey.h"
+#include "itkMetaDataObject.h"
 
 #include "itkLinearInterpolateImageFunction.h"
 #include "otbBCOInterpolateImageFunction.h"
@@ -53,6 +57,16 @@
 
 #include "otbGeographicalDistance.h"
 
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#include <unistd.h>
+
 namespace otb
 {
 
@@ -229,6 +243,54 @@ CompositeFilter<TInputImageType, TOutputImageType>
   Superclass::PrintSelf(os, indent);
 }
 
+/** \class GridWarpImageFilter
+ *  \brief A StreamingWarpImageFilter whose output is in another map projection.
+ *
+ *  The displacement field maps the output grid to the input physical space, like
+ *  the one of GenericRSResampleImageFilter. The output keeps the projection of
+ *  the displacement field instead of the one of the input image.
+ */
+template <class TInputImage, class TOutputImage, class TDisplacementField>
+class ITK_EXPORT GridWarpImageFilter
+  : public StreamingWarpImageFilter<TInputImage, TOutputImage, TDisplacementField>
+{
+public:
+  /** Standard typedefs */
+  typedef GridWarpImageFilter                       Self;
+  typedef StreamingWarpImageFilter
+      <TInputImage, TOutputImage, TDisplacementField> Superclass;
+  typedef itk::SmartPointer<Self>                   Pointer;
+  typedef itk::SmartPointer<const Self>             ConstPointer;
+
+  /** Type macro */
+  itkNewMacro(Self);
+
+  /** Creation through object factory macro */
+  itkTypeMacro(GridWarpImageFilter, StreamingWarpImageFilter);
+
+  itkSetStringMacro(OutputProjectionRef);
+  itkGetStringMacro(OutputProjectionRef);
+
+protected:
+  GridWarpImageFilter() {}
+  ~GridWarpImageFilter() override {}
+
+  void GenerateOutputInformation() override
+  {
+    Superclass::GenerateOutputInformation();
+
+    itk::MetaDataDictionary &dict = this->GetOutput()->GetMetaDataDictionary();
+    itk::EncapsulateMetaData<std::string>(dict, MetaDataKey::ProjectionRefKey, m_OutputProjectionRef);
+    itk::EncapsulateMetaData<ImageKeywordlist>(dict, MetaDataKey::OSSIMKeywordlistKey, ImageKeywordlist());
+  }
+
+private:
+  GridWarpImageFilter(const Self &) = delete;
+  void operator =(const Self&) = delete;
+
+  std::string m_OutputProjectionRef;
+};
+
 enum
 {
   Interpolator_BCO,
@@ -263,9 +325,15 @@ public:
     typedef otb::ObjectList<ExtractROIFilterType>                         ExtractROIListType;
     typedef otb::CompositeFilter
                 <InputImageType, OutputImageType>                         CompositeFilterType;
-    /** Generic Remote Sensor Resampler */
-    typedef otb::GenericRSResampleImageFilter<InputImageType,
-                                              InputImageType>             ResampleFilterType;
+    /** Generic Remote Sensor Resampler, through a deformation grid */
+    typedef itk::Vector<double, 2>                                        DisplacementType;
+    typedef otb::Image<DisplacementType>                                  DisplacementFieldType;
+    typedef otb::GenericRSTransform<double, 2, 2>                         TransformType;
+    typedef itk::TransformToDisplacementFieldFilter
+                <DisplacementFieldType, double>                           DisplacementFieldGeneratorType;
+    typedef otb::GridWarpImageFilter<InputImageType,
+                                     InputImageType,
+                                     DisplacementFieldType>               ResampleFilterType;
 
     /** Interpolators typedefs*/
     typedef itk::LinearInterpolateImageFunction<InputImageType,
@@ -398,6 +466,13 @@ private:
                                 "but increasing this parameter will reduce processing time.");
         MandatoryOff("opt.gridspacing");
 
+        AddParameter(ParameterType_Directory, "opt.gridcache", "Deformation grid cache");
+        SetParameterDescription("opt.gridcache",
+                                "Directory keeping the coarse deformation grids, reused by the next runs with "
+                                "the same input projection and output grid. The grids larger than a quarter "
+                                "of the available RAM are streamed and never cached.");
+        MandatoryOff("opt.gridcache");
+
         AddRAMParameter();
 
         SetDocExampleParameterValue("il", "image1.tif image2.tif");
@@ -434,9 +509,9 @@ private:
 
         auto inOrtho = GetParameterImage("ref");
 
-        ResampleFilterType::OriginType orig = inOrtho->GetOrigin();
-        ResampleFilterType::SpacingType spacing = inOrtho->GetSpacing();
-        ResampleFilterType::SizeType size = inOrtho->GetLargestPossibleRegion().GetSize();
+        InputImageType::PointType orig = inOrtho->GetOrigin();
+        InputImageType::SpacingType spacing = inOrtho->GetSpacing();
+        InputImageType::SizeType size = inOrtho->GetLargestPossibleRegion().GetSize();
         m_OutputProjectionRef = inOrtho->GetProjectionRef();
 
         SetParameterInt("outputs.sizex",size[0]);
@@ -507,6 +582,9 @@ private:
 
         m_ReprojectedImages = ImageListType::New();
         m_Readers = ReaderListType::New();
+        m_DisplacementFields.clear();
+        m_DisplacementFieldGenerators.clear();
+        m_CachedGridBytes = 0;
 
         auto first = true;
         for (const auto &file : inImages)
@@ -549,8 +627,6 @@ private:
             resampleFilter->SetInput(inImage);
 
             // Set the output projection Ref
-            resampleFilter->SetInputProjectionRef(inImage->GetProjectionRef());
-            resampleFilter->SetInputKeywordList(inImage->GetImageKeywordlist());
             resampleFilter->SetOutputProjectionRef(m_OutputProjectionRef);
 
             // Check size
@@ -602,17 +678,17 @@ private:
               }
 
             // Set Output information
-            ResampleFilterType::SizeType size;
+            InputImageType::SizeType size;
             size[0] = GetParameterInt("outputs.sizex");
             size[1] = GetParameterInt("outputs.sizey");
             resampleFilter->SetOutputSize(size);
 
-            ResampleFilterType::SpacingType spacing;
+            InputImageType::SpacingType spacing;
             spacing[0] = GetParameterFloat("outputs.spacingx");
             spacing[1] = GetParameterFloat("outputs.spacingy");
             resampleFilter->SetOutputSpacing(spacing);
 
-            ResampleFilterType::OriginType origin;
+            InputImageType::PointType origin;
             origin[0] = GetParameterFloat("outputs.ulx") + 0.5 * GetParameterFloat("outputs.spacingx");
             origin[1] = GetParameterFloat("outputs.uly") + 0.5 * GetParameterFloat("outputs.spacingy");
             resampleFilter->SetOutputOrigin(origin);
@@ -630,7 +706,7 @@ private:
               }
 
             // Displacement Field spacing
-            ResampleFilterType::SpacingType gridSpacing;
+            InputImageType::SpacingType gridSpacing;
             if (IsParameterEnabled("opt.gridspacing"))
               {
               gridSpacing[0] = GetParameterFloat("opt.gridspacing");
@@ -642,10 +718,10 @@ private:
                 }
 
               // Predict size of deformation grid
-              ResampleFilterType::SpacingType deformationGridSize;
-              deformationGridSize[0] = static_cast<ResampleFilterType::SpacingType::ValueType >(std::abs(
+              InputImageType::SpacingType deformationGridSize;
+              deformationGridSize[0] = static_cast<InputImageType::SpacingType::ValueType >(std::abs(
                   GetParameterInt("outputs.sizex") * GetParameterFloat("outputs.spacingx") / GetParameterFloat("opt.gridspacing") ));
-              deformationGridSize[1] = static_cast<ResampleFilterType::SpacingType::ValueType>(std::abs(
+              deformationGridSize[1] = static_cast<InputImageType::SpacingType::ValueType>(std::abs(
                   GetParameterInt("outputs.sizey") * GetParameterFloat("outputs.spacingy") / GetParameterFloat("opt.gridspacing") ));
               if (first)
                 {
@@ -670,9 +746,15 @@ private:
                     "opt.gridspacing units are the same as outputs.spacing units");
                 }
 
-              resampleFilter->SetDisplacementFieldSpacing(gridSpacing);
-              m_ReprojectedImages->PushBack(resampleFilter->GetOutput());
               }
+            else
+              {
+              // the grid has the resolution of the output
+              gridSpacing = spacing;
+              }
+
+            resampleFilter->SetDisplacementField(GetDisplacementField(inImage, origin, spacing, size, gridSpacing));
+            m_ReprojectedImages->PushBack(resampleFilter->GetOutput());
           first = false;
         }
 
@@ -822,9 +904,207 @@ private:
 //        SetParameterOutputImage("out", resampleFilter->GetOutput());
     }
 
+    /** Returns the deformation grid mapping the output grid to the input image projection.
+     *  The grid only depends on the input geometry and on the output grid, so it is shared by all
+     *  the acquisitions with the same geometry. The coarse grids are computed once, kept in memory
+     *  within a quarter of the available RAM and read from opt.gridcache when a previous run left
+     *  them there. The other ones stay in the pipeline and are streamed with the resampling. */
+    DisplacementFieldType::Pointer GetDisplacementField(const InputImageType *inImage,
+                                                        const InputImageType::PointType &origin,
+                                                        const InputImageType::SpacingType &spacing,
+                                                        const InputImageType::SizeType &size,
+                                                        const InputImageType::SpacingType &gridSpacing)
+    {
+        // + 1 because the warp needs the next grid node to interpolate the displacement of the last pixels
+        DisplacementFieldType::SizeType gridSize;
+        for (unsigned int dim = 0; dim < 2; dim++)
+          {
+          gridSize[dim] = static_cast<DisplacementFieldType::SizeValueType>(
+              std::ceil(size[dim] * std::abs(spacing[dim] / gridSpacing[dim]))) + 1;
+          }
+
+        // the keyword list only matters for the inputs in sensor geometry,
+        // the map projected ones share their grid with all the dates in the same projection
+        const bool sensorGeometry = inImage->GetProjectionRef().empty();
+        std::ostringstream key;
+        key.precision(17);
+        key << inImage->GetProjectionRef() << '\n';
+        if (sensorGeometry)
+          {
+          const auto keywordList = inImage->GetImageKeywordlist();
+          for (const auto &entry : keywordList.GetKeywordlist())
+            {
+            key << entry.first << '=' << entry.second << '\n';
+            }
+          }
+        key << m_OutputProjectionRef << '\n'
+            << origin[0] << ' ' << origin[1] << ' '
+            << gridSpacing[0] << ' ' << gridSpacing[1] << ' '
+            << gridSize[0] << ' ' << gridSize[1];
+
+        auto it = m_DisplacementFields.find(key.str());
+        if (it != m_DisplacementFields.end())
+          {
+          return it->second;
+          }
+
+        auto itGenerator = m_DisplacementFieldGenerators.find(key.str());
+        if (itGenerator != m_DisplacementFieldGenerators.end())
+          {
+          return itGenerator->second->GetOutput();
+          }
+
+        auto transform = TransformType::New();
+        transform->SetInputProjectionRef(m_OutputProjectionRef);
+        transform->SetOutputProjectionRef(inImage->GetProjectionRef());
+        if (sensorGeometry)
+          {
+          transform->SetOutputKeywordList(inImage->GetImageKeywordlist());
+          }
+        transform->InstantiateTransform();
+
+        auto generator = DisplacementFieldGeneratorType::New();
+        generator->SetTransform(transform);
+        generator->SetOutputOrigin(origin);
+        generator->SetOutputSpacing(gridSpacing);
+        generator->SetSize(gridSize);
+
+        const uint64_t gridBytes = static_cast<uint64_t>(gridSize[0]) * gridSize[1] * sizeof(DisplacementType);
+        const uint64_t maxCachedBytes = static_cast<uint64_t>(GetParameterInt("ram")) * 1024 * 1024 / 4;
+        if (m_CachedGridBytes + gridBytes > maxCachedBytes)
+          {
+          otbAppLogINFO("The deformation grid of " << gridSize[0] << "x" << gridSize[1]
+                        << " nodes is too large to be cached, it is streamed");
+          m_DisplacementFieldGenerators.emplace(key.str(), generator);
+          return generator->GetOutput();
+          }
+
+        std::string fileName;
+        if (HasValue("opt.gridcache"))
+          {
+          // FNV-1a
+          uint64_t hash = 14695981039346656037ULL;
+          for (unsigned char c : key.str())
+            {
+            hash = (hash ^ c) * 1099511628211ULL;
+            }
+          char name[32];
+          std::snprintf(name, sizeof(name), "%016llx.grid", static_cast<unsigned long long>(hash));
+          fileName = GetParameterString("opt.gridcache") + "/" + name;
+          }
+
+        DisplacementFieldType::Pointer field;
+        if (!fileName.empty())
+          {
+          field = ReadDisplacementField(fileName, key.str(), origin, gridSpacing, gridSize);
+          if (field)
+            {
+            otbAppLogINFO("Read the deformation grid " << fileName);
+            }
+          }
+
+        if (!field)
+          {
+          generator->Update();
+
+          field = generator->GetOutput();
+          field->DisconnectPipeline();
+
+          if (!fileName.empty())
+            {
+            if (WriteDisplacementField(fileName, key.str(), field))
+              {
+              otbAppLogINFO("Wrote the deformation grid " << fileName);
+              }
+            else
+              {
+              otbAppLogWARNING("Unable to write the deformation grid " << fileName);
+              }
+            }
+          }
+
+        m_CachedGridBytes += gridBytes;
+        m_DisplacementFields.emplace(key.str(), field);
+        return field;
+    }
+
+    static const char * GetGridMagic() { return "S2AGRID1"; }
+
+    /** Reads a grid written by WriteDisplacementField, returns NULL if it is missing or was built for another key */
+    static DisplacementFieldType::Pointer ReadDisplacementField(const std::string &fileName,
+                                                                const std::string &key,
+                                                                const InputImageType::PointType &origin,
+                                                                const InputImageType::SpacingType &gridSpacing,
+                                                                const DisplacementFieldType::SizeType &gridSize)
+    {
+        std::ifstream in(fileName.c_str(), std::ios::binary);
+        char magic[8];
+        uint64_t keyLength = 0;
+        if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, GetGridMagic(), sizeof(magic)) != 0 ||
+            !in.read(reinterpret_cast<char *>(&keyLength), sizeof(keyLength)) || keyLength != key.size())
+          {
+          return DisplacementFieldType::Pointer();
+          }
+        std::string fileKey(keyLength, '\0');
+        if (!in.read(&fileKey[0], keyLength) || fileKey != key)
+          {
+          return DisplacementFieldType::Pointer();
+          }
+
+        DisplacementFieldType::RegionType region;
+        region.SetSize(gridSize);
+        auto field = DisplacementFieldType::New();
+        field->SetRegions(region);
+        field->SetOrigin(origin);
+        field->SetSpacing(gridSpacing);
+        field->Allocate();
+
+        const auto bytes = region.GetNumberOfPixels() * sizeof(DisplacementType);
+        if (!in.read(reinterpret_cast<char *>(field->GetBufferPointer()), bytes))
+          {
+          return DisplacementFieldType::Pointer();
+          }
+        return field;
+    }
+
+    /** Writes a grid with its key, through a temporary file so that concurrent runs never read a partial one */
+    static bool WriteDisplacementField(const std::string &fileName,
+                                       const std::string &key,
+                                       const DisplacementFieldType *field)
+    {
+        std::ostringstream tempFileName;
+        tempFileName << fileName << '.' << getpid() << ".tmp";
+
+        const uint64_t keyLength = key.size();
+        const auto bytes = field->GetBufferedRegion().GetNumberOfPixels() * sizeof(DisplacementType);
+        {
+            std::ofstream out(tempFileName.str().c_str(), std::ios::binary | std::ios::trunc);
+            out.write(GetGridMagic(), 8);
+            out.write(reinterpret_cast<const char *>(&keyLength), sizeof(keyLength));
+            out.write(key.data(), keyLength);
+            out.write(reinterpret_cast<const char *>(field->GetBufferPointer()), bytes);
+            if (!out.flush())
+              {
+              std::remove(tempFileName.str().c_str());
+              return false;
+              }
+        }
+        if (std::rename(tempFileName.str().c_str(), fileName.c_str()) != 0)
+          {
+          std::remove(tempFileName.str().c_str());
+          return false;
+          }
+        return true;
+    }
+
     ReaderListType::Pointer                      m_Readers;
     ExtractROIListType::Pointer                  m_ExtractROIFilters;
     std::vector<ResampleFilterType::Pointer>     m_ResampleFilters;
+    std::map<std::string,
+             DisplacementFieldType::Pointer>     m_DisplacementFields;
+    std::map<std::string,
+             DisplacementFieldGeneratorType::Pointer> m_DisplacementFieldGenerators;
+    uint64_t                                     m_CachedGridBytes;
     ImageListType::Pointer                       m_ReprojectedImages;
     CompositeFilterType::Pointer                 m_CompositeFilter;
     std::string                                  m_OutputProjectionRef;
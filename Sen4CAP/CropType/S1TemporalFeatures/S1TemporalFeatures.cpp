@@ -0,0 +1,596 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+
+#include "otbWrapperApplication.h"
+#include "otbWrapperApplicationFactory.h"
+
+#include "otbWrapperTypes.h"
+#include "otbObjectList.h"
+#include "otbVectorImage.h"
+#include "otbImageList.h"
+#include "otbImageListToImageFilter.h"
+
+#include "itkProgressReporter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <vector>
+
+namespace otb
+{
+
+/** \class S1TemporalFeaturesFilter
+ *  \brief Computes the temporal features of a S1 series in a single pass over the acquisitions.
+ *
+ *  Each input is an acquisition, assigned to a period (a week or a month). The
+ *  enabled features are written one after the other in the output bands:
+ *  - the mean of each period, as computed by Composite (one band per period);
+ *  - the standard deviation of the period means, as computed by StandardDeviation;
+ *  - the mean and coefficient of variation of all the acquisitions, as computed by BackscatterTemporalFeatures;
+ *  - the mean and 10% quantile of each period, as computed by CoherenceMonthlyFeatures (two bands per period).
+ *
+ *  The acquisitions are accumulated one image line at a time, in arrays indexed
+ *  by column, so that each input block is read once and the masking of the no
+ *  data and NaN values does not branch.
+ */
+template <class TInputImageType, class TOutputImageType>
+class ITK_EXPORT S1TemporalFeaturesFilter
+  : public ImageListToImageFilter<TInputImageType, TOutputImageType>
+{
+public:
+  /** Standard typedefs */
+  typedef S1TemporalFeaturesFilter                  Self;
+  typedef ImageListToImageFilter
+      <TInputImageType, TOutputImageType>           Superclass;
+  typedef itk::SmartPointer<Self>                   Pointer;
+  typedef itk::SmartPointer<const Self>             ConstPointer;
+
+  typedef TInputImageType                               InputImageType;
+  typedef typename InputImageType::Pointer              InputImagePointerType;
+  typedef typename InputImageType::PixelType            InputPixelType;
+  typedef ImageList<InputImageType>                     InputImageListType;
+  typedef TOutputImageType                              OutputImageType;
+  typedef typename OutputImageType::PixelType           OutputPixelType;
+  typedef typename OutputImageType::InternalPixelType   OutputInternalPixelType;
+  typedef typename OutputImageType::Pointer             OutputImagePointerType;
+  typedef double                                        PrecisionType;
+
+  typedef typename OutputImageType::RegionType OutputImageRegionType;
+  typedef typename InputImageType::RegionType  InputImageRegionType;
+
+
+  /** Type macro */
+  itkNewMacro(Self);
+
+  /** Creation through object factory macro */
+  itkTypeMacro(S1TemporalFeaturesFilter, ImageListToImageFilter);
+
+  itkGetMacro(NoDataValue, InputPixelType);
+  itkSetMacro(NoDataValue, InputPixelType);
+  itkGetMacro(UseNoDataValue, bool);
+  itkSetMacro(UseNoDataValue, bool);
+  itkBooleanMacro(UseNoDataValue);
+
+  itkGetMacro(ComputeComposite, bool);
+  itkSetMacro(ComputeComposite, bool);
+  itkBooleanMacro(ComputeComposite);
+  itkGetMacro(ComputeStandardDeviation, bool);
+  itkSetMacro(ComputeStandardDeviation, bool);
+  itkBooleanMacro(ComputeStandardDeviation);
+  itkGetMacro(ComputeTemporal, bool);
+  itkSetMacro(ComputeTemporal, bool);
+  itkBooleanMacro(ComputeTemporal);
+  itkGetMacro(ComputeCoherence, bool);
+  itkSetMacro(ComputeCoherence, bool);
+  itkBooleanMacro(ComputeCoherence);
+
+  /** The period of each input, numbered from 0 */
+  void SetPeriods(const std::vector<unsigned int> &periods)
+  {
+    m_Periods = periods;
+    m_PeriodCount = periods.empty() ? 0 : *std::max_element(periods.begin(), periods.end()) + 1;
+    this->Modified();
+  }
+
+  unsigned int GetPeriodCount() const
+  {
+    return m_PeriodCount;
+  }
+
+protected:
+  S1TemporalFeaturesFilter();
+  ~S1TemporalFeaturesFilter() override {}
+
+  void GenerateInputRequestedRegion() override;
+  void GenerateOutputInformation() override;
+  void ThreadedGenerateData(const OutputImageRegionType &outputRegionForThread, itk::ThreadIdType threadId) override;
+
+  /**PrintSelf method */
+  void PrintSelf(std::ostream& os, itk::Indent indent) const override;
+
+
+private:
+  S1TemporalFeaturesFilter(const Self &) = delete;
+  void operator =(const Self&) = delete;
+
+  static float Quantile(size_t k, size_t q, float *values, size_t n);
+
+  InputPixelType             m_NoDataValue;
+  bool                       m_UseNoDataValue;
+  bool                       m_ComputeComposite;
+  bool                       m_ComputeStandardDeviation;
+  bool                       m_ComputeTemporal;
+  bool                       m_ComputeCoherence;
+  std::vector<unsigned int>  m_Periods;
+  unsigned int               m_PeriodCount;
+};
+
+template <class TInputImageType, class TOutputImageType>
+S1TemporalFeaturesFilter<TInputImageType, TOutputImageType>
+::S1TemporalFeaturesFilter()
+ : m_NoDataValue(),
+   m_UseNoDataValue(),
+   m_ComputeComposite(),
+   m_ComputeStandardDeviation(),
+   m_ComputeTemporal(),
+   m_ComputeCoherence(),
+   m_PeriodCount()
+{
+  this->SetNumberOfRequiredInputs(1);
+  this->SetNumberOfRequiredOutputs(1);
+}
+
+template <class TInputImageType, class TOutputImageType>
+void
+S1TemporalFeaturesFilter<TInputImageType, TOutputImageType>
+::GenerateInputRequestedRegion(void)
+{
+  auto inputPtr = this->GetInput();
+  for (auto inputListIt = inputPtr->Begin(); inputListIt != inputPtr->End(); ++inputListIt)
+    {
+    inputListIt.Get()->SetRequestedRegion(this->GetOutput()->GetRequestedRegion());
+    }
+}
+
+template <class TInputImageType, class TOutputImageType>
+void
+S1TemporalFeaturesFilter<TInputImageType, TOutputImageType>
+::GenerateOutputInformation()
+{
+  if (m_Periods.size() != this->GetInput()->Size())
+    {
+    itkExceptionMacro("The number of periods (" << m_Periods.size() << ") does not match the number of inputs ("
+                      << this->GetInput()->Size() << ")");
+    }
+
+  unsigned int bands = 0;
+  if (m_ComputeComposite)
+    {
+    bands += m_PeriodCount;
+    }
+  if (m_ComputeStandardDeviation)
+    {
+    bands += 1;
+    }
+  if (m_ComputeTemporal)
+    {
+    bands += 2;
+    }
+  if (m_ComputeCoherence)
+    {
+    bands += 2 * m_PeriodCount;
+    }
+  if (bands == 0)
+    {
+    itkExceptionMacro("No feature to compute");
+    }
+
+  if (this->GetOutput())
+    {
+    if (this->GetInput()->Size() > 0)
+      {
+      this->GetOutput()->CopyInformation(this->GetInput()->GetNthElement(0));
+      this->GetOutput()->SetLargestPossibleRegion(this->GetInput()->GetNthElement(0)->GetLargestPossibleRegion());
+      this->GetOutput()->SetNumberOfComponentsPerPixel(bands);
+      }
+    }
+}
+
+template <class TInputImageType, class TOutputImageType>
+float
+S1TemporalFeaturesFilter<TInputImageType, TOutputImageType>
+::Quantile(size_t k, size_t q, float *values, size_t n)
+{
+    auto p = static_cast<float>(k) / q;
+
+    // https://en.wikipedia.org/wiki/Quantile#Estimating_quantiles_from_a_sample
+    // R-4
+    auto h = n * p;
+    auto hl = static_cast<size_t>(h);
+    if (p < 1.0f / n) {
+        return *std::min_element(values, values + n);
+    }
+    if (p >= 1 || hl + 1 == n) {
+        return *std::max_element(values, values + n);
+    }
+    std::sort(values, values + n);
+    if (h == hl) {
+        return values[hl - 1];
+    }
+    return values[hl - 1] + (h - hl) * (values[hl] - values[hl - 1]);
+}
+
+template <class TInputImageType, class TOutputImageType>
+void
+S1TemporalFeaturesFilter<TInputImageType, TOutputImageType>
+::ThreadedGenerateData(const OutputImageRegionType &outputRegionForThread, itk::ThreadIdType threadId)
+{
+  auto inputPtr = this->GetInput();
+  const auto inputImages = inputPtr->Size();
+
+  OutputImagePointerType  outputPtr = this->GetOutput();
+  const auto bands = outputPtr->GetNumberOfComponentsPerPixel();
+
+  const auto width = outputRegionForThread.GetSize()[0];
+  const auto height = outputRegionForThread.GetSize()[1];
+
+  itk::ProgressReporter progress(this, threadId, height);
+
+  const InputPixelType noData = m_NoDataValue;
+  const bool useNoData = m_UseNoDataValue;
+  const PrecisionType zero = m_UseNoDataValue ? m_NoDataValue : 0;
+
+  // the acquisitions of each period, for the quantiles
+  std::vector<size_t> periodSizes(m_PeriodCount);
+  for (auto period : m_Periods)
+    {
+    periodSizes[period]++;
+    }
+  std::vector<size_t> valueOffsets(m_PeriodCount);
+  size_t valueCount = 0;
+  for (unsigned int p = 0; p < m_PeriodCount; p++)
+    {
+    valueOffsets[p] = valueCount;
+    valueCount += periodSizes[p] * width;
+    }
+
+  // the accumulators of a line, indexed by [period * width + column] or by column
+  std::vector<PrecisionType> periodSum(m_PeriodCount * width);
+  std::vector<unsigned int> periodCount(m_PeriodCount * width);
+  std::vector<PrecisionType> totalSum(width);
+  std::vector<PrecisionType> totalSqSum(width);
+  std::vector<unsigned int> totalCount(width);
+  std::vector<float> values(m_ComputeCoherence ? valueCount : 0);
+
+  auto index = outputRegionForThread.GetIndex();
+  for (size_t y = 0; y < height; y++, index[1]++)
+    {
+    std::fill(periodSum.begin(), periodSum.end(), 0);
+    std::fill(periodCount.begin(), periodCount.end(), 0);
+    std::fill(totalSum.begin(), totalSum.end(), 0);
+    std::fill(totalSqSum.begin(), totalSqSum.end(), 0);
+    std::fill(totalCount.begin(), totalCount.end(), 0);
+
+    for (size_t i = 0; i < inputImages; i++)
+      {
+      const InputImageType *image = inputPtr->GetNthElement(i);
+      const InputPixelType *in = image->GetBufferPointer() + image->ComputeOffset(index);
+
+      const auto period = m_Periods[i];
+      PrecisionType *sum = &periodSum[period * width];
+      unsigned int *count = &periodCount[period * width];
+      for (size_t x = 0; x < width; x++)
+        {
+        const InputPixelType v = in[x];
+        const bool valid = v == v && (!useNoData || v != noData);
+        sum[x] += valid ? v : 0;
+        count[x] += valid;
+        }
+
+      if (m_ComputeTemporal)
+        {
+        PrecisionType *tsum = &totalSum[0];
+        PrecisionType *tsqSum = &totalSqSum[0];
+        unsigned int *tcount = &totalCount[0];
+        for (size_t x = 0; x < width; x++)
+          {
+          const InputPixelType v = in[x];
+          const bool valid = v == v && (!useNoData || v != noData);
+          const PrecisionType value = valid ? v : 0;
+          tsum[x] += value;
+          tsqSum[x] += value * value;
+          tcount[x] += valid;
+          }
+        }
+
+      if (m_ComputeCoherence)
+        {
+        // the valid values are packed at the start of the slots of each pixel,
+        // an invalid one is overwritten by the next value of the period
+        const size_t size = periodSizes[period];
+        float *slots = &values[valueOffsets[period]];
+        for (size_t x = 0; x < width; x++)
+          {
+          slots[x * size + count[x] - (in[x] == in[x] && (!useNoData || in[x] != noData))] = in[x];
+          }
+        }
+      }
+
+    OutputInternalPixelType *out = outputPtr->GetBufferPointer() + outputPtr->ComputeOffset(index) * bands;
+    for (size_t x = 0; x < width; x++, out += bands)
+      {
+      unsigned int band = 0;
+
+      if (m_ComputeComposite)
+        {
+        for (unsigned int p = 0; p < m_PeriodCount; p++)
+          {
+          const auto count = periodCount[p * width + x];
+          out[band++] = count > 0 ? static_cast<OutputInternalPixelType>(periodSum[p * width + x] / count) : 0;
+          }
+        }
+
+      if (m_ComputeStandardDeviation)
+        {
+        // over the period means, the empty periods are skipped like the missing composites
+        PrecisionType sum = 0;
+        PrecisionType sqSum = 0;
+        int count = 0;
+        for (unsigned int p = 0; p < m_PeriodCount; p++)
+          {
+          const auto periodPixels = periodCount[p * width + x];
+          if (periodPixels > 0)
+            {
+            const PrecisionType mean = static_cast<float>(periodSum[p * width + x] / periodPixels);
+            sum += mean;
+            sqSum += mean * mean;
+            count++;
+            }
+          }
+        PrecisionType dev;
+        if (count > 1)
+          {
+          auto mean = sum / count;
+          dev = std::sqrt((sqSum - sum * mean) / (count - 1));
+          }
+        else
+          {
+          dev = zero;
+          }
+        out[band++] = static_cast<OutputInternalPixelType>(dev);
+        }
+
+      if (m_ComputeTemporal)
+        {
+        const PrecisionType sum = totalSum[x];
+        const auto count = totalCount[x];
+        PrecisionType mean;
+        PrecisionType cvar;
+        if (count > 0 && sum > 0)
+          {
+          mean = sum / count;
+          if (count > 1)
+            {
+            auto dev = std::sqrt((totalSqSum[x] - sum * mean) / (count - 1));
+            cvar = dev / mean;
+            }
+          else
+            {
+            cvar = zero;
+            }
+          }
+        else
+          {
+          mean = zero;
+          cvar = zero;
+          }
+        out[band++] = static_cast<OutputInternalPixelType>(mean);
+        out[band++] = static_cast<OutputInternalPixelType>(cvar);
+        }
+
+      if (m_ComputeCoherence)
+        {
+        for (unsigned int p = 0; p < m_PeriodCount; p++)
+          {
+          const auto count = periodCount[p * width + x];
+          if (count > 0)
+            {
+            out[band++] = static_cast<OutputInternalPixelType>(periodSum[p * width + x] / count);
+            out[band++] = Quantile(1, 10, &values[valueOffsets[p] + x * periodSizes[p]], count);
+            }
+          else
+            {
+            out[band++] = static_cast<OutputInternalPixelType>(zero);
+            out[band++] = static_cast<OutputInternalPixelType>(zero);
+            }
+          }
+        }
+      }
+
+    progress.CompletedPixel();
+    }
+}
+
+/**
+ * PrintSelf Method
+ */
+template <class TInputImageType, class TOutputImageType>
+void
+S1TemporalFeaturesFilter<TInputImageType, TOutputImageType>
+::PrintSelf(std::ostream& os, itk::Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+}
+
+namespace Wrapper
+{
+class S1TemporalFeatures : public Application
+{
+public:
+    typedef S1TemporalFeatures Self;
+    typedef Application Superclass;
+    typedef itk::SmartPointer<Self> Pointer;
+    typedef itk::SmartPointer<const Self> ConstPointer;
+
+    itkNewMacro(Self);
+    itkTypeMacro(S1TemporalFeatures, otb::Application);
+
+    typedef FloatImageType                                   InputImageType;
+    typedef FloatVectorImageType                             OutputImageType;
+    typedef otb::ImageList<FloatImageType>                   ImageListType;
+    typedef otb::ImageFileReader<InputImageType>             ReaderType;
+    typedef otb::ObjectList<ReaderType>                      ReaderListType;
+    typedef otb::S1TemporalFeaturesFilter
+                <InputImageType, OutputImageType>            S1TemporalFeaturesFilterType;
+
+private:
+    void DoInit() override
+    {
+        SetName("S1TemporalFeatures");
+        SetDescription("Computes the temporal features of a S1 series in a single pass");
+
+        SetDocName("S1 Temporal Features");
+        SetDocLongDescription("Computes the period composites, their standard deviation, the backscatter temporal "
+                              "features and the coherence period features of a S1 series, reading each acquisition once. "
+                              "The inputs must be on the same grid. The enabled features are written in this order: "
+                              "one band per period with the mean of its acquisitions (as Composite), "
+                              "the standard deviation of the period means (as StandardDeviation), "
+                              "the mean and coefficient of variation of all the acquisitions (as BackscatterTemporalFeatures), "
+                              "then the mean and 10% quantile of each period (as CoherenceMonthlyFeatures).");
+        SetDocLimitations("The VV/VH ratio mode of BackscatterTemporalFeatures is not supported.");
+        SetDocAuthors("LN");
+        SetDocSeeAlso("Composite, StandardDeviation, BackscatterTemporalFeatures, CoherenceMonthlyFeatures");
+
+        AddDocTag(Tags::Raster);
+
+        AddParameter(ParameterType_InputFilenameList, "il", "Input images");
+        SetParameterDescription("il", "The list of input images");
+
+        AddParameter(ParameterType_StringList, "periods", "Periods");
+        SetParameterDescription("periods", "The period (week or month) of each input image. "
+                                           "The periods are numbered in the order of their first image. "
+                                           "All the images are in the same period by default.");
+        MandatoryOff("periods");
+
+        AddParameter(ParameterType_Float, "bv", "Background value");
+        SetParameterDescription("bv", "Background value to ignore in computation.");
+        SetDefaultParameterFloat("bv", 0.);
+        MandatoryOff("bv");
+
+        AddParameter(ParameterType_Bool, "composite", "Period composites");
+        SetParameterDescription("composite", "Output the mean of each period.");
+        MandatoryOff("composite");
+
+        AddParameter(ParameterType_Bool, "stddev", "Standard deviation");
+        SetParameterDescription("stddev", "Output the standard deviation of the period means.");
+        MandatoryOff("stddev");
+
+        AddParameter(ParameterType_Bool, "temporal", "Backscatter temporal features");
+        SetParameterDescription("temporal", "Output the mean and coefficient of variation of all the images.");
+        MandatoryOff("temporal");
+
+        AddParameter(ParameterType_Bool, "coherence", "Coherence period features");
+        SetParameterDescription("coherence", "Output the mean and 10% quantile of each period.");
+        MandatoryOff("coherence");
+
+        AddParameter(ParameterType_OutputImage, "out", "Output image");
+        SetParameterDescription("out", "Output image.");
+
+        AddRAMParameter();
+
+        SetDocExampleParameterValue("il", "image1.tif image2.tif image3.tif");
+        SetDocExampleParameterValue("periods", "2019-W01 2019-W01 2019-W02");
+        SetDocExampleParameterValue("composite", "1");
+        SetDocExampleParameterValue("stddev", "1");
+        SetDocExampleParameterValue("out", "output.tif");
+    }
+
+    void DoUpdateParameters() override
+    {
+    }
+
+    void DoExecute() override
+    {
+        const auto &inImages = GetParameterStringList("il");
+
+        std::vector<unsigned int> periods;
+        if (HasValue("periods"))
+        {
+            const auto &periodNames = GetParameterStringList("periods");
+            if (periodNames.size() != inImages.size())
+            {
+                otbAppLogFATAL("The number of periods (" << periodNames.size()
+                               << ") does not match the number of input images (" << inImages.size() << ")");
+            }
+
+            std::map<std::string, unsigned int> periodIndices;
+            for (const auto &name : periodNames)
+            {
+                auto it = periodIndices.emplace(name, periodIndices.size()).first;
+                periods.emplace_back(it->second);
+            }
+            otbAppLogINFO("Number of periods: " << periodIndices.size());
+        }
+        else
+        {
+            periods.resize(inImages.size());
+        }
+
+        m_ImageList = ImageListType::New();
+        m_Readers = ReaderListType::New();
+
+        for (const auto &file : inImages)
+        {
+            auto reader = ReaderType::New();
+            reader->SetFileName(file);
+            reader->UpdateOutputInformation();
+            m_Readers->PushBack(reader);
+
+            m_ImageList->PushBack(reader->GetOutput());
+        }
+
+        m_S1TemporalFeaturesFilter = S1TemporalFeaturesFilterType::New();
+        m_S1TemporalFeaturesFilter->SetInput(m_ImageList);
+        m_S1TemporalFeaturesFilter->SetPeriods(periods);
+        m_S1TemporalFeaturesFilter->SetComputeComposite(IsParameterEnabled("composite"));
+        m_S1TemporalFeaturesFilter->SetComputeStandardDeviation(IsParameterEnabled("stddev"));
+        m_S1TemporalFeaturesFilter->SetComputeTemporal(IsParameterEnabled("temporal"));
+        m_S1TemporalFeaturesFilter->SetComputeCoherence(IsParameterEnabled("coherence"));
+
+        if (!IsParameterEnabled("composite") && !IsParameterEnabled("stddev") &&
+            !IsParameterEnabled("temporal") && !IsParameterEnabled("coherence"))
+        {
+            otbAppLogFATAL("No feature to compute, enable at least one of composite, stddev, temporal or coherence");
+        }
+
+        if (HasValue("bv"))
+        {
+          m_S1TemporalFeaturesFilter->UseNoDataValueOn();
+          m_S1TemporalFeaturesFilter->SetNoDataValue(GetParameterFloat("bv"));
+        }
+
+        // Output Image
+        SetParameterOutputImage("out", m_S1TemporalFeaturesFilter->GetOutput());
+    }
+
+    ImageListType::Pointer                           m_ImageList;
+    ReaderListType::Pointer                          m_Readers;
+    S1TemporalFeaturesFilterType::Pointer            m_S1TemporalFeaturesFilter;
+};
+}
+}
+
+OTB_APPLICATION_EXPORT(otb::Wrapper::S1TemporalFeatures)
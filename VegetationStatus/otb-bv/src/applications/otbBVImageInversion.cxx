@@ -39,6 +39,7 @@
 
 #include "otbMachineLearningModelFactory.h"
 #include "otbNeuralNetworkRegressionMachineLearningModel.h"
+#include "otbDenseMLPImageFilter.h"
 #include "otbSVMMachineLearningModel.h"
 #include "otbRandomForestsMachineLearningModel.h"
 #include "otbMultiLinearRegressionModel.h"
@@ -253,6 +254,11 @@ public:
                                                        FloatVectorImageType,
                                                        FloatVectorImageType,
                                                        FunctorType>;
+  using DenseMLPFilterType = DenseMLPImageFilter<FloatVectorImageType,
+                                                 FloatVectorImageType>;
+  using DenseMLPFloatFilterType = DenseMLPImageFilter<FloatVectorImageType,
+                                                      FloatVectorImageType,
+                                                      float>;
 
 private:
   void DoInit()
@@ -296,6 +302,9 @@ private:
     SetParameterDescription( "normalization", "Input file containing min and max values per sample component. This file can be produced by the invers model learning application. If no file is given as parameter, the variables are not normalized." );
     MandatoryOff("normalization");
 
+    AddParameter(ParameterType_Bool, "fp32", "Evaluate neural network models in single precision");
+    SetParameterDescription("fp32", "Evaluate neural network models in single precision, which is faster but slightly less accurate. Ignored for the other regression models.");
+
   }
 
   virtual ~BVImageInversion()
@@ -412,6 +421,36 @@ private:
         bool bHasMsks = HasValue("msks");
         if(bHasMsks) {
             m_msksImg = GetParameterFloatVectorImage("msks");
+        }
+
+        // neural networks are evaluated on blocks of pixels instead of
+        // going through OpenCV one pixel at a time
+        if(regressor == nn_regressor.GetPointer()) {
+            if(GetParameterInt("fp32")) {
+                DenseMLP<float> mlp;
+                if(nn_regressor->ExportDenseMLP(mlp)) {
+                    applyNormalization(mlp, var_minmax, nbInputVariables);
+                    auto filter = DenseMLPFloatFilterType::New();
+                    filter->SetNetwork(mlp);
+                    SetParameterOutputImage("out", setupDenseMLPFilter(filter.GetPointer(), input_image));
+                    m_DenseMLPFilter = filter;
+                    return;
+                }
+            } else {
+                DenseMLP<double> mlp;
+                if(nn_regressor->ExportDenseMLP(mlp)) {
+                    applyNormalization(mlp, var_minmax, nbInputVariables);
+                    auto filter = DenseMLPFilterType::New();
+                    filter->SetNetwork(mlp);
+                    SetParameterOutputImage("out", setupDenseMLPFilter(filter.GetPointer(), input_image));
+                    m_DenseMLPFilter = filter;
+                    return;
+                }
+            }
+            otbAppLogWARNING("The activation function of the network is not supported for block evaluation, using OpenCV");
+        }
+
+        if(bHasMsks) {
             bv_MaskedFilter = MaskedFilterType::New();
             bv_MaskedFilter->SetFunctor(FunctorType(regressor,var_minmax));
             bv_MaskedFilter->SetInput1(input_image);
@@ -430,6 +469,32 @@ private:
         }
   }
 
+  template <typename TPrecision>
+  void applyNormalization(DenseMLP<TPrecision> &mlp, const NormalizationVectorType &var_minmax,
+                          size_t nbInputVariables) {
+      if(var_minmax == NormalizationVectorType{})
+          return;
+      // same transforms as normalize() and denormalize()
+      const double eps = std::numeric_limits<double>::epsilon();
+      for(size_t var = 0; var < nbInputVariables; ++var) {
+          double range = var_minmax[var].second - var_minmax[var].first + eps;
+          mlp.PrependInputTransform(var, 2.0 / range, -2.0 * var_minmax[var].first / range - 1.0);
+      }
+      double range = var_minmax[nbInputVariables].second - var_minmax[nbInputVariables].first + eps;
+      mlp.AppendOutputTransform(0, 0.5 * range, 0.5 * range + var_minmax[nbInputVariables].first);
+  }
+
+  template <typename TFilter>
+  FloatVectorImageType * setupDenseMLPFilter(TFilter *filter, FloatVectorImageType *input_image) {
+      filter->SetInput(input_image);
+      filter->SetOutputNoDataValue(NO_DATA_VALUE);
+      if(m_msksImg.IsNotNull()) {
+          filter->SetMaskImage(m_msksImg);
+          filter->SetMaskValidValue(IMG_FLG_LAND);
+      }
+      return filter->GetOutput();
+  }
+
   void readFileLines(const std::string &fileName, std::vector<std::string> &outLines) {
       std::ifstream isFile;
       isFile.open(fileName);
@@ -560,6 +625,7 @@ private:
   FilterType::Pointer bv_filter;
   MaskedFilterType::Pointer bv_MaskedFilter;
   FloatVectorImageType::Pointer m_msksImg;
+  itk::ProcessObject::Pointer m_DenseMLPFilter;
 };
 
 }
@@ -41,6 +41,7 @@
 
 #include "otbBVUtil.h"
 #include "otbProSailSimulatorFunctor.h"
+#include "otbProSailSimulationEngine.h"
 #include "MetadataHelperFactory.h"
 #include "CommonFunctions.h"
 
@@ -60,6 +61,8 @@ std::vector<BVType> parse_bv_sample_file(std::ifstream& sample_file)
     BVType prosailBV;
     // Read the variable values
     std::getline(sample_file, line);
+    if(line.find_first_not_of(" \t\r") == std::string::npos)
+      continue;
     std::stringstream ss(line);
     for(auto varName = 0; 
         varName != static_cast<unsigned int>(IVNames::IVNamesEnd);
@@ -94,6 +97,7 @@ public:
   typedef otb::SatelliteRSR<PrecisionType, PrecisionType>  SatRSRType;
   typedef Functor::ProSailSimulator<SatRSRType> ProSailType;
   typedef typename ProSailType::OutputType SimulationType;
+  typedef ProSailSimulationEngine<SatRSRType> ProSailEngineType;
   
 private:
   void DoInit()
@@ -163,6 +167,12 @@ private:
     MandatoryOff("threads");
     m_SolarZenith_Fapar = 90;
 
+    AddParameter(ParameterType_Int, "seed",
+                 "Seed of the noise generators");
+    SetParameterDescription("seed",
+                            "Seed of the noise generators. The simulations are reproducible for a given seed, whatever the number of threads. A random seed is used if not set.");
+    MandatoryOff("seed");
+
     AddParameter(ParameterType_InputFilename, "laicfgs",
                  "Master file containing the LAI configuration files for each mission.");
     SetParameterDescription( "laicfgs", "Master file containing the LAI configuration files for each mission." );
@@ -310,11 +320,9 @@ private:
     otbAppLogINFO(""<<ss.str());
 
     bool add_noise =IsParameterEnabled("noisevar");
-    std::vector<std::normal_distribution<>> noise_generators;
-    std::mt19937 RNG;
+    std::vector<double> noise_stddevs;
     if(add_noise)
       {
-      RNG = std::mt19937(std::random_device{}());
       std::vector<std::string> var_str = GetParameterStringList("noisevar");
       if(var_str.size()==1)
         {
@@ -329,9 +337,7 @@ private:
         }
       for(size_t i=0; i<var_str.size(); i++)
         {
-        noise_generators.push_back(
-          std::normal_distribution<>(0,
-                                     boost::lexical_cast<double>(var_str[i])));
+        noise_stddevs.push_back(boost::lexical_cast<double>(var_str[i]));
         otbAppLogINFO("Noise variance for band " << i << " equal to " << var_str[0] << "\n");
         }
       }    
@@ -372,30 +378,6 @@ private:
     }
     otbAppLogINFO("" << sampleCount << " samples read."<< std::endl);
 
-    std::vector<SimulationType> simus{sampleCount};
-    
-    auto simulator = [&](std::vector<BVType>::const_iterator sample_first,
-                         std::vector<BVType>::const_iterator sample_last,
-                         std::vector<SimulationType>::iterator simu_first){
-      ProSailType prosail;
-      prosail.SetRSR(satRSR);
-      prosail.SetParameters(prosailPars);
-      while(sample_first != sample_last)
-        {
-        prosail.SetBVs(*sample_first);
-        *simu_first = prosail();
-        if(add_noise)
-          {
-          for(size_t i=0; i<nbBands; i++)
-            {
-            (*simu_first)[i] += noise_generators[i](RNG);
-            }
-          }
-        ++sample_first;
-        ++simu_first;
-        }
-    };    
-
     auto num_threads = std::thread::hardware_concurrency();
     decltype(num_threads) num_requested_threads = 
       num_threads;
@@ -409,28 +391,23 @@ private:
     otbAppLogINFO("Using " << num_threads << " threads for the simulations."
                   << std::endl);
 
-    auto block_size = sampleCount/num_threads;
-    auto remainder =  sampleCount%num_threads;
-    if(num_threads>=sampleCount) block_size = sampleCount;
-    std::vector<std::thread> threads(num_threads);
-    auto input_start = std::begin(bv_vec);
-    auto output_start = std::begin(simus);
-
-    for(size_t t=0; t<num_threads; ++t)
+    ProSailEngineType engine;
+    engine.SetRSR(satRSR);
+    engine.SetParameters(prosailPars);
+    if(!engine.GetBandWeights().IsExact())
+      {
+      otbAppLogWARNING("Could not precompute the RSR band weights, using the spectral response reduction for every sample");
+      }
+    if(add_noise)
       {
-      auto input_end = input_start;
-      std::advance(input_end, block_size);
-      if(t==(num_threads-1)) 
-        std::advance(input_end, remainder-1);
-      threads[t] = std::thread(simulator,
-                               input_start,
-                               input_end,
-                               output_start);
-      input_start = input_end;
-      std::advance(output_start, block_size);
+      unsigned int seed = std::random_device{}();
+      if(IsParameterEnabled("seed"))
+        seed = GetParameterInt("seed");
+      otbAppLogINFO("Noise seed: " << seed << std::endl);
+      engine.SetNoise(noise_stddevs, seed);
       }
-    std::for_each(threads.begin(),threads.end(),
-                  std::mem_fn(&std::thread::join));
+
+    auto simus = engine.Simulate(bv_vec, num_threads);
     
     otbAppLogINFO("" << sampleCount << " samples processed."<< std::endl);
 
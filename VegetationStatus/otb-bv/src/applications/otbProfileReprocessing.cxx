@@ -47,6 +47,7 @@
 #include "dateUtils.h"
 #include "phenoFunctions.h"
 #include "otbProfileReprocessing.h"
+#include "otbProfileReprocessingImageFilter.h"
 #include "MetadataHelperFactory.h"
 
 //VectorType date_vect1 = {37, 57, 77, 92, 102, 107, 112, 117, 122, 127, 132, 137, 147, 152, 157, 162, 167};
@@ -218,6 +219,7 @@ public:
     typedef itk::BinaryFunctorImageFilter<InputImageType,
                                           InputImageType,
                                           OutImageType, BinaryFunctorType> BinaryFilterType;
+    typedef otb::ProfileReprocessingImageFilter<InputImageType, OutImageType> ProfileReprocessingFilterType;
 
     typedef FloatVectorImageType                    ImageType;
     typedef otb::Image<float, 2>                    InternalImageType;
@@ -313,6 +315,10 @@ private:
     SetParameterDescription("algo.local.fwr", "Forward radius of the local window. ");
     MandatoryOff("algo");
 
+    AddParameter(ParameterType_Bool, "vnlfit", "Fit each pixel with the vnl minimizer");
+    SetParameterDescription("vnlfit", "With the fit algorithm, fit the profiles one pixel at a time with the vnl Levenberg-Marquardt minimizer instead of the batch fitting with analytic derivatives. Slower, kept for reference.");
+    MandatoryOff("vnlfit");
+
     AddParameter(ParameterType_Int, "genall", "Generate LAI for all products in the time series, in one product.");
     MandatoryOff("genall");
     SetDefaultParameterInt("genall", 0);
@@ -443,6 +449,23 @@ private:
 //          bwr = realBwr;
 //      }
 
+      if (algoType == ALGO_LOCAL || !GetParameterInt("vnlfit")) {
+          m_profileReprocessingBlockFilter = ProfileReprocessingFilterType::New();
+          m_profileReprocessingBlockFilter->SetLAIImage(lai_image);
+          m_profileReprocessingBlockFilter->SetMaskImage(msks_image);
+          if (hasErrImg) {
+              m_profileReprocessingBlockFilter->SetErrorImage(err_image);
+          }
+          m_profileReprocessingBlockFilter->SetDates(inDates);
+          m_profileReprocessingBlockFilter->SetFit(algoType == ALGO_FIT);
+          m_profileReprocessingBlockFilter->SetBackwardRadius(bwr);
+          m_profileReprocessingBlockFilter->SetForwardRadius(fwr);
+          m_profileReprocessingBlockFilter->SetGenerateAll(bGenerateAll);
+
+          SetParameterOutputImage("opf", m_profileReprocessingBlockFilter->GetOutput());
+          return;
+      }
+
       //instantiate a functor with the regressor and pass it to the
       //unary functor image filter pass also the normalization values
       FunctorType *functor;
@@ -657,6 +680,7 @@ private:
   // Profile reprocessing variables
   TernaryFilterType::Pointer m_profileReprocessingFilter;
   BinaryFilterType::Pointer m_profileReprocessingNoErrFilter;
+  ProfileReprocessingFilterType::Pointer m_profileReprocessingBlockFilter;
   FunctorType m_ternaryFunctor;
   BinaryFunctorType m_binaryFunctor;
 
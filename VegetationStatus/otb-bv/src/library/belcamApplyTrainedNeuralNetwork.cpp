@@ -17,7 +17,7 @@ int main(int argc, char * argv[])
   {
     printf("Create a metric based on a trained network and input reflectances.\n");
     printf("Min four args are mandatory: new output file, network text file, input file (multi bands), NaN value.\n");
-    printf("                one opt arg: scaling factor on input (default 1)\n");
+    printf("               two opt args: scaling factor on input (default 1), single precision evaluation 0/1 (default 0)\n");
     exit(EXIT_FAILURE);
   }
   char outputFilename[200];
@@ -28,6 +28,9 @@ int main(int argc, char * argv[])
   double scale = 1.;
   if(argc > 5)
     scale = atof(argv[5]);
+  bool singlePrecision = false;
+  if(argc > 6)
+    singlePrecision = atoi(argv[6]) != 0;
 
   // extract params from formated text file (mustache template)
   trained_network params = bvnet_fill_trained_network(inputTextFilename);
@@ -44,6 +47,7 @@ int main(int argc, char * argv[])
   neuronF->SetInput(readerF->GetOutput() );
   neuronF->setParams( params );
   neuronF->setScale( scale );
+  neuronF->setSinglePrecision( singlePrecision );
   writerF->SetInput( neuronF->GetOutput() );
   writerF->SetFileName( outputFilename );
 
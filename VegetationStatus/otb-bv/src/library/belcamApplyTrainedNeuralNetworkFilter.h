@@ -4,6 +4,7 @@
 #include "otbMacro.h"
 #include "itkImageToImageFilter.h"
 #include "trainedNeuralNetwork.h"
+#include "otbDenseMLP.h"
 
 template <class TI, class TO>
 class ITK_EXPORT belcamApplyTrainedNeuralNetworkFilter : public itk::ImageToImageFilter<TI, TO>
@@ -19,19 +20,33 @@ public:
 
   void setParams(trained_network &n) { m_net = n; }
   void setScale(double scale) { m_scale = scale; }
+  // evaluate the network in float32 instead of float64
+  void setSinglePrecision(bool single) { m_singlePrecision = single; }
 
 protected:
-  belcamApplyTrainedNeuralNetworkFilter() {}
+  belcamApplyTrainedNeuralNetworkFilter() : m_scale(1.), m_singlePrecision(false) {}
   virtual ~belcamApplyTrainedNeuralNetworkFilter() {}
+  void BeforeThreadedGenerateData();
   void ThreadedGenerateData(const typename TO::RegionType & outputRegionForThread, itk::ThreadIdType threadId);
   void GenerateOutputInformation();
 
+  // number of pixels evaluated together by the network
+  static const unsigned int BlockSize = 256;
+
+  template <typename TPrecision>
+  void fillDenseMLP(otb::DenseMLP<TPrecision> &mlp) const;
+  template <typename TPrecision>
+  void processRegion(const otb::DenseMLP<TPrecision> &mlp, const typename TO::RegionType & outputRegionForThread);
+
 private:
   // copy operators purposely not implemented
   belcamApplyTrainedNeuralNetworkFilter(const Self &);
   void operator=(const Self&);
   trained_network m_net;
   double m_scale;
+  bool m_singlePrecision;
+  otb::DenseMLP<double> m_mlp;
+  otb::DenseMLP<float> m_mlpF;
 
 };
 
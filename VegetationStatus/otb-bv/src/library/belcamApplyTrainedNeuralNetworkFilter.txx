@@ -2,15 +2,73 @@
 #include "belcamApplyTrainedNeuralNetworkFilter.h"
 
 
+template <class TI, class TO>
+void belcamApplyTrainedNeuralNetworkFilter<TI, TO>
+::BeforeThreadedGenerateData()
+{
+  unsigned int nbBands = this->GetInput(0)->GetNumberOfComponentsPerPixel();
+
+  if(m_net.layers[0].weights[0].size() != nbBands) {
+    printf("the number of bands and the number of inputs in txt file have to be identical !! (%d vs %d)\n", nbBands, (int)m_net.layers[0].weights[0].size());
+    exit(1);
+  }
+
+  m_mlp = otb::DenseMLP<double>();
+  m_mlpF = otb::DenseMLP<float>();
+  if(m_singlePrecision)
+    fillDenseMLP(m_mlpF);
+  else
+    fillDenseMLP(m_mlp);
+}
+
+template <class TI, class TO>
+template <typename TPrecision>
+void belcamApplyTrainedNeuralNetworkFilter<TI, TO>
+::fillDenseMLP(otb::DenseMLP<TPrecision> &mlp) const
+{
+  for(const trained_network_layer &lay : m_net.layers) {
+    otb::DenseMLPActivation activation = otb::DenseMLPActivation::Identity;
+    if(lay.func_name == "tansig")
+      activation = otb::DenseMLPActivation::SymmetricSigmoid;
+
+    // the network file gives one row of weights per neuron
+    std::vector<double> weights;
+    for(const std::vector<double> &w : lay.weights)
+      weights.insert(weights.end(), w.begin(), w.end());
+    mlp.AddLayer(lay.weights[0].size(), lay.weights.size(), weights.data(), lay.bias.data(),
+                 activation, 2.0, 1.0);
+  }
+
+  // normalisation of inputs: 2 * (x / scale - min) / (max - min) - 1
+  for(unsigned int iB = 0; iB < mlp.GetNumberOfInputs(); ++iB) {
+    double range = m_net.max_norm_in[iB] - m_net.min_norm_in[iB];
+    mlp.PrependInputTransform(iB, 2.0 / (m_scale * range), -2.0 * m_net.min_norm_in[iB] / range - 1.0);
+  }
+
+  // de-normalisation of output: 0.5 * (y + 1) * (max - min) + min
+  double halfRange = 0.5 * (m_net.max_norm_out - m_net.min_norm_out);
+  mlp.AppendOutputTransform(0, halfRange, halfRange + m_net.min_norm_out);
+}
+
 template <class TI, class TO>
 void belcamApplyTrainedNeuralNetworkFilter<TI, TO>
 ::ThreadedGenerateData(const typename TO::RegionType& outputRegionForThread, itk::ThreadIdType threadId)
 {
   // remove the unused parameter warning
   (void)threadId;
-  
+
+  if(m_singlePrecision)
+    processRegion(m_mlpF, outputRegionForThread);
+  else
+    processRegion(m_mlp, outputRegionForThread);
+}
+
+template <class TI, class TO>
+template <typename TPrecision>
+void belcamApplyTrainedNeuralNetworkFilter<TI, TO>
+::processRegion(const otb::DenseMLP<TPrecision> &mlp, const typename TO::RegionType& outputRegionForThread)
+{
   unsigned int nbBands = this->GetInput(0)->GetNumberOfComponentsPerPixel();
-  unsigned int nbLayers = m_net.layers.size();
 
   // initialize iterators
   typename TI::RegionType inputRegionForThread;
@@ -20,44 +78,35 @@ void belcamApplyTrainedNeuralNetworkFilter<TI, TO>
 
   typename TO::PixelType pixelO(1);
 
-  if(m_net.layers[0].weights[0].size() != nbBands) {
-    printf("the number of bands and the number of inputs in txt file have to be identical !! (%d vs %d)\n", nbBands, (int)m_net.layers[0].weights[0].size());
-    exit(1);
-  }
-
-  // init size of processing variables
-  std::vector<std::vector<double> > inputs(nbLayers+1);
-  for(int iN = 0; iN < nbLayers; ++iN)
-    for(int i = 0; i < m_net.layers[iN].weights[0].size(); ++i)
-      inputs[iN].push_back(0.);
-  inputs[nbLayers].push_back(0.); // one output
+  // block of pixels, stored band by band
+  std::vector<TPrecision> inputs(nbBands * BlockSize);
+  std::vector<TPrecision> outputs(BlockSize);
+  typename otb::DenseMLP<TPrecision>::Workspace ws;
 
-  // loop over pixels
-  for(oIt.GoToBegin(), iIt.GoToBegin(); ! oIt.IsAtEnd(); ++oIt, ++iIt)
+  oIt.GoToBegin();
+  iIt.GoToBegin();
+  while(!iIt.IsAtEnd())
   {
-    // normalisation of inputs
-    const typename TI::PixelType &pixelI = iIt.Get();
-    for(int iB = 0; iB < nbBands; ++iB)
-      inputs[0][iB] = 2.0 * (pixelI[iB] / m_scale - m_net.min_norm_in[iB]) / (m_net.max_norm_in[iB] - m_net.min_norm_in[iB]) - 1.0;
-
-    // loop over layers
-    for(int iL = 0; iL < nbLayers; ++iL) {
-      trained_network_layer & lay = m_net.layers[iL];
-
-      // loop over neurons (apply layer rules)
-      for(int iN = 0; iN < lay.weights.size(); ++iN) {
-        inputs[iL+1][iN] = lay.bias[iN];
-        for(int iB = 0; iB < lay.weights[iN].size(); ++iB)
-          inputs[iL+1][iN] += inputs[iL][iB] * lay.weights[iN][iB];
-        inputs[iL+1][iN] = (*lay.func)(inputs[iL+1][iN]);
-      }
-
+    unsigned int n = 0;
+    for(; n < BlockSize && !iIt.IsAtEnd(); ++n, ++iIt)
+    {
+      const typename TI::PixelType &pixelI = iIt.Get();
+      for(unsigned int iB = 0; iB < nbBands; ++iB)
+        inputs[iB * BlockSize + n] = pixelI[iB];
     }
 
-    // de-normalisation of output
-    pixelO[0] = 0.5 * (inputs[nbLayers][0] + 1.0) * (m_net.max_norm_out - m_net.min_norm_out) + m_net.min_norm_out;
+    // the network expects a dense nbBands x n matrix
+    if(n < BlockSize)
+      for(unsigned int iB = 1; iB < nbBands; ++iB)
+        std::copy(inputs.begin() + iB * BlockSize, inputs.begin() + iB * BlockSize + n, inputs.begin() + iB * n);
+
+    mlp.Evaluate(inputs.data(), n, outputs.data(), ws);
 
-    oIt.Set( pixelO );
+    for(unsigned int i = 0; i < n; ++i, ++oIt)
+    {
+      pixelO[0] = outputs[i];
+      oIt.Set( pixelO );
+    }
   }
 
 }
@@ -69,6 +118,3 @@ void belcamApplyTrainedNeuralNetworkFilter<TI, TO>
   Superclass::GenerateOutputInformation();
   this->GetOutput()->SetNumberOfComponentsPerPixel( 1 );
 }
-
-
-
@@ -0,0 +1,242 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+
+#ifndef __OTBDENSEMLP_H
+#define __OTBDENSEMLP_H
+
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+#include <limits>
+#include "itkMacro.h"
+
+namespace otb
+{
+
+enum class DenseMLPActivation {Identity, SymmetricSigmoid};
+
+/** \class DenseMLP
+ * \brief Feed-forward multi-layer perceptron evaluated on blocks of samples.
+ *
+ * A block of samples is stored variable-major: row k holds the k-th
+ * variable of every sample of the block. Each layer is then a small matrix
+ * product whose inner loop runs over the samples, followed by the activation
+ * function applied on the whole output block. Both loops are over contiguous
+ * memory and are vectorized by the compiler, independently of the (usually
+ * small) number of neurons.
+ *
+ * The input and output normalizations are folded into per-variable affine
+ * transforms (scale * x + offset), so that any chain of normalizations
+ * (file based min/max, OpenCV input/output scales, ...) costs a single
+ * multiply-add per value.
+ *
+ * The activation functions are:
+ *  - Identity:         f(x) = x
+ *  - SymmetricSigmoid: f(x) = beta * (1 - exp(-alpha x)) / (1 + exp(-alpha x))
+ *                      (tansig is alpha = 2, beta = 1)
+ */
+template <typename TPrecision = double>
+class DenseMLP
+{
+public:
+  using ValueType = TPrecision;
+  using VectorType = std::vector<ValueType>;
+
+  struct Layer
+  {
+    std::size_t nbInputs;
+    std::size_t nbOutputs;
+    // nbOutputs x nbInputs, row-major (one row per neuron)
+    VectorType weights;
+    VectorType bias;
+    DenseMLPActivation activation;
+    ValueType alpha;
+    ValueType beta;
+  };
+
+  /** Per-thread buffers holding the intermediate layer outputs */
+  struct Workspace
+  {
+    VectorType first;
+    VectorType second;
+  };
+
+  DenseMLP() = default;
+
+  std::size_t GetNumberOfInputs() const
+  {
+    return m_InputScale.size();
+  }
+
+  std::size_t GetNumberOfOutputs() const
+  {
+    return m_OutputScale.size();
+  }
+
+  std::size_t GetNumberOfLayers() const
+  {
+    return m_Layers.size();
+  }
+
+  bool IsEmpty() const
+  {
+    return m_Layers.empty();
+  }
+
+  /** Append a layer. The weights are given one row per neuron
+   * (nbOutputs x nbInputs, row-major). */
+  template <typename T>
+  void AddLayer(std::size_t nbInputs, std::size_t nbOutputs,
+                const T* weights, const T* bias,
+                DenseMLPActivation activation, double alpha = 1.0, double beta = 1.0)
+  {
+    if(!m_Layers.empty() && m_Layers.back().nbOutputs != nbInputs)
+      {
+      itkGenericExceptionMacro(<< "Layer with " << nbInputs << " inputs cannot follow a layer with "
+                               << m_Layers.back().nbOutputs << " outputs.");
+      }
+    Layer layer;
+    layer.nbInputs = nbInputs;
+    layer.nbOutputs = nbOutputs;
+    layer.weights.assign(weights, weights + nbInputs * nbOutputs);
+    layer.bias.assign(bias, bias + nbOutputs);
+    layer.activation = activation;
+    layer.alpha = static_cast<ValueType>(alpha);
+    layer.beta = static_cast<ValueType>(beta);
+    if(m_Layers.empty())
+      {
+      m_InputScale.assign(nbInputs, 1);
+      m_InputOffset.assign(nbInputs, 0);
+      }
+    m_OutputScale.assign(nbOutputs, 1);
+    m_OutputOffset.assign(nbOutputs, 0);
+    m_Layers.push_back(layer);
+  }
+
+  /** Compose the current input transform with an affine transform applied
+   * before it: x -> current(scale * x + offset) */
+  void PrependInputTransform(std::size_t var, double scale, double offset)
+  {
+    m_InputOffset[var] += m_InputScale[var] * static_cast<ValueType>(offset);
+    m_InputScale[var] *= static_cast<ValueType>(scale);
+  }
+
+  /** Compose the current output transform with an affine transform applied
+   * after it: y -> scale * current(y) + offset */
+  void AppendOutputTransform(std::size_t var, double scale, double offset)
+  {
+    m_OutputScale[var] *= static_cast<ValueType>(scale);
+    m_OutputOffset[var] = m_OutputOffset[var] * static_cast<ValueType>(scale)
+      + static_cast<ValueType>(offset);
+  }
+
+  /** Evaluate the network on a block of nbSamples samples.
+   * \param in  nbInputs x nbSamples matrix (variable-major)
+   * \param out nbOutputs x nbSamples matrix (variable-major)
+   */
+  void Evaluate(const ValueType* in, std::size_t nbSamples, ValueType* out,
+                Workspace& ws) const
+  {
+    std::size_t maxWidth = GetNumberOfInputs();
+    for(const auto& layer : m_Layers)
+      maxWidth = std::max(maxWidth, layer.nbOutputs);
+    if(ws.first.size() < maxWidth * nbSamples)
+      {
+      ws.first.resize(maxWidth * nbSamples);
+      ws.second.resize(maxWidth * nbSamples);
+      }
+
+    ValueType* cur = ws.first.data();
+    ValueType* next = ws.second.data();
+    for(std::size_t k = 0; k < GetNumberOfInputs(); ++k)
+      {
+      const ValueType scale = m_InputScale[k];
+      const ValueType offset = m_InputOffset[k];
+      const ValueType* src = in + k * nbSamples;
+      ValueType* dst = cur + k * nbSamples;
+      for(std::size_t s = 0; s < nbSamples; ++s)
+        dst[s] = scale * src[s] + offset;
+      }
+
+    for(const auto& layer : m_Layers)
+      {
+      EvaluateLayer(layer, cur, nbSamples, next);
+      std::swap(cur, next);
+      }
+
+    for(std::size_t j = 0; j < GetNumberOfOutputs(); ++j)
+      {
+      const ValueType scale = m_OutputScale[j];
+      const ValueType offset = m_OutputOffset[j];
+      const ValueType* src = cur + j * nbSamples;
+      ValueType* dst = out + j * nbSamples;
+      for(std::size_t s = 0; s < nbSamples; ++s)
+        dst[s] = scale * src[s] + offset;
+      }
+  }
+
+private:
+  static void EvaluateLayer(const Layer& layer, const ValueType* in,
+                            std::size_t nbSamples, ValueType* out)
+  {
+    for(std::size_t j = 0; j < layer.nbOutputs; ++j)
+      {
+      ValueType* dst = out + j * nbSamples;
+      const ValueType* w = layer.weights.data() + j * layer.nbInputs;
+      std::fill(dst, dst + nbSamples, layer.bias[j]);
+      for(std::size_t k = 0; k < layer.nbInputs; ++k)
+        {
+        const ValueType wk = w[k];
+        const ValueType* src = in + k * nbSamples;
+        for(std::size_t s = 0; s < nbSamples; ++s)
+          dst[s] += wk * src[s];
+        }
+      }
+    ApplyActivation(layer, out, layer.nbOutputs * nbSamples);
+  }
+
+  static void ApplyActivation(const Layer& layer, ValueType* values, std::size_t n)
+  {
+    // exp() overflows for large arguments; the functions are saturated
+    // well before this bound.
+    const ValueType bound = std::log(std::numeric_limits<ValueType>::max()) - 1;
+    const ValueType alpha = layer.alpha;
+    const ValueType beta = layer.beta;
+    switch(layer.activation)
+      {
+      case DenseMLPActivation::Identity:
+        break;
+      case DenseMLPActivation::SymmetricSigmoid:
+        for(std::size_t i = 0; i < n; ++i)
+          {
+          const ValueType x = std::min(bound, std::max(-bound, -alpha * values[i]));
+          const ValueType e = std::exp(x);
+          values[i] = beta * (1 - e) / (1 + e);
+          }
+        break;
+      }
+  }
+
+  std::vector<Layer> m_Layers;
+  VectorType m_InputScale;
+  VectorType m_InputOffset;
+  VectorType m_OutputScale;
+  VectorType m_OutputOffset;
+};
+
+}
+
+#endif
@@ -0,0 +1,104 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+
+#ifndef __otbDenseMLPImageFilter_h
+#define __otbDenseMLPImageFilter_h
+
+#include "itkImageToImageFilter.h"
+#include "otbDenseMLP.h"
+
+namespace otb
+{
+
+/** \class DenseMLPImageFilter
+ * \brief Applies a DenseMLP on every pixel of a vector image.
+ *
+ * The pixels of each thread region are gathered in blocks which are
+ * evaluated at once by the network. A pixel having a negative value in any
+ * band, or whose mask value (first band of the optional mask image) differs
+ * from MaskValidValue, is set to OutputNoDataValue.
+ */
+template <class TInputImage, class TOutputImage, typename TPrecision = double>
+class ITK_EXPORT DenseMLPImageFilter
+  : public itk::ImageToImageFilter<TInputImage, TOutputImage>
+{
+public:
+  /** Standard class typedefs. */
+  typedef DenseMLPImageFilter                                 Self;
+  typedef itk::ImageToImageFilter<TInputImage, TOutputImage>  Superclass;
+  typedef itk::SmartPointer<Self>                             Pointer;
+  typedef itk::SmartPointer<const Self>                       ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(DenseMLPImageFilter, ImageToImageFilter);
+
+  typedef TInputImage                           InputImageType;
+  typedef TOutputImage                          OutputImageType;
+  typedef typename OutputImageType::RegionType  OutputImageRegionType;
+  typedef typename OutputImageType::PixelType   OutputPixelType;
+  typedef typename OutputImageType::InternalPixelType OutputInternalPixelType;
+  typedef DenseMLP<TPrecision>                  NetworkType;
+
+  /** Number of pixels evaluated together */
+  itkStaticConstMacro(BlockSize, unsigned int, 256);
+
+  void SetNetwork(const NetworkType &network)
+  {
+    m_Network = network;
+    this->Modified();
+  }
+
+  const NetworkType & GetNetwork() const
+  {
+    return m_Network;
+  }
+
+  void SetMaskImage(const InputImageType *mask);
+  const InputImageType * GetMaskImage() const;
+
+  itkSetMacro(OutputNoDataValue, OutputInternalPixelType);
+  itkGetConstMacro(OutputNoDataValue, OutputInternalPixelType);
+
+  itkSetMacro(MaskValidValue, double);
+  itkGetConstMacro(MaskValidValue, double);
+
+protected:
+  DenseMLPImageFilter();
+  virtual ~DenseMLPImageFilter() {}
+
+  virtual void GenerateOutputInformation();
+  virtual void BeforeThreadedGenerateData();
+  virtual void ThreadedGenerateData(const OutputImageRegionType& outputRegionForThread,
+                                    itk::ThreadIdType threadId);
+
+private:
+  DenseMLPImageFilter(const Self &); //purposely not implemented
+  void operator =(const Self&); //purposely not implemented
+
+  NetworkType             m_Network;
+  OutputInternalPixelType m_OutputNoDataValue;
+  double                  m_MaskValidValue;
+};
+
+} // end namespace otb
+
+#ifndef OTB_MANUAL_INSTANTIATION
+#include "otbDenseMLPImageFilter.txx"
+#endif
+
+#endif
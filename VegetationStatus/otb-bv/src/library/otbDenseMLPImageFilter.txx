@@ -0,0 +1,175 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+
+#ifndef __otbDenseMLPImageFilter_txx
+#define __otbDenseMLPImageFilter_txx
+
+#include "otbDenseMLPImageFilter.h"
+#include "itkImageRegionIterator.h"
+#include "itkImageRegionConstIterator.h"
+
+namespace otb
+{
+
+template <class TInputImage, class TOutputImage, typename TPrecision>
+DenseMLPImageFilter<TInputImage, TOutputImage, TPrecision>
+::DenseMLPImageFilter() : m_OutputNoDataValue(0), m_MaskValidValue(0)
+{
+  this->SetNumberOfRequiredInputs(1);
+}
+
+template <class TInputImage, class TOutputImage, typename TPrecision>
+void
+DenseMLPImageFilter<TInputImage, TOutputImage, TPrecision>
+::SetMaskImage(const InputImageType *mask)
+{
+  this->itk::ProcessObject::SetNthInput(1, const_cast<InputImageType *>(mask));
+}
+
+template <class TInputImage, class TOutputImage, typename TPrecision>
+const typename DenseMLPImageFilter<TInputImage, TOutputImage, TPrecision>::InputImageType *
+DenseMLPImageFilter<TInputImage, TOutputImage, TPrecision>
+::GetMaskImage() const
+{
+  if (this->GetNumberOfInputs() < 2)
+    {
+    return 0;
+    }
+  return static_cast<const InputImageType *>(this->itk::ProcessObject::GetInput(1));
+}
+
+template <class TInputImage, class TOutputImage, typename TPrecision>
+void
+DenseMLPImageFilter<TInputImage, TOutputImage, TPrecision>
+::GenerateOutputInformation()
+{
+  Superclass::GenerateOutputInformation();
+  this->GetOutput()->SetNumberOfComponentsPerPixel(m_Network.GetNumberOfOutputs());
+}
+
+template <class TInputImage, class TOutputImage, typename TPrecision>
+void
+DenseMLPImageFilter<TInputImage, TOutputImage, TPrecision>
+::BeforeThreadedGenerateData()
+{
+  if (m_Network.IsEmpty())
+    {
+    itkExceptionMacro(<< "No network was set");
+    }
+  if (this->GetInput()->GetNumberOfComponentsPerPixel() != m_Network.GetNumberOfInputs())
+    {
+    itkExceptionMacro(<< "The input image has " << this->GetInput()->GetNumberOfComponentsPerPixel()
+                      << " bands but the network expects " << m_Network.GetNumberOfInputs() << " inputs");
+    }
+}
+
+template <class TInputImage, class TOutputImage, typename TPrecision>
+void
+DenseMLPImageFilter<TInputImage, TOutputImage, TPrecision>
+::ThreadedGenerateData(const OutputImageRegionType& outputRegionForThread, itk::ThreadIdType)
+{
+  const InputImageType *input = this->GetInput();
+  const InputImageType *mask = this->GetMaskImage();
+  OutputImageType *output = this->GetOutput();
+
+  const unsigned int nbInputs = m_Network.GetNumberOfInputs();
+  const unsigned int nbOutputs = m_Network.GetNumberOfOutputs();
+
+  itk::ImageRegionConstIterator<InputImageType> inIt(input, outputRegionForThread);
+  itk::ImageRegionConstIterator<InputImageType> maskIt;
+  if (mask)
+    {
+    maskIt = itk::ImageRegionConstIterator<InputImageType>(mask, outputRegionForThread);
+    maskIt.GoToBegin();
+    }
+  itk::ImageRegionIterator<OutputImageType> outIt(output, outputRegionForThread);
+
+  // valid pixels of the block, stored band by band
+  std::vector<TPrecision> block(nbInputs * BlockSize);
+  std::vector<TPrecision> results(nbOutputs * BlockSize);
+  std::vector<bool> valid(BlockSize);
+  typename NetworkType::Workspace ws;
+
+  OutputPixelType outPix;
+  outPix.SetSize(nbOutputs);
+
+  inIt.GoToBegin();
+  outIt.GoToBegin();
+  while (!inIt.IsAtEnd())
+    {
+    // first pass: gather the valid pixels of the next block
+    unsigned int nbPixels = 0;
+    unsigned int nbValid = 0;
+    for (; nbPixels < BlockSize && !inIt.IsAtEnd(); ++nbPixels, ++inIt)
+      {
+      bool isValid = true;
+      if (mask)
+        {
+        isValid = maskIt.Get()[0] == m_MaskValidValue;
+        ++maskIt;
+        }
+      const typename InputImageType::PixelType &pix = inIt.Get();
+      for (unsigned int b = 0; isValid && b < nbInputs; ++b)
+        {
+        isValid = pix[b] >= 0;
+        }
+      valid[nbPixels] = isValid;
+      if (isValid)
+        {
+        for (unsigned int b = 0; b < nbInputs; ++b)
+          {
+          block[b * BlockSize + nbValid] = pix[b];
+          }
+        ++nbValid;
+        }
+      }
+
+    // the network expects a dense nbInputs x nbValid matrix
+    if (nbValid < BlockSize)
+      {
+      for (unsigned int b = 1; b < nbInputs; ++b)
+        {
+        std::copy(block.begin() + b * BlockSize, block.begin() + b * BlockSize + nbValid,
+                  block.begin() + b * nbValid);
+        }
+      }
+    if (nbValid > 0)
+      {
+      m_Network.Evaluate(block.data(), nbValid, results.data(), ws);
+      }
+
+    // second pass: write the block
+    for (unsigned int i = 0, v = 0; i < nbPixels; ++i, ++outIt)
+      {
+      if (valid[i])
+        {
+        for (unsigned int o = 0; o < nbOutputs; ++o)
+          {
+          outPix[o] = static_cast<OutputInternalPixelType>(results[o * nbValid + v]);
+          }
+        ++v;
+        }
+      else
+        {
+        outPix.Fill(m_OutputNoDataValue);
+        }
+      outIt.Set(outPix);
+      }
+    }
+}
+
+} // end namespace otb
+
+#endif
@@ -34,6 +34,7 @@
 #define __OTBNEURALNETWORKREGRESSIONMACHINELEARNINGMODEL_H
 
 #include "otbNeuralNetworkMachineLearningModel.h"
+#include "otbDenseMLP.h"
 
 namespace otb
 {
@@ -88,6 +89,12 @@ public:
   /** Load the model from file */
   virtual void Load(const std::string & filename, const std::string & name="");
 
+  /** Copy the trained network, including the OpenCV input and output
+   * scaling, into a DenseMLP for block evaluation. Returns false if the
+   * activation function is not supported by DenseMLP (GAUSSIAN). */
+  template <typename TPrecision>
+  bool ExportDenseMLP(DenseMLP<TPrecision> & mlp) const;
+
 protected:
   /** Constructor */
   NeuralNetworkRegressionMachineLearningModel();
@@ -150,9 +150,88 @@ void NeuralNetworkRegressionMachineLearningModel<TInputValue, TOutputValue>::Loa
     }
 
   m_ANNModel->read(fs, model_node);
+
+  // CvANN_MLP does not expose its activation function, keep it for ExportDenseMLP
+  const char* activ_func_name = cvReadStringByName(fs, model_node, "activation_function", 0);
+  if ( activ_func_name )
+    {
+    std::string activ_func(activ_func_name);
+    if ( activ_func == "IDENTITY" )
+      m_ActivateFunction = CvANN_MLP::IDENTITY;
+    else if ( activ_func == "GAUSSIAN" )
+      m_ActivateFunction = CvANN_MLP::GAUSSIAN;
+    else
+      m_ActivateFunction = CvANN_MLP::SIGMOID_SYM;
+    }
+  else
+    {
+    m_ActivateFunction = cvReadIntByName(fs, model_node, "activation_function", CvANN_MLP::SIGMOID_SYM);
+    }
+  m_Alpha = cvReadRealByName(fs, model_node, "f_param1", 0);
+  m_Beta = cvReadRealByName(fs, model_node, "f_param2", 0);
+  // same defaults as CvANN_MLP::set_activ_func
+  if ( m_ActivateFunction == CvANN_MLP::SIGMOID_SYM )
+    {
+    if ( fabs(m_Alpha) < FLT_EPSILON )
+      m_Alpha = 2. / 3;
+    if ( fabs(m_Beta) < FLT_EPSILON )
+      m_Beta = 1.7159;
+    }
+  else if ( m_ActivateFunction == CvANN_MLP::GAUSSIAN )
+    {
+    if ( fabs(m_Alpha) < FLT_EPSILON )
+      m_Alpha = 1.;
+    if ( fabs(m_Beta) < FLT_EPSILON )
+      m_Beta = 1.;
+    }
+
   cvReleaseFileStorage(&fs);
 }
 
+template<class TInputValue, class TOutputValue>
+template<typename TPrecision>
+bool NeuralNetworkRegressionMachineLearningModel<TInputValue, TOutputValue>::ExportDenseMLP(DenseMLP<TPrecision> & mlp) const
+{
+  const CvMat* layerSizes = m_ANNModel->get_layer_sizes();
+  if ( !layerSizes )
+    {
+    itkExceptionMacro(<< "The neural network is not trained or loaded");
+    }
+  const int nbLayers = layerSizes->cols;
+  const int* sizes = layerSizes->data.i;
+
+  if ( m_ActivateFunction == CvANN_MLP::GAUSSIAN )
+    return false;
+  DenseMLPActivation activation = DenseMLPActivation::SymmetricSigmoid;
+  if ( m_ActivateFunction == CvANN_MLP::IDENTITY )
+    activation = DenseMLPActivation::Identity;
+
+  mlp = DenseMLP<TPrecision>();
+  for ( int l = 1; l < nbLayers; ++l )
+    {
+    // OpenCV stores (inputs + 1) x outputs, the last row being the bias
+    const int nbInputs = sizes[l - 1];
+    const int nbOutputs = sizes[l];
+    const double* w = m_ANNModel->get_weights(l);
+    std::vector<double> weights(nbInputs * nbOutputs);
+    for ( int k = 0; k < nbInputs; ++k )
+      for ( int j = 0; j < nbOutputs; ++j )
+        weights[j * nbInputs + k] = w[k * nbOutputs + j];
+    mlp.AddLayer(nbInputs, nbOutputs, weights.data(), w + nbInputs * nbOutputs,
+                 activation, m_Alpha, m_Beta);
+    }
+
+  const double* inputScale = m_ANNModel->get_weights(0);
+  for ( int k = 0; k < sizes[0]; ++k )
+    mlp.PrependInputTransform(k, inputScale[2 * k], inputScale[2 * k + 1]);
+
+  const double* outputScale = m_ANNModel->get_weights(nbLayers);
+  for ( int j = 0; j < sizes[nbLayers - 1]; ++j )
+    mlp.AppendOutputTransform(j, outputScale[2 * j], outputScale[2 * j + 1]);
+
+  return true;
+}
+
 template<class TInputValue, class TOutputValue>
 void NeuralNetworkRegressionMachineLearningModel<TInputValue, TOutputValue>::PrintSelf(std::ostream& os, itk::Indent indent) const
 {
@@ -0,0 +1,393 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+
+#ifndef __OTBPROSAILSIMULATIONENGINE_H
+#define __OTBPROSAILSIMULATIONENGINE_H
+
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "otbProSailSimulatorFunctor.h"
+
+namespace otb
+{
+
+/** \class ProSailBandWeights
+ * \brief Precomputed convolution of the simulated spectrum with a
+ * satellite RSR.
+ *
+ * The reduction done by ReduceSpectralResponse in reflectance mode is
+ * linear in the values of the input spectrum, so each band is a weighted
+ * sum of the SimNbBands simulated values. The weights are obtained once by
+ * reducing unit spectra and the reduction of a simulation then becomes one
+ * sparse dot product per band.
+ */
+template <class TSatRSR, unsigned int SimNbBands = 2000>
+class ProSailBandWeights
+{
+public:
+  typedef TSatRSR SatRSRType;
+  typedef typename SatRSRType::Pointer SatRSRPointerType;
+  typedef typename SatRSRType::PrecisionType PrecisionType;
+  typedef std::pair<PrecisionType,PrecisionType> PairType;
+  typedef typename std::vector<PairType> VectorPairType;
+  typedef otb::SpectralResponse< PrecisionType, PrecisionType>  ResponseType;
+  typedef otb::ReduceSpectralResponse < ResponseType,SatRSRType>  ReduceResponseType;
+
+  ProSailBandWeights() : m_NbBands(0), m_Exact(false) {}
+
+  void Compute(const SatRSRPointerType rsr)
+  {
+    m_NbBands = rsr->GetNbBands();
+    m_First.assign(m_NbBands, SimNbBands);
+    m_Last.assign(m_NbBands, 0);
+    std::vector<std::vector<PrecisionType>> weights(m_NbBands,
+                                                    std::vector<PrecisionType>(SimNbBands, 0));
+
+    VectorPairType spectrum(SimNbBands);
+    for(size_t i=0;i<SimNbBands;i++)
+      spectrum[i] = PairType(static_cast<PrecisionType>((400.0+i)/1000), 0);
+
+    for(size_t i=0;i<SimNbBands;i++)
+      {
+      spectrum[i].second = 1;
+      auto response = Reduce(rsr, spectrum);
+      for(size_t b=0;b<m_NbBands;b++)
+        {
+        weights[b][i] = response[b];
+        if(response[b] != 0)
+          {
+          m_First[b] = std::min(m_First[b], i);
+          m_Last[b] = std::max(m_Last[b], i+1);
+          }
+        }
+      spectrum[i].second = 0;
+      }
+
+    // keep only the non zero range of each band
+    m_Offsets.assign(m_NbBands+1, 0);
+    m_Weights.clear();
+    for(size_t b=0;b<m_NbBands;b++)
+      {
+      if(m_First[b] > m_Last[b])
+        m_First[b] = m_Last[b];
+      m_Weights.insert(m_Weights.end(), weights[b].begin()+m_First[b], weights[b].begin()+m_Last[b]);
+      m_Offsets[b+1] = m_Weights.size();
+      }
+
+    // check the weights against ReduceSpectralResponse on a smooth spectrum
+    std::vector<PrecisionType> values(SimNbBands);
+    for(size_t i=0;i<SimNbBands;i++)
+      {
+      values[i] = 0.3+0.2*std::sin(i/150.0);
+      spectrum[i].second = values[i];
+      }
+    auto expected = Reduce(rsr, spectrum);
+    std::vector<PrecisionType> result(m_NbBands);
+    Apply(values.data(), result.data());
+    m_Exact = true;
+    for(size_t b=0;b<m_NbBands;b++)
+      if(std::fabs(result[b]-expected[b]) > 1e-9*std::max(PrecisionType(1), std::fabs(expected[b])))
+        m_Exact = false;
+  }
+
+  /** Whether the weights reproduce ReduceSpectralResponse */
+  bool IsExact() const
+  {
+    return m_Exact;
+  }
+
+  size_t GetNbBands() const
+  {
+    return m_NbBands;
+  }
+
+  /** Reduce a spectrum sampled every nm from 400 nm */
+  void Apply(const PrecisionType* spectrum, PrecisionType* out) const
+  {
+    for(size_t b=0;b<m_NbBands;b++)
+      {
+      const PrecisionType* w = m_Weights.data()+m_Offsets[b];
+      const PrecisionType* s = spectrum+m_First[b];
+      const size_t n = m_Last[b]-m_First[b];
+      PrecisionType sum{0};
+      for(size_t i=0;i<n;i++)
+        sum += w[i]*s[i];
+      out[b] = sum;
+      }
+  }
+
+  /** Reduce a spectrum with ReduceSpectralResponse */
+  static std::vector<PrecisionType> Reduce(const SatRSRPointerType rsr, const VectorPairType& spectrum)
+  {
+    auto aResponse = ResponseType::New();
+    aResponse->SetResponse( spectrum );
+    auto  reduceResponse = ReduceResponseType::New();
+    reduceResponse->SetInputSatRSR(rsr);
+    reduceResponse->SetInputSpectralResponse( aResponse );
+    reduceResponse->SetReflectanceMode(true);
+    reduceResponse->CalculateResponse();
+    std::vector<PrecisionType> result(rsr->GetNbBands());
+    for(size_t i=0;i<rsr->GetNbBands();i++)
+      result[i] = (*reduceResponse)(i);
+    return result;
+  }
+
+private:
+  size_t m_NbBands;
+  bool m_Exact;
+  std::vector<size_t> m_First;
+  std::vector<size_t> m_Last;
+  std::vector<size_t> m_Offsets;
+  std::vector<PrecisionType> m_Weights;
+};
+
+/** \class ProSailSimulationEngine
+ * \brief Multi-threaded Prospect+Sail simulation of a set of BV samples.
+ *
+ * Produces the same simulations as Functor::ProSailSimulator (reflectances
+ * followed by fcover and fapar), but each thread keeps its Prospect and Sail
+ * models and its spectrum buffer for all its samples, and the reduction to
+ * the sensor bands uses the precomputed ProSailBandWeights.
+ *
+ * The samples are processed in chunks of ChunkSize samples which are
+ * distributed dynamically to the threads. When noise is added, every chunk
+ * uses its own generator seeded from (seed, chunk index), so the result
+ * only depends on the seed and not on the number of threads.
+ */
+template <class TSatRSR, unsigned int SimNbBands = 2000>
+class ProSailSimulationEngine
+{
+public:
+  typedef TSatRSR SatRSRType;
+  typedef typename SatRSRType::Pointer SatRSRPointerType;
+  typedef typename SatRSRType::PrecisionType PrecisionType;
+  typedef Functor::ProSailSimulator<TSatRSR, SimNbBands> ProSailType;
+  typedef typename ProSailType::OutputType OutputType;
+  typedef typename otb::ProspectModel ProspectType;
+  typedef typename otb::LeafParameters LeafParametersType;
+  typedef typename otb::SailModel SailType;
+  typedef ProSailBandWeights<TSatRSR, SimNbBands> BandWeightsType;
+
+  static const size_t ChunkSize = 64;
+
+  ProSailSimulationEngine() : m_NoiseSeed(0) {}
+
+  void SetRSR(const SatRSRPointerType rsr)
+  {
+    m_SatRSR = rsr;
+    m_BandWeights.Compute(rsr);
+  }
+
+  const BandWeightsType& GetBandWeights() const
+  {
+    return m_BandWeights;
+  }
+
+  void SetParameters(AcquisitionParsType apmap)
+  {
+    m_Parameters = apmap;
+  }
+
+  /** Standard deviation of the gaussian noise added to each band */
+  void SetNoise(const std::vector<double>& stddev, unsigned int seed)
+  {
+    m_NoiseStdDev = stddev;
+    m_NoiseSeed = seed;
+  }
+
+  std::vector<OutputType> Simulate(const std::vector<BVType>& samples, unsigned int nbThreads) const
+  {
+    std::vector<OutputType> simus(samples.size());
+    const size_t nbChunks = (samples.size()+ChunkSize-1)/ChunkSize;
+    if(nbThreads == 0)
+      nbThreads = 1;
+    if(nbThreads > nbChunks)
+      nbThreads = nbChunks;
+
+    std::atomic<size_t> nextChunk{0};
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    auto worker = [&]() {
+      try
+        {
+        Simulator simulator(*this);
+        size_t chunk;
+        while((chunk = nextChunk++) < nbChunks)
+          {
+          size_t first = chunk*ChunkSize;
+          size_t last = std::min(first+ChunkSize, samples.size());
+          for(size_t s=first; s<last; ++s)
+            simus[s] = simulator(samples[s]);
+          AddNoise(simus.begin()+first, simus.begin()+last, chunk);
+          }
+        }
+      catch(...)
+        {
+        std::lock_guard<std::mutex> lock(errorMutex);
+        if(!error)
+          error = std::current_exception();
+        nextChunk = nbChunks;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for(unsigned int t=1; t<nbThreads; ++t)
+      threads.emplace_back(worker);
+    worker();
+    for(auto& t : threads)
+      t.join();
+    if(error)
+      std::rethrow_exception(error);
+    return simus;
+  }
+
+private:
+  /** Per thread simulation state */
+  class Simulator
+  {
+  public:
+    Simulator(const ProSailSimulationEngine& engine) :
+      m_Engine(engine),
+      m_Spectrum(SimNbBands),
+      m_Reference(),
+      m_LeafPars(LeafParametersType::New()),
+      m_Prospect(ProspectType::New()),
+      m_Sail(SailType::New()),
+      m_SailFAPAR(SailType::New())
+    {
+      AcquisitionParsType pars = engine.m_Parameters;
+      m_Prospect->SetInput(m_LeafPars);
+      m_Sail->SetTTS(pars[TTS]);
+      m_Sail->SetTTO(pars[TTO]);
+      m_Sail->SetPSI(pars[PSI]);
+      m_Sail->SetSkyl(0.3);
+      m_SailFAPAR->SetTTS(pars[TTS_FAPAR]);
+      m_SailFAPAR->SetTTO(0.0);
+      m_SailFAPAR->SetPSI(0.0);
+      m_SailFAPAR->SetSkyl(0.3);
+      if(!engine.m_BandWeights.IsExact())
+        {
+        m_Reference.SetRSR(engine.m_SatRSR);
+        m_Reference.SetParameters(pars);
+        }
+    }
+
+    OutputType operator()(const BVType& sample)
+    {
+      BVType bv = sample;
+      if(!m_Engine.m_BandWeights.IsExact())
+        {
+        m_Reference.SetBVs(bv);
+        return m_Reference();
+        }
+
+      m_LeafPars->SetCab(bv[IVNames::Cab]);
+      m_LeafPars->SetCar(bv[IVNames::Car]);
+      m_LeafPars->SetCBrown(bv[IVNames::Cbp]);
+      double Cw = bv[IVNames::Cdm]/(1.-bv[IVNames::CwRel]);
+      if(Cw<0) Cw = 0.0;
+      m_LeafPars->SetCw(Cw);
+      m_LeafPars->SetCm(bv[IVNames::Cdm]);
+      m_LeafPars->SetN(bv[IVNames::N]);
+
+      // the responses are cleared but keep their capacity
+      m_Prospect->GetReflectance()->Clear();
+      m_Prospect->GetTransmittance()->Clear();
+      m_Prospect->GenerateData();
+
+      Run(m_Sail, bv);
+      Run(m_SailFAPAR, bv);
+
+      auto& sailSim = m_Sail->GetViewingReflectance()->GetResponse();
+      for(size_t i=0;i<SimNbBands;i++)
+        m_Spectrum[i] = sailSim[i].second;
+
+      const size_t nbBands = m_Engine.m_BandWeights.GetNbBands();
+      OutputType pix(nbBands+2);
+      m_Engine.m_BandWeights.Apply(m_Spectrum.data(), pix.data());
+      pix[nbBands] = m_Sail->GetFCoverView();
+      pix[nbBands+1] = ComputeFAPAR(m_SailFAPAR->GetViewingAbsorptance());
+      return pix;
+    }
+
+  private:
+    void Run(typename SailType::Pointer& sail, BVType& bv)
+    {
+      sail->SetLAI(bv[IVNames::MLAI]);
+      sail->SetAngl(bv[IVNames::ALA]);
+      sail->SetPSoil(bv[IVNames::Bs]);
+      sail->SetHSpot(bv[IVNames::HsD]);
+      sail->SetReflectance(m_Prospect->GetReflectance());
+      sail->SetTransmittance(m_Prospect->GetTransmittance());
+      sail->GetViewingReflectance()->Clear();
+      sail->GetHemisphericalReflectance()->Clear();
+      sail->GetViewingAbsorptance()->Clear();
+      sail->GetHemisphericalAbsorptance()->Clear();
+      // the leaf optical properties change even if the canopy ones don't
+      sail->Modified();
+      sail->Update();
+    }
+
+    double ComputeFAPAR(SailType::SpectralResponseType* absorptance)
+    {
+      double fapar{0};
+      double solar_irrad{0};
+      for(auto& sip : solar_irradiance_fapar)
+        {
+        fapar += (*absorptance)(sip.first)*sip.second;
+        solar_irrad += sip.second;
+        }
+      return fapar/solar_irrad;
+    }
+
+    const ProSailSimulationEngine& m_Engine;
+    std::vector<PrecisionType> m_Spectrum;
+    ProSailType m_Reference;
+    LeafParametersType::Pointer m_LeafPars;
+    ProspectType::Pointer m_Prospect;
+    SailType::Pointer m_Sail;
+    SailType::Pointer m_SailFAPAR;
+  };
+
+  template <typename Iterator>
+  void AddNoise(Iterator first, Iterator last, size_t chunk) const
+  {
+    if(m_NoiseStdDev.empty())
+      return;
+    std::seed_seq seq{m_NoiseSeed, static_cast<unsigned int>(chunk)};
+    std::mt19937 rng(seq);
+    std::vector<std::normal_distribution<>> generators;
+    for(auto sd : m_NoiseStdDev)
+      generators.push_back(std::normal_distribution<>(0, sd));
+    for(; first != last; ++first)
+      for(size_t i=0; i<generators.size(); i++)
+        (*first)[i] += generators[i](rng);
+  }
+
+  SatRSRPointerType m_SatRSR;
+  BandWeightsType m_BandWeights;
+  AcquisitionParsType m_Parameters;
+  std::vector<double> m_NoiseStdDev;
+  unsigned int m_NoiseSeed;
+};
+
+}
+
+#endif
@@ -30,6 +30,7 @@
 #define __OTBBVPROFREPR_H
 
 #include <vector>
+#include <algorithm>
 #include <phenoFunctions.h>
 #include "../../../../Common/Utils/include/GlobalDefs.h"
 
@@ -49,7 +50,7 @@ T compute_weight(T delta, T err)
   return (one/(one+delta)+one/(one+err));
 }
 
-bool IsValidLandValue(float fValue, float fMskValue)
+inline bool IsValidLandValue(float fValue, float fMskValue)
 {
     if(fMskValue != IMG_FLG_LAND) {
         return false;
@@ -64,7 +65,7 @@ bool IsValidLandValue(float fValue, float fMskValue)
 
 
 // DEPRECATED - NOT USED ANYMORE
-std::pair<VectorType, VectorType> 
+inline std::pair<VectorType, VectorType> 
 fit_csdm(const VectorType &dts, const VectorType &ts, const VectorType &ets, const VectorType &msks)
 {
   assert(ts.size()==ets.size() && ts.size()==dts.size() && ts.size()==msks.size());
@@ -123,7 +124,7 @@ fit_csdm(const VectorType &dts, const VectorType &ts, const VectorType &ets, con
   return std::make_pair(result,result_flag);
 }
 
-std::pair<VectorType, VectorType>
+inline std::pair<VectorType, VectorType>
 fit_csdm_2(const VectorType &dts, const VectorType &ts, const VectorType &ets, const VectorType &msks)
 {
     assert(/*ts.size()==ets.size() &&*/ ts.size()==dts.size() && ts.size()==msks.size());
@@ -209,7 +210,7 @@ fit_csdm_2(const VectorType &dts, const VectorType &ts, const VectorType &ets, c
 }
 
 
-std::pair<VectorType, VectorType> 
+inline std::pair<VectorType, VectorType> 
 smooth_time_series_local_window_with_error(const VectorType &dts,
                                            const VectorType &ts,
                                            const VectorType &ets,
@@ -365,7 +366,121 @@ smooth_time_series_local_window_with_error(const VectorType &dts,
     return std::make_pair(result,result_flag);
 }
 
-VectorType smooth_time_series(VectorType ts, PrecisionType alpha, 
+/** Date part of compute_weight for all the pairs of dates: element
+    i*nbDates+j is 1/(1+|dts[j]-dts[i]|). It only depends on the dates, so
+    it can be computed once and shared by all the pixels. */
+inline VectorType compute_date_weights(const VectorType &dts)
+{
+  const PrecisionType one{1};
+  const size_t nbDates = dts.size();
+  VectorType date_weights(nbDates*nbDates);
+  for(size_t i = 0; i < nbDates; i++)
+    for(size_t j = 0; j < nbDates; j++)
+      date_weights[i*nbDates+j] = one/(one+fabs(dts[j]-dts[i]));
+  return date_weights;
+}
+
+/// Buffers of the local window smoothing, reused from one pixel to the next
+struct LocalWindowWorkspace
+{
+  VectorType err_weights;
+  // ring buffer with the indices of the last bwd_radius land dates
+  std::vector<size_t> last_valid;
+};
+
+/** Same as smooth_time_series_local_window_with_error above, for one pixel
+    given as arrays of nbDates values, with the date weights computed by
+    compute_date_weights. The results are written to result and
+    result_flag and nothing is allocated once the workspace has grown to
+    the number of dates. The results are identical to the ones of the
+    vector version. */
+inline void
+smooth_time_series_local_window_with_error(size_t nbDates,
+                                           const PrecisionType *date_weights,
+                                           const PrecisionType *ts,
+                                           const PrecisionType *ets,
+                                           const PrecisionType *msks,
+                                           size_t bwd_radius,
+                                           size_t fwd_radius,
+                                           PrecisionType *result,
+                                           PrecisionType *result_flag,
+                                           LocalWindowWorkspace &ws)
+{
+    const PrecisionType one{1};
+    std::copy(ts, ts+nbDates, result);
+    std::fill(result_flag, result_flag+nbDates, not_processed_value);
+    // we process only if we have at least a number of values equals with bwd + fwd + 1
+    if(nbDates > (bwd_radius + fwd_radius)) {
+        ws.err_weights.resize(nbDates);
+        for(size_t j = 0; j < nbDates; j++) {
+            ws.err_weights[j] = one/(one+fabs(ets[j]));
+        }
+        ws.last_valid.resize(bwd_radius);
+        size_t lastValidStart = 0;
+        size_t lastValidValuesCnt = 0;
+
+        for(size_t i = 0; i < bwd_radius; i++) {
+            result_flag[i] = ((msks[i] == IMG_FLG_LAND) ? not_processed_value : invalid_value);
+        }
+
+        for(size_t cur = bwd_radius; cur + fwd_radius < nbDates; cur++) {
+            const size_t win_first = cur - bwd_radius;
+            const PrecisionType *dw = date_weights + cur*nbDates;
+            if(msks[cur] == IMG_FLG_LAND) {
+                PrecisionType sum_weights{0.0};
+                PrecisionType weighted_value{0.0};
+                size_t nProcessedVals = 0;
+                for(size_t j = win_first; j <= cur + fwd_radius; j++) {
+                    if(msks[j] == IMG_FLG_LAND) {
+                        auto cw = dw[j] + ws.err_weights[j];
+                        sum_weights += cw;
+                        weighted_value += ts[j]*cw;
+                        ++nProcessedVals;
+                    }
+                }
+
+                if(nProcessedVals > bwd_radius) {
+                    result[cur] = weighted_value/sum_weights;
+                    result_flag[cur] = nProcessedVals;
+                } else if ((nProcessedVals + lastValidValuesCnt) >= (bwd_radius+1)) {
+                    // complete with the last valid values, from the most recent one
+                    size_t remVals = bwd_radius - nProcessedVals + 1;
+                    for(size_t k = 0; k < remVals; k++) {
+                        size_t idx = lastValidValuesCnt - k - 1;
+                        size_t j = ws.last_valid[(lastValidStart + idx) % bwd_radius];
+                        auto cw = dw[j] + ws.err_weights[j];
+                        sum_weights += cw;
+                        weighted_value += ts[j]*cw;
+                        ++nProcessedVals;
+                    }
+                    result[cur] = weighted_value/sum_weights;
+                    result_flag[cur] = nProcessedVals;
+                }
+            } else {
+                result_flag[cur] = invalid_value;
+            }
+            // update the last valid values buffer if it is the case
+            if(bwd_radius > 0 && msks[win_first] == IMG_FLG_LAND) {
+                if(lastValidValuesCnt < bwd_radius) {
+                    ws.last_valid[(lastValidStart + lastValidValuesCnt) % bwd_radius] = win_first;
+                    lastValidValuesCnt++;
+                } else {
+                    ws.last_valid[lastValidStart] = win_first;
+                    lastValidStart = (lastValidStart + 1) % bwd_radius;
+                }
+            }
+        }
+    }
+    for (size_t i = 0; i<nbDates; i++) {
+        if (result_flag[i] != invalid_value) {
+            if (abs(result[i] - ts[i]) > ResidueVal) {
+                result[i] = ts[i];
+            }
+        }
+    }
+}
+
+inline VectorType smooth_time_series(VectorType ts, PrecisionType alpha, 
                               bool online=true)
 {
   auto result = ts;
@@ -387,7 +502,7 @@ VectorType smooth_time_series(VectorType ts, PrecisionType alpha,
 }
 
 //assumes regular time sampling
-VectorType smooth_time_series_n_minus_1(VectorType ts, PrecisionType alpha)
+inline VectorType smooth_time_series_n_minus_1(VectorType ts, PrecisionType alpha)
 {
   auto result = ts;
   auto ot = result.begin();
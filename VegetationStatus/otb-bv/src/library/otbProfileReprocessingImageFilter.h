@@ -0,0 +1,126 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+
+#ifndef __otbProfileReprocessingImageFilter_h
+#define __otbProfileReprocessingImageFilter_h
+
+#include "itkImageToImageFilter.h"
+#include "otbProfileReprocessing.h"
+
+namespace otb
+{
+
+/** \class ProfileReprocessingImageFilter
+ * \brief Reprocesses the BV time profile of every pixel of a vector image.
+ *
+ * The inputs are the BV profiles (one band per date), the mask flags and,
+ * optionally, the error estimations. The output has the reprocessed values
+ * followed by the flags for all the dates if GenerateAll is on, otherwise
+ * only the value and the flag of the last date.
+ *
+ * The local window algorithm gives the same results as
+ * smooth_time_series_local_window_with_error: the date weights are
+ * computed once for all the pixels and every thread reuses its buffers.
+ * The fit algorithm is the one of fit_csdm_2, but the pixels are fitted by
+ * blocks of BlockSize profiles with pheno::normalized_sigmoid::BatchApproximator
+ * instead of one at a time with vnl.
+ */
+template <class TInputImage, class TOutputImage>
+class ITK_EXPORT ProfileReprocessingImageFilter
+  : public itk::ImageToImageFilter<TInputImage, TOutputImage>
+{
+public:
+  /** Standard class typedefs. */
+  typedef ProfileReprocessingImageFilter                      Self;
+  typedef itk::ImageToImageFilter<TInputImage, TOutputImage>  Superclass;
+  typedef itk::SmartPointer<Self>                             Pointer;
+  typedef itk::SmartPointer<const Self>                       ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(ProfileReprocessingImageFilter, ImageToImageFilter);
+
+  typedef TInputImage                           InputImageType;
+  typedef TOutputImage                          OutputImageType;
+  typedef typename OutputImageType::RegionType  OutputImageRegionType;
+  typedef typename OutputImageType::PixelType   OutputPixelType;
+  typedef typename OutputImageType::InternalPixelType OutputInternalPixelType;
+
+  void SetLAIImage(const InputImageType *lai);
+  void SetMaskImage(const InputImageType *msks);
+  void SetErrorImage(const InputImageType *err);
+  const InputImageType * GetErrorImage() const;
+
+  void SetDates(const VectorType &dates)
+  {
+    m_Dates = dates;
+    this->Modified();
+  }
+
+  const VectorType & GetDates() const
+  {
+    return m_Dates;
+  }
+
+  /** Use the double logistic fitting instead of the local window */
+  itkSetMacro(Fit, bool);
+  itkGetConstMacro(Fit, bool);
+  itkBooleanMacro(Fit);
+
+  itkSetMacro(BackwardRadius, unsigned int);
+  itkGetConstMacro(BackwardRadius, unsigned int);
+
+  itkSetMacro(ForwardRadius, unsigned int);
+  itkGetConstMacro(ForwardRadius, unsigned int);
+
+  itkSetMacro(GenerateAll, bool);
+  itkGetConstMacro(GenerateAll, bool);
+  itkBooleanMacro(GenerateAll);
+
+  /** Number of pixels processed together */
+  itkSetMacro(BlockSize, unsigned int);
+  itkGetConstMacro(BlockSize, unsigned int);
+
+protected:
+  ProfileReprocessingImageFilter();
+  virtual ~ProfileReprocessingImageFilter() {}
+
+  virtual void GenerateOutputInformation();
+  virtual void BeforeThreadedGenerateData();
+  virtual void ThreadedGenerateData(const OutputImageRegionType& outputRegionForThread,
+                                    itk::ThreadIdType threadId);
+
+private:
+  ProfileReprocessingImageFilter(const Self &); //purposely not implemented
+  void operator =(const Self&); //purposely not implemented
+
+  VectorType   m_Dates;
+  VectorType   m_DateWeights;
+  bool         m_Fit;
+  unsigned int m_BackwardRadius;
+  unsigned int m_ForwardRadius;
+  bool         m_GenerateAll;
+  unsigned int m_BlockSize;
+};
+
+} // end namespace otb
+
+#ifndef OTB_MANUAL_INSTANTIATION
+#include "otbProfileReprocessingImageFilter.txx"
+#endif
+
+#endif
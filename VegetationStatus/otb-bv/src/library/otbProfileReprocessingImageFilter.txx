@@ -0,0 +1,269 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+
+#ifndef __otbProfileReprocessingImageFilter_txx
+#define __otbProfileReprocessingImageFilter_txx
+
+#include "otbProfileReprocessingImageFilter.h"
+#include "itkImageRegionIterator.h"
+#include "itkImageRegionConstIterator.h"
+#include "phenoBatchFitting.h"
+
+namespace otb
+{
+
+template <class TInputImage, class TOutputImage>
+ProfileReprocessingImageFilter<TInputImage, TOutputImage>
+::ProfileReprocessingImageFilter() : m_Fit(false), m_BackwardRadius(2), m_ForwardRadius(0),
+                                     m_GenerateAll(false), m_BlockSize(256)
+{
+  this->SetNumberOfRequiredInputs(2);
+}
+
+template <class TInputImage, class TOutputImage>
+void
+ProfileReprocessingImageFilter<TInputImage, TOutputImage>
+::SetLAIImage(const InputImageType *lai)
+{
+  this->itk::ProcessObject::SetNthInput(0, const_cast<InputImageType *>(lai));
+}
+
+template <class TInputImage, class TOutputImage>
+void
+ProfileReprocessingImageFilter<TInputImage, TOutputImage>
+::SetMaskImage(const InputImageType *msks)
+{
+  this->itk::ProcessObject::SetNthInput(1, const_cast<InputImageType *>(msks));
+}
+
+template <class TInputImage, class TOutputImage>
+void
+ProfileReprocessingImageFilter<TInputImage, TOutputImage>
+::SetErrorImage(const InputImageType *err)
+{
+  this->itk::ProcessObject::SetNthInput(2, const_cast<InputImageType *>(err));
+}
+
+template <class TInputImage, class TOutputImage>
+const typename ProfileReprocessingImageFilter<TInputImage, TOutputImage>::InputImageType *
+ProfileReprocessingImageFilter<TInputImage, TOutputImage>
+::GetErrorImage() const
+{
+  if (this->GetNumberOfInputs() < 3)
+    {
+    return 0;
+    }
+  return static_cast<const InputImageType *>(this->itk::ProcessObject::GetInput(2));
+}
+
+template <class TInputImage, class TOutputImage>
+void
+ProfileReprocessingImageFilter<TInputImage, TOutputImage>
+::GenerateOutputInformation()
+{
+  Superclass::GenerateOutputInformation();
+  this->GetOutput()->SetNumberOfComponentsPerPixel(m_GenerateAll ? 2 * m_Dates.size() : 2);
+}
+
+template <class TInputImage, class TOutputImage>
+void
+ProfileReprocessingImageFilter<TInputImage, TOutputImage>
+::BeforeThreadedGenerateData()
+{
+  const unsigned int nbDates = m_Dates.size();
+  if (nbDates == 0)
+    {
+    itkExceptionMacro(<< "No dates were set");
+    }
+  const InputImageType *err = this->GetErrorImage();
+  if (this->GetInput(0)->GetNumberOfComponentsPerPixel() != nbDates ||
+      this->GetInput(1)->GetNumberOfComponentsPerPixel() != nbDates ||
+      (err && err->GetNumberOfComponentsPerPixel() != nbDates))
+    {
+    itkExceptionMacro(<< "The input images must have one band per date (" << nbDates << " dates)");
+    }
+  if (m_Fit)
+    {
+    m_DateWeights.clear();
+    }
+  else
+    {
+    m_DateWeights = compute_date_weights(m_Dates);
+    }
+}
+
+template <class TInputImage, class TOutputImage>
+void
+ProfileReprocessingImageFilter<TInputImage, TOutputImage>
+::ThreadedGenerateData(const OutputImageRegionType& outputRegionForThread, itk::ThreadIdType)
+{
+  typedef pheno::normalized_sigmoid::BatchApproximator ApproximatorType;
+  typedef pheno::normalized_sigmoid::DoubleSigmoidModel ModelType;
+
+  const InputImageType *err = this->GetErrorImage();
+  const size_t nbDates = m_Dates.size();
+
+  itk::ImageRegionConstIterator<InputImageType> laiIt(this->GetInput(0), outputRegionForThread);
+  itk::ImageRegionConstIterator<InputImageType> mskIt(this->GetInput(1), outputRegionForThread);
+  itk::ImageRegionConstIterator<InputImageType> errIt;
+  if (err)
+    {
+    errIt = itk::ImageRegionConstIterator<InputImageType>(err, outputRegionForThread);
+    errIt.GoToBegin();
+    }
+  itk::ImageRegionIterator<OutputImageType> outIt(this->GetOutput(), outputRegionForThread);
+
+  // profiles of the block, one pixel after the other
+  VectorType ts(m_BlockSize * nbDates);
+  VectorType ets(m_BlockSize * nbDates, 0);
+  VectorType msks(m_BlockSize * nbDates);
+  VectorType results(m_BlockSize * nbDates);
+  VectorType flags(m_BlockSize * nbDates);
+
+  // local window buffers
+  LocalWindowWorkspace ws;
+
+  // fitting buffers: valid dates of the fitted pixels, concatenated
+  ApproximatorType approximator;
+  ApproximatorType::Result pca, residualApprox;
+  std::vector<double> t, values, yHat;
+  std::vector<size_t> offsets, fitted;
+
+  OutputPixelType outPix;
+  outPix.SetSize(m_GenerateAll ? 2 * nbDates : 2);
+
+  laiIt.GoToBegin();
+  mskIt.GoToBegin();
+  outIt.GoToBegin();
+  while (!laiIt.IsAtEnd())
+    {
+    size_t nbPixels = 0;
+    for (; nbPixels < m_BlockSize && !laiIt.IsAtEnd(); ++nbPixels, ++laiIt, ++mskIt)
+      {
+      const typename InputImageType::PixelType &lai = laiIt.Get();
+      const typename InputImageType::PixelType &msk = mskIt.Get();
+      for (size_t i = 0; i < nbDates; ++i)
+        {
+        ts[nbPixels * nbDates + i] = lai[i];
+        msks[nbPixels * nbDates + i] = msk[i];
+        }
+      if (err)
+        {
+        const typename InputImageType::PixelType &e = errIt.Get();
+        for (size_t i = 0; i < nbDates; ++i)
+          {
+          ets[nbPixels * nbDates + i] = e[i];
+          }
+        ++errIt;
+        }
+      }
+
+    if (!m_Fit)
+      {
+      for (size_t p = 0; p < nbPixels; ++p)
+        {
+        const size_t o = p * nbDates;
+        smooth_time_series_local_window_with_error(nbDates, m_DateWeights.data(),
+                                                   &ts[o], &ets[o], &msks[o],
+                                                   m_BackwardRadius, m_ForwardRadius,
+                                                   &results[o], &flags[o], ws);
+        }
+      }
+    else
+      {
+      // pixels with less than 4 valid dates are not fitted
+      t.clear();
+      values.clear();
+      offsets.assign(1, 0);
+      fitted.clear();
+      for (size_t p = 0; p < nbPixels; ++p)
+        {
+        const size_t o = p * nbDates;
+        const size_t begin = t.size();
+        for (size_t i = 0; i < nbDates; ++i)
+          {
+          if (!std::isnan(ts[o + i]) && IsValidLandValue(ts[o + i], msks[o + i]))
+            {
+            t.push_back(m_Dates[i]);
+            values.push_back(ts[o + i]);
+            }
+          }
+        if (t.size() - begin < 4)
+          {
+          t.resize(begin);
+          values.resize(begin);
+          std::fill(&results[o], &results[o] + nbDates, 0);
+          std::fill(&flags[o], &flags[o] + nbDates, 0);
+          }
+        else
+          {
+          offsets.push_back(t.size());
+          fitted.push_back(p);
+          }
+        }
+
+      if (!fitted.empty())
+        {
+        approximator.SetDates(t, offsets);
+        approximator.TwoCycleApproximation(values, yHat, pca, residualApprox);
+        }
+      for (size_t k = 0; k < fitted.size(); ++k)
+        {
+        const size_t o = fitted[k] * nbDates;
+        const auto &mm1 = pca.minmax[k];
+        const auto &mm2 = residualApprox.minmax[k];
+        int validDatesCnt = 0;
+        for (size_t i = 0; i < nbDates; ++i)
+          {
+          if (IsValidLandValue(ts[o + i], msks[o + i]))
+            {
+            results[o + i] = ModelType::Value(m_Dates[i], pca.x[k]) * (mm1.second - mm1.first) + mm1.first
+              + ModelType::Value(m_Dates[i], residualApprox.x[k]) * (mm2.second - mm2.first) + mm2.first;
+            flags[o + i] = ++validDatesCnt;
+            }
+          else
+            {
+            results[o + i] = NO_DATA_VALUE;
+            flags[o + i] = 0;
+            }
+          }
+        }
+      }
+
+    for (size_t p = 0; p < nbPixels; ++p, ++outIt)
+      {
+      const size_t o = p * nbDates;
+      if (m_GenerateAll)
+        {
+        for (size_t i = 0; i < nbDates; ++i)
+          {
+          outPix[i] = static_cast<OutputInternalPixelType>(results[o + i]);
+          outPix[nbDates + i] = static_cast<OutputInternalPixelType>(flags[o + i]);
+          }
+        }
+      else
+        {
+        // only the last date
+        outPix[0] = static_cast<OutputInternalPixelType>(results[o + nbDates - 1]);
+        outPix[1] = static_cast<OutputInternalPixelType>(flags[o + nbDates - 1]);
+        }
+      outIt.Set(outPix);
+      }
+    }
+}
+
+} // end namespace otb
+
+#endif
@@ -0,0 +1,119 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+
+#include "itkMacro.h"
+
+#include "otbDenseMLP.h"
+#include <random>
+#include <iostream>
+
+// reference: one sample at a time, tansig hidden layer, linear output
+// layer, normalisation of the inputs and of the output
+static double reference_mlp(const std::vector<double>& x,
+                            const std::vector<double>& w1, const std::vector<double>& b1,
+                            const std::vector<double>& w2, double b2,
+                            size_t nbInputs, size_t nbHidden)
+{
+  std::vector<double> xn(nbInputs);
+  for(size_t k=0; k<nbInputs; ++k)
+    xn[k] = 2.0*(x[k]-0.1)/0.5-1.0;
+  double y = b2;
+  for(size_t j=0; j<nbHidden; ++j)
+    {
+    double h = b1[j];
+    for(size_t k=0; k<nbInputs; ++k)
+      h += w1[j*nbInputs+k]*xn[k];
+    y += w2[j]*(2.0/(1.0+exp(-2.0*h))-1.0);
+    }
+  return 0.5*(y+1.0)*8.0;
+}
+
+template <typename T>
+static double max_error(const std::vector<std::vector<double>>& samples,
+                        const std::vector<double>& expected,
+                        const otb::DenseMLP<T>& mlp, size_t nbInputs)
+{
+  size_t nbSamples = samples.size();
+  std::vector<T> in(nbInputs*nbSamples);
+  for(size_t s=0; s<nbSamples; ++s)
+    for(size_t k=0; k<nbInputs; ++k)
+      in[k*nbSamples+s] = samples[s][k];
+  std::vector<T> out(nbSamples);
+  typename otb::DenseMLP<T>::Workspace ws;
+  mlp.Evaluate(in.data(), nbSamples, out.data(), ws);
+  double err{0};
+  for(size_t s=0; s<nbSamples; ++s)
+    err = std::max(err, std::fabs(out[s]-expected[s]));
+  return err;
+}
+
+template <typename T>
+static otb::DenseMLP<T> build_mlp(const std::vector<double>& w1, const std::vector<double>& b1,
+                                  const std::vector<double>& w2, double b2,
+                                  size_t nbInputs, size_t nbHidden)
+{
+  otb::DenseMLP<T> mlp;
+  mlp.AddLayer(nbInputs, nbHidden, w1.data(), b1.data(),
+               otb::DenseMLPActivation::SymmetricSigmoid, 2.0, 1.0);
+  mlp.AddLayer(nbHidden, 1, w2.data(), &b2, otb::DenseMLPActivation::Identity);
+  for(size_t k=0; k<nbInputs; ++k)
+    mlp.PrependInputTransform(k, 2.0/0.5, -2.0*0.1/0.5-1.0);
+  mlp.AppendOutputTransform(0, 4.0, 4.0);
+  return mlp;
+}
+
+int bvDenseMLP(int argc, char * argv[])
+{
+  if(argc>1)
+    {
+    for(auto i=0; i<argc; ++i)
+      std::cout << i << " --> " << argv[i] << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const size_t nbInputs{8};
+  const size_t nbHidden{5};
+  const size_t nbSamples{1000};
+
+  std::mt19937 rng(5);
+  std::uniform_real_distribution<> dw(-1.0, 1.0);
+  std::uniform_real_distribution<> dx(0.0, 0.7);
+
+  std::vector<double> w1(nbInputs*nbHidden), b1(nbHidden), w2(nbHidden);
+  for(auto& w : w1) w = dw(rng);
+  for(auto& b : b1) b = dw(rng);
+  for(auto& w : w2) w = dw(rng);
+  double b2 = dw(rng);
+
+  std::vector<std::vector<double>> samples(nbSamples, std::vector<double>(nbInputs));
+  std::vector<double> expected(nbSamples);
+  for(size_t s=0; s<nbSamples; ++s)
+    {
+    for(auto& x : samples[s]) x = dx(rng);
+    expected[s] = reference_mlp(samples[s], w1, b1, w2, b2, nbInputs, nbHidden);
+    }
+
+  auto err = max_error(samples, expected, build_mlp<double>(w1, b1, w2, b2, nbInputs, nbHidden), nbInputs);
+  std::cout << "Max error (double): " << err << std::endl;
+  if(err > 1e-10)
+    return EXIT_FAILURE;
+
+  auto errF = max_error(samples, expected, build_mlp<float>(w1, b1, w2, b2, nbInputs, nbHidden), nbInputs);
+  std::cout << "Max error (float): " << errF << std::endl;
+  if(errF > 1e-4)
+    return EXIT_FAILURE;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,104 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+
+#include "itkMacro.h"
+#include "otbProSailSimulationEngine.h"
+#include <random>
+
+int bvProSailSimulationEngine(int argc, char * argv[])
+{
+  if(argc<2)
+    {
+    std::cout << " At least one parameter is needed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  typedef double PrecisionType;
+  typedef otb::SatelliteRSR<PrecisionType, PrecisionType>  SatRSRType;
+  typedef otb::Functor::ProSailSimulator<SatRSRType> ProSailType;
+  typedef otb::ProSailSimulationEngine<SatRSRType> EngineType;
+  auto satRSR = SatRSRType::New();
+  satRSR->SetNbBands(4);
+  satRSR->SetSortBands(false);
+  satRSR->Load(argv[1]);
+
+  typename otb::AcquisitionParsType prosailPars;
+  prosailPars[otb::TTS] = 0.6476*(180.0/3.141592);
+  prosailPars[otb::TTO] = 0.30456*(180.0/3.141592);
+  prosailPars[otb::PSI] = -2.5952*(180.0/3.141592);
+  prosailPars[otb::TTS_FAPAR] = prosailPars[otb::TTS];
+
+  std::mt19937 rng(5);
+  std::uniform_real_distribution<> u(0.0, 1.0);
+  std::vector<otb::BVType> samples(150);
+  for(auto& bv : samples)
+    {
+    bv[otb::IVNames::MLAI] = 6*u(rng);
+    bv[otb::IVNames::ALA] = 30+50*u(rng);
+    bv[otb::IVNames::CrownCover] = 1;
+    bv[otb::IVNames::HsD] = 0.1+0.4*u(rng);
+    bv[otb::IVNames::N] = 1.2+0.6*u(rng);
+    bv[otb::IVNames::Cab] = 20+70*u(rng);
+    bv[otb::IVNames::Car] = 0;
+    bv[otb::IVNames::Cdm] = 0.003+0.008*u(rng);
+    bv[otb::IVNames::CwRel] = 0.6+0.25*u(rng);
+    bv[otb::IVNames::Cbp] = 0.5*u(rng);
+    bv[otb::IVNames::Bs] = 0.5+0.7*u(rng);
+    }
+
+  EngineType engine;
+  engine.SetRSR(satRSR);
+  engine.SetParameters(prosailPars);
+  if(!engine.GetBandWeights().IsExact())
+    {
+    std::cout << "The band weights do not reproduce the spectral response reduction" << std::endl;
+    return EXIT_FAILURE;
+    }
+  auto simus = engine.Simulate(samples, 3);
+
+  ProSailType prosail;
+  prosail.SetRSR(satRSR);
+  prosail.SetParameters(prosailPars);
+  auto tolerance = double{1e-8};
+  for(size_t s=0; s<samples.size(); s++)
+    {
+    prosail.SetBVs(samples[s]);
+    auto ref_pix = prosail();
+    if(ref_pix.size() != simus[s].size())
+      {
+      std::cout << "Wrong simulation size for sample " << s << std::endl;
+      return EXIT_FAILURE;
+      }
+    for(size_t i=0; i<ref_pix.size(); i++)
+      if(fabs(ref_pix[i]-simus[s][i]) > tolerance)
+        {
+        std::cout << "Sample " << s << " band " << i << ": " << simus[s][i]
+                  << " instead of " << ref_pix[i] << std::endl;
+        return EXIT_FAILURE;
+        }
+    }
+
+  // the noise only depends on the seed
+  engine.SetNoise(std::vector<double>(4, 0.01), 42);
+  auto noisy1 = engine.Simulate(samples, 1);
+  auto noisy4 = engine.Simulate(samples, 4);
+  if(noisy1 != noisy4)
+    {
+    std::cout << "The noisy simulations depend on the number of threads" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -31,9 +31,12 @@
 void RegisterTests()
 {
   REGISTER_TEST(bvProSailSimulatorFunctor);
+  REGISTER_TEST(bvProSailSimulationEngine);
   REGISTER_TEST(bvMultiLinearFitting);
   REGISTER_TEST(bvMultiLinearFittingConversions);
   REGISTER_TEST(bvMultiTemporalInversion);
   REGISTER_TEST(bvMultiTemporalInversionFromFile);
   REGISTER_TEST(bvLaiLogNdvi);
+  REGISTER_TEST(bvDenseMLP);
+  REGISTER_TEST(bvProfileReprocessing);
 }
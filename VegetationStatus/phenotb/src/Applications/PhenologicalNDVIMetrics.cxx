@@ -32,6 +32,8 @@
 #include "otbWrapperChoiceParameter.h"
 
 #include "phenoFunctions.h"
+#include "phenoBatchFitting.h"
+#include "phenoBinaryBatchFunctorImageFilter.h"
 #include "GlobalDefs.h"
 
 // we have 4 phenological parameters and 1 band for the flags
@@ -44,6 +46,14 @@ class PhenologicalNDVIMetricsFunctor
 protected:
   VectorType dv;
 
+  // buffers of the block processing
+  std::vector<double> batch_t;
+  std::vector<double> batch_values;
+  std::vector<size_t> batch_offsets;
+  std::vector<size_t> batch_indices;
+  normalized_sigmoid::BatchApproximator batch_approximator;
+  normalized_sigmoid::BatchApproximator::Result batch_princ_cycle;
+
 public:
   struct DifferentSizes {};
   PhenologicalNDVIMetricsFunctor() {};
@@ -88,8 +98,65 @@ public:
 
     auto approx = normalized_sigmoid::TwoCycleApproximation(profile, t);
     auto princ_cycle = std::get<1>(approx);
-    auto x_hat = std::get<0>(princ_cycle);
-    auto min_max = std::get<1>(princ_cycle);
+    SetMetrics(std::get<0>(princ_cycle), std::get<1>(princ_cycle), profile.size(), result);
+
+    return result;
+  }
+
+  // Same as above on a block of pixels: all the valid profiles of the block
+  // are fitted together by the batch approximator
+  void operator()(const std::vector<PixelType>& pix, const std::vector<PixelType>& mask,
+                  size_t nbPixels, std::vector<PixelType>& result)
+  {
+    batch_t.clear();
+    batch_values.clear();
+    batch_offsets.assign(1, 0);
+    batch_indices.clear();
+    for(size_t p=0; p<nbPixels; p++)
+    {
+      if(result[p].GetSize() != RESULT_BANDS_NO)
+        result[p].SetSize(RESULT_BANDS_NO);
+      result[p].Fill(0);
+
+      auto nbDates = pix[p].GetSize();
+      if(dv.size()!=nbDates) throw DifferentSizes{};
+
+      // A date is valid if it is not NaN and the mask value == 0.
+      auto first = batch_t.size();
+      for(size_t i=0; i<nbDates; i++)
+      {
+        double v = pix[p][i];
+        if(!(std::isnan(v)) && (v >= 0) &&
+           (mask[p][i]==(typename PixelType::ValueType{IMG_FLG_LAND}))) {
+          batch_t.push_back(dv[i]);
+          batch_values.push_back(v);
+        }
+      }
+
+      // If there are not enough valid dates, keep the original value
+      if(batch_t.size() - first < 4) {
+        batch_t.resize(first);
+        batch_values.resize(first);
+        continue;
+      }
+      batch_offsets.push_back(batch_t.size());
+      batch_indices.push_back(p);
+    }
+
+    if(batch_indices.empty()) return;
+
+    // only the principal cycle is used for the metrics
+    batch_approximator.SetDates(batch_t, batch_offsets);
+    batch_approximator.PrincipalCycleApproximation(batch_values, batch_princ_cycle);
+    for(size_t k=0; k<batch_indices.size(); k++)
+    {
+      SetMetrics(batch_princ_cycle.x[k], batch_princ_cycle.minmax[k], batch_offsets[k+1]-batch_offsets[k], result[batch_indices[k]]);
+    }
+  }
+
+  template <ContainerC V>
+  void SetMetrics(const V& x_hat, const MinMaxType& min_max, size_t nbValidDates, PixelType& result) const
+  {
     auto A_hat = min_max.second - min_max.first;
     auto B_hat = min_max.first;
 
@@ -105,10 +172,8 @@ public:
         result[1] = t0;
         result[2] = (t2-t1);
         result[3] = t3;
-        result[4] = profile.size();
+        result[4] = nbValidDates;
     }
-
-    return result;
   }
 
   bool operator!=(const PhenologicalNDVIMetricsFunctor a)
@@ -147,6 +212,9 @@ public:
   using FilterType = pheno::BinaryFunctorImageFilterWithNBands<FloatVectorImageType,
                                                                FloatVectorImageType,
                                                                FunctorType>;
+  using BatchFilterType = pheno::BinaryBatchFunctorImageFilter<FloatVectorImageType,
+                                                               FloatVectorImageType,
+                                                               FunctorType>;
 
 
 private:
@@ -177,6 +245,10 @@ private:
     SetParameterDescription("mode", "Choose between producing as output the reprocessed profile or the parametres of the two-cycle sigmoid. Default value is profile.");
     MandatoryOff("mode");
 
+    AddParameter(ParameterType_Bool, "batchfit", "Fit the pixels by blocks");
+    SetParameterDescription("batchfit", "Fit the profiles by blocks of pixels with the batch Levenberg-Marquardt minimizer using analytic derivatives, instead of one pixel at a time with the vnl minimizer. Faster, but not yet validated against the vnl fitting.");
+    MandatoryOff("batchfit");
+
     AddParameter(ParameterType_OutputImage, "out",  "Output Image");
     SetParameterDescription("out", "Output image");
     MandatoryOn("out");
@@ -205,19 +277,31 @@ private:
     FloatVectorImageType::Pointer maskImage = this->GetParameterImage("mask");
     inputImage->UpdateOutputInformation();
     maskImage->UpdateOutputInformation();
-    filter = FilterType::New();
-
-    filter->SetInput(0, inputImage);
-    filter->SetInput(1, maskImage);
-    filter->GetFunctor().SetDates(dates);
-    filter->SetNumberOfOutputBands(RESULT_BANDS_NO);
-    filter->UpdateOutputInformation();
-    // the pheno ndvi metrics are already int values as they are only dates
-    SetParameterOutputImage("out", filter->GetOutput());
+    if(GetParameterInt("batchfit")) {
+      batchFilter = BatchFilterType::New();
+
+      batchFilter->SetInput(0, inputImage);
+      batchFilter->SetInput(1, maskImage);
+      batchFilter->GetFunctor().SetDates(dates);
+      batchFilter->SetNumberOfOutputBands(RESULT_BANDS_NO);
+      batchFilter->UpdateOutputInformation();
+      SetParameterOutputImage("out", batchFilter->GetOutput());
+    } else {
+      filter = FilterType::New();
+
+      filter->SetInput(0, inputImage);
+      filter->SetInput(1, maskImage);
+      filter->GetFunctor().SetDates(dates);
+      filter->SetNumberOfOutputBands(RESULT_BANDS_NO);
+      filter->UpdateOutputInformation();
+      // the pheno ndvi metrics are already int values as they are only dates
+      SetParameterOutputImage("out", filter->GetOutput());
+    }
     SetParameterOutputImagePixelType("out", ImagePixelType_int16);
   }
 
   FilterType::Pointer filter;
+  BatchFilterType::Pointer batchFilter;
 
 };
 
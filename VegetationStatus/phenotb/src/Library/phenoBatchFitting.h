@@ -0,0 +1,410 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+#ifndef _PHENOBATCHFITTING_H_
+#define _PHENOBATCHFITTING_H_
+
+#include <array>
+#include <vector>
+#include <cmath>
+#include <limits>
+#include "phenoFunctions.h"
+
+namespace pheno
+{
+
+/** Levenberg-Marquardt least squares fitting of a model with NbPars
+    parameters on a batch of independent profiles.
+
+    The profiles are concatenated: the values of profile p are
+    [offsets[p], offsets[p+1]). All the profiles are iterated in lockstep
+    (normal equations of every running profile, then the steps, then the
+    trial costs), so that each pass runs over contiguous memory.
+
+    The model is a class providing
+      static double Value(double t, const ParametersType& x);
+      static double Value(double t, const ParametersType& x, ParametersType& dfdx);
+    the Jacobian is therefore analytic, and nothing is allocated once the
+    internal buffers have reached the size of the largest batch.
+
+    The stopping criterion is the relative reduction of the sum of squares
+    (f_tolerance), as with the vnl minimizer used by optimize().
+*/
+template <unsigned int NbPars, typename ModelType>
+class BatchLevenbergMarquardt
+{
+public:
+  using ParametersType = std::array<double, NbPars>;
+
+  BatchLevenbergMarquardt() : m_FTolerance{1e-10}, m_MaxIterations{400} {}
+
+  void SetFTolerance(double ftol) { m_FTolerance = ftol; }
+  void SetMaxIterations(unsigned int maxit) { m_MaxIterations = maxit; }
+
+  /** Fit every profile. x holds the initial guesses and receives the
+      results, err receives the RMS of the residuals at the solution. */
+  void Minimize(const double* t, const double* y, const size_t* offsets,
+                size_t nbProfiles, ParametersType* x, double* err)
+  {
+    if(m_States.size() < nbProfiles)
+      m_States.resize(nbProfiles);
+
+    for(size_t p=0; p<nbProfiles; ++p)
+      {
+      auto& s = m_States[p];
+      s.lambda = 1e-3;
+      s.running = offsets[p+1] > offsets[p];
+      s.update = true;
+      s.cost = 0.0;
+      }
+
+    size_t nbRunning{nbProfiles};
+    for(unsigned int it=0; it<m_MaxIterations && nbRunning>0; ++it)
+      {
+      // normal equations at the current solution
+      for(size_t p=0; p<nbProfiles; ++p)
+        {
+        auto& s = m_States[p];
+        if(s.running && s.update)
+          NormalEquations(t+offsets[p], y+offsets[p], offsets[p+1]-offsets[p], x[p], s);
+        }
+      // damped steps
+      for(size_t p=0; p<nbProfiles; ++p)
+        {
+        auto& s = m_States[p];
+        if(s.running && !std::isfinite(s.cost))
+          s.running = false;
+        if(s.running)
+          s.valid = Step(s, x[p]);
+        }
+      // costs at the trial points
+      for(size_t p=0; p<nbProfiles; ++p)
+        {
+        auto& s = m_States[p];
+        if(s.running && s.valid)
+          s.trialCost = Cost(t+offsets[p], y+offsets[p], offsets[p+1]-offsets[p], s.trial);
+        }
+      // acceptance and convergence
+      nbRunning = 0;
+      for(size_t p=0; p<nbProfiles; ++p)
+        {
+        auto& s = m_States[p];
+        if(!s.running) continue;
+        if(s.valid && s.trialCost < s.cost)
+          {
+          auto reduction = (s.cost - s.trialCost) / s.cost;
+          x[p] = s.trial;
+          s.cost = s.trialCost;
+          s.lambda = std::max(s.lambda * 0.1, 1e-12);
+          s.update = true;
+          if(reduction <= m_FTolerance || s.cost == 0.0)
+            s.running = false;
+          }
+        else
+          {
+          s.lambda *= 10.0;
+          s.update = false;
+          if(s.lambda > 1e16)
+            s.running = false;
+          }
+        if(s.running) ++nbRunning;
+        }
+      }
+
+    for(size_t p=0; p<nbProfiles; ++p)
+      {
+      auto n = offsets[p+1]-offsets[p];
+      err[p] = (n>0) ? std::sqrt(Cost(t+offsets[p], y+offsets[p], n, x[p])/n) : 0.0;
+      }
+  }
+
+private:
+  struct State
+  {
+    // upper triangle of J^T J, row by row
+    std::array<double, NbPars*(NbPars+1)/2> jtj;
+    ParametersType jtr;
+    ParametersType trial;
+    double cost;
+    double trialCost;
+    double lambda;
+    bool running;
+    bool update;
+    bool valid;
+  };
+
+  static double Cost(const double* t, const double* y, size_t n, const ParametersType& x)
+  {
+    double cost{0};
+    for(size_t i=0; i<n; ++i)
+      {
+      auto r = y[i] - ModelType::Value(t[i], x);
+      cost += r*r;
+      }
+    return cost;
+  }
+
+  static void NormalEquations(const double* t, const double* y, size_t n,
+                              const ParametersType& x, State& s)
+  {
+    s.jtj.fill(0.0);
+    s.jtr.fill(0.0);
+    s.cost = 0.0;
+    ParametersType g;
+    for(size_t i=0; i<n; ++i)
+      {
+      auto r = y[i] - ModelType::Value(t[i], x, g);
+      s.cost += r*r;
+      for(unsigned int j=0, k=0; j<NbPars; ++j)
+        {
+        s.jtr[j] += g[j]*r;
+        for(unsigned int l=j; l<NbPars; ++l, ++k)
+          s.jtj[k] += g[j]*g[l];
+        }
+      }
+  }
+
+  /** Solve (J^T J + lambda diag(J^T J)) dx = J^T r with a Cholesky
+      decomposition and set the trial point. Returns false if the
+      system is not positive definite. */
+  static bool Step(State& s, const ParametersType& x)
+  {
+    double a[NbPars][NbPars];
+    for(unsigned int j=0, k=0; j<NbPars; ++j)
+      for(unsigned int l=j; l<NbPars; ++l, ++k)
+        a[j][l] = a[l][j] = s.jtj[k];
+    for(unsigned int j=0; j<NbPars; ++j)
+      a[j][j] += s.lambda * std::max(a[j][j], 1e-12);
+
+    for(unsigned int j=0; j<NbPars; ++j)
+      {
+      auto d = a[j][j];
+      for(unsigned int k=0; k<j; ++k)
+        d -= a[j][k]*a[j][k];
+      if(!(d > 0.0))
+        return false;
+      a[j][j] = std::sqrt(d);
+      for(unsigned int l=j+1; l<NbPars; ++l)
+        {
+        auto v = a[l][j];
+        for(unsigned int k=0; k<j; ++k)
+          v -= a[l][k]*a[j][k];
+        a[l][j] = v / a[j][j];
+        }
+      }
+
+    ParametersType dx;
+    for(unsigned int j=0; j<NbPars; ++j)
+      {
+      auto v = s.jtr[j];
+      for(unsigned int k=0; k<j; ++k)
+        v -= a[j][k]*dx[k];
+      dx[j] = v / a[j][j];
+      }
+    for(unsigned int j=NbPars; j-- > 0;)
+      {
+      auto v = dx[j];
+      for(unsigned int k=j+1; k<NbPars; ++k)
+        v -= a[k][j]*dx[k];
+      dx[j] = v / a[j][j];
+      }
+
+    for(unsigned int j=0; j<NbPars; ++j)
+      {
+      s.trial[j] = x[j] + dx[j];
+      if(!std::isfinite(s.trial[j]))
+        return false;
+      }
+    return true;
+  }
+
+  double m_FTolerance;
+  unsigned int m_MaxIterations;
+  std::vector<State> m_States;
+};
+
+namespace normalized_sigmoid{
+
+/// The normalised double sigmoid (see F) and its analytic derivatives
+struct DoubleSigmoidModel
+{
+  using ParametersType = std::array<double, 4>;
+
+  static inline double Value(double t, const ParametersType& x)
+  {
+    return 1.0/(1.0+exp((x[0]-t)/x[1]))-1.0/(1.0+exp((x[2]-t)/x[3]));
+  }
+
+  static inline double Value(double t, const ParametersType& x, ParametersType& dfdx)
+  {
+    auto s1 = 1.0/(1.0+exp((x[0]-t)/x[1]));
+    auto s2 = 1.0/(1.0+exp((x[2]-t)/x[3]));
+    auto d1 = s1*(1.0-s1)/x[1];
+    auto d2 = s2*(1.0-s2)/x[3];
+    dfdx[0] = -d1;
+    dfdx[1] = d1*(x[0]-t)/x[1];
+    dfdx[2] = d2;
+    dfdx[3] = -d2*(x[2]-t)/x[3];
+    return s1-s2;
+  }
+};
+
+/** Batched version of Approximation, PrincipalCycleApproximation and
+    TwoCycleApproximation.
+
+    The dates of the profiles are concatenated (see SetDates) and the
+    values are given as vectors following the same layout. The results
+    (yHat, residuals) use the same layout too. The object keeps its
+    buffers between calls, so one instance should be used per thread.
+*/
+class BatchApproximator
+{
+public:
+  using FitterType = BatchLevenbergMarquardt<4, DoubleSigmoidModel>;
+  using ParametersType = DoubleSigmoidModel::ParametersType;
+
+  struct Result
+  {
+    std::vector<ParametersType> x;
+    std::vector<MinMaxType> minmax;
+    std::vector<double> yHat;
+    std::vector<double> residuals;
+    std::vector<ApproximationErrorType> err;
+
+    void Resize(size_t nbProfiles, size_t nbValues)
+    {
+      x.resize(nbProfiles);
+      minmax.resize(nbProfiles);
+      err.resize(nbProfiles);
+      yHat.resize(nbValues);
+      residuals.resize(nbValues);
+    }
+
+    /// The result of profile p, as returned by Approximation
+    ApproximationResultType Get(size_t p, const std::vector<size_t>& offsets) const
+    {
+      VectorType xp(x[p].data(), 4);
+      VectorType yp(yHat.data()+offsets[p], offsets[p+1]-offsets[p]);
+      VectorType rp(residuals.data()+offsets[p], offsets[p+1]-offsets[p]);
+      return ApproximationResultType{xp, minmax[p], yp, rp, err[p]};
+    }
+  };
+
+  FitterType& GetFitter() { return m_Fitter; }
+
+  /// Dates of all the profiles and offsets of each profile (nbProfiles+1 values)
+  void SetDates(const std::vector<double>& t, const std::vector<size_t>& offsets)
+  {
+    m_T = t.data();
+    m_Offsets = offsets.data();
+    m_NbProfiles = offsets.size()-1;
+    m_NbValues = offsets.back();
+  }
+
+  void Approximation(const std::vector<double>& profiles, Result& result)
+  {
+    result.Resize(m_NbProfiles, m_NbValues);
+    m_Weighted.resize(m_NbValues);
+    for(size_t p=0; p<m_NbProfiles; ++p)
+      {
+      auto b = m_Offsets[p];
+      auto e = m_Offsets[p+1];
+      result.x[p].fill(0.0);
+      result.minmax[p] = std::make_pair(0.0, 0.0);
+      if(b==e) continue;
+      // same conventions as std::minmax_element: first min, last max
+      size_t pmin{b}, pmax{b};
+      for(size_t i=b+1; i<e; ++i)
+        {
+        if(profiles[i] < profiles[pmin]) pmin = i;
+        if(!(profiles[i] < profiles[pmax])) pmax = i;
+        }
+      auto vmin = profiles[pmin];
+      auto vmax = profiles[pmax];
+      auto t_max = m_T[pmax];
+      auto* prof = result.residuals.data();
+      for(size_t i=b; i<e; ++i)
+        prof[i] = (profiles[i]-vmin)/(vmax-vmin);
+      // guesstimator uses the first max of the normalized profile
+      size_t pfirst{b};
+      for(size_t i=b+1; i<e; ++i)
+        if(prof[pfirst] < prof[i]) pfirst = i;
+      result.x[p] = ParametersType{{m_T[pfirst]-25, 10.0, m_T[pfirst]+25, 10.0}};
+      for(size_t i=b; i<e; ++i)
+        m_Weighted[i] = prof[i]*gaussianFunction(m_T[i], t_max, 75.0);
+      result.minmax[p] = std::make_pair(vmin, vmax);
+      }
+
+    m_Fitter.Minimize(m_T, m_Weighted.data(), m_Offsets, m_NbProfiles,
+                      result.x.data(), result.err.data());
+
+    for(size_t p=0; p<m_NbProfiles; ++p)
+      {
+      auto vmin = result.minmax[p].first;
+      auto scale = result.minmax[p].second - vmin;
+      for(size_t i=m_Offsets[p]; i<m_Offsets[p+1]; ++i)
+        {
+        auto y = DoubleSigmoidModel::Value(m_T[i], result.x[p]);
+        result.residuals[i] = (result.residuals[i]-y)*scale;
+        result.yHat[i] = y*scale+vmin;
+        }
+      }
+  }
+
+  void PrincipalCycleApproximation(const std::vector<double>& profiles, Result& result)
+  {
+    // Profile approximation
+    Approximation(profiles, m_First);
+    m_Values.resize(m_NbValues);
+    for(size_t p=0; p<m_NbProfiles; ++p)
+      for(size_t i=m_Offsets[p]; i<m_Offsets[p+1]; ++i)
+        m_Values[i] = m_First.residuals[i] + m_First.minmax[p].first;
+
+    // Residual approximation
+    Approximation(m_Values, m_First);
+
+    // Subtract the residual approximation from the original profile
+    for(size_t i=0; i<m_NbValues; ++i)
+      m_Values[i] = profiles[i] - m_First.yHat[i];
+
+    // Approx the original minus the residuals
+    Approximation(m_Values, result);
+    for(size_t i=0; i<m_NbValues; ++i)
+      result.residuals[i] = profiles[i] - result.yHat[i];
+  }
+
+  /// yHat receives the sum of the two approximations
+  void TwoCycleApproximation(const std::vector<double>& profiles, std::vector<double>& yHat,
+                             Result& pca, Result& residual_approx)
+  {
+    PrincipalCycleApproximation(profiles, pca);
+    Approximation(pca.residuals, residual_approx);
+    yHat.resize(m_NbValues);
+    for(size_t i=0; i<m_NbValues; ++i)
+      yHat[i] = pca.yHat[i] + residual_approx.yHat[i];
+  }
+
+private:
+  FitterType m_Fitter;
+  const double* m_T{nullptr};
+  const size_t* m_Offsets{nullptr};
+  size_t m_NbProfiles{0};
+  size_t m_NbValues{0};
+  std::vector<double> m_Weighted;
+  std::vector<double> m_Values;
+  Result m_First;
+};
+}
+}
+#endif
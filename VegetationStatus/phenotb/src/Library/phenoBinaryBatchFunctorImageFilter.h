@@ -0,0 +1,132 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+#ifndef _PHENOBINARYBATCHFUNCTORIMAGEFILTER_H_
+#define _PHENOBINARYBATCHFUNCTORIMAGEFILTER_H_
+
+#include <vector>
+#include "itkImageToImageFilter.h"
+#include "itkImageRegionIterator.h"
+#include "itkImageRegionConstIterator.h"
+
+namespace pheno
+{
+/** Binary functor image filter which gives the pixels to the functor by
+    blocks instead of one at a time, and produces a vector image with a
+    number of bands different from the input images.
+
+    The functor must provide
+      void operator()(const std::vector<PixelType>& pix,
+                      const std::vector<PixelType>& mask,
+                      size_t nbPixels,
+                      std::vector<OutputPixelType>& result);
+    where only the first nbPixels elements of the vectors are used. Each
+    thread works on its own copy of the functor, which can therefore keep
+    buffers between blocks.
+*/
+template <class TInputImage, class TOutputImage, class TFunctor>
+class ITK_EXPORT BinaryBatchFunctorImageFilter :
+    public itk::ImageToImageFilter<TInputImage, TOutputImage>
+{
+public:
+  typedef BinaryBatchFunctorImageFilter Self;
+  typedef itk::ImageToImageFilter<TInputImage, TOutputImage> Superclass;
+  typedef itk::SmartPointer<Self>       Pointer;
+  typedef itk::SmartPointer<const Self> ConstPointer;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Macro defining the type*/
+  itkTypeMacro(BinaryBatchFunctorImageFilter, ImageToImageFilter);
+
+  typedef TInputImage                               InputImageType;
+  typedef typename InputImageType::PixelType        InputPixelType;
+  typedef TOutputImage                              OutputImageType;
+  typedef typename OutputImageType::PixelType       OutputPixelType;
+  typedef typename OutputImageType::RegionType      OutputImageRegionType;
+  typedef TFunctor                                  FunctorType;
+
+  /** Accessors for the number of bands*/
+  itkSetMacro(NumberOfOutputBands, unsigned int);
+  itkGetConstMacro(NumberOfOutputBands, unsigned int);
+
+  /** Number of pixels given at once to the functor */
+  itkSetMacro(BlockSize, unsigned int);
+  itkGetConstMacro(BlockSize, unsigned int);
+
+  FunctorType& GetFunctor()
+  {
+    this->Modified();
+    return m_Functor;
+  }
+
+  const FunctorType& GetFunctor() const
+  {
+    return m_Functor;
+  }
+
+protected:
+  BinaryBatchFunctorImageFilter() : m_NumberOfOutputBands{1}, m_BlockSize{256}
+  {
+    this->SetNumberOfRequiredInputs(2);
+  }
+  virtual ~BinaryBatchFunctorImageFilter() {}
+
+  void GenerateOutputInformation()
+  {
+    Superclass::GenerateOutputInformation();
+    this->GetOutput()->SetNumberOfComponentsPerPixel( m_NumberOfOutputBands );
+  }
+
+  void ThreadedGenerateData(const OutputImageRegionType& outputRegionForThread,
+                            itk::ThreadIdType itkNotUsed(threadId))
+  {
+    auto functor = m_Functor;
+
+    itk::ImageRegionConstIterator<InputImageType> pixIt(this->GetInput(0), outputRegionForThread);
+    itk::ImageRegionConstIterator<InputImageType> maskIt(this->GetInput(1), outputRegionForThread);
+    itk::ImageRegionIterator<OutputImageType> outIt(this->GetOutput(), outputRegionForThread);
+
+    std::vector<InputPixelType> pixels(m_BlockSize);
+    std::vector<InputPixelType> masks(m_BlockSize);
+    std::vector<OutputPixelType> results(m_BlockSize);
+
+    pixIt.GoToBegin();
+    maskIt.GoToBegin();
+    outIt.GoToBegin();
+    while(!pixIt.IsAtEnd())
+      {
+      size_t nbPixels{0};
+      for(; nbPixels<m_BlockSize && !pixIt.IsAtEnd(); ++nbPixels, ++pixIt, ++maskIt)
+        {
+        pixels[nbPixels] = pixIt.Get();
+        masks[nbPixels] = maskIt.Get();
+        }
+      functor(pixels, masks, nbPixels, results);
+      for(size_t i=0; i<nbPixels; ++i, ++outIt)
+        outIt.Set(results[i]);
+      }
+  }
+
+private:
+  BinaryBatchFunctorImageFilter(const Self &); //purposely not implemented
+  void operator =(const Self&); //purposely not implemented
+
+  FunctorType m_Functor;
+  unsigned int m_NumberOfOutputBands;
+  unsigned int m_BlockSize;
+};
+}
+#endif
@@ -38,4 +38,5 @@ void RegisterTests()
   REGISTER_TEST(phenoEarlyEmergence);
   REGISTER_TEST(phenoEarlyEmergenceCB);
   REGISTER_TEST(phenoTwoCycleFittingFunctor);
+  REGISTER_TEST(phenoBatchFitting);
 }
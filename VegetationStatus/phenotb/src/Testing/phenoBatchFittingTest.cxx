@@ -0,0 +1,114 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+#include "itkMacro.h"
+#include "phenoBatchFitting.h"
+#include <random>
+#include <vector>
+
+// The batch fitting of synthetic two cycle profiles must give the same
+// principal cycle as the per pixel vnl fitting, on average and for the
+// worst profile
+int phenoBatchFitting(int argc, char * argv[])
+{
+  if(argc>1)
+    {
+    for(auto i=0; i<argc; ++i)
+      std::cout << i << " --> " << argv[i] << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const size_t nbProfiles{100};
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<> u(0.0, 1.0);
+  std::normal_distribution<> noise(0.0, 0.01);
+
+  std::vector<double> t;
+  std::vector<double> y;
+  std::vector<size_t> offsets{0};
+  for(size_t p=0; p<nbProfiles; ++p)
+    {
+    pheno::normalized_sigmoid::DoubleSigmoidModel::ParametersType x1{{60+60*u(rng), 5+10*u(rng),
+          180+40*u(rng), 5+10*u(rng)}};
+    pheno::normalized_sigmoid::DoubleSigmoidModel::ParametersType x2{{250+20*u(rng), 7.0,
+          310+20*u(rng), 5.0}};
+    auto a1 = 0.5+0.4*u(rng);
+    auto a2 = 0.1*u(rng);
+    auto nbDates = 15+p%15;
+    for(size_t i=0; i<nbDates; ++i)
+      {
+      auto d = 10.0+i*(350.0/nbDates)+5*u(rng);
+      t.push_back(d);
+      y.push_back(0.1
+                  + a1*pheno::normalized_sigmoid::DoubleSigmoidModel::Value(d, x1)
+                  + a2*pheno::normalized_sigmoid::DoubleSigmoidModel::Value(d, x2)
+                  + noise(rng));
+      }
+    offsets.push_back(t.size());
+    }
+
+  pheno::normalized_sigmoid::BatchApproximator approximator;
+  pheno::normalized_sigmoid::BatchApproximator::Result result;
+  approximator.SetDates(t, offsets);
+  approximator.PrincipalCycleApproximation(y, result);
+
+  // the difference of the fitted profiles, relative to the amplitude, and of
+  // the fit errors, averaged over the profiles and for the worst profile
+  double meanDiff{0};
+  double maxDiff{0};
+  double meanErrDiff{0};
+  double maxErrDiff{0};
+  size_t worstProfile{0};
+  for(size_t p=0; p<nbProfiles; ++p)
+    {
+    auto n = offsets[p+1]-offsets[p];
+    pheno::VectorType profile(y.data()+offsets[p], n);
+    pheno::VectorType dates(t.data()+offsets[p], n);
+    auto reference = pheno::normalized_sigmoid::PrincipalCycleApproximation(profile, dates);
+    auto batch = result.Get(p, offsets);
+
+    auto amplitude = std::get<1>(reference).second - std::get<1>(reference).first;
+    auto yHatRef = std::get<2>(reference);
+    auto yHat = std::get<2>(batch);
+    double diff{0};
+    for(size_t i=0; i<n; ++i)
+      diff = std::max(diff, fabs(yHat[i]-yHatRef[i])/amplitude);
+    auto errDiff = fabs(std::get<4>(batch)-std::get<4>(reference));
+
+    meanDiff += diff/nbProfiles;
+    meanErrDiff += errDiff/nbProfiles;
+    if(diff > maxDiff)
+      {
+      maxDiff = diff;
+      worstProfile = p;
+      }
+    maxErrDiff = std::max(maxErrDiff, errDiff);
+    }
+
+  std::cout << "Relative profile difference: mean " << meanDiff << ", max " << maxDiff
+            << " (profile " << worstProfile << ")" << std::endl;
+  std::cout << "Error difference: mean " << meanErrDiff << ", max " << maxErrDiff << std::endl;
+  if(meanDiff > 1e-3 || maxDiff > 1e-2 || meanErrDiff > 1e-4 || maxErrDiff > 1e-3)
+    {
+    auto n = offsets[worstProfile+1]-offsets[worstProfile];
+    pheno::VectorType profile(y.data()+offsets[worstProfile], n);
+    pheno::VectorType dates(t.data()+offsets[worstProfile], n);
+    auto reference = pheno::normalized_sigmoid::PrincipalCycleApproximation(profile, dates);
+    auto batch = result.Get(worstProfile, offsets);
+    std::cout << "x batch: " << std::get<0>(batch) << std::endl;
+    std::cout << "x vnl:   " << std::get<0>(reference) << std::endl;
+    return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
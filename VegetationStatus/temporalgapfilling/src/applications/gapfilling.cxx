@@ -62,23 +62,17 @@ int main(int argc, char** argv)
     {
     std::cout << "Using linear interpolation and " << cpd
               << " components per date " << std::endl;
-    GapFilling::gapfill_time_series<ImageType, LinearFunctorType>(argv[1],
-                                                                  argv[2],
-                                                                  argv[3],
-                                                                  cpd,
-                                                                  in_date_file,
-                                                                  out_date_file);
+    GapFilling::gapfill_time_series_fixed_size<
+      ImageType, GapFilling::FixedSizeLinearGapFillingFunctor,
+      LinearFunctorType>(argv[1], argv[2], argv[3], cpd, in_date_file, out_date_file);
     }
   else
     {
     std::cout << "Using spline interpolation and " << cpd
               << " components per date " << std::endl;
-    GapFilling::gapfill_time_series<ImageType, SplineFunctorType>(argv[1],
-                                                                  argv[2],
-                                                                  argv[3],
-                                                                  cpd,
-                                                                  in_date_file,
-                                                                  out_date_file);
+    GapFilling::gapfill_time_series_fixed_size<
+      ImageType, GapFilling::FixedSizeSplineGapFillingFunctor,
+      SplineFunctorType>(argv[1], argv[2], argv[3], cpd, in_date_file, out_date_file);
     }
   return EXIT_SUCCESS;
 }
@@ -36,9 +36,11 @@
 #include "otbStandardFilterWatcher.h"
 #include "itkBinaryFunctorImageFilter.h"
 #include <vector>
+#include <algorithm>
 #include <tuple>
 #include <stdexcept>
 #include <cmath>
+#include <limits>
 #include <gsl/gsl_errno.h>
 #include <gsl/gsl_spline.h>
 
@@ -506,6 +508,425 @@ protected:
 PixelType odv;
 };
 
+/**
+Base of the gap filling functors for time series of at most MaxDates
+dates, counting the interlaced input and output dates. Everything which
+only depends on the dates (interlacing, position of the output dates in
+the interlaced series) is computed once when the functor is built, and the
+pixels are processed with stack arrays. The results are the same as those
+of the LinearGapFillingFunctor and SplineGapFillingFunctor.
+*/
+template <typename PixelType, unsigned int MaxDates>
+class FixedSizeGapFillingFunctorBase
+{
+public:
+  using ValueType = typename PixelType::ValueType;
+  ValueType valid_value = ValueType{0};
+  ValueType invalid_pixel_return_value = ValueType{0};
+
+  FixedSizeGapFillingFunctorBase() : nb_input_dates{0}, nb_dates{0},
+                                     nb_output_dates{0}, same_dates{true} {}
+  FixedSizeGapFillingFunctorBase(const PixelType& d) : dv{d}, odv{d}
+  {
+    this->set_up();
+  }
+  FixedSizeGapFillingFunctorBase(const PixelType& d, const PixelType& od)
+    : dv{d}, odv{od}
+  {
+    this->set_up();
+  }
+
+  bool operator!=(const FixedSizeGapFillingFunctorBase a) const
+  {
+    return (this->dv != a.dv) || (this->odv != a.odv);
+  }
+
+  bool operator==(const FixedSizeGapFillingFunctorBase a) const
+  {
+    return !(*this != a);
+  }
+
+protected:
+  /// Interlace the input and output dates as create_tmp_data_interlace_dates does
+  void set_up()
+  {
+    nb_input_dates = dv.GetSize();
+    nb_output_dates = odv.GetSize();
+    if(nb_input_dates == 0 && nb_output_dates != 0)
+      throw std::invalid_argument("Output dates can not be used without input dates\n");
+    same_dates = (dv == odv);
+    nb_dates = same_dates ? nb_input_dates : nb_input_dates + nb_output_dates;
+    if(nb_dates > MaxDates)
+      {
+      std::stringstream  errmessg;
+      errmessg << "Too many dates for the fixed size gap filling: "
+               << nb_dates << " vs " << MaxDates << "\n";
+      throw
+        std::invalid_argument(errmessg.str());
+      }
+    unsigned int icount = 0;
+    unsigned int ocount = 0;
+    for(unsigned int dcount = 0; dcount < nb_dates; dcount++)
+      {
+      if(same_dates ||
+         (icount < nb_input_dates &&
+          (ocount == nb_output_dates || dv[icount] <= odv[ocount])))
+        {
+        dates[dcount] = dv[icount];
+        source[dcount] = icount;
+        icount++;
+        }
+      else
+        {
+        dates[dcount] = odv[ocount];
+        source[dcount] = -1;
+        ocount++;
+        }
+      }
+    // Output dates: first interlaced date with the same value, as
+    // extract_output_dates does
+    unsigned int in_count = 0;
+    unsigned int out_count = 0;
+    while(in_count < nb_dates && out_count < nb_output_dates)
+      {
+      if(same_dates || dates[in_count] == odv[out_count])
+        output_position[out_count++] = in_count;
+      ++in_count;
+      }
+  }
+
+  /** Shared part of the processing of a pixel. The interpolator is
+      called with the interlaced values, validity flags, dates, the
+      number of interlaced dates and the result pixel. */
+  template <typename InterpolatorType>
+  PixelType process(const PixelType& pix, const PixelType& mask,
+                    InterpolatorType interpolator) const
+  {
+    unsigned int nbDates = nb_input_dates;
+    if(nbDates == 0) nbDates = pix.GetSize();
+    if(nbDates != mask.GetSize())
+      throw std::invalid_argument("Pixel and mask have different sizes\n");
+    if(nbDates != pix.GetSize())
+      {
+      std::stringstream  errmessg;
+      errmessg << "Pixel and date vector have different sizes: "
+               << pix.GetSize() << " vs " << nbDates << "\n";
+      throw
+        std::invalid_argument(errmessg.str());
+      }
+    if(nbDates > MaxDates)
+      {
+      std::stringstream  errmessg;
+      errmessg << "Too many dates for the fixed size gap filling: "
+               << nbDates << " vs " << MaxDates << "\n";
+      throw
+        std::invalid_argument(errmessg.str());
+      }
+    // Without date vector, the dates are the indices of the components
+    const bool index_dates = (nb_input_dates == 0);
+    const unsigned int nbInterlacedDates = index_dates ? nbDates : nb_dates;
+    const unsigned int nbOutputDates = index_dates ? nbDates : nb_output_dates;
+
+    ValueType values[MaxDates];
+    ValueType tmp_dates[MaxDates];
+    bool valid[MaxDates];
+    bool all_valid{true};
+    bool any_valid{false};
+    for(unsigned int i=0; i<nbInterlacedDates; i++)
+      {
+      auto src = index_dates ? static_cast<int>(i) : source[i];
+      tmp_dates[i] = index_dates ? ValueType(i) : dates[i];
+      if(src >= 0)
+        {
+        values[i] = pix[src];
+        valid[i] = (mask[src]==(valid_value));
+        all_valid = all_valid && valid[i];
+        }
+      else
+        {
+        values[i] = ValueType{0};
+        valid[i] = false;
+        }
+      any_valid = any_valid || valid[i];
+      }
+    // If the mask says all dates are valid and the input and output
+    // dates are the same, keep the original value
+    if(all_valid && (index_dates || same_dates)) return pix;
+    // invalid pixel?
+    if(!any_valid)
+      {
+      PixelType invalidpix{nbOutputDates};
+      invalidpix.Fill(invalid_pixel_return_value);
+      return invalidpix;
+      }
+
+    ValueType interpolated[MaxDates];
+    interpolator(values, valid, tmp_dates, nbInterlacedDates, interpolated);
+
+    PixelType result{nbOutputDates};
+    for(unsigned int i=0; i<nbOutputDates; i++)
+      result[i] = interpolated[index_dates ? i : output_position[i]];
+    return result;
+  }
+
+  /// For each date, the position of the last (resp. next) valid date
+  static void valid_bounds(const bool* valid, unsigned int nbDates,
+                           int* last_valid, int* next_valid)
+  {
+    int lv{-1};
+    int nv{static_cast<int>(nbDates)};
+    for(unsigned int i=0; i<nbDates; i++)
+      {
+      if(valid[i]) lv=i;
+      last_valid[i] = lv;
+      auto j = nbDates-1-i;
+      if(valid[j]) nv=j;
+      next_valid[j] = nv;
+      }
+  }
+
+  /// Input date vector
+  PixelType dv;
+  /// Output date vector
+  PixelType odv;
+  unsigned int nb_input_dates;
+  /// Number of interlaced dates
+  unsigned int nb_dates;
+  unsigned int nb_output_dates;
+  bool same_dates;
+  /// Interlaced dates
+  ValueType dates[MaxDates];
+  /// Position in the input pixel of each interlaced date, -1 for output only dates
+  int source[MaxDates];
+  /// Position in the interlaced series of each output date
+  unsigned int output_position[MaxDates];
+};
+
+/// Fixed size version of LinearGapFillingFunctor
+template <typename PixelType, unsigned int MaxDates>
+class FixedSizeLinearGapFillingFunctor
+  : public FixedSizeGapFillingFunctorBase<PixelType, MaxDates>
+{
+public:
+  using Superclass = FixedSizeGapFillingFunctorBase<PixelType, MaxDates>;
+  using ValueType = typename Superclass::ValueType;
+  FixedSizeLinearGapFillingFunctor() = default;
+  FixedSizeLinearGapFillingFunctor(const PixelType& d) : Superclass(d) {}
+  FixedSizeLinearGapFillingFunctor(const PixelType& d, const PixelType& od)
+    : Superclass(d, od) {}
+
+  // valid pixel has a mask==0
+  PixelType operator()(PixelType pix, PixelType mask) const
+  {
+    return this->process(pix, mask, &FixedSizeLinearGapFillingFunctor::interpolate);
+  }
+
+protected:
+  static void interpolate(const ValueType* p, const bool* valid, const ValueType* d,
+                          unsigned int nbDates, ValueType* result)
+  {
+    int lv[MaxDates];
+    int nv[MaxDates];
+    Superclass::valid_bounds(valid, nbDates, lv, nv);
+    for(unsigned int i=0; i<nbDates; i++)
+      {
+      auto lvp = lv[i];
+      auto nvp = nv[i];
+      if(valid[i])
+        result[i] = p[i];
+      // If there is no previous valid value, just use the next one
+      else if(lvp==-1)
+        result[i] = p[nvp];
+      // If there is no next valid value, just use the last one
+      else if(nvp==static_cast<int>(nbDates))
+        result[i] = p[lvp];
+      // Otherwise, use linear interpolation
+      else
+        {
+        double x1 = d[lvp];
+        double y1 = p[lvp];
+        double x2 = d[nvp];
+        double y2 = p[nvp];
+        double a = (y2-y1)/(x2-x1);
+        double b = ((y1+y2)*(x2-x1)-(y2-y1)*(x2+x1))/(2*(x2-x1));
+
+        result[i] = a*d[i]+b;
+        }
+      }
+  }
+};
+
+/** Fixed size version of SplineGapFillingFunctor. The linear, natural
+    cubic (3 or 4 valid dates) and Akima (5 or more valid dates)
+    interpolations use the same formulas as gsl_interp_linear,
+    gsl_interp_cspline and gsl_interp_akima, without allocations. */
+template <typename PixelType, unsigned int MaxDates>
+class FixedSizeSplineGapFillingFunctor
+  : public FixedSizeGapFillingFunctorBase<PixelType, MaxDates>
+{
+public:
+  using Superclass = FixedSizeGapFillingFunctorBase<PixelType, MaxDates>;
+  using ValueType = typename Superclass::ValueType;
+  FixedSizeSplineGapFillingFunctor() = default;
+  FixedSizeSplineGapFillingFunctor(const PixelType& d) : Superclass(d) {}
+  FixedSizeSplineGapFillingFunctor(const PixelType& d, const PixelType& od)
+    : Superclass(d, od) {}
+
+  // valid pixel has a mask==0
+  PixelType operator()(PixelType pix, PixelType mask) const
+  {
+    return this->process(pix, mask, &FixedSizeSplineGapFillingFunctor::interpolate);
+  }
+
+protected:
+  static void interpolate(const ValueType* p, const bool* valid, const ValueType* d,
+                          unsigned int nbDates, ValueType* result)
+  {
+    // The valid dates are the knots of the spline
+    double x[MaxDates];
+    double y[MaxDates];
+    int knot[MaxDates];
+    unsigned int n{0};
+    for(unsigned int i=0; i<nbDates; i++)
+      {
+      if(valid[i])
+        {
+        x[n] = d[i];
+        y[n] = p[i];
+        n++;
+        }
+      knot[i] = static_cast<int>(n)-1;
+      }
+    if(n < 2)
+      {
+      std::copy(p, p+nbDates, result);
+      return;
+      }
+
+    // Polynomial coefficients of each interval
+    double b[MaxDates];
+    double c[MaxDates];
+    double e[MaxDates];
+    if(n == 2)
+      {
+      b[0] = (y[1]-y[0])/(x[1]-x[0]);
+      c[0] = e[0] = 0.0;
+      }
+    else if(n < 5)
+      natural_cubic(x, y, n, b, c, e);
+    else
+      akima(x, y, n, b, c, e);
+
+    int lv[MaxDates];
+    int nv[MaxDates];
+    Superclass::valid_bounds(valid, nbDates, lv, nv);
+    for(unsigned int i=0; i<nbDates; i++)
+      {
+      auto lvp = lv[i];
+      auto nvp = nv[i];
+      if(valid[i])
+        result[i] = p[i];
+      // If there is no previous valid value, just use the next one
+      else if(lvp==-1)
+        result[i] = p[nvp];
+      // If there is no next valid value, just use the last one
+      else if(nvp==static_cast<int>(nbDates))
+        result[i] = p[lvp];
+      // Otherwise, use spline interpolation
+      else
+        {
+        auto k = knot[i];
+        double delx = d[i] - x[k];
+        result[i] = y[k] + delx * (b[k] + delx * (c[k] + e[k] * delx));
+        }
+      }
+  }
+
+  static void natural_cubic(const double* x, const double* y, unsigned int n,
+                            double* b, double* c, double* e)
+  {
+    // symmetric tridiagonal system for the second order coefficients
+    const unsigned int sys_size = n-2;
+    double diag[MaxDates];
+    double offdiag[MaxDates];
+    double g[MaxDates];
+    double cc[MaxDates];
+    for(unsigned int i=0; i<sys_size; i++)
+      {
+      const double h_i = x[i+1]-x[i];
+      const double h_ip1 = x[i+2]-x[i+1];
+      const double g_i = (h_i != 0.0) ? 1.0/h_i : 0.0;
+      const double g_ip1 = (h_ip1 != 0.0) ? 1.0/h_ip1 : 0.0;
+      offdiag[i] = h_ip1;
+      diag[i] = 2.0*(h_ip1+h_i);
+      g[i] = 3.0*((y[i+2]-y[i+1])*g_ip1 - (y[i+1]-y[i])*g_i);
+      }
+    // forward elimination and back substitution
+    for(unsigned int i=1; i<sys_size; i++)
+      {
+      const double f = offdiag[i-1]/diag[i-1];
+      diag[i] -= f*offdiag[i-1];
+      g[i] -= f*g[i-1];
+      }
+    cc[0] = 0.0;
+    cc[n-1] = 0.0;
+    for(unsigned int i=sys_size; i-- > 0;)
+      {
+      cc[i+1] = g[i];
+      if(i+1 < sys_size)
+        cc[i+1] -= offdiag[i]*cc[i+2];
+      cc[i+1] /= diag[i];
+      }
+    for(unsigned int i=0; i<n-1; i++)
+      {
+      const double dx = x[i+1]-x[i];
+      const double dy = y[i+1]-y[i];
+      b[i] = dy/dx - dx*(cc[i+1]+2.0*cc[i])/3.0;
+      c[i] = cc[i];
+      e[i] = (cc[i+1]-cc[i])/(3.0*dx);
+      }
+  }
+
+  static void akima(const double* x, const double* y, unsigned int n,
+                    double* b, double* c, double* e)
+  {
+    // slopes, shifted by 2 so that m[-2] and m[-1] can be addressed
+    double mm[MaxDates+3];
+    double* m = mm+2;
+    for(unsigned int i=0; i+1<n; i++)
+      m[i] = (y[i+1]-y[i])/(x[i+1]-x[i]);
+    m[-2] = 3.0*m[0] - 2.0*m[1];
+    m[-1] = 2.0*m[0] - m[1];
+    m[n-1] = 2.0*m[n-2] - m[n-3];
+    m[n] = 3.0*m[n-2] - 2.0*m[n-3];
+    for(int i=0; i+1<static_cast<int>(n); i++)
+      {
+      const double NE = fabs(m[i+1]-m[i]) + fabs(m[i-1]-m[i-2]);
+      if(NE == 0.0)
+        {
+        b[i] = m[i];
+        c[i] = 0.0;
+        e[i] = 0.0;
+        }
+      else
+        {
+        const double h_i = x[i+1]-x[i];
+        const double NE_next = fabs(m[i+2]-m[i+1]) + fabs(m[i]-m[i-1]);
+        const double alpha_i = fabs(m[i-1]-m[i-2])/NE;
+        double tL_ip1 = m[i];
+        if(NE_next != 0.0)
+          {
+          const double alpha_ip1 = fabs(m[i]-m[i-1])/NE_next;
+          tL_ip1 = (1.0-alpha_ip1)*m[i] + alpha_ip1*m[i+1];
+          }
+        b[i] = (1.0-alpha_i)*m[i-1] + alpha_i*m[i];
+        c[i] = (3.0*m[i] - 2.0*b[i] - tL_ip1)/h_i;
+        e[i] = (b[i] + tL_ip1 - 2.0*m[i])/(h_i*h_i);
+        }
+      }
+  }
+};
+
 /**
 Adapts a functor operating on time series so that it can work with
 series which have several components per date. The p2 pixel can have
@@ -605,6 +1026,18 @@ private:
   FunctorType m_Functor;
 };
 
+/// Read a date file (one YYYYMMDD date per line) as a pixel of days of year
+template <typename TPixel>
+TPixel read_doy_file(std::string date_file)
+{
+  using TValue = typename TPixel::ValueType;
+  auto date_vec = pheno::parse_date_file(date_file);
+  std::vector<TValue> doy_vector(date_vec.size(), TValue{0});
+  std::transform(std::begin(date_vec), std::end(date_vec),
+                 std::begin(doy_vector), pheno::doy);
+  return TPixel(doy_vector.data(), doy_vector.size());
+}
+
 /**
 The gapfill_time_series function takes 2 input time series files (the
 image data and the mask data) and produces an output file (the
@@ -631,26 +1064,17 @@ void gapfill_time_series(std::string ima_name, std::string mask_name,
   readerMask->SetFileName(mask_name);
 
   using TPixel = typename ImageType::PixelType;
-  using TValue = typename TPixel::ValueType;
   TPixel dv, odv;
   if(date_file != "")
     {
     std::cout << "Using date file " << date_file << std::endl;
-    auto date_vec = pheno::parse_date_file(date_file);
-    std::vector<TValue> doy_vector(date_vec.size(), TValue{0});
-    std::transform(std::begin(date_vec), std::end(date_vec),
-                   std::begin(doy_vector), pheno::doy);
-    dv = TPixel(doy_vector.data(), doy_vector.size());
+    dv = read_doy_file<TPixel>(date_file);
     odv = dv;
     }
   if(out_date_file != "")
     {
     std::cout << "Using output date file " << out_date_file << std::endl;
-    auto date_vec = pheno::parse_date_file(out_date_file);
-    std::vector<TValue> doy_vector(date_vec.size(), TValue{0});
-    std::transform(std::begin(date_vec), std::end(date_vec),
-                   std::begin(doy_vector), pheno::doy);
-    odv = TPixel(doy_vector.data(), doy_vector.size());
+    odv = read_doy_file<TPixel>(out_date_file);
     }
   using MultiComponentFunctorType =
     MultiComponentTimeSeriesFunctorAdaptor<typename ImageType::PixelType,
@@ -695,6 +1119,52 @@ void gapfill_time_series(std::string ima_name, std::string mask_name,
   writer->Update();
 }
 
+/**
+Same as gapfill_time_series, but uses the fixed size version of the
+functor (FixedSizeFunctorType<PixelType, N>, with N = 16, 32 or 64) when
+the interlaced input and output dates fit in it, and FunctorType
+otherwise.
+*/
+template <typename ImageType,
+          template <typename, unsigned int> class FixedSizeFunctorType,
+          typename FunctorType>
+void gapfill_time_series_fixed_size(std::string ima_name, std::string mask_name,
+                                    std::string out_name,
+                                    size_t components_per_date = 1,
+                                    std::string date_file="",
+                                    std::string out_date_file="")
+{
+  using TPixel = typename ImageType::PixelType;
+  // The fixed size functors need the input dates when output dates are given
+  unsigned int nbDates{std::numeric_limits<unsigned int>::max()};
+  if(date_file != "")
+    {
+    auto dv = read_doy_file<TPixel>(date_file);
+    auto odv = (out_date_file != "") ? read_doy_file<TPixel>(out_date_file) : dv;
+    nbDates = (dv == odv) ? dv.GetSize() : dv.GetSize() + odv.GetSize();
+    }
+  else if(out_date_file == "")
+    {
+    auto reader = otb::ImageFileReader<ImageType>::New();
+    reader->SetFileName(ima_name);
+    reader->UpdateOutputInformation();
+    nbDates = reader->GetOutput()->GetNumberOfComponentsPerPixel()/components_per_date;
+    }
+
+  if(nbDates <= 16)
+    gapfill_time_series<ImageType, FixedSizeFunctorType<TPixel, 16>>(
+      ima_name, mask_name, out_name, components_per_date, date_file, out_date_file);
+  else if(nbDates <= 32)
+    gapfill_time_series<ImageType, FixedSizeFunctorType<TPixel, 32>>(
+      ima_name, mask_name, out_name, components_per_date, date_file, out_date_file);
+  else if(nbDates <= 64)
+    gapfill_time_series<ImageType, FixedSizeFunctorType<TPixel, 64>>(
+      ima_name, mask_name, out_name, components_per_date, date_file, out_date_file);
+  else
+    gapfill_time_series<ImageType, FunctorType>(
+      ima_name, mask_name, out_name, components_per_date, date_file, out_date_file);
+}
+
 }//GapFilling namespace
 
 #endif
@@ -0,0 +1,102 @@
+/*=========================================================================
+  *
+  * Program:      Sen2agri-Processors
+  * Language:     C++
+  * Copyright:    2015-2016, CS Romania, office@c-s.ro
+  * See COPYRIGHT file for details.
+  *
+  * Unless required by applicable law or agreed to in writing, software
+  * distributed under the License is distributed on an "AS IS" BASIS,
+  * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  * See the License for the specific language governing permissions and
+  * limitations under the License.
+
+ =========================================================================*/
+
+#include "otbGapfillingTests.h"
+#include <random>
+
+// The fixed size functors must give the same results as the generic ones,
+// with and without output dates
+template <typename GFF, typename FSGFF>
+int compareFixedSize(double tolerance)
+{
+  std::mt19937 rng(3);
+  std::uniform_real_distribution<> u(0.0, 1.0);
+  for(auto it=0; it<2000; it++)
+    {
+    size_t nbDates = 2+it%20;
+    size_t nbOutputDates = 1+it%15;
+    VectorType d(nbDates), od(nbOutputDates), p(nbDates), m(nbDates);
+    double t{0};
+    for(auto& x : d)
+      {
+      t += 1+10*u(rng);
+      x = std::floor(t);
+      }
+    t = 0;
+    for(auto& x : od)
+      {
+      t += 1+14*u(rng);
+      x = std::floor(t);
+      }
+    for(size_t i=0; i<nbDates; i++)
+      {
+      p[i] = u(rng);
+      m[i] = (u(rng) < 0.4) ? 1 : 0;
+      }
+    PixelType dat(d.data(), d.size());
+    PixelType odat(od.data(), od.size());
+    PixelType pix(p.data(), p.size());
+    PixelType mask(m.data(), m.size());
+
+    PixelType res, expect;
+    switch(it%3)
+      {
+      case 0:
+        expect = GFF{dat}(pix, mask);
+        res = FSGFF{dat}(pix, mask);
+        break;
+      case 1:
+        expect = GFF{dat, odat}(pix, mask);
+        res = FSGFF{dat, odat}(pix, mask);
+        break;
+      default:
+        expect = GFF{}(pix, mask);
+        res = FSGFF{}(pix, mask);
+      }
+
+    bool ok = (res.GetSize() == expect.GetSize());
+    for(size_t i=0; ok && i<res.GetSize(); i++)
+      ok = fabs(res[i]-expect[i]) <= tolerance;
+    if(!ok)
+      {
+      std::cout << "m" << mask << std::endl;
+      std::cout << "p" << pix << std::endl;
+      std::cout << "d" << dat << std::endl;
+      std::cout << "o" << odat << std::endl;
+      std::cout << "e" << expect << std::endl;;
+      std::cout << "r" << res << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  return EXIT_SUCCESS;
+}
+
+int fixedSizeGapfillingTest(int argc, char * argv[])
+{
+ if(argc>1)
+    {
+    for(auto i=0; i<argc; ++i)
+      std::cout << i << " --> " << argv[i] << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if(compareFixedSize<GapFilling::LinearGapFillingFunctor<PixelType>,
+                      GapFilling::FixedSizeLinearGapFillingFunctor<PixelType, 64>>(1e-12)
+     != EXIT_SUCCESS)
+    return EXIT_FAILURE;
+
+  return compareFixedSize<GapFilling::SplineGapFillingFunctor<PixelType>,
+                          GapFilling::FixedSizeSplineGapFillingFunctor<PixelType, 64>>(1e-9);
+}
@@ -42,4 +42,5 @@ void RegisterTests()
   REGISTER_TEST(linearWithOutputDatesGapfillingTest);
   REGISTER_TEST(linearWithRealDates);
   REGISTER_TEST(splineWithRealDates);
+  REGISTER_TEST(fixedSizeGapfillingTest);
 }